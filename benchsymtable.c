@@ -0,0 +1,1691 @@
+/*--------------------------------------------------------------------*/
+/* benchsymtable.c                                                    */
+/* Author: Maxwell Lloyd                                              */
+/*--------------------------------------------------------------------*/
+
+/* clock_gettime is POSIX */
+#define _POSIX_C_SOURCE 200809L
+#ifdef BENCH_HUGE
+/* syscall, to read the TLB miss counter, is not */
+#define _DEFAULT_SOURCE
+#endif
+
+#include "symtable.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+#include <stdint.h>
+#include <time.h>
+
+#ifdef BENCH_LOG
+#include "symtablelog.h"
+#endif
+#ifdef BENCH_INT
+#include "symtableint.h"
+#endif
+#if defined(BENCH_CACHE) || defined(BENCH_TTL) || defined(BENCH_COLLIDE) \
+   || defined(BENCH_PARALLEL) || defined(BENCH_INLINE) \
+   || defined(BENCH_COMPACT)
+#include "symtablehash.h"
+#endif
+#ifdef BENCH_HANDLE
+#include "symtablehandle.h"
+#endif
+#ifdef BENCH_DISK
+#include "symtabledisk.h"
+#endif
+#ifdef BENCH_PARALLEL
+#include <unistd.h>
+#endif
+#ifdef BENCH_HUGE
+#include "symtablehuge.h"
+#if defined(__linux__)
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+#endif
+
+/* Name of the implementation being measured, given by the Makefile */
+#ifndef SYMTABLE_BACKEND
+#define SYMTABLE_BACKEND "unknown"
+#endif
+
+/*--------------------------------------------------------------------*/
+
+enum {MAX_KEY_LENGTH = 300};
+
+/* Length of every key in the long key workload */
+enum {LONG_KEY_LENGTH = 256};
+
+/* Number of bindings in each table of the small tables workload */
+enum {SMALL_TABLE_SIZE = 50};
+
+/* Workloads that keep every key in memory at once stop here */
+enum {MAX_LONG_KEY_COUNT = 1000000};
+
+/*--------------------------------------------------------------------*/
+
+/* Latency in nanoseconds of each operation of the current workload */
+static uint32_t *puLatencies;
+
+/* Number of operations timed in the current workload */
+static size_t uOps;
+
+/* Value stored in every binding; the values themselves are not
+   measured */
+static char acValue[] = "value";
+
+/* State of the random number generator */
+static uint64_t uRandomState = UINT64_C(88172645463325252);
+
+/*--------------------------------------------------------------------*/
+
+/* Return the current time in nanoseconds. */
+
+static uint64_t now(void)
+{
+   struct timespec sTime;
+   clock_gettime(CLOCK_MONOTONIC, &sTime);
+   return (uint64_t)sTime.tv_sec * UINT64_C(1000000000)
+      + (uint64_t)sTime.tv_nsec;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Record that an operation started at uStart has just finished. */
+
+static void record(uint64_t uStart)
+{
+   uint64_t uElapsed = now() - uStart;
+   puLatencies[uOps++] = (uElapsed > UINT32_MAX) ? UINT32_MAX
+      : (uint32_t)uElapsed;
+}
+
+/*--------------------------------------------------------------------*/
+
+#if defined(BENCH_PARALLEL) || defined(BENCH_COMPACT)
+/* Record that uCount operations done together, started at uStart,
+   have just finished, each taking an equal share of the time. */
+
+static void recordBulk(uint64_t uStart, size_t uCount)
+{
+   uint64_t uElapsed = now() - uStart;
+   uint64_t uShare;
+   size_t u;
+
+   assert(uCount != 0);
+
+   uShare = uElapsed / uCount;
+   for (u = 0; u < uCount; u++)
+      puLatencies[uOps++] = (uShare > UINT32_MAX) ? UINT32_MAX
+         : (uint32_t)uShare;
+}
+#endif
+
+/*--------------------------------------------------------------------*/
+
+/* Return a pseudo-random number. */
+
+static uint64_t randomNumber(void)
+{
+   uRandomState ^= uRandomState >> 12;
+   uRandomState ^= uRandomState << 25;
+   uRandomState ^= uRandomState >> 27;
+   return uRandomState * UINT64_C(2685821657736338717);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return a random rank between 0 and uCount-1, with rank r drawn about
+   as often as 1/(r+1)^0.99, the skew of typical access traces. This
+   inverts the continuous approximation of the Zipf distribution. */
+
+static size_t zipfRank(size_t uCount)
+{
+   const double SKEW = 0.99;
+   double dUniform;
+   double dRank;
+
+   dUniform = (double)(randomNumber() >> 11) / 9007199254740992.0;
+   dRank = pow((pow((double)uCount + 1.0, 1.0 - SKEW) - 1.0) * dUniform
+      + 1.0, 1.0 / (1.0 - SKEW)) - 1.0;
+   if (dRank >= (double)uCount)
+      return uCount - 1;
+   return (size_t)dRank;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return a new array holding 0 to uCount-1 in random order. */
+
+static size_t *newPermutation(size_t uCount)
+{
+   size_t *puOrder;
+   size_t u;
+   size_t uOther;
+   size_t uTemp;
+
+   puOrder = (size_t*)malloc((uCount + 1) * sizeof(size_t));
+   if (puOrder == NULL)
+   {
+      fprintf(stderr, "Out of memory\n");
+      exit(EXIT_FAILURE);
+   }
+   for (u = 0; u < uCount; u++)
+      puOrder[u] = u;
+   for (u = uCount; u > 1; u--)
+   {
+      uOther = (size_t)(randomNumber() % u);
+      uTemp = puOrder[u - 1];
+      puOrder[u - 1] = puOrder[uOther];
+      puOrder[uOther] = uTemp;
+   }
+   return puOrder;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Write the key numbered u, with the prefix pcPrefix, to acKey. */
+
+static void makeKey(char *acKey, const char *pcPrefix, size_t u)
+{
+   sprintf(acKey, "%s%lu", pcPrefix, (unsigned long)u);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Write the long key numbered u to acKey. The keys differ only at the
+   end, so comparing two of them reads most of both. */
+
+static void makeLongKey(char *acKey, size_t u)
+{
+   char acNumber[24];
+   size_t uLength;
+
+   sprintf(acNumber, "%lu", (unsigned long)u);
+   uLength = strlen(acNumber);
+   memset(acKey, 'k', LONG_KEY_LENGTH - uLength);
+   strcpy(acKey + LONG_KEY_LENGTH - uLength, acNumber);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Compare the latencies pointed to by pvFirst and pvSecond. */
+
+static int compareLatencies(const void *pvFirst, const void *pvSecond)
+{
+   uint32_t uFirst = *(const uint32_t*)pvFirst;
+   uint32_t uSecond = *(const uint32_t*)pvSecond;
+   return (uFirst > uSecond) - (uFirst < uSecond);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Write one result line for the operations timed since the workload
+   pcWorkload started on a table of uSize bindings, then start the next
+   workload. */
+
+static void report(const char *pcWorkload, size_t uSize)
+{
+   double dTotal = 0.0;
+   size_t u;
+
+   assert(pcWorkload != NULL);
+
+   if (uOps == 0)
+      return;
+   for (u = 0; u < uOps; u++)
+      dTotal += puLatencies[u];
+   qsort(puLatencies, uOps, sizeof(uint32_t), compareLatencies);
+
+   printf("%s,%s,%lu,%lu,%.1f,%lu,%lu,%lu\n", SYMTABLE_BACKEND,
+      pcWorkload, (unsigned long)uSize, (unsigned long)uOps,
+      dTotal / (double)uOps,
+      (unsigned long)puLatencies[uOps * 50 / 100],
+      (unsigned long)puLatencies[uOps * 99 / 100],
+      (unsigned long)puLatencies[uOps * 999 / 1000]);
+   fflush(stdout);
+   uOps = 0;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Measure the cost of timing an operation that does nothing, which is
+   included in every latency reported. */
+
+static void benchTimer(void)
+{
+   enum {TIMER_OPS = 100000};
+   uint64_t uStart;
+   size_t u;
+
+   for (u = 0; u < TIMER_OPS; u++)
+   {
+      uStart = now();
+      record(uStart);
+   }
+   report("timer", 0);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Measure puts, gets of present keys in order and in random order,
+   gets of absent keys, Zipf-skewed gets, and removals, on a table of
+   uCount bindings. */
+
+static void benchLookups(size_t uCount)
+{
+   SymTable_T oSymTable;
+   char acKey[MAX_KEY_LENGTH];
+   size_t *puOrder;
+   uint64_t uStart;
+   size_t u;
+
+   puOrder = newPermutation(uCount);
+
+   oSymTable = SymTable_new();
+   assert(oSymTable != NULL);
+   for (u = 0; u < uCount; u++)
+   {
+      makeKey(acKey, "", u);
+      uStart = now();
+      SymTable_put(oSymTable, acKey, acValue);
+      record(uStart);
+   }
+   report("put-seq", uCount);
+
+   for (u = 0; u < uCount; u++)
+   {
+      makeKey(acKey, "", u);
+      uStart = now();
+      SymTable_get(oSymTable, acKey);
+      record(uStart);
+   }
+   report("get-hit-seq", uCount);
+
+   for (u = 0; u < uCount; u++)
+   {
+      makeKey(acKey, "", puOrder[u]);
+      uStart = now();
+      SymTable_get(oSymTable, acKey);
+      record(uStart);
+   }
+   report("get-hit-rand", uCount);
+
+   for (u = 0; u < uCount; u++)
+   {
+      makeKey(acKey, "", uCount + puOrder[u]);
+      uStart = now();
+      SymTable_get(oSymTable, acKey);
+      record(uStart);
+   }
+   report("get-miss", uCount);
+
+   /* The hot keys are scattered over the table, not the first ones */
+   for (u = 0; u < uCount; u++)
+   {
+      makeKey(acKey, "", puOrder[zipfRank(uCount)]);
+      uStart = now();
+      SymTable_get(oSymTable, acKey);
+      record(uStart);
+   }
+   report("get-zipf", uCount);
+
+   for (u = 0; u < uCount; u++)
+   {
+      makeKey(acKey, "", puOrder[u]);
+      uStart = now();
+      SymTable_remove(oSymTable, acKey);
+      record(uStart);
+   }
+   report("remove-rand", uCount);
+   SymTable_free(oSymTable);
+
+   oSymTable = SymTable_new();
+   assert(oSymTable != NULL);
+   for (u = 0; u < uCount; u++)
+   {
+      makeKey(acKey, "", puOrder[u]);
+      uStart = now();
+      SymTable_put(oSymTable, acKey, acValue);
+      record(uStart);
+   }
+   report("put-rand", uCount);
+   SymTable_free(oSymTable);
+
+   free(puOrder);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Measure a table that stays at uCount bindings while each operation
+   removes the oldest binding and puts a new one. */
+
+static void benchChurn(size_t uCount)
+{
+   SymTable_T oSymTable;
+   char acKey[MAX_KEY_LENGTH];
+   uint64_t uStart;
+   size_t u;
+
+   oSymTable = SymTable_new();
+   assert(oSymTable != NULL);
+   for (u = 0; u < uCount; u++)
+   {
+      makeKey(acKey, "", u);
+      SymTable_put(oSymTable, acKey, acValue);
+   }
+
+   for (u = 0; u < uCount; u++)
+   {
+      makeKey(acKey, "", u);
+      uStart = now();
+      SymTable_remove(oSymTable, acKey);
+      record(uStart);
+      makeKey(acKey, "", uCount + u);
+      uStart = now();
+      SymTable_put(oSymTable, acKey, acValue);
+      record(uStart);
+   }
+   report("churn", uCount);
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Measure puts and gets of uCount long keys. */
+
+static void benchLongKeys(size_t uCount)
+{
+   SymTable_T oSymTable;
+   char acKey[MAX_KEY_LENGTH];
+   uint64_t uStart;
+   size_t u;
+
+   if (uCount > MAX_LONG_KEY_COUNT)
+      uCount = MAX_LONG_KEY_COUNT;
+
+   oSymTable = SymTable_new();
+   assert(oSymTable != NULL);
+   for (u = 0; u < uCount; u++)
+   {
+      makeLongKey(acKey, u);
+      uStart = now();
+      SymTable_put(oSymTable, acKey, acValue);
+      record(uStart);
+   }
+   for (u = 0; u < uCount; u++)
+   {
+      makeLongKey(acKey, u);
+      uStart = now();
+      SymTable_get(oSymTable, acKey);
+      record(uStart);
+   }
+   report("long-keys", uCount);
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Measure creating, filling, reading and freeing uCount bindings
+   spread over tables of SMALL_TABLE_SIZE bindings each. */
+
+static void benchSmallTables(size_t uCount)
+{
+   SymTable_T oSymTable;
+   char acKey[MAX_KEY_LENGTH];
+   uint64_t uStart;
+   size_t uTable;
+   size_t u;
+
+   for (uTable = 0; uTable * SMALL_TABLE_SIZE < uCount; uTable++)
+   {
+      uStart = now();
+      oSymTable = SymTable_new();
+      record(uStart);
+      assert(oSymTable != NULL);
+      for (u = 0; u < SMALL_TABLE_SIZE; u++)
+      {
+         makeKey(acKey, "", u);
+         uStart = now();
+         SymTable_put(oSymTable, acKey, acValue);
+         record(uStart);
+      }
+      for (u = 0; u < SMALL_TABLE_SIZE; u++)
+      {
+         makeKey(acKey, "", u);
+         uStart = now();
+         SymTable_get(oSymTable, acKey);
+         record(uStart);
+      }
+      uStart = now();
+      SymTable_free(oSymTable);
+      record(uStart);
+   }
+   report("small-tables", uCount);
+}
+
+/*--------------------------------------------------------------------*/
+
+#ifdef BENCH_LOG
+/* Serialize the string pvValue, including its '\0'. */
+
+static size_t serializeString(const void *pvValue,
+   const void **ppvBytes)
+{
+   assert(ppvBytes != NULL);
+
+   *ppvBytes = pvValue;
+   if (pvValue == NULL)
+      return 0;
+   return strlen((const char*)pvValue) + 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Measure putting, replacing and then removing uCount bindings while
+   recording them in a log that is synced every uGroupSize changes, or
+   not recording them at all if uGroupSize is 0. */
+
+static void benchLog(size_t uCount, size_t uGroupSize)
+{
+   const char acPath[] = "benchsymtable.log";
+   SymTable_T oSymTable;
+   SymTableLog_T oSymTableLog = NULL;
+   char acKey[MAX_KEY_LENGTH];
+   char acWorkload[MAX_KEY_LENGTH];
+   uint64_t uStart;
+   size_t u;
+
+   oSymTable = SymTable_new();
+   assert(oSymTable != NULL);
+   if (uGroupSize != 0)
+   {
+      oSymTableLog = SymTableLog_open(oSymTable, acPath,
+         serializeString, uGroupSize);
+      assert(oSymTableLog != NULL);
+   }
+
+   for (u = 0; u < uCount; u++)
+   {
+      makeKey(acKey, "", u);
+      uStart = now();
+      if (oSymTableLog == NULL)
+         SymTable_put(oSymTable, acKey, acValue);
+      else
+         SymTableLog_put(oSymTableLog, acKey, acValue);
+      record(uStart);
+   }
+   for (u = 0; u < uCount; u++)
+   {
+      makeKey(acKey, "", u);
+      uStart = now();
+      if (oSymTableLog == NULL)
+         SymTable_replace(oSymTable, acKey, acValue);
+      else
+         SymTableLog_replace(oSymTableLog, acKey, acValue);
+      record(uStart);
+   }
+   for (u = 0; u < uCount; u++)
+   {
+      makeKey(acKey, "", u);
+      uStart = now();
+      if (oSymTableLog == NULL)
+         SymTable_remove(oSymTable, acKey);
+      else
+         SymTableLog_remove(oSymTableLog, acKey);
+      record(uStart);
+   }
+   if (oSymTableLog != NULL)
+      SymTableLog_close(oSymTableLog);
+
+   sprintf(acWorkload, "log-group-%lu", (unsigned long)uGroupSize);
+   report((uGroupSize == 0) ? "log-off" : acWorkload, uCount);
+
+   SymTable_free(oSymTable);
+   remove(acPath);
+}
+#endif
+
+/*--------------------------------------------------------------------*/
+
+#ifdef BENCH_INT
+/* Measure numeric IDs as keys: first formatted with sprintf into a
+   string table, as the SymTable ADT requires, with the formatting
+   timed as part of each operation, then in a SymTableInt object. */
+
+static void benchIntKeys(size_t uCount)
+{
+   SymTable_T oSymTable;
+   SymTableInt_T oSymTableInt;
+   char acKey[MAX_KEY_LENGTH];
+   size_t *puOrder;
+   uint64_t uStart;
+   size_t u;
+
+   puOrder = newPermutation(uCount);
+
+   oSymTable = SymTable_new();
+   assert(oSymTable != NULL);
+   for (u = 0; u < uCount; u++)
+   {
+      uStart = now();
+      makeKey(acKey, "", puOrder[u]);
+      SymTable_put(oSymTable, acKey, acValue);
+      record(uStart);
+   }
+   report("id-string-put", uCount);
+
+   for (u = 0; u < uCount; u++)
+   {
+      uStart = now();
+      makeKey(acKey, "", puOrder[u]);
+      SymTable_get(oSymTable, acKey);
+      record(uStart);
+   }
+   report("id-string-get-hit", uCount);
+
+   for (u = 0; u < uCount; u++)
+   {
+      uStart = now();
+      makeKey(acKey, "", uCount + puOrder[u]);
+      SymTable_get(oSymTable, acKey);
+      record(uStart);
+   }
+   report("id-string-get-miss", uCount);
+   SymTable_free(oSymTable);
+
+   oSymTableInt = SymTableInt_new();
+   assert(oSymTableInt != NULL);
+   for (u = 0; u < uCount; u++)
+   {
+      uStart = now();
+      SymTableInt_put(oSymTableInt, (uint64_t)puOrder[u], acValue);
+      record(uStart);
+   }
+   report("id-int-put", uCount);
+
+   for (u = 0; u < uCount; u++)
+   {
+      uStart = now();
+      SymTableInt_get(oSymTableInt, (uint64_t)puOrder[u]);
+      record(uStart);
+   }
+   report("id-int-get-hit", uCount);
+
+   for (u = 0; u < uCount; u++)
+   {
+      uStart = now();
+      SymTableInt_get(oSymTableInt, (uint64_t)(uCount + puOrder[u]));
+      record(uStart);
+   }
+   report("id-int-get-miss", uCount);
+   SymTableInt_free(oSymTableInt);
+
+   free(puOrder);
+}
+#endif
+
+/*--------------------------------------------------------------------*/
+
+#ifdef BENCH_CACHE
+/* Length of every key of the cache workloads, with its '\0' */
+enum {CACHE_KEY_LENGTH = 24};
+
+/* Keys of the bindings a scan chose to evict */
+struct Victims{
+   /* CACHE_KEY_LENGTH bytes per key */
+   char *pcKeys;
+
+   /* Number of keys chosen so far, and the number wanted */
+   size_t uCount;
+   size_t uWanted;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Add pcKey to the Victims pointed to by pvExtra until it has as
+   many as it wants. pvValue is unused. */
+
+static void chooseVictim(const char *pcKey, void *pvValue, void *pvExtra)
+{
+   struct Victims *pVictims = (struct Victims*)pvExtra;
+
+   assert(pcKey != NULL);
+   assert(pVictims != NULL);
+   (void)pvValue;
+
+   if (pVictims->uCount < pVictims->uWanted)
+      strcpy(pVictims->pcKeys + CACHE_KEY_LENGTH * pVictims->uCount++,
+         pcKey);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Write the hit ratio of the cache workload pcWorkload to stderr,
+   so that stdout stays one line per workload. */
+
+static void reportHits(const char *pcWorkload, size_t uSize,
+   size_t uHits, size_t uLookups)
+{
+   fprintf(stderr, "%s,%s,%lu,hit_ratio,%.4f\n", SYMTABLE_BACKEND,
+      pcWorkload, (unsigned long)uSize,
+      (double)uHits / (double)uLookups);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Measure a memoization cache of uCount/10 bindings over uCount keys
+   looked up in a Zipf-skewed trace, where every miss puts its key.
+   First with SymTable_newBounded, which evicts by CLOCK, then with an
+   unbounded table that a SymTable_map scan trims by a tenth whenever
+   it fills, as callers had to do before. */
+
+static void benchCache(size_t uCount)
+{
+   SymTable_T oSymTable;
+   struct Victims victims;
+   char acKey[CACHE_KEY_LENGTH];
+   size_t uCapacity;
+   size_t uHits;
+   size_t uTrace;
+   uint64_t uStart;
+   size_t u;
+   size_t v;
+
+   uCapacity = (uCount < 10) ? 1 : uCount / 10;
+   uTrace = 2 * uCount;
+
+   oSymTable = SymTable_newBounded(uCapacity, NULL, NULL);
+   assert(oSymTable != NULL);
+   uHits = 0;
+   for (u = 0; u < uTrace; u++)
+   {
+      makeKey(acKey, "", zipfRank(uCount));
+      uStart = now();
+      if (SymTable_get(oSymTable, acKey) != NULL)
+         uHits++;
+      else
+         SymTable_put(oSymTable, acKey, acValue);
+      record(uStart);
+   }
+   report("cache-clock-zipf", uCount);
+   reportHits("cache-clock-zipf", uCount, uHits, uTrace);
+   SymTable_free(oSymTable);
+
+   victims.uWanted = (uCapacity < 10) ? 1 : uCapacity / 10;
+   victims.pcKeys = (char*)malloc(victims.uWanted * CACHE_KEY_LENGTH);
+   assert(victims.pcKeys != NULL);
+   oSymTable = SymTable_new();
+   assert(oSymTable != NULL);
+   uHits = 0;
+   for (u = 0; u < uTrace; u++)
+   {
+      makeKey(acKey, "", zipfRank(uCount));
+      uStart = now();
+      if (SymTable_get(oSymTable, acKey) != NULL)
+         uHits++;
+      else
+      {
+         if (SymTable_getLength(oSymTable) == uCapacity)
+         {
+            victims.uCount = 0;
+            SymTable_map(oSymTable, chooseVictim, &victims);
+            for (v = 0; v < victims.uCount; v++)
+               SymTable_remove(oSymTable,
+                  victims.pcKeys + CACHE_KEY_LENGTH * v);
+         }
+         SymTable_put(oSymTable, acKey, acValue);
+      }
+      record(uStart);
+   }
+   report("cache-scan-zipf", uCount);
+   reportHits("cache-scan-zipf", uCount, uHits, uTrace);
+   SymTable_free(oSymTable);
+   free(victims.pcKeys);
+}
+#endif
+
+/*--------------------------------------------------------------------*/
+
+#ifdef BENCH_TTL
+/* Keys of the expired bindings a sweep found, and the time it
+   sweeps at */
+struct Sweep{
+   /* MAX_KEY_LENGTH bytes per key */
+   char *pcKeys;
+
+   /* Number of keys found so far */
+   size_t uCount;
+
+   /* Bindings whose deadline is not after uNow have expired */
+   uint64_t uNow;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Add pcKey to the Sweep pointed to by pvExtra if its deadline, which
+   pvValue points to, has passed. */
+
+static void sweepExpired(const char *pcKey, void *pvValue, void *pvExtra)
+{
+   struct Sweep *pSweep = (struct Sweep*)pvExtra;
+
+   assert(pcKey != NULL);
+   assert(pvValue != NULL);
+   assert(pSweep != NULL);
+
+   if (*(uint64_t*)pvValue <= pSweep->uNow)
+      strcpy(pSweep->pcKeys + MAX_KEY_LENGTH * pSweep->uCount++, pcKey);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Measure expiring uCount bindings whose deadlines are spread over
+   uCount time units, one unit per operation: first with
+   SymTable_putWithTTL and SymTable_expire, then with deadlines stored
+   in the values and a SymTable_map sweep that removes the expired
+   bindings, as callers had to do before. The sweeps stop after
+   MAX_SWEEPS units, since each one visits every binding. */
+
+static void benchTTL(size_t uCount)
+{
+   enum {MAX_SWEEPS = 1000};
+
+   SymTable_T oSymTable;
+   struct Sweep sweep;
+   char acKey[MAX_KEY_LENGTH];
+   uint64_t *puDeadlines;
+   uint64_t uStart;
+   size_t u;
+   size_t v;
+
+   puDeadlines = (uint64_t*)malloc(uCount * sizeof(uint64_t));
+   assert(puDeadlines != NULL);
+   for (u = 0; u < uCount; u++)
+      puDeadlines[u] = 1 + randomNumber() % uCount;
+
+   oSymTable = SymTable_new();
+   assert(oSymTable != NULL);
+   for (u = 0; u < uCount; u++)
+   {
+      makeKey(acKey, "", u);
+      uStart = now();
+      SymTable_putWithTTL(oSymTable, acKey, &puDeadlines[u], 0,
+         puDeadlines[u]);
+      record(uStart);
+   }
+   report("ttl-put", uCount);
+
+   for (u = 1; u <= uCount; u++)
+   {
+      uStart = now();
+      SymTable_expire(oSymTable, (uint64_t)u, NULL, NULL);
+      record(uStart);
+   }
+   report("ttl-expire", uCount);
+   assert(SymTable_getLength(oSymTable) == 0);
+   SymTable_free(oSymTable);
+
+   sweep.pcKeys = (char*)malloc(uCount * MAX_KEY_LENGTH);
+   assert(sweep.pcKeys != NULL);
+   oSymTable = SymTable_new();
+   assert(oSymTable != NULL);
+   for (u = 0; u < uCount; u++)
+   {
+      makeKey(acKey, "", u);
+      SymTable_put(oSymTable, acKey, &puDeadlines[u]);
+   }
+   for (u = 1; u <= uCount && u <= MAX_SWEEPS; u++)
+   {
+      uStart = now();
+      sweep.uCount = 0;
+      sweep.uNow = (uint64_t)u;
+      SymTable_map(oSymTable, sweepExpired, &sweep);
+      for (v = 0; v < sweep.uCount; v++)
+         SymTable_remove(oSymTable, sweep.pcKeys + MAX_KEY_LENGTH * v);
+      record(uStart);
+   }
+   report("ttl-sweep", uCount);
+   SymTable_free(oSymTable);
+
+   free(sweep.pcKeys);
+   free(puDeadlines);
+}
+#endif
+
+/*--------------------------------------------------------------------*/
+
+#ifdef BENCH_HANDLE
+/* Measure replacing and then removing uCount bindings in random
+   order through the handles SymTable_putHandle gave for them, against
+   replacing them by key. Removing by key is remove-rand. */
+
+static void benchHandles(size_t uCount)
+{
+   SymTable_T oSymTable;
+   SymTable_Handle *poHandles;
+   char acKey[MAX_KEY_LENGTH];
+   size_t *puOrder;
+   uint64_t uStart;
+   size_t u;
+
+   puOrder = newPermutation(uCount);
+   poHandles = (SymTable_Handle*)malloc(uCount * sizeof(SymTable_Handle));
+   assert(poHandles != NULL);
+
+   oSymTable = SymTable_new();
+   assert(oSymTable != NULL);
+   for (u = 0; u < uCount; u++)
+   {
+      makeKey(acKey, "key", u);
+      poHandles[u] = SymTable_putHandle(oSymTable, acKey, acValue);
+   }
+
+   for (u = 0; u < uCount; u++)
+   {
+      makeKey(acKey, "key", puOrder[u]);
+      uStart = now();
+      SymTable_replace(oSymTable, acKey, acValue);
+      record(uStart);
+   }
+   report("replace-rand", uCount);
+
+   for (u = 0; u < uCount; u++)
+   {
+      uStart = now();
+      SymTable_handleReplace(oSymTable, poHandles[puOrder[u]], acValue);
+      record(uStart);
+   }
+   report("handle-replace-rand", uCount);
+
+   for (u = 0; u < uCount; u++)
+   {
+      uStart = now();
+      SymTable_handleRemove(oSymTable, poHandles[puOrder[u]]);
+      record(uStart);
+   }
+   report("handle-remove-rand", uCount);
+   SymTable_free(oSymTable);
+
+   free(poHandles);
+   free(puOrder);
+}
+#endif
+
+/*--------------------------------------------------------------------*/
+
+#ifdef BENCH_COLLIDE
+/* The collision workload runs at sizes up to this many keys */
+enum {MAX_COLLIDE_COUNT = 100000};
+
+/* Length of every colliding key, with its '\0', and the number of
+   characters its suffix draws from */
+enum {COLLIDE_KEY_LENGTH = 16, SUFFIX_CHARS = 94};
+
+/*--------------------------------------------------------------------*/
+
+/* Return the hash code symtablehash.c gives pcKey. */
+
+static size_t collideHash(const char *pcKey)
+{
+   size_t uHash = 0;
+   size_t u;
+
+   for (u = 0; pcKey[u] != '\0'; u++)
+      uHash = uHash * 65599 + (size_t)pcKey[u];
+   return uHash;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Fill pcKeys with uCount keys of COLLIDE_KEY_LENGTH bytes whose hash
+   codes are all multiples of uBuckets, so that they share one bucket
+   of a table of that many buckets. Each key is a numbered prefix and a
+   three character suffix chosen to cancel the prefix's hash code. */
+
+static void makeCollidingKeys(char *pcKeys, size_t uCount,
+   size_t uBuckets)
+{
+   const size_t HASH_MULTIPLIER = 65599;
+   uint32_t *puSuffixes;
+   size_t uMaxSuffix;
+   size_t uPrefixHash;
+   size_t uSuffix;
+   size_t uNeeded;
+   size_t uNumber;
+   size_t u;
+   char *pcKey;
+
+   puSuffixes = (uint32_t*)malloc(uBuckets * sizeof(uint32_t));
+   assert(puSuffixes != NULL);
+   memset(puSuffixes, 0xff, uBuckets * sizeof(uint32_t));
+
+   /* The suffix abc adds a*M^2 + b*M + c to the prefix's hash code
+      times M^3, where M is the multiplier; remember one suffix for
+      each value that sum takes modulo uBuckets */
+   for (u = 0; u < SUFFIX_CHARS * SUFFIX_CHARS * SUFFIX_CHARS; u++)
+   {
+      uSuffix = ((size_t)'!' + u / (SUFFIX_CHARS * SUFFIX_CHARS))
+         * HASH_MULTIPLIER * HASH_MULTIPLIER
+         + ((size_t)'!' + u / SUFFIX_CHARS % SUFFIX_CHARS)
+         * HASH_MULTIPLIER + ((size_t)'!' + u % SUFFIX_CHARS);
+      if (puSuffixes[uSuffix % uBuckets] == UINT32_MAX)
+         puSuffixes[uSuffix % uBuckets] = (uint32_t)u;
+   }
+   uMaxSuffix = (size_t)'~' * (HASH_MULTIPLIER * HASH_MULTIPLIER
+      + HASH_MULTIPLIER + 1);
+
+   uNumber = 0;
+   for (u = 0; u < uCount; uNumber++)
+   {
+      pcKey = pcKeys + COLLIDE_KEY_LENGTH * u;
+      makeKey(pcKey, "c", uNumber);
+      uPrefixHash = collideHash(pcKey) * HASH_MULTIPLIER
+         * HASH_MULTIPLIER * HASH_MULTIPLIER;
+      /* The sum must not wrap, or it is not a multiple any more */
+      if (uPrefixHash > (size_t)-1 - uMaxSuffix)
+         continue;
+      uNeeded = (uBuckets - uPrefixHash % uBuckets) % uBuckets;
+      if (puSuffixes[uNeeded] == UINT32_MAX)
+         continue;
+      uSuffix = puSuffixes[uNeeded];
+      pcKey += strlen(pcKey);
+      pcKey[0] = (char)('!' + uSuffix / (SUFFIX_CHARS * SUFFIX_CHARS));
+      pcKey[1] = (char)('!' + uSuffix / SUFFIX_CHARS % SUFFIX_CHARS);
+      pcKey[2] = (char)('!' + uSuffix % SUFFIX_CHARS);
+      pcKey[3] = '\0';
+      assert(collideHash(pcKeys + COLLIDE_KEY_LENGTH * u) % uBuckets
+         == 0);
+      u++;
+   }
+   free(puSuffixes);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Measure uCount keys that all land in one bucket, as a caller that
+   knows the hash function can arrange: putting them, getting them in
+   random order and removing them. Each chain walk would cost time in
+   proportion to the keys already put; the tree the chain gets keeps
+   it logarithmic. The table is reserved up front so that it does not
+   grow and scatter the keys. */
+
+static void benchCollisions(size_t uCount)
+{
+   struct SymTable_Stats stats;
+   SymTable_T oSymTable;
+   char *pcKeys;
+   size_t *puOrder;
+   uint64_t uStart;
+   size_t u;
+
+   if (uCount > MAX_COLLIDE_COUNT)
+      return;
+
+   oSymTable = SymTable_new();
+   assert(oSymTable != NULL);
+   SymTable_reserve(oSymTable, uCount);
+   SymTable_getStats(oSymTable, &stats);
+
+   pcKeys = (char*)malloc(uCount * COLLIDE_KEY_LENGTH);
+   assert(pcKeys != NULL);
+   makeCollidingKeys(pcKeys, uCount, stats.uBucketCount);
+   puOrder = newPermutation(uCount);
+
+   for (u = 0; u < uCount; u++)
+   {
+      uStart = now();
+      SymTable_put(oSymTable, pcKeys + COLLIDE_KEY_LENGTH * u, acValue);
+      record(uStart);
+   }
+   report("collide-put", uCount);
+
+   for (u = 0; u < uCount; u++)
+   {
+      uStart = now();
+      SymTable_get(oSymTable, pcKeys + COLLIDE_KEY_LENGTH * puOrder[u]);
+      record(uStart);
+   }
+   report("collide-get", uCount);
+
+   for (u = 0; u < uCount; u++)
+   {
+      uStart = now();
+      SymTable_remove(oSymTable, pcKeys + COLLIDE_KEY_LENGTH * puOrder[u]);
+      record(uStart);
+   }
+   report("collide-remove", uCount);
+   SymTable_free(oSymTable);
+
+   free(puOrder);
+   free(pcKeys);
+}
+#endif
+
+/*--------------------------------------------------------------------*/
+
+#ifdef BENCH_PARALLEL
+/* Length of every key of the build workloads, with its '\0' */
+enum {BUILD_KEY_LENGTH = 24};
+
+/*--------------------------------------------------------------------*/
+
+/* Measure building a table of uCount bindings in one go: by
+   SymTable_put into a table reserved for them, then by
+   SymTable_buildParallel with 1 to 16 threads. Each build is timed as
+   a whole and reported per binding. The times are only what this
+   machine gives; no scaling with the thread count is claimed, and the
+   number of CPUs online is reported with them, since threads beyond
+   it cannot run at once. */
+
+static void benchBuild(size_t uCount)
+{
+   static const size_t auThreads[] = {1, 2, 4, 8, 16};
+   SymTable_T oSymTable;
+   char *pcKeys;
+   const char **ppcKeys;
+   const void **ppvValues;
+   char acWorkload[MAX_KEY_LENGTH];
+   uint64_t uStart;
+   size_t u;
+
+   pcKeys = (char*)malloc(uCount * BUILD_KEY_LENGTH);
+   ppcKeys = (const char**)malloc(uCount * sizeof(const char*));
+   ppvValues = (const void**)malloc(uCount * sizeof(const void*));
+   assert(pcKeys != NULL && ppcKeys != NULL && ppvValues != NULL);
+   for (u = 0; u < uCount; u++)
+   {
+      makeKey(pcKeys + BUILD_KEY_LENGTH * u, "key", u);
+      ppcKeys[u] = pcKeys + BUILD_KEY_LENGTH * u;
+      ppvValues[u] = acValue;
+   }
+
+   uStart = now();
+   oSymTable = SymTable_new();
+   assert(oSymTable != NULL);
+   SymTable_reserve(oSymTable, uCount);
+   for (u = 0; u < uCount; u++)
+      SymTable_put(oSymTable, ppcKeys[u], ppvValues[u]);
+   recordBulk(uStart, uCount);
+   report("build-put", uCount);
+   SymTable_free(oSymTable);
+
+   fprintf(stderr, "%s,build-parallel,%lu,online_cpus,%ld\n",
+      SYMTABLE_BACKEND, (unsigned long)uCount,
+      sysconf(_SC_NPROCESSORS_ONLN));
+
+   for (u = 0; u < sizeof(auThreads) / sizeof(auThreads[0]); u++)
+   {
+      uStart = now();
+      oSymTable = SymTable_buildParallel(ppcKeys, ppvValues, uCount,
+         auThreads[u]);
+      assert(oSymTable != NULL);
+      recordBulk(uStart, uCount);
+      sprintf(acWorkload, "build-parallel-%lu",
+         (unsigned long)auThreads[u]);
+      report(acWorkload, uCount);
+      SymTable_free(oSymTable);
+   }
+
+   free(ppvValues);
+   free(ppcKeys);
+   free(pcKeys);
+}
+#endif
+
+/*--------------------------------------------------------------------*/
+
+#ifdef BENCH_HUGE
+/* Return a file descriptor counting the data TLB misses of loads by
+   this process from now until it is closed, or -1 if the system does
+   not count them. */
+
+static int openTlbCounter(void)
+{
+#if defined(__linux__) && defined(SYS_perf_event_open)
+   struct perf_event_attr attr;
+
+   memset(&attr, 0, sizeof(attr));
+   attr.size = sizeof(attr);
+   attr.type = PERF_TYPE_HW_CACHE;
+   attr.config = PERF_COUNT_HW_CACHE_DTLB
+      | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+      | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+   attr.exclude_kernel = 1;
+   attr.exclude_hv = 1;
+   return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#else
+   return -1;
+#endif
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Close the counter iCounter and return its count, or -1 if iCounter
+   is -1 or cannot be read. */
+
+static long closeTlbCounter(int iCounter)
+{
+   long long llCount = -1;
+
+   if (iCounter < 0)
+      return -1;
+#if defined(__linux__)
+   if (read(iCounter, &llCount, sizeof(llCount)) != sizeof(llCount))
+      llCount = -1;
+   close(iCounter);
+#endif
+   return (long)llCount;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Measure random lookups in a table of uCount bindings from
+   SymTable_new, then from SymTable_newHugePages, writing the data TLB
+   misses per lookup of each to stderr. Once the bucket array and
+   nodes outgrow what the TLB maps with 4K pages, nearly every lookup
+   misses it; 2MB pages map 512 times as much. */
+
+static void benchHugePages(size_t uCount)
+{
+   SymTable_T oSymTable;
+   char acKey[MAX_KEY_LENGTH];
+   size_t *puOrder;
+   uint64_t uStart;
+   long lMisses;
+   int iCounter;
+   int iHuge;
+   size_t u;
+
+   puOrder = newPermutation(uCount);
+   for (iHuge = 0; iHuge <= 1; iHuge++)
+   {
+      oSymTable = iHuge ? SymTable_newHugePages(-1) : SymTable_new();
+      assert(oSymTable != NULL);
+      for (u = 0; u < uCount; u++)
+      {
+         makeKey(acKey, "key", u);
+         SymTable_put(oSymTable, acKey, acValue);
+      }
+
+      iCounter = openTlbCounter();
+      for (u = 0; u < uCount; u++)
+      {
+         makeKey(acKey, "key", puOrder[u]);
+         uStart = now();
+         SymTable_get(oSymTable, acKey);
+         record(uStart);
+      }
+      lMisses = closeTlbCounter(iCounter);
+      report(iHuge ? "huge-on-get-rand" : "huge-off-get-rand", uCount);
+      fprintf(stderr, "%s,%s,%lu,dtlb_misses_per_op,%.4f\n",
+         SYMTABLE_BACKEND, iHuge ? "huge-on-get-rand"
+         : "huge-off-get-rand", (unsigned long)uCount,
+         (lMisses < 0) ? -1.0 : (double)lMisses / (double)uCount);
+      SymTable_free(oSymTable);
+   }
+   free(puOrder);
+}
+#endif
+
+/*--------------------------------------------------------------------*/
+
+#ifdef BENCH_INLINE
+/* Free the value pvValue. pcKey and pvExtra are unused. */
+
+static void freeCount(const char *pcKey, void *pvValue, void *pvExtra)
+{
+   (void)pcKey;
+   (void)pvExtra;
+   free(pvValue);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Measure counting uCount words drawn from uCount/10 with Zipf skew,
+   first with a malloced long per word, then with SymTable_add on a
+   table from SymTable_newInline; then random gets that read each
+   value, from the malloced longs and from the inline ones. */
+
+static void benchInline(size_t uCount)
+{
+   SymTable_T oSymTable;
+   char acKey[MAX_KEY_LENGTH];
+   size_t *puRanks;
+   size_t *puOrder;
+   size_t uWords;
+   long *plCount;
+   long lSum = 0;
+   uint64_t uStart;
+   size_t u;
+
+   uWords = (uCount < 10) ? 1 : uCount / 10;
+   puRanks = (size_t*)malloc(uCount * sizeof(size_t));
+   assert(puRanks != NULL);
+   for (u = 0; u < uCount; u++)
+      puRanks[u] = zipfRank(uWords);
+
+   oSymTable = SymTable_new();
+   assert(oSymTable != NULL);
+   for (u = 0; u < uCount; u++)
+   {
+      makeKey(acKey, "word", puRanks[u]);
+      uStart = now();
+      plCount = (long*)SymTable_get(oSymTable, acKey);
+      if (plCount != NULL)
+         (*plCount)++;
+      else
+      {
+         plCount = (long*)malloc(sizeof(long));
+         assert(plCount != NULL);
+         *plCount = 1;
+         SymTable_put(oSymTable, acKey, plCount);
+      }
+      record(uStart);
+   }
+   report("count-malloc-zipf", uCount);
+
+   puOrder = newPermutation(uWords);
+   for (u = 0; u < uWords; u++)
+   {
+      makeKey(acKey, "word", puOrder[u]);
+      uStart = now();
+      plCount = (long*)SymTable_get(oSymTable, acKey);
+      if (plCount != NULL)
+         lSum += *plCount;
+      record(uStart);
+   }
+   report("get-deref-rand", uWords);
+   SymTable_map(oSymTable, freeCount, NULL);
+   SymTable_free(oSymTable);
+
+   oSymTable = SymTable_newInline(sizeof(long));
+   assert(oSymTable != NULL);
+   for (u = 0; u < uCount; u++)
+   {
+      makeKey(acKey, "word", puRanks[u]);
+      uStart = now();
+      SymTable_add(oSymTable, acKey, 1);
+      record(uStart);
+   }
+   report("count-add-zipf", uCount);
+
+   for (u = 0; u < uWords; u++)
+   {
+      makeKey(acKey, "word", puOrder[u]);
+      uStart = now();
+      plCount = (long*)SymTable_getValuePtr(oSymTable, acKey);
+      if (plCount != NULL)
+         lSum -= *plCount;
+      record(uStart);
+   }
+   report("get-inline-rand", uWords);
+   SymTable_free(oSymTable);
+
+   /* Both tables counted the same words */
+   assert(lSum == 0);
+   (void)lSum;
+   free(puOrder);
+   free(puRanks);
+}
+#endif
+
+#ifdef BENCH_COMPACT
+/* Add the address of the value pvValue to the sum pvExtra points to,
+   so that mapping reads every node. pcKey is unused. */
+
+static void sumValue(const char *pcKey, void *pvValue, void *pvExtra)
+{
+   (void)pcKey;
+   *(uintptr_t*)pvExtra += (uintptr_t)pvValue;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Time random gets of every key "churn0" to "churn<uCount-1>" of
+   oSymTable, reported as pcGets, then one SymTable_map, reported per
+   binding as pcMap. The gets are done once untimed first, so that a
+   table that fits in the caches is measured there whatever was done
+   to it last. */
+
+static void timeChurned(SymTable_T oSymTable, size_t uCount,
+   const char *pcGets, const char *pcMap)
+{
+   char acKey[MAX_KEY_LENGTH];
+   size_t *puOrder;
+   uintptr_t uSum = 0;
+   uint64_t uStart;
+   size_t u;
+
+   puOrder = newPermutation(uCount);
+   for (u = 0; u < uCount; u++)
+   {
+      makeKey(acKey, "churn", puOrder[u]);
+      if (SymTable_get(oSymTable, acKey) == NULL)
+         uSum++;
+   }
+   for (u = 0; u < uCount; u++)
+   {
+      makeKey(acKey, "churn", puOrder[u]);
+      uStart = now();
+      if (SymTable_get(oSymTable, acKey) == NULL)
+         uSum++;
+      record(uStart);
+   }
+   report(pcGets, uCount);
+   free(puOrder);
+
+   uStart = now();
+   SymTable_map(oSymTable, sumValue, &uSum);
+   recordBulk(uStart, uCount);
+   report(pcMap, uCount);
+   (void)uSum;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Churn a table of uCount bindings by removing half of its keys and
+   putting them back, in random orders, while other blocks of random
+   sizes are allocated in between, so that its nodes end up scattered
+   over the heap. Then time gets and a map before and after
+   SymTable_compact, and each step of an incremental pass after more
+   churn. */
+
+static void benchCompact(size_t uCount)
+{
+   enum {ROUND_COUNT = 2, STEP_BINDINGS = 4096};
+
+   SymTable_T oSymTable;
+   char acKey[MAX_KEY_LENGTH];
+   void **ppvFillers;
+   size_t *puOrder;
+   size_t uFillers = 0;
+   size_t uRound;
+   uint64_t uStart;
+   size_t u;
+   int iMore;
+
+   ppvFillers = (void**)malloc(ROUND_COUNT * 2 * uCount * sizeof(void*));
+   assert(ppvFillers != NULL);
+
+   oSymTable = SymTable_new();
+   assert(oSymTable != NULL);
+   for (u = 0; u < uCount; u++)
+   {
+      makeKey(acKey, "churn", u);
+      SymTable_put(oSymTable, acKey, acValue);
+   }
+
+   for (uRound = 0; uRound < 2 * ROUND_COUNT; uRound++)
+   {
+      /* Compact after the first rounds, then churn again for the
+         incremental pass */
+      if (uRound == ROUND_COUNT)
+      {
+         timeChurned(oSymTable, uCount, "get-churned-rand",
+            "map-churned");
+         uStart = now();
+         SymTable_compact(oSymTable);
+         fprintf(stderr, "%s,compact,%lu,seconds,%.4f\n",
+            SYMTABLE_BACKEND, (unsigned long)uCount,
+            (double)(now() - uStart) / 1e9);
+         timeChurned(oSymTable, uCount, "get-compact-rand",
+            "map-compact");
+      }
+
+      puOrder = newPermutation(uCount);
+      for (u = 0; u < uCount / 2; u++)
+      {
+         makeKey(acKey, "churn", puOrder[u]);
+         SymTable_remove(oSymTable, acKey);
+      }
+      free(puOrder);
+      puOrder = newPermutation(uCount);
+      for (u = 0; u < uCount; u++)
+      {
+         makeKey(acKey, "churn", puOrder[u]);
+         if (SymTable_put(oSymTable, acKey, acValue))
+         {
+            ppvFillers[uFillers] = malloc(16 + randomNumber() % 112);
+            assert(ppvFillers[uFillers] != NULL);
+            uFillers++;
+         }
+      }
+      free(puOrder);
+   }
+
+   do
+   {
+      uStart = now();
+      iMore = SymTable_compactStep(oSymTable, STEP_BINDINGS);
+      record(uStart);
+   } while (iMore == 1);
+   if (iMore < 0)
+   {
+      fprintf(stderr, "Out of memory\n");
+      exit(EXIT_FAILURE);
+   }
+   report("compact-step", uCount);
+   timeChurned(oSymTable, uCount, "get-stepped-rand", "map-stepped");
+
+   SymTable_free(oSymTable);
+   for (u = 0; u < uFillers; u++)
+      free(ppvFillers[u]);
+   free(ppvFillers);
+}
+#endif
+
+/*--------------------------------------------------------------------*/
+
+#ifdef BENCH_DISK
+/* Measure a table of uCount bindings whose cache holds a tenth of the
+   memory the same bindings take with an unbounded cache, so that the
+   keys take ten times the memory the table may hold: puts, random and
+   Zipf-distributed gets, then removes in random order. The file is
+   still cached by the operating system, so the misses cost a system
+   call and a copy rather than a seek. */
+
+static void benchDisk(size_t uCount)
+{
+   enum {RAM_FRACTION = 10};
+
+   SymTable_T oSymTable;
+   char acKey[MAX_KEY_LENGTH];
+   size_t *puOrder;
+   size_t uCacheBytes;
+   uint64_t uStart;
+   size_t u;
+
+   oSymTable = SymTable_newOnDisk(NULL, (size_t)-1);
+   assert(oSymTable != NULL);
+   for (u = 0; u < uCount; u++)
+   {
+      makeKey(acKey, "key", u);
+      SymTable_put(oSymTable, acKey, acValue);
+   }
+   uCacheBytes = SymTable_memoryUsage(oSymTable) / RAM_FRACTION;
+   SymTable_free(oSymTable);
+   fprintf(stderr, "%s,disk-cache,%lu,bytes,%lu\n", SYMTABLE_BACKEND,
+      (unsigned long)uCount, (unsigned long)uCacheBytes);
+
+   puOrder = newPermutation(uCount);
+   oSymTable = SymTable_newOnDisk(NULL, uCacheBytes);
+   assert(oSymTable != NULL);
+   for (u = 0; u < uCount; u++)
+   {
+      makeKey(acKey, "key", puOrder[u]);
+      uStart = now();
+      SymTable_put(oSymTable, acKey, acValue);
+      record(uStart);
+   }
+   report("disk-put-rand", uCount);
+
+   free(puOrder);
+   puOrder = newPermutation(uCount);
+   for (u = 0; u < uCount; u++)
+   {
+      makeKey(acKey, "key", puOrder[u]);
+      uStart = now();
+      SymTable_get(oSymTable, acKey);
+      record(uStart);
+   }
+   report("disk-get-rand", uCount);
+
+   for (u = 0; u < uCount; u++)
+   {
+      makeKey(acKey, "key", puOrder[zipfRank(uCount)]);
+      uStart = now();
+      SymTable_get(oSymTable, acKey);
+      record(uStart);
+   }
+   report("disk-get-zipf", uCount);
+
+   for (u = 0; u < uCount; u++)
+   {
+      makeKey(acKey, "key", puOrder[u]);
+      uStart = now();
+      SymTable_remove(oSymTable, acKey);
+      record(uStart);
+   }
+   report("disk-remove-rand", uCount);
+
+   SymTable_free(oSymTable);
+   free(puOrder);
+}
+#endif
+
+/*--------------------------------------------------------------------*/
+
+/* Run every workload at a table size of uCount. */
+
+static void benchSize(size_t uCount)
+{
+#ifdef BENCH_LOG
+   /* Syncing every change is slow, so it uses fewer bindings */
+   enum {MAX_UNGROUPED_COUNT = 2000};
+#endif
+
+   benchLookups(uCount);
+   benchChurn(uCount);
+   benchLongKeys(uCount);
+   benchSmallTables(uCount);
+#ifdef BENCH_LOG
+   benchLog(uCount, 0);
+   benchLog((uCount < MAX_UNGROUPED_COUNT) ? uCount
+      : MAX_UNGROUPED_COUNT, 1);
+   benchLog(uCount, 64);
+   benchLog(uCount, 1024);
+#endif
+#ifdef BENCH_INT
+   benchIntKeys(uCount);
+#endif
+#ifdef BENCH_CACHE
+   benchCache(uCount);
+#endif
+#ifdef BENCH_TTL
+   benchTTL(uCount);
+#endif
+#ifdef BENCH_HANDLE
+   benchHandles(uCount);
+#endif
+#ifdef BENCH_COLLIDE
+   benchCollisions(uCount);
+#endif
+#ifdef BENCH_PARALLEL
+   benchBuild(uCount);
+#endif
+#ifdef BENCH_HUGE
+   benchHugePages(uCount);
+#endif
+#ifdef BENCH_INLINE
+   benchInline(uCount);
+#endif
+#ifdef BENCH_COMPACT
+   benchCompact(uCount);
+#endif
+#ifdef BENCH_DISK
+   benchDisk(uCount);
+#endif
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Run the SymTable benchmarks and write one comma-separated line per
+   workload and size to stdout, giving the mean and the 50th, 99th and
+   99.9th percentile latencies in nanoseconds. The arguments are the
+   sizes to run, 50 to 10000000 by default, optionally preceded by
+   "-m maxsize" to skip larger sizes. Return 0, or exit with
+   EXIT_FAILURE if an argument is not a positive number. */
+
+int main(int argc, char *argv[])
+{
+   static const unsigned long aulDefaultSizes[] = {50, 500, 5000,
+      50000, 500000, 5000000, 10000000};
+   enum {DEFAULT_SIZE_COUNT =
+      sizeof(aulDefaultSizes) / sizeof(aulDefaultSizes[0])};
+
+   unsigned long ulMaxSize = (unsigned long)-1;
+   unsigned long ulLargest = 0;
+   unsigned long *pulSizes;
+   size_t uSizeCount = 0;
+   int iArg = 1;
+   int i;
+
+   if (argc > 2 && strcmp(argv[1], "-m") == 0)
+   {
+      if (sscanf(argv[2], "%lu", &ulMaxSize) != 1 || ulMaxSize == 0)
+      {
+         fprintf(stderr, "maxsize must be a positive number\n");
+         exit(EXIT_FAILURE);
+      }
+      iArg = 3;
+   }
+
+   pulSizes = (unsigned long*)malloc((size_t)(argc + DEFAULT_SIZE_COUNT)
+      * sizeof(unsigned long));
+   if (pulSizes == NULL)
+   {
+      fprintf(stderr, "Out of memory\n");
+      exit(EXIT_FAILURE);
+   }
+   for (i = iArg; i < argc; i++)
+   {
+      if (sscanf(argv[i], "%lu", &pulSizes[uSizeCount]) != 1
+         || pulSizes[uSizeCount] == 0)
+      {
+         fprintf(stderr, "Usage: %s [-m maxsize] [size ...]\n", argv[0]);
+         exit(EXIT_FAILURE);
+      }
+      uSizeCount++;
+   }
+   if (uSizeCount == 0)
+      for (i = 0; i < DEFAULT_SIZE_COUNT; i++)
+         pulSizes[uSizeCount++] = aulDefaultSizes[i];
+
+   /* Each workload times at most three operations per binding */
+   for (i = 0; i < (int)uSizeCount; i++)
+      if (pulSizes[i] <= ulMaxSize && pulSizes[i] > ulLargest)
+         ulLargest = pulSizes[i];
+   puLatencies = (uint32_t*)malloc((3 * (size_t)ulLargest
+      + SMALL_TABLE_SIZE * 4 + 100000) * sizeof(uint32_t));
+   if (puLatencies == NULL)
+   {
+      fprintf(stderr, "Out of memory\n");
+      exit(EXIT_FAILURE);
+   }
+
+   printf("backend,workload,size,ops,ns_per_op,p50_ns,p99_ns,p999_ns\n");
+   benchTimer();
+   for (i = 0; i < (int)uSizeCount; i++)
+      if (pulSizes[i] <= ulMaxSize)
+         benchSize((size_t)pulSizes[i]);
+
+   free(puLatencies);
+   free(pulSizes);
+   return 0;
+}
@@ -27,6 +27,32 @@ SymTable_T SymTable_new(void);
 
 /*--------------------------------------------------------------------*/
 
+/* SymTable_Allocator supplies the memory of a SymTable object. pfAlloc 
+   returns uSize bytes, or NULL to refuse them. pfFree takes back a 
+   block pfAlloc returned, along with its size. pvContext is passed to 
+   both */
+typedef struct SymTable_Allocator{
+    void *(*pfAlloc)(size_t uSize, void *pvContext);
+    void (*pfFree)(void *pvBlock, size_t uSize, void *pvContext);
+    void *pvContext;
+} SymTable_Allocator;
+
+/*--------------------------------------------------------------------*/
+
+/* Return a new SymTable object whose own memory, nodes, keys, and 
+   buckets all come from parameter pAllocator, or NULL if pAllocator 
+   refuses. *pAllocator is copied. An operation that pAllocator refuses 
+   fails as if there were not enough memory available */
+SymTable_T SymTable_newWithAllocator(const SymTable_Allocator *pAllocator);
+
+/*--------------------------------------------------------------------*/
+
+/* Returns the number of bytes parameter oSymTable holds from its 
+   allocator, including the object itself. Values are not counted */
+size_t SymTable_memoryUsage(SymTable_T oSymTable);
+
+/*--------------------------------------------------------------------*/
+
 /* Free parameter oSymTable and all nodes, keys, and values associated 
    with it */
 void SymTable_free(SymTable_T oSymTable);
@@ -77,5 +103,19 @@ void *SymTable_remove(SymTable_T oSymTable, const char *pcKey);
 void SymTable_map(SymTable_T oSymTable, 
     void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra), const void *pvExtra);
 
+/*--------------------------------------------------------------------*/
+
+/* Removes from parameter oSymTable every binding for which 
+   pfPredicate(pcKey, pvValue, pvExtra) returns nonzero, in one pass 
+   over the table, and calls pfRemoved(pcKey, pvValue, pvExtra), if 
+   pfRemoved is not NULL, with each one as it goes. Neither function 
+   may call any function on the table. Values are not freed, and a 
+   table left sparse may shrink. Returns the number of bindings 
+   removed */
+size_t SymTable_removeIf(SymTable_T oSymTable, 
+    int (*pfPredicate)(const char *pcKey, void *pvValue, void *pvExtra),
+    const void *pvExtra,
+    void (*pfRemoved)(const char *pcKey, void *pvValue, void *pvExtra));
+
 
 #endif
\ No newline at end of file
@@ -0,0 +1,702 @@
+/*--------------------------------------------------------------------*/
+/*                                                                    */
+/* Implementation of the SymTable ADT as a hash table whose buckets   */
+/* each fill a cache line with tagged slots, chaining only when full  */
+/*                                                                    */
+/* Author: Maxwell Lloyd                                              */
+/*                                                                    */
+/*--------------------------------------------------------------------*/
+
+
+
+#include <stddef.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "symtable.h"
+
+/* Bindings a bucket holds before it overflows into a chain */
+enum {BUCKET_SLOTS = 5};
+
+/* Bytes in a cache line; a bucket fills one on 64-bit machines */
+enum {CACHE_LINE = 64};
+
+/* Number of buckets in a new table */
+enum {INITIAL_BUCKETS = 16};
+
+/* The table grows once it averages more than this many bindings per
+   bucket, which keeps overflow chains rare */
+enum {MAX_BUCKET_LOAD = 3};
+
+/*--------------------------------------------------------------------*/
+
+/* Each binding is stored in a BucketEntry, with its key */
+struct BucketEntry{
+    /* Full hash code of the key */
+    uint64_t uHash;
+
+    /* Value of the binding */
+    const void *pvValue;
+
+    /* Next entry in the overflow chain of the bucket */
+    struct BucketEntry *pNext;
+
+    /* Key of the binding */
+    char acKey[];
+};
+
+/*--------------------------------------------------------------------*/
+
+/* A TagBucket holds up to BUCKET_SLOTS entries inline. A slot is empty
+   if its tag is 0; otherwise the tag holds the top bits of the entry's
+   hash code, so that most mismatches are ruled out without reading the
+   entry. Entries that do not fit go in the overflow chain. */
+struct TagBucket{
+    /* Tags of the slots */
+    uint16_t auTags[BUCKET_SLOTS];
+
+    /* Entries of the slots */
+    struct BucketEntry *apEntries[BUCKET_SLOTS];
+
+    /* First entry that did not fit in the slots, or NULL */
+    struct BucketEntry *pOverflow;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* SymTable object is a manager pointing to the buckets of a
+   SymTable_T object */
+struct SymTable{
+    /* Buckets, aligned to a cache line within pvBlock */
+    struct TagBucket *pBuckets;
+
+    /* Block holding pBuckets, as the allocator returned it */
+    void *pvBlock;
+
+    /* Number of buckets, a power of 2 */
+    size_t uBucketCount;
+
+    /* size of the entire symtable */
+    size_t size;
+
+    /* Source of every block the table holds */
+    SymTable_Allocator allocator;
+
+    /* Bytes currently held from allocator */
+    size_t uBytes;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Return uSize bytes from malloc. pvContext is unused. */
+
+static void *SymTable_defaultAlloc(size_t uSize, void *pvContext)
+{
+    (void)pvContext;
+    return malloc(uSize);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Free pvBlock, which SymTable_defaultAlloc returned. */
+
+static void SymTable_defaultFree(void *pvBlock, size_t uSize,
+    void *pvContext)
+{
+    (void)uSize;
+    (void)pvContext;
+    free(pvBlock);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* The allocator of tables made by SymTable_new */
+static const SymTable_Allocator defaultAllocator = {
+    SymTable_defaultAlloc, SymTable_defaultFree, NULL};
+
+/*--------------------------------------------------------------------*/
+
+/* Return uSize bytes from the allocator of oSymTable, or NULL if it
+   refuses. */
+
+static void *SymTable_alloc(SymTable_T oSymTable, size_t uSize)
+{
+    void *pvBlock;
+
+    assert(oSymTable != NULL);
+
+    pvBlock = (*oSymTable->allocator.pfAlloc)(uSize,
+        oSymTable->allocator.pvContext);
+    if(pvBlock != NULL){
+        oSymTable->uBytes += uSize;
+    }
+    return pvBlock;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Give the uSize bytes at pvBlock back to the allocator of
+   oSymTable. */
+
+static void SymTable_release(SymTable_T oSymTable, void *pvBlock,
+    size_t uSize)
+{
+    assert(oSymTable != NULL);
+    assert(pvBlock != NULL);
+
+    oSymTable->uBytes -= uSize;
+    (*oSymTable->allocator.pfFree)(pvBlock, uSize,
+        oSymTable->allocator.pvContext);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Free pEntry of oSymTable. */
+
+static void SymTable_freeEntry(SymTable_T oSymTable,
+    struct BucketEntry *pEntry)
+{
+    assert(pEntry != NULL);
+
+    SymTable_release(oSymTable, pEntry,
+        sizeof(struct BucketEntry) + strlen(pEntry->acKey) + 1);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Pass pEntry of oSymTable, which is no longer in its bucket, to
+   pfRemoved with pvExtra if pfRemoved is not NULL, then free it. */
+
+static void SymTable_removeEntry(SymTable_T oSymTable,
+    struct BucketEntry *pEntry, void (*pfRemoved)
+    (const char *pcKey, void *pvValue, void *pvExtra),
+    const void *pvExtra)
+{
+    assert(pEntry != NULL);
+
+    if(pfRemoved != NULL){
+        (*pfRemoved)(pEntry->acKey, (void*)pEntry->pvValue,
+            (void*) pvExtra);
+    }
+    SymTable_freeEntry(oSymTable, pEntry);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the number of bytes the block of uBucketCount buckets takes,
+   with room to align them. */
+
+static size_t SymTable_blockSize(size_t uBucketCount)
+{
+    return uBucketCount * sizeof(struct TagBucket) + CACHE_LINE - 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the hash code for pcKey. The low bits pick the bucket and the
+   top bits make the tag, so the bits are mixed well. */
+
+static uint64_t SymTable_hash(const char *pcKey)
+{
+    uint64_t uHash = UINT64_C(14695981039346656037);
+    size_t u;
+
+    assert(pcKey != NULL);
+
+    for(u = 0; pcKey[u] != '\0'; u++){
+        uHash ^= (unsigned char)pcKey[u];
+        uHash *= UINT64_C(1099511628211);
+    }
+
+    uHash ^= uHash >> 33;
+    uHash *= UINT64_C(0xff51afd7ed558ccd);
+    uHash ^= uHash >> 33;
+    uHash *= UINT64_C(0xc4ceb9fe1a85ec53);
+    uHash ^= uHash >> 33;
+    return uHash;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the tag of the hash code uHash, which is never 0. */
+
+static uint16_t SymTable_tag(uint64_t uHash)
+{
+    uint16_t uTag = (uint16_t)(uHash >> 48);
+    return (uTag == 0) ? 1 : uTag;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the bucket of oSymTable for the hash code uHash. */
+
+static struct TagBucket *SymTable_bucket(SymTable_T oSymTable,
+    uint64_t uHash)
+{
+    return &oSymTable->pBuckets[(size_t)uHash
+        & (oSymTable->uBucketCount - 1)];
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the entry of pcKey, whose hash code is uHash, in pBucket, or
+   NULL if there is none. If it is in a slot, store the slot in *puSlot;
+   otherwise store BUCKET_SLOTS there and the entry before it in the
+   overflow chain, or NULL if it is first, in *ppPrev. */
+
+static struct BucketEntry *SymTable_find(struct TagBucket *pBucket,
+    const char *pcKey, uint64_t uHash, unsigned *puSlot,
+    struct BucketEntry **ppPrev)
+{
+    struct BucketEntry *pEntry;
+    struct BucketEntry *pPrev;
+    uint16_t uTag;
+    unsigned u;
+
+    assert(pBucket != NULL);
+    assert(pcKey != NULL);
+
+    uTag = SymTable_tag(uHash);
+    for(u = 0; u < BUCKET_SLOTS; u++){
+        if(pBucket->auTags[u] == uTag){
+            pEntry = pBucket->apEntries[u];
+            if(pEntry->uHash == uHash && strcmp(pEntry->acKey, pcKey) == 0){
+                *puSlot = u;
+                return pEntry;
+            }
+        }
+    }
+
+    pPrev = NULL;
+    for(pEntry = pBucket->pOverflow; pEntry != NULL;
+        pEntry = pEntry->pNext){
+        if(pEntry->uHash == uHash && strcmp(pEntry->acKey, pcKey) == 0){
+            *puSlot = BUCKET_SLOTS;
+            *ppPrev = pPrev;
+            return pEntry;
+        }
+        pPrev = pEntry;
+    }
+    return NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Add pEntry, whose key is not in pBucket, to pBucket: in an empty
+   slot if there is one, otherwise at the front of the overflow
+   chain. */
+
+static void SymTable_place(struct TagBucket *pBucket,
+    struct BucketEntry *pEntry)
+{
+    unsigned u;
+
+    assert(pBucket != NULL);
+    assert(pEntry != NULL);
+
+    for(u = 0; u < BUCKET_SLOTS; u++){
+        if(pBucket->auTags[u] == 0){
+            pBucket->auTags[u] = SymTable_tag(pEntry->uHash);
+            pBucket->apEntries[u] = pEntry;
+            return;
+        }
+    }
+    pEntry->pNext = pBucket->pOverflow;
+    pBucket->pOverflow = pEntry;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Set pvBlock as the block of uBucketCount empty buckets of
+   oSymTable. */
+
+static void SymTable_setBuckets(SymTable_T oSymTable, void *pvBlock,
+    size_t uBucketCount)
+{
+    assert(oSymTable != NULL);
+    assert(pvBlock != NULL);
+
+    oSymTable->pvBlock = pvBlock;
+    oSymTable->pBuckets = (struct TagBucket*)(((uintptr_t)pvBlock
+        + CACHE_LINE - 1) & ~(uintptr_t)(CACHE_LINE - 1));
+    oSymTable->uBucketCount = uBucketCount;
+    memset(oSymTable->pBuckets, 0, uBucketCount * sizeof(struct TagBucket));
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Move every entry of oSymTable into a new array of uBucketCount
+   buckets. Returns 1 for success or 0 for failure, in which case
+   nothing changes. */
+
+static int SymTable_rehash(SymTable_T oSymTable, size_t uBucketCount)
+{
+    struct TagBucket *pOldBuckets;
+    struct TagBucket *pBucket;
+    struct BucketEntry *pEntry;
+    struct BucketEntry *pNext;
+    void *pvOldBlock;
+    void *pvBlock;
+    size_t uOldCount;
+    size_t counter;
+    unsigned u;
+
+    assert(oSymTable != NULL);
+
+    pvBlock = SymTable_alloc(oSymTable, SymTable_blockSize(uBucketCount));
+    if(pvBlock == NULL){
+        return 0;
+    }
+
+    pOldBuckets = oSymTable->pBuckets;
+    pvOldBlock = oSymTable->pvBlock;
+    uOldCount = oSymTable->uBucketCount;
+    SymTable_setBuckets(oSymTable, pvBlock, uBucketCount);
+
+    for(counter = 0; counter < uOldCount; counter++){
+        pBucket = &pOldBuckets[counter];
+        for(u = 0; u < BUCKET_SLOTS; u++){
+            if(pBucket->auTags[u] != 0){
+                pEntry = pBucket->apEntries[u];
+                SymTable_place(SymTable_bucket(oSymTable, pEntry->uHash),
+                    pEntry);
+            }
+        }
+        for(pEntry = pBucket->pOverflow; pEntry != NULL; pEntry = pNext){
+            pNext = pEntry->pNext;
+            SymTable_place(SymTable_bucket(oSymTable, pEntry->uHash),
+                pEntry);
+        }
+    }
+
+    SymTable_release(oSymTable, pvOldBlock, SymTable_blockSize(uOldCount));
+    return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+SymTable_T SymTable_new(void){
+    return SymTable_newWithAllocator(&defaultAllocator);
+}
+
+/*--------------------------------------------------------------------*/
+
+SymTable_T SymTable_newWithAllocator(const SymTable_Allocator *pAllocator){
+    SymTable_T oSymTable;
+    void *pvBlock;
+
+    assert(pAllocator != NULL);
+    assert(pAllocator->pfAlloc != NULL);
+    assert(pAllocator->pfFree != NULL);
+
+    oSymTable = (SymTable_T)(*pAllocator->pfAlloc)(sizeof(struct SymTable),
+        pAllocator->pvContext);
+    if (oSymTable == NULL)
+       return NULL;
+    oSymTable->allocator = *pAllocator;
+    oSymTable->uBytes = sizeof(struct SymTable);
+
+    pvBlock = SymTable_alloc(oSymTable, SymTable_blockSize(INITIAL_BUCKETS));
+    if(pvBlock == NULL){
+        SymTable_release(oSymTable, oSymTable, sizeof(struct SymTable));
+        return NULL;
+    }
+    SymTable_setBuckets(oSymTable, pvBlock, INITIAL_BUCKETS);
+    oSymTable->size = 0;
+    return oSymTable;
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t SymTable_memoryUsage(SymTable_T oSymTable){
+    assert(oSymTable != NULL);
+
+    return oSymTable->uBytes;
+}
+
+/*--------------------------------------------------------------------*/
+
+void SymTable_free(SymTable_T oSymTable){
+    struct TagBucket *pBucket;
+    struct BucketEntry *pEntry;
+    struct BucketEntry *pNext;
+    size_t counter;
+    unsigned u;
+
+    assert(oSymTable != NULL);
+
+    for(counter = 0; counter < oSymTable->uBucketCount; counter++){
+        pBucket = &oSymTable->pBuckets[counter];
+        for(u = 0; u < BUCKET_SLOTS; u++){
+            if(pBucket->auTags[u] != 0){
+                SymTable_freeEntry(oSymTable, pBucket->apEntries[u]);
+            }
+        }
+        for(pEntry = pBucket->pOverflow; pEntry != NULL; pEntry = pNext){
+            pNext = pEntry->pNext;
+            SymTable_freeEntry(oSymTable, pEntry);
+        }
+    }
+
+    SymTable_release(oSymTable, oSymTable->pvBlock,
+        SymTable_blockSize(oSymTable->uBucketCount));
+    SymTable_release(oSymTable, oSymTable, sizeof(struct SymTable));
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t SymTable_getLength(SymTable_T oSymTable){
+    assert(oSymTable != NULL);
+
+    return oSymTable->size;
+}
+
+/*--------------------------------------------------------------------*/
+
+int SymTable_put(SymTable_T oSymTable, const char *pcKey,
+    const void *pvValue){
+    struct BucketEntry *pEntry;
+    struct BucketEntry *pPrev;
+    uint64_t uHash;
+    size_t strLength;
+    unsigned uSlot;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    uHash = SymTable_hash(pcKey);
+    if(SymTable_find(SymTable_bucket(oSymTable, uHash), pcKey, uHash,
+        &uSlot, &pPrev) != NULL){
+        return 0;
+    }
+
+    /* Defensive copy */
+    strLength = strlen(pcKey) + 1;
+    pEntry = (struct BucketEntry*)SymTable_alloc(oSymTable,
+        sizeof(struct BucketEntry) + strLength);
+    if(pEntry == NULL){
+        return 0;
+    }
+    pEntry->uHash = uHash;
+    pEntry->pvValue = pvValue;
+    pEntry->pNext = NULL;
+    memcpy(pEntry->acKey, pcKey, strLength);
+
+    SymTable_place(SymTable_bucket(oSymTable, uHash), pEntry);
+    oSymTable->size++;
+
+    /* If the buckets cannot grow, the binding is still in the table
+       and the chains are just longer */
+    if(oSymTable->size > oSymTable->uBucketCount * MAX_BUCKET_LOAD){
+        (void)SymTable_rehash(oSymTable, oSymTable->uBucketCount * 2);
+    }
+    return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *SymTable_replace(SymTable_T oSymTable, const char *pcKey,
+    const void *pvValue){
+    struct BucketEntry *pEntry;
+    struct BucketEntry *pPrev;
+    const void *pOldValue;
+    uint64_t uHash;
+    unsigned uSlot;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    uHash = SymTable_hash(pcKey);
+    pEntry = SymTable_find(SymTable_bucket(oSymTable, uHash), pcKey, uHash,
+        &uSlot, &pPrev);
+    if(pEntry == NULL){
+        return NULL;
+    }
+    pOldValue = pEntry->pvValue;
+    pEntry->pvValue = pvValue;
+    return (void*) pOldValue;
+}
+
+/*--------------------------------------------------------------------*/
+
+int SymTable_contains(SymTable_T oSymTable, const char *pcKey){
+    struct BucketEntry *pPrev;
+    uint64_t uHash;
+    unsigned uSlot;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    uHash = SymTable_hash(pcKey);
+    return SymTable_find(SymTable_bucket(oSymTable, uHash), pcKey, uHash,
+        &uSlot, &pPrev) != NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *SymTable_get(SymTable_T oSymTable, const char *pcKey){
+    struct BucketEntry *pEntry;
+    struct BucketEntry *pPrev;
+    uint64_t uHash;
+    unsigned uSlot;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    uHash = SymTable_hash(pcKey);
+    pEntry = SymTable_find(SymTable_bucket(oSymTable, uHash), pcKey, uHash,
+        &uSlot, &pPrev);
+    if(pEntry == NULL){
+        return NULL;
+    }
+    return (void*)pEntry->pvValue;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *SymTable_remove(SymTable_T oSymTable, const char *pcKey){
+    struct TagBucket *pBucket;
+    struct BucketEntry *pEntry;
+    struct BucketEntry *pPrev;
+    struct BucketEntry *pPromoted;
+    const void *pOldValue;
+    uint64_t uHash;
+    unsigned uSlot;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    uHash = SymTable_hash(pcKey);
+    pBucket = SymTable_bucket(oSymTable, uHash);
+    pEntry = SymTable_find(pBucket, pcKey, uHash, &uSlot, &pPrev);
+    if(pEntry == NULL){
+        return NULL;
+    }
+
+    if(uSlot == BUCKET_SLOTS){
+        if(pPrev == NULL){
+            pBucket->pOverflow = pEntry->pNext;
+        }
+        else{
+            pPrev->pNext = pEntry->pNext;
+        }
+    }
+    else if(pBucket->pOverflow != NULL){
+        /* Keep the slots full, so that misses rarely need the chain */
+        pPromoted = pBucket->pOverflow;
+        pBucket->pOverflow = pPromoted->pNext;
+        pBucket->auTags[uSlot] = SymTable_tag(pPromoted->uHash);
+        pBucket->apEntries[uSlot] = pPromoted;
+    }
+    else{
+        pBucket->auTags[uSlot] = 0;
+        pBucket->apEntries[uSlot] = NULL;
+    }
+
+    pOldValue = pEntry->pvValue;
+    SymTable_freeEntry(oSymTable, pEntry);
+    oSymTable->size--;
+    return (void*) pOldValue;
+}
+
+/*--------------------------------------------------------------------*/
+
+void SymTable_map(SymTable_T oSymTable, void (*pfApply)
+    (const char *pcKey, void *pvValue, void *pvExtra),
+    const void *pvExtra){
+    struct TagBucket *pBucket;
+    struct BucketEntry *pEntry;
+    size_t counter;
+    unsigned u;
+
+    assert(oSymTable != NULL);
+    assert(pfApply != NULL);
+
+    for(counter = 0; counter < oSymTable->uBucketCount; counter++){
+        pBucket = &oSymTable->pBuckets[counter];
+        for(u = 0; u < BUCKET_SLOTS; u++){
+            if(pBucket->auTags[u] != 0){
+                pEntry = pBucket->apEntries[u];
+                (*pfApply)(pEntry->acKey, (void*)pEntry->pvValue,
+                    (void*) pvExtra);
+            }
+        }
+        for(pEntry = pBucket->pOverflow; pEntry != NULL;
+            pEntry = pEntry->pNext){
+            (*pfApply)(pEntry->acKey, (void*)pEntry->pvValue,
+                (void*) pvExtra);
+        }
+    }
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t SymTable_removeIf(SymTable_T oSymTable, int (*pfPredicate)
+    (const char *pcKey, void *pvValue, void *pvExtra),
+    const void *pvExtra, void (*pfRemoved)
+    (const char *pcKey, void *pvValue, void *pvExtra)){
+    struct TagBucket *pBucket;
+    struct BucketEntry **ppLink;
+    struct BucketEntry *pEntry;
+    size_t uRemoved = 0;
+    size_t counter;
+    unsigned u;
+
+    assert(oSymTable != NULL);
+    assert(pfPredicate != NULL);
+
+    for(counter = 0; counter < oSymTable->uBucketCount; counter++){
+        pBucket = &oSymTable->pBuckets[counter];
+        for(u = 0; u < BUCKET_SLOTS; u++){
+            pEntry = pBucket->apEntries[u];
+            if(pBucket->auTags[u] == 0
+                || ! (*pfPredicate)(pEntry->acKey, (void*)pEntry->pvValue,
+                    (void*) pvExtra)){
+                continue;
+            }
+            pBucket->auTags[u] = 0;
+            pBucket->apEntries[u] = NULL;
+            SymTable_removeEntry(oSymTable, pEntry, pfRemoved, pvExtra);
+            uRemoved++;
+        }
+
+        ppLink = &pBucket->pOverflow;
+        while((pEntry = *ppLink) != NULL){
+            if(! (*pfPredicate)(pEntry->acKey, (void*)pEntry->pvValue,
+                (void*) pvExtra)){
+                ppLink = &pEntry->pNext;
+                continue;
+            }
+            *ppLink = pEntry->pNext;
+            SymTable_removeEntry(oSymTable, pEntry, pfRemoved, pvExtra);
+            uRemoved++;
+        }
+
+        /* Keep the slots full, so that misses rarely need the chain */
+        for(u = 0; u < BUCKET_SLOTS && pBucket->pOverflow != NULL; u++){
+            if(pBucket->auTags[u] == 0){
+                pEntry = pBucket->pOverflow;
+                pBucket->pOverflow = pEntry->pNext;
+                pBucket->auTags[u] = SymTable_tag(pEntry->uHash);
+                pBucket->apEntries[u] = pEntry;
+            }
+        }
+    }
+    oSymTable->size -= uRemoved;
+
+    /* Once the table is under a quarter of its most load, the buckets
+       halve until it is at least half. If they cannot, the table stays
+       as it is. */
+    if(oSymTable->size * 4 < oSymTable->uBucketCount * MAX_BUCKET_LOAD){
+        counter = oSymTable->uBucketCount;
+        while(counter / 2 >= INITIAL_BUCKETS
+            && oSymTable->size * 2 <= counter / 2 * MAX_BUCKET_LOAD){
+            counter /= 2;
+        }
+        if(counter < oSymTable->uBucketCount){
+            (void)SymTable_rehash(oSymTable, counter);
+        }
+    }
+    return uRemoved;
+}
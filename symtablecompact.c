@@ -0,0 +1,715 @@
+/*--------------------------------------------------------------------*/
+/*                                                                    */
+/* Implementation of the SymTable ADT as a compact chained hash table */
+/* whose entries live in one array addressed by 32-bit indices and    */
+/* whose keys share one string heap                                   */
+/*                                                                    */
+/* Author: Maxwell Lloyd                                              */
+/*                                                                    */
+/*--------------------------------------------------------------------*/
+
+
+
+#include <stddef.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "symtable.h"
+
+/* Number of buckets in a new table */
+enum {INITIAL_BUCKETS = 16};
+
+/* Number of entries and bytes of key heap the table first makes room
+   for */
+enum {INITIAL_ENTRIES = 16, INITIAL_HEAP_SIZE = 256};
+
+/* The buckets grow once there are more than MAX_LOAD bindings per
+   bucket */
+enum {MAX_LOAD = 2};
+
+/* The entries and the key heap grow by a GROWTH_DIVISORth of what they
+   hold, so that little of them sits unused: with an eighth, a binding
+   costs under 24 bytes beside its key and value from a thousand
+   bindings up */
+enum {GROWTH_DIVISOR = 8};
+
+/* Index that refers to no entry. It ends a chain and the free list. */
+#define NO_ENTRY UINT32_MAX
+
+/*--------------------------------------------------------------------*/
+
+/* Each binding is stored in a CompactEntry. On 64-bit machines an
+   entry is 24 bytes, so that a binding costs 16 bytes beside its
+   value, plus 2 to 4 bytes of bucket and the bytes of its key. */
+struct CompactEntry{
+    /* Index of the next entry of the chain, or of the free list once
+       the entry is removed, or NO_ENTRY */
+    uint32_t uNext;
+
+    /* Length of the key, without its '\0' */
+    uint32_t uKeyLength;
+
+    /* Offset of the key in the key heap */
+    uint64_t uKeyOffset;
+
+    /* Value of the binding */
+    const void *pvValue;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* SymTable object is a manager pointing to the buckets, entries and
+   keys of a SymTable_T object */
+struct SymTable{
+    /* The buckets, each the index of the first entry of its chain, or
+       NO_ENTRY */
+    uint32_t *puBuckets;
+
+    /* Number of buckets, a power of 2 */
+    size_t uBucketCount;
+
+    /* The entries, and the number there is room for */
+    struct CompactEntry *pEntries;
+    size_t uEntryCapacity;
+
+    /* Number of entries that have ever been used. Those past it have
+       not. */
+    size_t uEntriesUsed;
+
+    /* First removed entry, each linked to the next through uNext, or
+       NO_ENTRY */
+    uint32_t uFree;
+
+    /* The key heap. Each key is followed by '\0'. */
+    char *pcHeap;
+
+    /* Bytes of the key heap, bytes from its start that have been
+       used, and bytes of those that belong to removed keys */
+    size_t uHeapSize;
+    size_t uHeapUsed;
+    size_t uHeapGarbage;
+
+    /* size of the entire symtable */
+    size_t size;
+
+    /* Source of every block the table holds */
+    SymTable_Allocator allocator;
+
+    /* Bytes currently held from allocator */
+    size_t uBytes;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Return uSize bytes from malloc. pvContext is unused. */
+
+static void *SymTable_defaultAlloc(size_t uSize, void *pvContext)
+{
+    (void)pvContext;
+    return malloc(uSize);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Free pvBlock, which SymTable_defaultAlloc returned. */
+
+static void SymTable_defaultFree(void *pvBlock, size_t uSize,
+    void *pvContext)
+{
+    (void)uSize;
+    (void)pvContext;
+    free(pvBlock);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* The allocator of tables made by SymTable_new */
+static const SymTable_Allocator defaultAllocator = {
+    SymTable_defaultAlloc, SymTable_defaultFree, NULL};
+
+/*--------------------------------------------------------------------*/
+
+/* Return uSize bytes from the allocator of oSymTable, or NULL if it
+   refuses. */
+
+static void *SymTable_alloc(SymTable_T oSymTable, size_t uSize)
+{
+    void *pvBlock;
+
+    assert(oSymTable != NULL);
+
+    pvBlock = (*oSymTable->allocator.pfAlloc)(uSize,
+        oSymTable->allocator.pvContext);
+    if(pvBlock != NULL){
+        oSymTable->uBytes += uSize;
+    }
+    return pvBlock;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Give the uSize bytes at pvBlock back to the allocator of
+   oSymTable. pvBlock may be NULL, in which case nothing happens. */
+
+static void SymTable_release(SymTable_T oSymTable, void *pvBlock,
+    size_t uSize)
+{
+    assert(oSymTable != NULL);
+
+    if(pvBlock == NULL){
+        return;
+    }
+    oSymTable->uBytes -= uSize;
+    (*oSymTable->allocator.pfFree)(pvBlock, uSize,
+        oSymTable->allocator.pvContext);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the hash code for the uLength bytes at pcKey. The low bits
+   pick the bucket, so the bits are mixed well. */
+
+static uint64_t SymTable_hash(const char *pcKey, size_t uLength)
+{
+    uint64_t uHash = UINT64_C(14695981039346656037);
+    size_t u;
+
+    assert(pcKey != NULL);
+
+    for(u = 0; u < uLength; u++){
+        uHash ^= (unsigned char)pcKey[u];
+        uHash *= UINT64_C(1099511628211);
+    }
+
+    uHash ^= uHash >> 33;
+    uHash *= UINT64_C(0xff51afd7ed558ccd);
+    uHash ^= uHash >> 33;
+    uHash *= UINT64_C(0xc4ceb9fe1a85ec53);
+    uHash ^= uHash >> 33;
+    return uHash;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the key of pEntry of oSymTable. The key moves whenever the
+   key heap does. */
+
+static const char *SymTable_keyOf(SymTable_T oSymTable,
+    const struct CompactEntry *pEntry)
+{
+    assert(oSymTable != NULL);
+    assert(pEntry != NULL);
+
+    return oSymTable->pcHeap + (size_t)pEntry->uKeyOffset;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the link of oSymTable that refers to the entry of pcKey,
+   whose length is uLength and whose hash code is uHash, or NULL if
+   there is none. The link is either a bucket or the uNext of the
+   entry before it in the chain. */
+
+static uint32_t *SymTable_lookup(SymTable_T oSymTable, const char *pcKey,
+    size_t uLength, uint64_t uHash)
+{
+    struct CompactEntry *pEntry;
+    uint32_t *puLink;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    puLink = &oSymTable->puBuckets[(size_t)uHash
+        & (oSymTable->uBucketCount - 1)];
+    while(*puLink != NO_ENTRY){
+        pEntry = &oSymTable->pEntries[*puLink];
+        if(pEntry->uKeyLength == uLength
+            && memcmp(SymTable_keyOf(oSymTable, pEntry), pcKey,
+                uLength) == 0){
+            return puLink;
+        }
+        puLink = &pEntry->uNext;
+    }
+    return NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Move every entry of oSymTable into a new array of uBucketCount
+   buckets. Returns 1 for success or 0 for failure, in which case
+   nothing changes. The hash codes are not kept, so every key is
+   hashed again. */
+
+static int SymTable_rehash(SymTable_T oSymTable, size_t uBucketCount)
+{
+    struct CompactEntry *pEntry;
+    uint32_t *puOldBuckets;
+    uint32_t *puNewBuckets;
+    uint32_t uIndex;
+    uint32_t uNext;
+    size_t uOldCount;
+    size_t uBucket;
+    size_t u;
+
+    assert(oSymTable != NULL);
+
+    if(uBucketCount > SIZE_MAX / sizeof(uint32_t)){
+        return 0;
+    }
+    puNewBuckets = (uint32_t*)SymTable_alloc(oSymTable,
+        uBucketCount * sizeof(uint32_t));
+    if(puNewBuckets == NULL){
+        return 0;
+    }
+    for(u = 0; u < uBucketCount; u++){
+        puNewBuckets[u] = NO_ENTRY;
+    }
+
+    puOldBuckets = oSymTable->puBuckets;
+    uOldCount = oSymTable->uBucketCount;
+    for(u = 0; u < uOldCount; u++){
+        for(uIndex = puOldBuckets[u]; uIndex != NO_ENTRY; uIndex = uNext){
+            pEntry = &oSymTable->pEntries[uIndex];
+            uNext = pEntry->uNext;
+            uBucket = (size_t)SymTable_hash(SymTable_keyOf(oSymTable,
+                pEntry), pEntry->uKeyLength) & (uBucketCount - 1);
+            pEntry->uNext = puNewBuckets[uBucket];
+            puNewBuckets[uBucket] = uIndex;
+        }
+    }
+
+    oSymTable->puBuckets = puNewBuckets;
+    oSymTable->uBucketCount = uBucketCount;
+    SymTable_release(oSymTable, puOldBuckets,
+        uOldCount * sizeof(uint32_t));
+    return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Make room in oSymTable for at least one more entry than it has
+   ever used. Returns 1 for success or 0 for failure, in which case
+   nothing changes. */
+
+static int SymTable_growEntries(SymTable_T oSymTable)
+{
+    struct CompactEntry *pNewEntries;
+    size_t uCapacity;
+
+    assert(oSymTable != NULL);
+
+    /* Every index must fit in 32 bits and differ from NO_ENTRY */
+    if(oSymTable->uEntryCapacity >= NO_ENTRY){
+        return 0;
+    }
+    uCapacity = oSymTable->uEntryCapacity
+        + oSymTable->uEntryCapacity / GROWTH_DIVISOR;
+    if(uCapacity < INITIAL_ENTRIES){
+        uCapacity = INITIAL_ENTRIES;
+    }
+    if(uCapacity > NO_ENTRY){
+        uCapacity = NO_ENTRY;
+    }
+    if(uCapacity > SIZE_MAX / sizeof(struct CompactEntry)){
+        return 0;
+    }
+
+    pNewEntries = (struct CompactEntry*)SymTable_alloc(oSymTable,
+        uCapacity * sizeof(struct CompactEntry));
+    if(pNewEntries == NULL){
+        return 0;
+    }
+    if(oSymTable->uEntriesUsed != 0){
+        memcpy(pNewEntries, oSymTable->pEntries,
+            oSymTable->uEntriesUsed * sizeof(struct CompactEntry));
+    }
+    SymTable_release(oSymTable, oSymTable->pEntries,
+        oSymTable->uEntryCapacity * sizeof(struct CompactEntry));
+    oSymTable->pEntries = pNewEntries;
+    oSymTable->uEntryCapacity = uCapacity;
+    return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Move the keys of oSymTable into a new key heap with room for
+   uExtra more bytes and some to spare, leaving the bytes of
+   removed keys behind. The keys of each chain end up next to each
+   other. If pcKey is not NULL, its uExtra bytes are appended and
+   their offset is stored in *puOffset; pcKey may be in the old
+   heap. Returns 1 for success or 0 for failure, in which case
+   nothing changes. */
+
+static int SymTable_moveHeap(SymTable_T oSymTable, size_t uExtra,
+    const char *pcKey, uint64_t *puOffset)
+{
+    struct CompactEntry *pEntry;
+    char *pcNewHeap = NULL;
+    size_t uLive;
+    size_t uSize;
+    size_t uUsed = 0;
+    size_t u;
+    uint32_t uIndex;
+
+    assert(oSymTable != NULL);
+
+    uLive = oSymTable->uHeapUsed - oSymTable->uHeapGarbage;
+    if(uExtra > SIZE_MAX / 2 - uLive){
+        return 0;
+    }
+    uSize = uLive + uExtra;
+    uSize += uSize / GROWTH_DIVISOR;
+    if(pcKey != NULL && uSize < INITIAL_HEAP_SIZE){
+        uSize = INITIAL_HEAP_SIZE;
+    }
+
+    if(uSize != 0){
+        pcNewHeap = (char*)SymTable_alloc(oSymTable, uSize);
+        if(pcNewHeap == NULL){
+            return 0;
+        }
+    }
+
+    for(u = 0; u < oSymTable->uBucketCount; u++){
+        for(uIndex = oSymTable->puBuckets[u]; uIndex != NO_ENTRY;
+            uIndex = pEntry->uNext){
+            pEntry = &oSymTable->pEntries[uIndex];
+            memcpy(pcNewHeap + uUsed, SymTable_keyOf(oSymTable, pEntry),
+                (size_t)pEntry->uKeyLength + 1);
+            pEntry->uKeyOffset = uUsed;
+            uUsed += (size_t)pEntry->uKeyLength + 1;
+        }
+    }
+    assert(uUsed == uLive);
+
+    if(pcKey != NULL){
+        memcpy(pcNewHeap + uUsed, pcKey, uExtra);
+        *puOffset = uUsed;
+        uUsed += uExtra;
+    }
+
+    SymTable_release(oSymTable, oSymTable->pcHeap, oSymTable->uHeapSize);
+    oSymTable->pcHeap = pcNewHeap;
+    oSymTable->uHeapSize = uSize;
+    oSymTable->uHeapUsed = uUsed;
+    oSymTable->uHeapGarbage = 0;
+    return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+SymTable_T SymTable_new(void){
+    return SymTable_newWithAllocator(&defaultAllocator);
+}
+
+/*--------------------------------------------------------------------*/
+
+SymTable_T SymTable_newWithAllocator(const SymTable_Allocator *pAllocator){
+    SymTable_T oSymTable;
+    size_t u;
+
+    assert(pAllocator != NULL);
+    assert(pAllocator->pfAlloc != NULL);
+    assert(pAllocator->pfFree != NULL);
+
+    oSymTable = (SymTable_T)(*pAllocator->pfAlloc)(sizeof(struct SymTable),
+        pAllocator->pvContext);
+    if (oSymTable == NULL)
+       return NULL;
+    oSymTable->allocator = *pAllocator;
+    oSymTable->uBytes = sizeof(struct SymTable);
+
+    oSymTable->puBuckets = (uint32_t*)SymTable_alloc(oSymTable,
+        INITIAL_BUCKETS * sizeof(uint32_t));
+    if(oSymTable->puBuckets == NULL){
+        SymTable_release(oSymTable, oSymTable, sizeof(struct SymTable));
+        return NULL;
+    }
+    for(u = 0; u < INITIAL_BUCKETS; u++){
+        oSymTable->puBuckets[u] = NO_ENTRY;
+    }
+    oSymTable->uBucketCount = INITIAL_BUCKETS;
+
+    /* The entries and the key heap are made by the first put */
+    oSymTable->pEntries = NULL;
+    oSymTable->uEntryCapacity = 0;
+    oSymTable->uEntriesUsed = 0;
+    oSymTable->uFree = NO_ENTRY;
+    oSymTable->pcHeap = NULL;
+    oSymTable->uHeapSize = 0;
+    oSymTable->uHeapUsed = 0;
+    oSymTable->uHeapGarbage = 0;
+    oSymTable->size = 0;
+    return oSymTable;
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t SymTable_memoryUsage(SymTable_T oSymTable){
+    assert(oSymTable != NULL);
+
+    return oSymTable->uBytes;
+}
+
+/*--------------------------------------------------------------------*/
+
+void SymTable_free(SymTable_T oSymTable){
+    assert(oSymTable != NULL);
+
+    SymTable_release(oSymTable, oSymTable->pcHeap, oSymTable->uHeapSize);
+    SymTable_release(oSymTable, oSymTable->pEntries,
+        oSymTable->uEntryCapacity * sizeof(struct CompactEntry));
+    SymTable_release(oSymTable, oSymTable->puBuckets,
+        oSymTable->uBucketCount * sizeof(uint32_t));
+    SymTable_release(oSymTable, oSymTable, sizeof(struct SymTable));
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t SymTable_getLength(SymTable_T oSymTable){
+    assert(oSymTable != NULL);
+
+    return oSymTable->size;
+}
+
+/*--------------------------------------------------------------------*/
+
+int SymTable_put(SymTable_T oSymTable, const char *pcKey,
+    const void *pvValue){
+    struct CompactEntry *pEntry;
+    uint64_t uHash;
+    uint64_t uOffset;
+    uint32_t uIndex;
+    size_t strLength;
+    size_t uBucket;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    strLength = strlen(pcKey);
+    if(strLength >= UINT32_MAX){
+        return 0;
+    }
+    uHash = SymTable_hash(pcKey, strLength);
+    if(SymTable_lookup(oSymTable, pcKey, strLength, uHash) != NULL){
+        return 0;
+    }
+
+    /* Each step that can fail leaves the table as it was */
+    if(oSymTable->size + 1 > oSymTable->uBucketCount * MAX_LOAD){
+        if(!SymTable_rehash(oSymTable, oSymTable->uBucketCount * 2)){
+            return 0;
+        }
+    }
+    if(oSymTable->uFree == NO_ENTRY
+        && oSymTable->uEntriesUsed == oSymTable->uEntryCapacity){
+        if(!SymTable_growEntries(oSymTable)){
+            return 0;
+        }
+    }
+
+    /* Defensive copy, into the key heap */
+    if(strLength + 1 > oSymTable->uHeapSize - oSymTable->uHeapUsed){
+        if(!SymTable_moveHeap(oSymTable, strLength + 1, pcKey,
+            &uOffset)){
+            return 0;
+        }
+    }
+    else{
+        uOffset = oSymTable->uHeapUsed;
+        memcpy(oSymTable->pcHeap + oSymTable->uHeapUsed, pcKey,
+            strLength + 1);
+        oSymTable->uHeapUsed += strLength + 1;
+    }
+
+    if(oSymTable->uFree != NO_ENTRY){
+        uIndex = oSymTable->uFree;
+        oSymTable->uFree = oSymTable->pEntries[uIndex].uNext;
+    }
+    else{
+        uIndex = (uint32_t)oSymTable->uEntriesUsed++;
+    }
+    pEntry = &oSymTable->pEntries[uIndex];
+    pEntry->uKeyLength = (uint32_t)strLength;
+    pEntry->uKeyOffset = uOffset;
+    pEntry->pvValue = pvValue;
+
+    uBucket = (size_t)uHash & (oSymTable->uBucketCount - 1);
+    pEntry->uNext = oSymTable->puBuckets[uBucket];
+    oSymTable->puBuckets[uBucket] = uIndex;
+    oSymTable->size++;
+    return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *SymTable_replace(SymTable_T oSymTable, const char *pcKey,
+    const void *pvValue){
+    struct CompactEntry *pEntry;
+    const void *pOldValue;
+    uint32_t *puLink;
+    size_t strLength;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    strLength = strlen(pcKey);
+    puLink = SymTable_lookup(oSymTable, pcKey, strLength,
+        SymTable_hash(pcKey, strLength));
+    if(puLink == NULL){
+        return NULL;
+    }
+    pEntry = &oSymTable->pEntries[*puLink];
+    pOldValue = pEntry->pvValue;
+    pEntry->pvValue = pvValue;
+    return (void*) pOldValue;
+}
+
+/*--------------------------------------------------------------------*/
+
+int SymTable_contains(SymTable_T oSymTable, const char *pcKey){
+    size_t strLength;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    strLength = strlen(pcKey);
+    return SymTable_lookup(oSymTable, pcKey, strLength,
+        SymTable_hash(pcKey, strLength)) != NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *SymTable_get(SymTable_T oSymTable, const char *pcKey){
+    uint32_t *puLink;
+    size_t strLength;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    strLength = strlen(pcKey);
+    puLink = SymTable_lookup(oSymTable, pcKey, strLength,
+        SymTable_hash(pcKey, strLength));
+    if(puLink == NULL){
+        return NULL;
+    }
+    return (void*)oSymTable->pEntries[*puLink].pvValue;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *SymTable_remove(SymTable_T oSymTable, const char *pcKey){
+    struct CompactEntry *pEntry;
+    const void *pOldValue;
+    uint32_t *puLink;
+    uint32_t uIndex;
+    size_t strLength;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    strLength = strlen(pcKey);
+    puLink = SymTable_lookup(oSymTable, pcKey, strLength,
+        SymTable_hash(pcKey, strLength));
+    if(puLink == NULL){
+        return NULL;
+    }
+    uIndex = *puLink;
+    pEntry = &oSymTable->pEntries[uIndex];
+    pOldValue = pEntry->pvValue;
+
+    /* The entry goes on the free list and its key is left in the heap
+       as garbage */
+    *puLink = pEntry->uNext;
+    pEntry->uNext = oSymTable->uFree;
+    oSymTable->uFree = uIndex;
+    oSymTable->uHeapGarbage += (size_t)pEntry->uKeyLength + 1;
+    oSymTable->size--;
+
+    /* Once a quarter of the heap is garbage, the live keys move to a
+       smaller one. If that fails the garbage simply stays. */
+    if(oSymTable->uHeapGarbage * 4 >= oSymTable->uHeapSize){
+        (void)SymTable_moveHeap(oSymTable, 0, NULL, NULL);
+    }
+    return (void*) pOldValue;
+}
+
+/*--------------------------------------------------------------------*/
+
+void SymTable_map(SymTable_T oSymTable, void (*pfApply)
+    (const char *pcKey, void *pvValue, void *pvExtra),
+    const void *pvExtra){
+    struct CompactEntry *pEntry;
+    uint32_t uIndex;
+    size_t counter;
+
+    assert(oSymTable != NULL);
+    assert(pfApply != NULL);
+
+    for(counter = 0; counter < oSymTable->uBucketCount; counter++){
+        for(uIndex = oSymTable->puBuckets[counter]; uIndex != NO_ENTRY;
+            uIndex = pEntry->uNext){
+            pEntry = &oSymTable->pEntries[uIndex];
+            (*pfApply)(SymTable_keyOf(oSymTable, pEntry),
+                (void*)pEntry->pvValue, (void*) pvExtra);
+        }
+    }
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t SymTable_removeIf(SymTable_T oSymTable, int (*pfPredicate)
+    (const char *pcKey, void *pvValue, void *pvExtra),
+    const void *pvExtra, void (*pfRemoved)
+    (const char *pcKey, void *pvValue, void *pvExtra)){
+    struct CompactEntry *pEntry;
+    uint32_t *puLink;
+    uint32_t uIndex;
+    size_t uRemoved = 0;
+    size_t counter;
+
+    assert(oSymTable != NULL);
+    assert(pfPredicate != NULL);
+
+    for(counter = 0; counter < oSymTable->uBucketCount; counter++){
+        puLink = &oSymTable->puBuckets[counter];
+        while((uIndex = *puLink) != NO_ENTRY){
+            pEntry = &oSymTable->pEntries[uIndex];
+            if(! (*pfPredicate)(SymTable_keyOf(oSymTable, pEntry),
+                (void*)pEntry->pvValue, (void*) pvExtra)){
+                puLink = &pEntry->uNext;
+                continue;
+            }
+            if(pfRemoved != NULL){
+                (*pfRemoved)(SymTable_keyOf(oSymTable, pEntry),
+                    (void*)pEntry->pvValue, (void*) pvExtra);
+            }
+            *puLink = pEntry->uNext;
+            pEntry->uNext = oSymTable->uFree;
+            oSymTable->uFree = uIndex;
+            oSymTable->uHeapGarbage += (size_t)pEntry->uKeyLength + 1;
+            uRemoved++;
+        }
+    }
+    oSymTable->size -= uRemoved;
+
+    /* Once the table is under a quarter of its most load, the buckets
+       halve until it is at least half. The removed entries stay on the
+       free list. If either step fails the table stays as it is. */
+    if(oSymTable->size * 4 < oSymTable->uBucketCount * MAX_LOAD){
+        counter = oSymTable->uBucketCount;
+        while(counter / 2 >= INITIAL_BUCKETS
+            && oSymTable->size * 2 <= counter / 2 * MAX_LOAD){
+            counter /= 2;
+        }
+        if(counter < oSymTable->uBucketCount){
+            (void)SymTable_rehash(oSymTable, counter);
+        }
+    }
+    if(uRemoved != 0
+        && oSymTable->uHeapGarbage * 4 >= oSymTable->uHeapSize){
+        (void)SymTable_moveHeap(oSymTable, 0, NULL, NULL);
+    }
+    return uRemoved;
+}
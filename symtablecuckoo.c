@@ -0,0 +1,850 @@
+/*--------------------------------------------------------------------*/
+/*                                                                    */
+/* Implementation of the SymTable ADT as a bucketized cuckoo hash     */
+/* table, so that every lookup reads at most two buckets              */
+/*                                                                    */
+/* Author: Maxwell Lloyd                                              */
+/*                                                                    */
+/*--------------------------------------------------------------------*/
+
+
+
+#include <stddef.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "symtable.h"
+
+/* Bindings each bucket holds */
+enum {CUCKOO_SLOTS = 4};
+
+/* Bytes in a cache line, which each bucket fills exactly */
+enum {CACHE_LINE = 64};
+
+/* Number of buckets in a new table */
+enum {INITIAL_BUCKETS = 64};
+
+/* Bindings kept outside the buckets when no room can be made */
+enum {STASH_SIZE = 4};
+
+/* Longest chain of moves tried to make room for a binding */
+enum {MAX_PATH_LENGTH = 5};
+
+/* Most buckets looked at while searching for room */
+enum {MAX_SEARCH = 256};
+
+/* Most times a rehash doubles again when the entries do not fit */
+enum {MAX_REHASH_TRIES = 4};
+
+/*--------------------------------------------------------------------*/
+
+/* Each binding is stored in a CuckooEntry */
+struct CuckooEntry{
+    /* Full hash code of the key */
+    uint64_t uHash;
+
+    /* Value of the binding */
+    const void *pvValue;
+
+    /* Key of the binding */
+    char acKey[];
+};
+
+/*--------------------------------------------------------------------*/
+
+/* A CuckooBucket fills one cache line. A slot is empty if its tag is
+   0; otherwise the tag holds high bits of the entry's hash code, so
+   that most mismatches are found without reading the entry. */
+struct CuckooBucket{
+    /* Tags of the slots */
+    uint32_t auTags[CUCKOO_SLOTS];
+
+    /* Entries of the slots */
+    struct CuckooEntry *apEntries[CUCKOO_SLOTS];
+
+    /* Unused, to fill the cache line */
+    unsigned char aucPad[CACHE_LINE - CUCKOO_SLOTS * sizeof(uint32_t)
+        - CUCKOO_SLOTS * sizeof(struct CuckooEntry*)];
+};
+
+/*--------------------------------------------------------------------*/
+
+/* SymTable object is a manager pointing to the buckets of a
+   SymTable_T object */
+struct SymTable{
+    /* Buckets, aligned to a cache line within pvBlock */
+    struct CuckooBucket *pBuckets;
+
+    /* Block holding pBuckets, as the allocator returned it */
+    void *pvBlock;
+
+    /* Number of buckets, a power of 2 */
+    size_t uBucketCount;
+
+    /* size of the entire symtable */
+    size_t size;
+
+    /* Bindings for which no bucket had room */
+    struct CuckooEntry *apStash[STASH_SIZE];
+
+    /* Number of bindings in apStash */
+    size_t uStashCount;
+
+    /* Source of every block the table holds */
+    SymTable_Allocator allocator;
+
+    /* Bytes currently held from allocator */
+    size_t uBytes;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* One bucket reached while searching for room, and how it was
+   reached */
+struct CuckooStep{
+    /* The bucket */
+    size_t uBucket;
+
+    /* Index of the step whose bucket has an entry that could move
+       here, or -1 for one of the new key's own buckets */
+    int iParent;
+
+    /* Slot of that entry in the parent's bucket */
+    unsigned uSlot;
+
+    /* Number of moves from one of the new key's buckets */
+    unsigned uDepth;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Return uSize bytes from malloc. pvContext is unused. */
+
+static void *SymTable_defaultAlloc(size_t uSize, void *pvContext)
+{
+    (void)pvContext;
+    return malloc(uSize);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Free pvBlock, which SymTable_defaultAlloc returned. */
+
+static void SymTable_defaultFree(void *pvBlock, size_t uSize,
+    void *pvContext)
+{
+    (void)uSize;
+    (void)pvContext;
+    free(pvBlock);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* The allocator of tables made by SymTable_new */
+static const SymTable_Allocator defaultAllocator = {
+    SymTable_defaultAlloc, SymTable_defaultFree, NULL};
+
+/*--------------------------------------------------------------------*/
+
+/* Return uSize bytes from the allocator of oSymTable, or NULL if it
+   refuses. */
+
+static void *SymTable_alloc(SymTable_T oSymTable, size_t uSize)
+{
+    void *pvBlock;
+
+    assert(oSymTable != NULL);
+
+    pvBlock = (*oSymTable->allocator.pfAlloc)(uSize,
+        oSymTable->allocator.pvContext);
+    if(pvBlock != NULL){
+        oSymTable->uBytes += uSize;
+    }
+    return pvBlock;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Give the uSize bytes at pvBlock back to the allocator of
+   oSymTable. */
+
+static void SymTable_release(SymTable_T oSymTable, void *pvBlock,
+    size_t uSize)
+{
+    assert(oSymTable != NULL);
+    assert(pvBlock != NULL);
+
+    oSymTable->uBytes -= uSize;
+    (*oSymTable->allocator.pfFree)(pvBlock, uSize,
+        oSymTable->allocator.pvContext);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Free pEntry of oSymTable. */
+
+static void SymTable_freeEntry(SymTable_T oSymTable,
+    struct CuckooEntry *pEntry)
+{
+    assert(pEntry != NULL);
+
+    SymTable_release(oSymTable, pEntry,
+        sizeof(struct CuckooEntry) + strlen(pEntry->acKey) + 1);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Pass pEntry of oSymTable, which is no longer in its bucket or the
+   stash, to pfRemoved with pvExtra if pfRemoved is not NULL, then free
+   it. */
+
+static void SymTable_removeEntry(SymTable_T oSymTable,
+    struct CuckooEntry *pEntry, void (*pfRemoved)
+    (const char *pcKey, void *pvValue, void *pvExtra),
+    const void *pvExtra)
+{
+    assert(pEntry != NULL);
+
+    if(pfRemoved != NULL){
+        (*pfRemoved)(pEntry->acKey, (void*)pEntry->pvValue,
+            (void*) pvExtra);
+    }
+    SymTable_freeEntry(oSymTable, pEntry);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the number of bytes the block of uBucketCount buckets takes,
+   with room to align them. */
+
+static size_t SymTable_blockSize(size_t uBucketCount)
+{
+    return uBucketCount * sizeof(struct CuckooBucket) + CACHE_LINE - 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the hash code for pcKey. The low bits pick the first bucket
+   and the high bits make the tag, so the bits are mixed well. */
+
+static uint64_t SymTable_hash(const char *pcKey)
+{
+    uint64_t uHash = UINT64_C(14695981039346656037);
+    size_t u;
+
+    assert(pcKey != NULL);
+
+    for(u = 0; pcKey[u] != '\0'; u++){
+        uHash ^= (unsigned char)pcKey[u];
+        uHash *= UINT64_C(1099511628211);
+    }
+
+    uHash ^= uHash >> 33;
+    uHash *= UINT64_C(0xff51afd7ed558ccd);
+    uHash ^= uHash >> 33;
+    uHash *= UINT64_C(0xc4ceb9fe1a85ec53);
+    uHash ^= uHash >> 33;
+    return uHash;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the tag of the hash code uHash, which is never 0. */
+
+static uint32_t SymTable_tag(uint64_t uHash)
+{
+    uint32_t uTag = (uint32_t)(uHash >> 32);
+    return (uTag == 0) ? 1 : uTag;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the other bucket of an entry with tag uTag that is in bucket
+   uBucket of oSymTable. Since it depends only on the tag, entries can
+   move without reading their keys, and each bucket is the other's
+   other bucket. */
+
+static size_t SymTable_otherBucket(SymTable_T oSymTable, size_t uBucket,
+    uint32_t uTag)
+{
+    return (uBucket ^ ((size_t)uTag * 0x5bd1e995u))
+        & (oSymTable->uBucketCount - 1);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Look for pcKey, whose hash code is uHash, in oSymTable. If it is
+   found, store its bucket in *ppBucket, or NULL if it is in the stash,
+   and its slot in *puSlot, and return 1. Otherwise return 0. */
+
+static int SymTable_find(SymTable_T oSymTable, const char *pcKey,
+    uint64_t uHash, struct CuckooBucket **ppBucket, unsigned *puSlot)
+{
+    struct CuckooBucket *pBucket;
+    struct CuckooBucket *pOther;
+    uint32_t uTag;
+    size_t uFirst;
+    unsigned u;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    uTag = SymTable_tag(uHash);
+    uFirst = (size_t)uHash & (oSymTable->uBucketCount - 1);
+    pBucket = &oSymTable->pBuckets[uFirst];
+    pOther = &oSymTable->pBuckets[
+        SymTable_otherBucket(oSymTable, uFirst, uTag)];
+#ifdef __GNUC__
+    __builtin_prefetch(pOther);
+#endif
+
+    for(u = 0; u < CUCKOO_SLOTS; u++){
+        if(pBucket->auTags[u] == uTag
+            && pBucket->apEntries[u]->uHash == uHash
+            && strcmp(pBucket->apEntries[u]->acKey, pcKey) == 0){
+            *ppBucket = pBucket;
+            *puSlot = u;
+            return 1;
+        }
+    }
+    for(u = 0; u < CUCKOO_SLOTS; u++){
+        if(pOther->auTags[u] == uTag
+            && pOther->apEntries[u]->uHash == uHash
+            && strcmp(pOther->apEntries[u]->acKey, pcKey) == 0){
+            *ppBucket = pOther;
+            *puSlot = u;
+            return 1;
+        }
+    }
+
+    for(u = 0; u < oSymTable->uStashCount; u++){
+        if(oSymTable->apStash[u]->uHash == uHash
+            && strcmp(oSymTable->apStash[u]->acKey, pcKey) == 0){
+            *ppBucket = NULL;
+            *puSlot = u;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the first empty slot of pBucket, or CUCKOO_SLOTS if it is
+   full. */
+
+static unsigned SymTable_emptySlot(const struct CuckooBucket *pBucket)
+{
+    unsigned u;
+
+    assert(pBucket != NULL);
+
+    for(u = 0; u < CUCKOO_SLOTS; u++){
+        if(pBucket->auTags[u] == 0){
+            break;
+        }
+    }
+    return u;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return 1 if the bucket of step iStep in asSteps, or of any step it
+   was reached from, is uBucket, or 0 otherwise. */
+
+static int SymTable_onPath(const struct CuckooStep *asSteps, int iStep,
+    size_t uBucket)
+{
+    for(; iStep >= 0; iStep = asSteps[iStep].iParent){
+        if(asSteps[iStep].uBucket == uBucket){
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Put pEntry into one of its buckets in oSymTable, first moving other
+   entries to their other buckets to make room if needed. The moves
+   are found by a breadth-first search before any is made. Returns 1
+   for success or 0 if no room was found, in which case nothing
+   changes. */
+
+static int SymTable_place(SymTable_T oSymTable, struct CuckooEntry *pEntry)
+{
+    struct CuckooStep asSteps[MAX_SEARCH];
+    struct CuckooBucket *pBucket;
+    struct CuckooBucket *pTarget;
+    struct CuckooEntry *pMoving;
+    uint32_t uTag;
+    size_t uOther;
+    unsigned uTargetSlot;
+    unsigned uSlot;
+    int iSteps;
+    int iStep;
+    int i;
+
+    assert(oSymTable != NULL);
+    assert(pEntry != NULL);
+
+    uTag = SymTable_tag(pEntry->uHash);
+    asSteps[0].uBucket = (size_t)pEntry->uHash
+        & (oSymTable->uBucketCount - 1);
+    asSteps[1].uBucket = SymTable_otherBucket(oSymTable,
+        asSteps[0].uBucket, uTag);
+    for(i = 0; i < 2; i++){
+        asSteps[i].iParent = -1;
+        asSteps[i].uSlot = 0;
+        asSteps[i].uDepth = 0;
+        pBucket = &oSymTable->pBuckets[asSteps[i].uBucket];
+        uSlot = SymTable_emptySlot(pBucket);
+        if(uSlot < CUCKOO_SLOTS){
+            pBucket->auTags[uSlot] = uTag;
+            pBucket->apEntries[uSlot] = pEntry;
+            return 1;
+        }
+    }
+
+    /* Both buckets are full: look for an entry that can move to an
+       empty slot of its other bucket, possibly after others move */
+    iSteps = 2;
+    for(iStep = 0; iStep < iSteps; iStep++){
+        if(asSteps[iStep].uDepth == MAX_PATH_LENGTH){
+            continue;
+        }
+        pBucket = &oSymTable->pBuckets[asSteps[iStep].uBucket];
+        for(uSlot = 0; uSlot < CUCKOO_SLOTS; uSlot++){
+            uOther = SymTable_otherBucket(oSymTable, asSteps[iStep].uBucket,
+                pBucket->auTags[uSlot]);
+            pTarget = &oSymTable->pBuckets[uOther];
+            uTargetSlot = SymTable_emptySlot(pTarget);
+            if(uTargetSlot < CUCKOO_SLOTS){
+                goto found;
+            }
+            if(iSteps < MAX_SEARCH
+                && !SymTable_onPath(asSteps, iStep, uOther)){
+                asSteps[iSteps].uBucket = uOther;
+                asSteps[iSteps].iParent = iStep;
+                asSteps[iSteps].uSlot = uSlot;
+                asSteps[iSteps].uDepth = asSteps[iStep].uDepth + 1;
+                iSteps++;
+            }
+        }
+    }
+    return 0;
+
+found:
+    /* Make the moves from the far end, so each lands in a slot that
+       was just emptied */
+    for(;;){
+        pBucket = &oSymTable->pBuckets[asSteps[iStep].uBucket];
+        pMoving = pBucket->apEntries[uSlot];
+        pTarget->auTags[uTargetSlot] = pBucket->auTags[uSlot];
+        pTarget->apEntries[uTargetSlot] = pMoving;
+        pTarget = pBucket;
+        uTargetSlot = uSlot;
+        if(asSteps[iStep].iParent < 0){
+            break;
+        }
+        uSlot = asSteps[iStep].uSlot;
+        iStep = asSteps[iStep].iParent;
+    }
+    pTarget->auTags[uTargetSlot] = uTag;
+    pTarget->apEntries[uTargetSlot] = pEntry;
+    return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Move every entry of oSymTable into a new array of uBucketCount
+   buckets, doubling it again a few times if the entries do not fit.
+   Returns 1 for success or 0 for failure, in which case nothing
+   changes. */
+
+static int SymTable_rehash(SymTable_T oSymTable, size_t uBucketCount)
+{
+    struct CuckooBucket *pOldBuckets;
+    struct CuckooEntry *apOldStash[STASH_SIZE];
+    struct CuckooEntry *pEntry;
+    void *pvOldBlock;
+    void *pvBlock;
+    size_t uOldCount;
+    size_t uOldStashCount;
+    size_t uBucket;
+    size_t u;
+    unsigned uSlot;
+    int iFits;
+    int iTries;
+
+    assert(oSymTable != NULL);
+
+    pOldBuckets = oSymTable->pBuckets;
+    pvOldBlock = oSymTable->pvBlock;
+    uOldCount = oSymTable->uBucketCount;
+    uOldStashCount = oSymTable->uStashCount;
+    memcpy(apOldStash, oSymTable->apStash, sizeof(apOldStash));
+
+    for(iTries = 0; ; iTries++){
+        if(iTries == MAX_REHASH_TRIES){
+            return 0;
+        }
+        pvBlock = SymTable_alloc(oSymTable, SymTable_blockSize(uBucketCount));
+        if(pvBlock == NULL){
+            return 0;
+        }
+        oSymTable->pvBlock = pvBlock;
+        oSymTable->pBuckets = (struct CuckooBucket*)(((uintptr_t)pvBlock
+            + CACHE_LINE - 1) & ~(uintptr_t)(CACHE_LINE - 1));
+        oSymTable->uBucketCount = uBucketCount;
+        oSymTable->uStashCount = 0;
+        memset(oSymTable->pBuckets, 0,
+            uBucketCount * sizeof(struct CuckooBucket));
+
+        iFits = 1;
+        for(uBucket = 0; iFits && uBucket < uOldCount; uBucket++){
+            for(uSlot = 0; uSlot < CUCKOO_SLOTS; uSlot++){
+                pEntry = pOldBuckets[uBucket].apEntries[uSlot];
+                if(pOldBuckets[uBucket].auTags[uSlot] != 0
+                    && !SymTable_place(oSymTable, pEntry)){
+                    iFits = 0;
+                    break;
+                }
+            }
+        }
+        for(u = 0; iFits && u < uOldStashCount; u++){
+            if(!SymTable_place(oSymTable, apOldStash[u])){
+                iFits = 0;
+            }
+        }
+        if(iFits){
+            break;
+        }
+
+        /* Rare: try again with more room */
+        SymTable_release(oSymTable, pvBlock,
+            SymTable_blockSize(uBucketCount));
+        oSymTable->pBuckets = pOldBuckets;
+        oSymTable->pvBlock = pvOldBlock;
+        oSymTable->uBucketCount = uOldCount;
+        oSymTable->uStashCount = uOldStashCount;
+        uBucketCount *= 2;
+    }
+
+    SymTable_release(oSymTable, pvOldBlock, SymTable_blockSize(uOldCount));
+    return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+SymTable_T SymTable_new(void){
+    return SymTable_newWithAllocator(&defaultAllocator);
+}
+
+/*--------------------------------------------------------------------*/
+
+SymTable_T SymTable_newWithAllocator(const SymTable_Allocator *pAllocator){
+    SymTable_T oSymTable;
+
+    assert(pAllocator != NULL);
+    assert(pAllocator->pfAlloc != NULL);
+    assert(pAllocator->pfFree != NULL);
+
+    oSymTable = (SymTable_T)(*pAllocator->pfAlloc)(sizeof(struct SymTable),
+        pAllocator->pvContext);
+    if (oSymTable == NULL)
+       return NULL;
+    oSymTable->allocator = *pAllocator;
+    oSymTable->uBytes = sizeof(struct SymTable);
+
+    oSymTable->pvBlock = SymTable_alloc(oSymTable,
+        SymTable_blockSize(INITIAL_BUCKETS));
+    if(oSymTable->pvBlock == NULL){
+        SymTable_release(oSymTable, oSymTable, sizeof(struct SymTable));
+        return NULL;
+    }
+    oSymTable->pBuckets = (struct CuckooBucket*)
+        (((uintptr_t)oSymTable->pvBlock + CACHE_LINE - 1)
+        & ~(uintptr_t)(CACHE_LINE - 1));
+    memset(oSymTable->pBuckets, 0,
+        INITIAL_BUCKETS * sizeof(struct CuckooBucket));
+
+    oSymTable->uBucketCount = INITIAL_BUCKETS;
+    oSymTable->size = 0;
+    oSymTable->uStashCount = 0;
+    return oSymTable;
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t SymTable_memoryUsage(SymTable_T oSymTable){
+    assert(oSymTable != NULL);
+
+    return oSymTable->uBytes;
+}
+
+/*--------------------------------------------------------------------*/
+
+void SymTable_free(SymTable_T oSymTable){
+    struct CuckooBucket *pBucket;
+    size_t counter;
+    unsigned uSlot;
+
+    assert(oSymTable != NULL);
+
+    for(counter = 0; counter < oSymTable->uBucketCount; counter++){
+        pBucket = &oSymTable->pBuckets[counter];
+        for(uSlot = 0; uSlot < CUCKOO_SLOTS; uSlot++){
+            if(pBucket->auTags[uSlot] != 0){
+                SymTable_freeEntry(oSymTable, pBucket->apEntries[uSlot]);
+            }
+        }
+    }
+    for(counter = 0; counter < oSymTable->uStashCount; counter++){
+        SymTable_freeEntry(oSymTable, oSymTable->apStash[counter]);
+    }
+
+    SymTable_release(oSymTable, oSymTable->pvBlock,
+        SymTable_blockSize(oSymTable->uBucketCount));
+    SymTable_release(oSymTable, oSymTable, sizeof(struct SymTable));
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t SymTable_getLength(SymTable_T oSymTable){
+    assert(oSymTable != NULL);
+
+    return oSymTable->size;
+}
+
+/*--------------------------------------------------------------------*/
+
+int SymTable_put(SymTable_T oSymTable, const char *pcKey,
+    const void *pvValue){
+    struct CuckooEntry *pEntry;
+    struct CuckooBucket *pBucket;
+    unsigned uSlot;
+    uint64_t uHash;
+    size_t strLength;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    uHash = SymTable_hash(pcKey);
+    if(SymTable_find(oSymTable, pcKey, uHash, &pBucket, &uSlot)){
+        return 0;
+    }
+
+    /* Grow past 90% full, where making room gets slow */
+    if((oSymTable->size + 1) * 10
+        > oSymTable->uBucketCount * CUCKOO_SLOTS * 9){
+        if(!SymTable_rehash(oSymTable, oSymTable->uBucketCount * 2)){
+            return 0;
+        }
+    }
+
+    /* Defensive copy */
+    strLength = strlen(pcKey) + 1;
+    pEntry = (struct CuckooEntry*)SymTable_alloc(oSymTable,
+        sizeof(struct CuckooEntry) + strLength);
+    if(pEntry == NULL){
+        return 0;
+    }
+    pEntry->uHash = uHash;
+    pEntry->pvValue = pvValue;
+    memcpy(pEntry->acKey, pcKey, strLength);
+
+    if(!SymTable_place(oSymTable, pEntry)){
+        if(oSymTable->uStashCount < STASH_SIZE){
+            oSymTable->apStash[oSymTable->uStashCount++] = pEntry;
+        }
+        else if(!SymTable_rehash(oSymTable, oSymTable->uBucketCount * 2)
+            || !SymTable_place(oSymTable, pEntry)){
+            SymTable_freeEntry(oSymTable, pEntry);
+            return 0;
+        }
+    }
+    oSymTable->size++;
+    return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *SymTable_replace(SymTable_T oSymTable, const char *pcKey,
+    const void *pvValue){
+    struct CuckooBucket *pBucket;
+    struct CuckooEntry *pEntry;
+    const void *pOldValue;
+    unsigned uSlot;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    if(!SymTable_find(oSymTable, pcKey, SymTable_hash(pcKey), &pBucket,
+        &uSlot)){
+        return NULL;
+    }
+    pEntry = (pBucket == NULL) ? oSymTable->apStash[uSlot]
+        : pBucket->apEntries[uSlot];
+    pOldValue = pEntry->pvValue;
+    pEntry->pvValue = pvValue;
+    return (void*) pOldValue;
+}
+
+/*--------------------------------------------------------------------*/
+
+int SymTable_contains(SymTable_T oSymTable, const char *pcKey){
+    struct CuckooBucket *pBucket;
+    unsigned uSlot;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    return SymTable_find(oSymTable, pcKey, SymTable_hash(pcKey), &pBucket,
+        &uSlot);
+}
+
+/*--------------------------------------------------------------------*/
+
+void *SymTable_get(SymTable_T oSymTable, const char *pcKey){
+    struct CuckooBucket *pBucket;
+    unsigned uSlot;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    if(!SymTable_find(oSymTable, pcKey, SymTable_hash(pcKey), &pBucket,
+        &uSlot)){
+        return NULL;
+    }
+    if(pBucket == NULL){
+        return (void*)oSymTable->apStash[uSlot]->pvValue;
+    }
+    return (void*)pBucket->apEntries[uSlot]->pvValue;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *SymTable_remove(SymTable_T oSymTable, const char *pcKey){
+    struct CuckooBucket *pBucket;
+    struct CuckooEntry *pEntry;
+    const void *pOldValue;
+    unsigned uSlot;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    if(!SymTable_find(oSymTable, pcKey, SymTable_hash(pcKey), &pBucket,
+        &uSlot)){
+        return NULL;
+    }
+    if(pBucket == NULL){
+        pEntry = oSymTable->apStash[uSlot];
+        oSymTable->apStash[uSlot] =
+            oSymTable->apStash[--oSymTable->uStashCount];
+    }
+    else{
+        pEntry = pBucket->apEntries[uSlot];
+        pBucket->auTags[uSlot] = 0;
+        pBucket->apEntries[uSlot] = NULL;
+    }
+
+    pOldValue = pEntry->pvValue;
+    SymTable_freeEntry(oSymTable, pEntry);
+    oSymTable->size--;
+    return (void*) pOldValue;
+}
+
+/*--------------------------------------------------------------------*/
+
+void SymTable_map(SymTable_T oSymTable, void (*pfApply)
+    (const char *pcKey, void *pvValue, void *pvExtra),
+    const void *pvExtra){
+    struct CuckooBucket *pBucket;
+    struct CuckooEntry *pEntry;
+    size_t counter;
+    unsigned uSlot;
+
+    assert(oSymTable != NULL);
+    assert(pfApply != NULL);
+
+    for(counter = 0; counter < oSymTable->uBucketCount; counter++){
+        pBucket = &oSymTable->pBuckets[counter];
+        for(uSlot = 0; uSlot < CUCKOO_SLOTS; uSlot++){
+            if(pBucket->auTags[uSlot] != 0){
+                pEntry = pBucket->apEntries[uSlot];
+                (*pfApply)(pEntry->acKey, (void*)pEntry->pvValue,
+                    (void*) pvExtra);
+            }
+        }
+    }
+    for(counter = 0; counter < oSymTable->uStashCount; counter++){
+        pEntry = oSymTable->apStash[counter];
+        (*pfApply)(pEntry->acKey, (void*)pEntry->pvValue, (void*) pvExtra);
+    }
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t SymTable_removeIf(SymTable_T oSymTable, int (*pfPredicate)
+    (const char *pcKey, void *pvValue, void *pvExtra),
+    const void *pvExtra, void (*pfRemoved)
+    (const char *pcKey, void *pvValue, void *pvExtra)){
+    struct CuckooBucket *pBucket;
+    struct CuckooEntry *pEntry;
+    size_t uRemoved = 0;
+    size_t counter;
+    unsigned uSlot;
+
+    assert(oSymTable != NULL);
+    assert(pfPredicate != NULL);
+
+    for(counter = 0; counter < oSymTable->uBucketCount; counter++){
+        pBucket = &oSymTable->pBuckets[counter];
+        for(uSlot = 0; uSlot < CUCKOO_SLOTS; uSlot++){
+            pEntry = pBucket->apEntries[uSlot];
+            if(pBucket->auTags[uSlot] == 0
+                || ! (*pfPredicate)(pEntry->acKey, (void*)pEntry->pvValue,
+                    (void*) pvExtra)){
+                continue;
+            }
+            pBucket->auTags[uSlot] = 0;
+            pBucket->apEntries[uSlot] = NULL;
+            SymTable_removeEntry(oSymTable, pEntry, pfRemoved, pvExtra);
+            uRemoved++;
+        }
+    }
+
+    /* The last entry of the stash fills each hole, so the same index
+       is looked at again */
+    counter = 0;
+    while(counter < oSymTable->uStashCount){
+        pEntry = oSymTable->apStash[counter];
+        if(! (*pfPredicate)(pEntry->acKey, (void*)pEntry->pvValue,
+            (void*) pvExtra)){
+            counter++;
+            continue;
+        }
+        oSymTable->apStash[counter] =
+            oSymTable->apStash[--oSymTable->uStashCount];
+        SymTable_removeEntry(oSymTable, pEntry, pfRemoved, pvExtra);
+        uRemoved++;
+    }
+    oSymTable->size -= uRemoved;
+
+    /* Once the table is under an eighth full, the buckets halve until
+       it is at least half full. If they cannot, the table stays as it
+       is. */
+    if(oSymTable->size * 8 < oSymTable->uBucketCount * CUCKOO_SLOTS){
+        counter = oSymTable->uBucketCount;
+        while(counter / 2 >= INITIAL_BUCKETS
+            && oSymTable->size * 2 <= counter / 2 * CUCKOO_SLOTS){
+            counter /= 2;
+        }
+        if(counter < oSymTable->uBucketCount){
+            (void)SymTable_rehash(oSymTable, counter);
+        }
+    }
+    return uRemoved;
+}
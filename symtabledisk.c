@@ -0,0 +1,1759 @@
+/*--------------------------------------------------------------------*/
+/*                                                                    */
+/* Implementation of the SymTable ADT as an extendible hash table     */
+/* whose buckets are pages of a scratch file, read and written        */
+/* through a bounded cache, so that a table can outgrow memory        */
+/*                                                                    */
+/* Author: Maxwell Lloyd                                              */
+/*                                                                    */
+/*--------------------------------------------------------------------*/
+
+
+
+/* pread, pwrite and mkstemp are POSIX, and the file may pass 2GB */
+#define _POSIX_C_SOURCE 200809L
+#define _FILE_OFFSET_BITS 64
+
+#include <stddef.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include "symtabledisk.h"
+
+/* Bytes in a page of the file, and in each frame of the cache */
+enum {DISK_PAGE_SIZE = 4096};
+
+/* Pages the cache of SymTable_new holds, and the fewest any cache
+   holds, enough for every page one operation uses at once */
+enum {DEFAULT_CACHE_PAGES = 16384, MIN_CACHE_PAGES = 8};
+
+/* Most bits of the hash code the directory uses. A bucket that fills
+   at this depth grows a chain of pages instead of splitting. */
+enum {MAX_DEPTH = 24};
+
+/* Longest key kept in its bucket page. Longer keys get pages of their
+   own, so that every bucket page has room for a few records. */
+enum {MAX_INLINE_KEY = 1024};
+
+/* Records are padded to a multiple of this many bytes */
+enum {RECORD_ALIGN = 8};
+
+/* Number of slots a new array of page numbers has */
+enum {INITIAL_WORDS = 16};
+
+/* Number of frames the array of frames has room for at first */
+enum {INITIAL_FRAMES = 8};
+
+/* Page number that refers to no page */
+#define NO_PAGE UINT32_MAX
+
+/* Frame index that refers to no frame */
+#define NO_FRAME SIZE_MAX
+
+/*--------------------------------------------------------------------*/
+
+/* Each bucket page starts with a DiskPage, followed by its records */
+struct DiskPage{
+    /* Next page of the bucket, or NO_PAGE. Only a bucket at MAX_DEPTH
+       has more than one page. */
+    uint32_t uNext;
+
+    /* Number of low bits of the hash code that every key of the
+       bucket shares */
+    uint32_t uLocalDepth;
+
+    /* Number of records, and the bytes they take */
+    uint32_t uCount;
+    uint32_t uUsed;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Each binding is a DiskRecord in a bucket page, followed by its key
+   and '\0' or, if the key is longer than MAX_INLINE_KEY, by the
+   number of the first page of its key, then padded to a multiple of
+   RECORD_ALIGN bytes */
+struct DiskRecord{
+    /* Low bits of the hash code of the key */
+    uint32_t uHash;
+
+    /* Length of the key, without its '\0' */
+    uint32_t uKeyLength;
+
+    /* Value of the binding */
+    const void *pvValue;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Each page of a long key starts with a DiskBlob */
+struct DiskBlob{
+    /* Next page of the key, or NO_PAGE */
+    uint32_t uNext;
+
+    /* Bytes of the key */
+    unsigned char aucBytes[];
+};
+
+/* Bytes of records a bucket page holds, and of a key a page of a long
+   key holds */
+enum {PAGE_ROOM = DISK_PAGE_SIZE - sizeof(struct DiskPage),
+    BLOB_ROOM = DISK_PAGE_SIZE - sizeof(struct DiskBlob)};
+
+/* Two buddy buckets merge once their records fit in this many bytes,
+   well short of a full page, so that a bucket does not split and
+   merge over and over */
+enum {MERGE_ROOM = PAGE_ROOM * 3 / 4};
+
+/*--------------------------------------------------------------------*/
+
+/* A DiskFrame holds one page of the file in memory */
+struct DiskFrame{
+    /* Bytes of the page */
+    unsigned char *pucData;
+
+    /* Number of the page */
+    uint32_t uPage;
+
+    /* Number of uses of pucData not yet done. A pinned frame is never
+       evicted. */
+    unsigned uPins;
+
+    /* 1 if pucData differs from the file, or 0 */
+    int iDirty;
+
+    /* 1 if the page was used since the clock hand last passed, or 0 */
+    int iReferenced;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* SymTable object is a manager pointing to the directory, the file and
+   the page cache of a SymTable_T object */
+struct SymTable{
+    /* The scratch file, already unlinked */
+    int iFd;
+
+    /* Bucket page of each value of the low uGlobalDepth bits of a hash
+       code, and the number of slots there is room for */
+    uint32_t *puDirectory;
+    size_t uDirectoryCapacity;
+    unsigned uGlobalDepth;
+
+    /* Number of buckets whose local depth is uGlobalDepth. The
+       directory halves once there are none. */
+    size_t uDeepBuckets;
+
+    /* Number of pages the file has ever had */
+    size_t uPageCount;
+
+    /* Pages given back, to be used again, and the number there is
+       room for */
+    uint32_t *puFree;
+    size_t uFreeCount;
+    size_t uFreeCapacity;
+
+    /* 1 more than the index of the frame holding each page, or 0, and
+       the number of pages there is room for */
+    uint32_t *puFrameOf;
+    size_t uFrameOfCapacity;
+
+    /* Frames of the cache, each holding a page, and the number there
+       is room for */
+    struct DiskFrame *pFrames;
+    size_t uFrameCount;
+    size_t uFrameCapacity;
+
+    /* Most frames the cache holds */
+    size_t uMaxFrames;
+
+    /* Next frame the clock hand looks at for eviction */
+    size_t uHand;
+
+    /* One page, to hold a bucket while it splits */
+    unsigned char *pucScratch;
+
+    /* A long key read back from its pages, and its size */
+    char *pcKeyBuffer;
+    size_t uKeyBufferSize;
+
+    /* size of the entire symtable */
+    size_t size;
+
+    /* Source of every block the table holds */
+    SymTable_Allocator allocator;
+
+    /* Bytes currently held from allocator */
+    size_t uBytes;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Return uSize bytes from malloc. pvContext is unused. */
+
+static void *SymTable_defaultAlloc(size_t uSize, void *pvContext)
+{
+    (void)pvContext;
+    return malloc(uSize);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Free pvBlock, which SymTable_defaultAlloc returned. */
+
+static void SymTable_defaultFree(void *pvBlock, size_t uSize,
+    void *pvContext)
+{
+    (void)uSize;
+    (void)pvContext;
+    free(pvBlock);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* The allocator of tables made by SymTable_new */
+static const SymTable_Allocator defaultAllocator = {
+    SymTable_defaultAlloc, SymTable_defaultFree, NULL};
+
+/*--------------------------------------------------------------------*/
+
+/* Return uSize bytes from the allocator of oSymTable, or NULL if it
+   refuses. The cache is left as it is. */
+
+static void *SymTable_allocOnce(SymTable_T oSymTable, size_t uSize)
+{
+    void *pvBlock;
+
+    assert(oSymTable != NULL);
+
+    pvBlock = (*oSymTable->allocator.pfAlloc)(uSize,
+        oSymTable->allocator.pvContext);
+    if(pvBlock != NULL){
+        oSymTable->uBytes += uSize;
+    }
+    return pvBlock;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Give the uSize bytes at pvBlock back to the allocator of
+   oSymTable. pvBlock may be NULL, in which case nothing happens. */
+
+static void SymTable_release(SymTable_T oSymTable, void *pvBlock,
+    size_t uSize)
+{
+    assert(oSymTable != NULL);
+
+    if(pvBlock == NULL){
+        return;
+    }
+    oSymTable->uBytes -= uSize;
+    (*oSymTable->allocator.pfFree)(pvBlock, uSize,
+        oSymTable->allocator.pvContext);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the hash code for the uLength bytes at pcKey. The low bits
+   pick the bucket, so the bits are mixed well. */
+
+static uint64_t SymTable_hash(const char *pcKey, size_t uLength)
+{
+    uint64_t uHash = UINT64_C(14695981039346656037);
+    size_t u;
+
+    assert(pcKey != NULL);
+
+    for(u = 0; u < uLength; u++){
+        uHash ^= (unsigned char)pcKey[u];
+        uHash *= UINT64_C(1099511628211);
+    }
+
+    uHash ^= uHash >> 33;
+    uHash *= UINT64_C(0xff51afd7ed558ccd);
+    uHash ^= uHash >> 33;
+    uHash *= UINT64_C(0xc4ceb9fe1a85ec53);
+    uHash ^= uHash >> 33;
+    return uHash;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Read page uPage of the file of oSymTable into pucData if iWrite is
+   0, or write pucData to it otherwise. Returns 1 for success or 0 for
+   failure. */
+
+static int SymTable_transfer(SymTable_T oSymTable, uint32_t uPage,
+    unsigned char *pucData, int iWrite)
+{
+    off_t iOffset;
+    ssize_t iCount;
+    size_t uDone = 0;
+
+    assert(oSymTable != NULL);
+    assert(pucData != NULL);
+
+    iOffset = (off_t)uPage * DISK_PAGE_SIZE;
+    while(uDone < DISK_PAGE_SIZE){
+        if(iWrite){
+            iCount = pwrite(oSymTable->iFd, pucData + uDone,
+                DISK_PAGE_SIZE - uDone, iOffset + (off_t)uDone);
+        }
+        else{
+            iCount = pread(oSymTable->iFd, pucData + uDone,
+                DISK_PAGE_SIZE - uDone, iOffset + (off_t)uDone);
+        }
+        if(iCount < 0 && errno == EINTR){
+            continue;
+        }
+        if(iCount <= 0){
+            return 0;
+        }
+        uDone += (size_t)iCount;
+    }
+    return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Free frame uFrame of oSymTable, which must not be pinned, without
+   writing it back, and move the last frame into its place. */
+
+static void SymTable_dropFrame(SymTable_T oSymTable, size_t uFrame)
+{
+    struct DiskFrame *pFrame;
+    struct DiskFrame *pLast;
+
+    assert(oSymTable != NULL);
+    assert(uFrame < oSymTable->uFrameCount);
+
+    pFrame = &oSymTable->pFrames[uFrame];
+    assert(pFrame->uPins == 0);
+    if(oSymTable->puFrameOf[pFrame->uPage] == uFrame + 1){
+        oSymTable->puFrameOf[pFrame->uPage] = 0;
+    }
+    SymTable_release(oSymTable, pFrame->pucData, DISK_PAGE_SIZE);
+
+    pLast = &oSymTable->pFrames[--oSymTable->uFrameCount];
+    if(pLast != pFrame){
+        *pFrame = *pLast;
+        if(oSymTable->puFrameOf[pFrame->uPage]
+            == oSymTable->uFrameCount + 1){
+            oSymTable->puFrameOf[pFrame->uPage] = (uint32_t)(uFrame + 1);
+        }
+    }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Pick a frame of oSymTable with the clock algorithm, passing over
+   pinned frames and giving the others a second chance if they were
+   used since the hand last passed. Write the frame back if it is
+   dirty. Return its index, with the frame no longer holding its page,
+   or NO_FRAME if every frame is pinned or cannot be written. */
+
+static size_t SymTable_evict(SymTable_T oSymTable)
+{
+    struct DiskFrame *pFrame;
+    size_t uSteps;
+
+    assert(oSymTable != NULL);
+
+    for(uSteps = 0; uSteps < 2 * oSymTable->uFrameCount; uSteps++){
+        if(oSymTable->uHand >= oSymTable->uFrameCount){
+            oSymTable->uHand = 0;
+        }
+        pFrame = &oSymTable->pFrames[oSymTable->uHand++];
+        if(pFrame->uPins != 0){
+            continue;
+        }
+        if(pFrame->iReferenced){
+            pFrame->iReferenced = 0;
+            continue;
+        }
+        if(pFrame->iDirty){
+            if(!SymTable_transfer(oSymTable, pFrame->uPage,
+                pFrame->pucData, 1)){
+                continue;
+            }
+            pFrame->iDirty = 0;
+        }
+        oSymTable->puFrameOf[pFrame->uPage] = 0;
+        return (size_t)(pFrame - oSymTable->pFrames);
+    }
+    return NO_FRAME;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Evict a frame of oSymTable and give its memory back. Returns 1 for
+   success or 0 if no frame can be evicted. */
+
+static int SymTable_shedFrame(SymTable_T oSymTable)
+{
+    size_t uFrame;
+
+    assert(oSymTable != NULL);
+
+    uFrame = SymTable_evict(oSymTable);
+    if(uFrame == NO_FRAME){
+        return 0;
+    }
+    SymTable_dropFrame(oSymTable, uFrame);
+    return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return uSize bytes from the allocator of oSymTable, evicting frames
+   of the cache to make room while it refuses, or NULL if it still
+   refuses once no frame can be evicted. */
+
+static void *SymTable_alloc(SymTable_T oSymTable, size_t uSize)
+{
+    void *pvBlock;
+
+    assert(oSymTable != NULL);
+
+    for(;;){
+        pvBlock = SymTable_allocOnce(oSymTable, uSize);
+        if(pvBlock != NULL || !SymTable_shedFrame(oSymTable)){
+            return pvBlock;
+        }
+    }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Double the room of the array of page numbers *ppuWords of
+   oSymTable, whose room is *puCapacity, or give it INITIAL_WORDS if it
+   has none. Returns 1 for success or 0 for failure, in which case
+   nothing changes. */
+
+static int SymTable_growWords(SymTable_T oSymTable, uint32_t **ppuWords,
+    size_t *puCapacity)
+{
+    uint32_t *puNewWords;
+    size_t uCapacity;
+
+    assert(oSymTable != NULL);
+    assert(ppuWords != NULL);
+    assert(puCapacity != NULL);
+
+    uCapacity = (*puCapacity == 0) ? INITIAL_WORDS : *puCapacity * 2;
+    if(uCapacity > SIZE_MAX / sizeof(uint32_t)){
+        return 0;
+    }
+    puNewWords = (uint32_t*)SymTable_alloc(oSymTable,
+        uCapacity * sizeof(uint32_t));
+    if(puNewWords == NULL){
+        return 0;
+    }
+    if(*puCapacity != 0){
+        memcpy(puNewWords, *ppuWords, *puCapacity * sizeof(uint32_t));
+    }
+    SymTable_release(oSymTable, *ppuWords, *puCapacity * sizeof(uint32_t));
+    *ppuWords = puNewWords;
+    *puCapacity = uCapacity;
+    return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the index of a frame of oSymTable that holds no page, made
+   new while the cache is below its size and the allocator agrees, or
+   evicted otherwise, or NO_FRAME if there is none. */
+
+static size_t SymTable_frameFor(SymTable_T oSymTable)
+{
+    struct DiskFrame *pNewFrames;
+    struct DiskFrame *pFrame;
+    unsigned char *pucData;
+    size_t uCapacity;
+
+    assert(oSymTable != NULL);
+
+    if(oSymTable->uFrameCount < oSymTable->uMaxFrames
+        && oSymTable->uFrameCount == oSymTable->uFrameCapacity){
+        uCapacity = (oSymTable->uFrameCapacity == 0) ? INITIAL_FRAMES
+            : oSymTable->uFrameCapacity * 2;
+        pNewFrames = (struct DiskFrame*)SymTable_alloc(oSymTable,
+            uCapacity * sizeof(struct DiskFrame));
+        if(pNewFrames != NULL){
+            if(oSymTable->uFrameCount != 0){
+                memcpy(pNewFrames, oSymTable->pFrames,
+                    oSymTable->uFrameCount * sizeof(struct DiskFrame));
+            }
+            SymTable_release(oSymTable, oSymTable->pFrames,
+                oSymTable->uFrameCapacity * sizeof(struct DiskFrame));
+            oSymTable->pFrames = pNewFrames;
+            oSymTable->uFrameCapacity = uCapacity;
+        }
+    }
+
+    if(oSymTable->uFrameCount < oSymTable->uMaxFrames
+        && oSymTable->uFrameCount < oSymTable->uFrameCapacity){
+        pucData = (unsigned char*)SymTable_allocOnce(oSymTable,
+            DISK_PAGE_SIZE);
+        if(pucData != NULL){
+            pFrame = &oSymTable->pFrames[oSymTable->uFrameCount];
+            pFrame->pucData = pucData;
+            pFrame->uPage = NO_PAGE;
+            pFrame->uPins = 0;
+            pFrame->iDirty = 0;
+            pFrame->iReferenced = 0;
+            return oSymTable->uFrameCount++;
+        }
+    }
+
+    /* The cache is full, or memory is */
+    return SymTable_evict(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the bytes of page uPage of oSymTable, pinned in the cache
+   until SymTable_unpin, read from the file or, if iNew is 1, zeroed
+   for a page not yet written. Return NULL if there is no frame for it
+   or it cannot be read. */
+
+static unsigned char *SymTable_fetch(SymTable_T oSymTable, uint32_t uPage,
+    int iNew)
+{
+    struct DiskFrame *pFrame;
+    size_t uFrame;
+
+    assert(oSymTable != NULL);
+    assert(uPage < oSymTable->uPageCount);
+
+    if(oSymTable->puFrameOf[uPage] != 0){
+        pFrame = &oSymTable->pFrames[oSymTable->puFrameOf[uPage] - 1];
+    }
+    else{
+        uFrame = SymTable_frameFor(oSymTable);
+        if(uFrame == NO_FRAME){
+            return NULL;
+        }
+        pFrame = &oSymTable->pFrames[uFrame];
+        pFrame->uPage = uPage;
+        if(!iNew && !SymTable_transfer(oSymTable, uPage, pFrame->pucData,
+            0)){
+            SymTable_dropFrame(oSymTable, uFrame);
+            return NULL;
+        }
+        pFrame->iDirty = 0;
+        oSymTable->puFrameOf[uPage] = (uint32_t)(uFrame + 1);
+    }
+
+    if(iNew){
+        memset(pFrame->pucData, 0, DISK_PAGE_SIZE);
+        pFrame->iDirty = 1;
+    }
+    pFrame->uPins++;
+    pFrame->iReferenced = 1;
+    return pFrame->pucData;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Undo one SymTable_fetch of page uPage of oSymTable, noting that its
+   bytes were changed if iDirty is 1. */
+
+static void SymTable_unpin(SymTable_T oSymTable, uint32_t uPage,
+    int iDirty)
+{
+    struct DiskFrame *pFrame;
+
+    assert(oSymTable != NULL);
+    assert(oSymTable->puFrameOf[uPage] != 0);
+
+    pFrame = &oSymTable->pFrames[oSymTable->puFrameOf[uPage] - 1];
+    assert(pFrame->uPins > 0);
+    pFrame->uPins--;
+    if(iDirty){
+        pFrame->iDirty = 1;
+    }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Store in *puPage the number of a page of oSymTable that is not in
+   use, reusing one given back if there is one. Returns 1 for success
+   or 0 for failure. */
+
+static int SymTable_newPage(SymTable_T oSymTable, uint32_t *puPage)
+{
+    assert(oSymTable != NULL);
+    assert(puPage != NULL);
+
+    if(oSymTable->uFreeCount != 0){
+        *puPage = oSymTable->puFree[--oSymTable->uFreeCount];
+        return 1;
+    }
+    if(oSymTable->uPageCount >= NO_PAGE){
+        return 0;
+    }
+    if(oSymTable->uPageCount == oSymTable->uFrameOfCapacity
+        && !SymTable_growWords(oSymTable, &oSymTable->puFrameOf,
+            &oSymTable->uFrameOfCapacity)){
+        return 0;
+    }
+    oSymTable->puFrameOf[oSymTable->uPageCount] = 0;
+    *puPage = (uint32_t)oSymTable->uPageCount++;
+    return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Give page uPage of oSymTable back, dropping it from the cache
+   unwritten. It must not be pinned. If there is no room to note it,
+   its space in the file is simply not used again. */
+
+static void SymTable_freePage(SymTable_T oSymTable, uint32_t uPage)
+{
+    assert(oSymTable != NULL);
+    assert(uPage < oSymTable->uPageCount);
+
+    if(oSymTable->puFrameOf[uPage] != 0){
+        SymTable_dropFrame(oSymTable, oSymTable->puFrameOf[uPage] - 1);
+    }
+    if(oSymTable->uFreeCount == oSymTable->uFreeCapacity
+        && !SymTable_growWords(oSymTable, &oSymTable->puFree,
+            &oSymTable->uFreeCapacity)){
+        return;
+    }
+    oSymTable->puFree[oSymTable->uFreeCount++] = uPage;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the number of bytes a record with a key of uKeyLength bytes
+   takes in its page. */
+
+static size_t SymTable_recordSize(size_t uKeyLength)
+{
+    size_t uSize;
+
+    uSize = sizeof(struct DiskRecord) + ((uKeyLength > MAX_INLINE_KEY)
+        ? sizeof(uint32_t) : uKeyLength + 1);
+    return (uSize + RECORD_ALIGN - 1) / RECORD_ALIGN * RECORD_ALIGN;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the record at uOffset of the bucket page pucData. */
+
+static struct DiskRecord *SymTable_recordAt(unsigned char *pucData,
+    size_t uOffset)
+{
+    assert(pucData != NULL);
+
+    return (struct DiskRecord*)(void*)(pucData + uOffset);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the first page of the long key of pRecord. */
+
+static uint32_t SymTable_blobOf(const struct DiskRecord *pRecord)
+{
+    uint32_t uPage;
+
+    assert(pRecord != NULL);
+    assert(pRecord->uKeyLength > MAX_INLINE_KEY);
+
+    memcpy(&uPage, (const char*)pRecord + sizeof(struct DiskRecord),
+        sizeof(uint32_t));
+    return uPage;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the key of pRecord of oSymTable, which is in its page if it
+   is short or read back into the key buffer if it is long, or NULL if
+   it cannot be read. A long key stays only until the next one is
+   read. */
+
+static const char *SymTable_keyOf(SymTable_T oSymTable,
+    const struct DiskRecord *pRecord)
+{
+    const struct DiskBlob *pBlob;
+    unsigned char *pucData;
+    size_t uLength;
+    size_t uDone = 0;
+    size_t uChunk;
+    uint32_t uPage;
+    uint32_t uNext;
+    char *pcBuffer;
+
+    assert(oSymTable != NULL);
+    assert(pRecord != NULL);
+
+    if(pRecord->uKeyLength <= MAX_INLINE_KEY){
+        return (const char*)pRecord + sizeof(struct DiskRecord);
+    }
+
+    uLength = pRecord->uKeyLength;
+    if(oSymTable->uKeyBufferSize < uLength + 1){
+        pcBuffer = (char*)SymTable_alloc(oSymTable, uLength + 1);
+        if(pcBuffer == NULL){
+            return NULL;
+        }
+        SymTable_release(oSymTable, oSymTable->pcKeyBuffer,
+            oSymTable->uKeyBufferSize);
+        oSymTable->pcKeyBuffer = pcBuffer;
+        oSymTable->uKeyBufferSize = uLength + 1;
+    }
+
+    uPage = SymTable_blobOf(pRecord);
+    while(uDone < uLength){
+        pucData = SymTable_fetch(oSymTable, uPage, 0);
+        if(pucData == NULL){
+            return NULL;
+        }
+        pBlob = (const struct DiskBlob*)(void*)pucData;
+        uChunk = (uLength - uDone < BLOB_ROOM) ? uLength - uDone
+            : BLOB_ROOM;
+        memcpy(oSymTable->pcKeyBuffer + uDone, pBlob->aucBytes, uChunk);
+        uNext = pBlob->uNext;
+        SymTable_unpin(oSymTable, uPage, 0);
+        uDone += uChunk;
+        uPage = uNext;
+    }
+    oSymTable->pcKeyBuffer[uLength] = '\0';
+    return oSymTable->pcKeyBuffer;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return 1 if the key of pRecord of oSymTable is pcKey, whose length
+   is uLength and whose hash code is uHash, 0 if it is not, or -1 if
+   the key cannot be read. */
+
+static int SymTable_keyMatches(SymTable_T oSymTable,
+    const struct DiskRecord *pRecord, const char *pcKey, size_t uLength,
+    uint64_t uHash)
+{
+    const struct DiskBlob *pBlob;
+    unsigned char *pucData;
+    size_t uDone = 0;
+    size_t uChunk;
+    uint32_t uPage;
+    uint32_t uNext;
+    int iSame;
+
+    assert(oSymTable != NULL);
+    assert(pRecord != NULL);
+    assert(pcKey != NULL);
+
+    if(pRecord->uHash != (uint32_t)uHash
+        || pRecord->uKeyLength != uLength){
+        return 0;
+    }
+    if(uLength <= MAX_INLINE_KEY){
+        return memcmp((const char*)pRecord + sizeof(struct DiskRecord),
+            pcKey, uLength) == 0;
+    }
+
+    uPage = SymTable_blobOf(pRecord);
+    while(uDone < uLength){
+        pucData = SymTable_fetch(oSymTable, uPage, 0);
+        if(pucData == NULL){
+            return -1;
+        }
+        pBlob = (const struct DiskBlob*)(void*)pucData;
+        uChunk = (uLength - uDone < BLOB_ROOM) ? uLength - uDone
+            : BLOB_ROOM;
+        iSame = memcmp(pBlob->aucBytes, pcKey + uDone, uChunk) == 0;
+        uNext = pBlob->uNext;
+        SymTable_unpin(oSymTable, uPage, 0);
+        if(!iSame){
+            return 0;
+        }
+        uDone += uChunk;
+        uPage = uNext;
+    }
+    return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Give back the pages of the long key of oSymTable whose first page
+   is uPage, which may be NO_PAGE. A page that cannot be read ends the
+   walk, and the rest of the key's space is not used again. */
+
+static void SymTable_freeBlob(SymTable_T oSymTable, uint32_t uPage)
+{
+    unsigned char *pucData;
+    uint32_t uNext;
+
+    assert(oSymTable != NULL);
+
+    while(uPage != NO_PAGE){
+        pucData = SymTable_fetch(oSymTable, uPage, 0);
+        if(pucData == NULL){
+            return;
+        }
+        uNext = ((const struct DiskBlob*)(void*)pucData)->uNext;
+        SymTable_unpin(oSymTable, uPage, 0);
+        SymTable_freePage(oSymTable, uPage);
+        uPage = uNext;
+    }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Write the uLength bytes of pcKey to new pages of oSymTable, and
+   store the number of the first in *puFirst. Returns 1 for success or
+   0 for failure, in which case nothing changes. */
+
+static int SymTable_writeBlob(SymTable_T oSymTable, const char *pcKey,
+    size_t uLength, uint32_t *puFirst)
+{
+    struct DiskBlob *pBlob;
+    unsigned char *pucData;
+    size_t uChunks;
+    size_t uStart;
+    size_t u;
+    uint32_t uNext = NO_PAGE;
+    uint32_t uPage;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+    assert(puFirst != NULL);
+
+    /* The last page is written first, so that each page can name the
+       next */
+    uChunks = (uLength + BLOB_ROOM - 1) / BLOB_ROOM;
+    for(u = uChunks; u > 0; u--){
+        if(!SymTable_newPage(oSymTable, &uPage)){
+            SymTable_freeBlob(oSymTable, uNext);
+            return 0;
+        }
+        pucData = SymTable_fetch(oSymTable, uPage, 1);
+        if(pucData == NULL){
+            SymTable_freePage(oSymTable, uPage);
+            SymTable_freeBlob(oSymTable, uNext);
+            return 0;
+        }
+        pBlob = (struct DiskBlob*)(void*)pucData;
+        uStart = (u - 1) * BLOB_ROOM;
+        pBlob->uNext = uNext;
+        memcpy(pBlob->aucBytes, pcKey + uStart, (uLength - uStart
+            < BLOB_ROOM) ? uLength - uStart : BLOB_ROOM);
+        SymTable_unpin(oSymTable, uPage, 1);
+        uNext = uPage;
+    }
+    *puFirst = uNext;
+    return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Look in oSymTable for pcKey, whose length is uLength and whose hash
+   code is uHash. Return 1 if it is there, storing the page of its
+   record, which stays pinned, in *puPage, the offset of the record in
+   *puOffset, and the page before that one in the bucket, or NO_PAGE,
+   in *puPrev. Return 0 if it is not there, or -1 if a page cannot be
+   read. */
+
+static int SymTable_find(SymTable_T oSymTable, const char *pcKey,
+    size_t uLength, uint64_t uHash, uint32_t *puPage, size_t *puOffset,
+    uint32_t *puPrev)
+{
+    struct DiskPage *pPage;
+    unsigned char *pucData;
+    size_t uOffset;
+    uint32_t uPage;
+    uint32_t uPrev = NO_PAGE;
+    uint32_t uNext;
+    int iMatch;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+    assert(puPage != NULL);
+    assert(puOffset != NULL);
+    assert(puPrev != NULL);
+
+    uPage = oSymTable->puDirectory[(size_t)uHash
+        & (((size_t)1 << oSymTable->uGlobalDepth) - 1)];
+    while(uPage != NO_PAGE){
+        pucData = SymTable_fetch(oSymTable, uPage, 0);
+        if(pucData == NULL){
+            return -1;
+        }
+        pPage = (struct DiskPage*)(void*)pucData;
+        for(uOffset = sizeof(struct DiskPage);
+            uOffset < sizeof(struct DiskPage) + pPage->uUsed;
+            uOffset += SymTable_recordSize(
+                SymTable_recordAt(pucData, uOffset)->uKeyLength)){
+            iMatch = SymTable_keyMatches(oSymTable,
+                SymTable_recordAt(pucData, uOffset), pcKey, uLength,
+                uHash);
+            if(iMatch < 0){
+                SymTable_unpin(oSymTable, uPage, 0);
+                return -1;
+            }
+            if(iMatch){
+                *puPage = uPage;
+                *puOffset = uOffset;
+                *puPrev = uPrev;
+                return 1;
+            }
+        }
+        uNext = pPage->uNext;
+        SymTable_unpin(oSymTable, uPage, 0);
+        uPrev = uPage;
+        uPage = uNext;
+    }
+    return 0;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Add a record for pcKey, whose length is uLength and whose hash code
+   is uHash, bound to pvValue, to the first page of the bucket whose
+   first page is uPage that has room for it. uBlob is the first page
+   of a long key. Store the local depth of the bucket in *puDepth.
+   Return 1 if the record was added, 0 if no page has room, or -1 if a
+   page cannot be read. */
+
+static int SymTable_append(SymTable_T oSymTable, uint32_t uPage,
+    const char *pcKey, size_t uLength, uint64_t uHash,
+    const void *pvValue, uint32_t uBlob, uint32_t *puDepth)
+{
+    struct DiskPage *pPage;
+    struct DiskRecord *pRecord;
+    unsigned char *pucData;
+    char *pcPayload;
+    size_t uSize;
+    uint32_t uNext;
+    int iFirst = 1;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+    assert(puDepth != NULL);
+
+    uSize = SymTable_recordSize(uLength);
+    while(uPage != NO_PAGE){
+        pucData = SymTable_fetch(oSymTable, uPage, 0);
+        if(pucData == NULL){
+            return -1;
+        }
+        pPage = (struct DiskPage*)(void*)pucData;
+        if(iFirst){
+            *puDepth = pPage->uLocalDepth;
+            iFirst = 0;
+        }
+        if(pPage->uUsed + uSize <= PAGE_ROOM){
+            pRecord = SymTable_recordAt(pucData,
+                sizeof(struct DiskPage) + pPage->uUsed);
+            pRecord->uHash = (uint32_t)uHash;
+            pRecord->uKeyLength = (uint32_t)uLength;
+            pRecord->pvValue = pvValue;
+            pcPayload = (char*)pRecord + sizeof(struct DiskRecord);
+            if(uLength > MAX_INLINE_KEY){
+                memcpy(pcPayload, &uBlob, sizeof(uint32_t));
+            }
+            else{
+                memcpy(pcPayload, pcKey, uLength + 1);
+            }
+            pPage->uUsed += (uint32_t)uSize;
+            pPage->uCount++;
+            SymTable_unpin(oSymTable, uPage, 1);
+            return 1;
+        }
+        uNext = pPage->uNext;
+        SymTable_unpin(oSymTable, uPage, 0);
+        uPage = uNext;
+    }
+    return 0;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the number of buckets of oSymTable whose local depth is its
+   global depth. Each has a single slot of the directory, whose buddy
+   slot refers to another bucket. */
+
+static size_t SymTable_countDeep(SymTable_T oSymTable)
+{
+    size_t uSlots;
+    size_t uTop;
+    size_t uCount = 0;
+    size_t u;
+
+    assert(oSymTable != NULL);
+
+    if(oSymTable->uGlobalDepth == 0){
+        return 1;
+    }
+    uSlots = (size_t)1 << oSymTable->uGlobalDepth;
+    uTop = uSlots / 2;
+    for(u = 0; u < uSlots; u++){
+        if(oSymTable->puDirectory[u] != oSymTable->puDirectory[u ^ uTop]){
+            uCount++;
+        }
+    }
+    return uCount;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Split the bucket of oSymTable in slot uSlot of the directory, which
+   has a single page and a local depth below MAX_DEPTH, in two by the
+   next bit of the hash code, doubling the directory first if the
+   bucket is as deep as it. Returns 1 for success or 0 for failure, in
+   which case the bindings are unchanged. */
+
+static int SymTable_split(SymTable_T oSymTable, size_t uSlot)
+{
+    struct DiskPage *pPage;
+    struct DiskPage *pNewPage;
+    struct DiskPage *pOldPage;
+    struct DiskRecord *pRecord;
+    unsigned char *pucData;
+    unsigned char *pucNewData;
+    unsigned char *pucTarget;
+    size_t uSlots;
+    size_t uOffset;
+    size_t uSize;
+    size_t u;
+    uint32_t uPage;
+    uint32_t uNewPage;
+    uint32_t uDepth;
+
+    assert(oSymTable != NULL);
+
+    uSlots = (size_t)1 << oSymTable->uGlobalDepth;
+    uPage = oSymTable->puDirectory[uSlot & (uSlots - 1)];
+    pucData = SymTable_fetch(oSymTable, uPage, 0);
+    if(pucData == NULL){
+        return 0;
+    }
+    pPage = (struct DiskPage*)(void*)pucData;
+    uDepth = pPage->uLocalDepth;
+    assert(uDepth < MAX_DEPTH);
+    assert(pPage->uNext == NO_PAGE);
+
+    /* The new half of the directory repeats the old one */
+    if(uDepth == oSymTable->uGlobalDepth){
+        if(uSlots * 2 > oSymTable->uDirectoryCapacity
+            && !SymTable_growWords(oSymTable, &oSymTable->puDirectory,
+                &oSymTable->uDirectoryCapacity)){
+            SymTable_unpin(oSymTable, uPage, 0);
+            return 0;
+        }
+        memcpy(oSymTable->puDirectory + uSlots, oSymTable->puDirectory,
+            uSlots * sizeof(uint32_t));
+        oSymTable->uGlobalDepth++;
+        oSymTable->uDeepBuckets = 0;
+        uSlots *= 2;
+    }
+
+    if(!SymTable_newPage(oSymTable, &uNewPage)){
+        SymTable_unpin(oSymTable, uPage, 0);
+        return 0;
+    }
+    pucNewData = SymTable_fetch(oSymTable, uNewPage, 1);
+    if(pucNewData == NULL){
+        SymTable_freePage(oSymTable, uNewPage);
+        SymTable_unpin(oSymTable, uPage, 0);
+        return 0;
+    }
+
+    /* The records are dealt from a copy of the old page */
+    memcpy(oSymTable->pucScratch, pucData, DISK_PAGE_SIZE);
+    pOldPage = (struct DiskPage*)(void*)oSymTable->pucScratch;
+    pPage->uLocalDepth = uDepth + 1;
+    pPage->uCount = 0;
+    pPage->uUsed = 0;
+    pNewPage = (struct DiskPage*)(void*)pucNewData;
+    pNewPage->uNext = NO_PAGE;
+    pNewPage->uLocalDepth = uDepth + 1;
+    for(uOffset = sizeof(struct DiskPage);
+        uOffset < sizeof(struct DiskPage) + pOldPage->uUsed;
+        uOffset += uSize){
+        pRecord = SymTable_recordAt(oSymTable->pucScratch, uOffset);
+        uSize = SymTable_recordSize(pRecord->uKeyLength);
+        pucTarget = ((pRecord->uHash >> uDepth) & 1) ? pucNewData
+            : pucData;
+        memcpy(pucTarget + sizeof(struct DiskPage)
+            + ((struct DiskPage*)(void*)pucTarget)->uUsed, pRecord, uSize);
+        ((struct DiskPage*)(void*)pucTarget)->uUsed += (uint32_t)uSize;
+        ((struct DiskPage*)(void*)pucTarget)->uCount++;
+    }
+
+    for(u = uSlot & (((size_t)1 << uDepth) - 1); u < uSlots;
+        u += (size_t)1 << uDepth){
+        if((u >> uDepth) & 1){
+            oSymTable->puDirectory[u] = uNewPage;
+        }
+    }
+    if(uDepth + 1 == oSymTable->uGlobalDepth){
+        oSymTable->uDeepBuckets += 2;
+    }
+
+    SymTable_unpin(oSymTable, uNewPage, 1);
+    SymTable_unpin(oSymTable, uPage, 1);
+    return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Give the bucket of oSymTable whose first page is uPage, which is at
+   MAX_DEPTH and full, one more page. Returns 1 for success or 0 for
+   failure, in which case nothing changes. */
+
+static int SymTable_addOverflow(SymTable_T oSymTable, uint32_t uPage)
+{
+    struct DiskPage *pPage;
+    struct DiskPage *pNewPage;
+    unsigned char *pucData;
+    unsigned char *pucNewData;
+    uint32_t uNewPage;
+
+    assert(oSymTable != NULL);
+
+    pucData = SymTable_fetch(oSymTable, uPage, 0);
+    if(pucData == NULL){
+        return 0;
+    }
+    if(!SymTable_newPage(oSymTable, &uNewPage)){
+        SymTable_unpin(oSymTable, uPage, 0);
+        return 0;
+    }
+    pucNewData = SymTable_fetch(oSymTable, uNewPage, 1);
+    if(pucNewData == NULL){
+        SymTable_freePage(oSymTable, uNewPage);
+        SymTable_unpin(oSymTable, uPage, 0);
+        return 0;
+    }
+
+    pPage = (struct DiskPage*)(void*)pucData;
+    pNewPage = (struct DiskPage*)(void*)pucNewData;
+    pNewPage->uNext = pPage->uNext;
+    pNewPage->uLocalDepth = pPage->uLocalDepth;
+    pPage->uNext = uNewPage;
+    SymTable_unpin(oSymTable, uNewPage, 1);
+    SymTable_unpin(oSymTable, uPage, 1);
+    return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Merge the bucket of oSymTable in slot uSlot of the directory with
+   its buddy, the bucket that differs in the last bit of its local
+   depth, as long as both have one page and their records together fit
+   in MERGE_ROOM bytes, halving the directory whenever no bucket is as
+   deep as it. A page that cannot be read ends the merging. */
+
+static void SymTable_coalesce(SymTable_T oSymTable, size_t uSlot)
+{
+    struct DiskPage *pPage;
+    struct DiskPage *pBuddy;
+    unsigned char *pucData;
+    unsigned char *pucBuddyData;
+    size_t u;
+    uint32_t uPage;
+    uint32_t uBuddy;
+    uint32_t uDepth;
+
+    assert(oSymTable != NULL);
+
+    while(oSymTable->uGlobalDepth > 0){
+        uSlot &= ((size_t)1 << oSymTable->uGlobalDepth) - 1;
+        uPage = oSymTable->puDirectory[uSlot];
+        pucData = SymTable_fetch(oSymTable, uPage, 0);
+        if(pucData == NULL){
+            return;
+        }
+        pPage = (struct DiskPage*)(void*)pucData;
+        uDepth = pPage->uLocalDepth;
+        if(uDepth == 0 || pPage->uNext != NO_PAGE){
+            SymTable_unpin(oSymTable, uPage, 0);
+            return;
+        }
+
+        uBuddy = oSymTable->puDirectory[uSlot
+            ^ ((size_t)1 << (uDepth - 1))];
+        pucBuddyData = SymTable_fetch(oSymTable, uBuddy, 0);
+        if(pucBuddyData == NULL){
+            SymTable_unpin(oSymTable, uPage, 0);
+            return;
+        }
+        pBuddy = (struct DiskPage*)(void*)pucBuddyData;
+        if(pBuddy->uLocalDepth != uDepth || pBuddy->uNext != NO_PAGE
+            || pPage->uUsed + pBuddy->uUsed > MERGE_ROOM){
+            SymTable_unpin(oSymTable, uBuddy, 0);
+            SymTable_unpin(oSymTable, uPage, 0);
+            return;
+        }
+
+        memcpy(pucData + sizeof(struct DiskPage) + pPage->uUsed,
+            pucBuddyData + sizeof(struct DiskPage), pBuddy->uUsed);
+        pPage->uUsed += pBuddy->uUsed;
+        pPage->uCount += pBuddy->uCount;
+        pPage->uLocalDepth = uDepth - 1;
+        SymTable_unpin(oSymTable, uBuddy, 0);
+        SymTable_freePage(oSymTable, uBuddy);
+        SymTable_unpin(oSymTable, uPage, 1);
+
+        for(u = uSlot & (((size_t)1 << (uDepth - 1)) - 1);
+            u < ((size_t)1 << oSymTable->uGlobalDepth);
+            u += (size_t)1 << (uDepth - 1)){
+            oSymTable->puDirectory[u] = uPage;
+        }
+        if(uDepth == oSymTable->uGlobalDepth){
+            oSymTable->uDeepBuckets -= 2;
+        }
+        while(oSymTable->uDeepBuckets == 0
+            && oSymTable->uGlobalDepth > 0){
+            oSymTable->uGlobalDepth--;
+            oSymTable->uDeepBuckets = SymTable_countDeep(oSymTable);
+        }
+    }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return 1 if uSlot is the first slot of the directory of oSymTable
+   that refers to its bucket, or 0 otherwise. Every slot of a bucket
+   shares its low bits, and the first has none of the others set. */
+
+static int SymTable_isFirstSlot(SymTable_T oSymTable, size_t uSlot)
+{
+    size_t uTop = 1;
+
+    assert(oSymTable != NULL);
+
+    if(uSlot == 0){
+        return 1;
+    }
+    while(uTop * 2 <= uSlot){
+        uTop *= 2;
+    }
+    return oSymTable->puDirectory[uSlot]
+        != oSymTable->puDirectory[uSlot ^ uTop];
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Open a new scratch file for oSymTable in the directory pcDirectory,
+   or in $TMPDIR or /tmp if it is NULL, and unlink it. Returns 1 for
+   success or 0 for failure. */
+
+static int SymTable_openFile(SymTable_T oSymTable, const char *pcDirectory)
+{
+    static const char acTemplate[] = "/symtableXXXXXX";
+    size_t uLength;
+    char *pcPath;
+
+    assert(oSymTable != NULL);
+
+    if(pcDirectory == NULL){
+        pcDirectory = getenv("TMPDIR");
+        if(pcDirectory == NULL || *pcDirectory == '\0'){
+            pcDirectory = "/tmp";
+        }
+    }
+
+    uLength = strlen(pcDirectory);
+    pcPath = (char*)SymTable_alloc(oSymTable, uLength + sizeof(acTemplate));
+    if(pcPath == NULL){
+        return 0;
+    }
+    memcpy(pcPath, pcDirectory, uLength);
+    memcpy(pcPath + uLength, acTemplate, sizeof(acTemplate));
+    oSymTable->iFd = mkstemp(pcPath);
+    if(oSymTable->iFd >= 0){
+        (void)unlink(pcPath);
+    }
+    SymTable_release(oSymTable, pcPath, uLength + sizeof(acTemplate));
+    return oSymTable->iFd >= 0;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return a new empty SymTable object whose memory comes from
+   pAllocator, whose file is in pcDirectory, and whose cache holds at
+   most uCacheBytes of pages, or NULL if it cannot be made. */
+
+static SymTable_T SymTable_create(const SymTable_Allocator *pAllocator,
+    const char *pcDirectory, size_t uCacheBytes)
+{
+    struct DiskPage *pPage;
+    unsigned char *pucData;
+    SymTable_T oSymTable;
+    uint32_t uPage;
+
+    assert(pAllocator != NULL);
+    assert(pAllocator->pfAlloc != NULL);
+    assert(pAllocator->pfFree != NULL);
+
+    oSymTable = (SymTable_T)(*pAllocator->pfAlloc)(sizeof(struct SymTable),
+        pAllocator->pvContext);
+    if (oSymTable == NULL)
+       return NULL;
+    oSymTable->allocator = *pAllocator;
+    oSymTable->uBytes = sizeof(struct SymTable);
+
+    oSymTable->iFd = -1;
+    oSymTable->puDirectory = NULL;
+    oSymTable->uDirectoryCapacity = 0;
+    oSymTable->uGlobalDepth = 0;
+    oSymTable->uDeepBuckets = 1;
+    oSymTable->uPageCount = 0;
+    oSymTable->puFree = NULL;
+    oSymTable->uFreeCount = 0;
+    oSymTable->uFreeCapacity = 0;
+    oSymTable->puFrameOf = NULL;
+    oSymTable->uFrameOfCapacity = 0;
+    oSymTable->pFrames = NULL;
+    oSymTable->uFrameCount = 0;
+    oSymTable->uFrameCapacity = 0;
+    oSymTable->uMaxFrames = uCacheBytes / DISK_PAGE_SIZE;
+    if(oSymTable->uMaxFrames < MIN_CACHE_PAGES){
+        oSymTable->uMaxFrames = MIN_CACHE_PAGES;
+    }
+    oSymTable->uHand = 0;
+    oSymTable->pucScratch = NULL;
+    oSymTable->pcKeyBuffer = NULL;
+    oSymTable->uKeyBufferSize = 0;
+    oSymTable->size = 0;
+
+    if(!SymTable_openFile(oSymTable, pcDirectory)
+        || !SymTable_growWords(oSymTable, &oSymTable->puDirectory,
+            &oSymTable->uDirectoryCapacity)){
+        SymTable_free(oSymTable);
+        return NULL;
+    }
+    oSymTable->pucScratch = (unsigned char*)SymTable_alloc(oSymTable,
+        DISK_PAGE_SIZE);
+    if(oSymTable->pucScratch == NULL
+        || !SymTable_newPage(oSymTable, &uPage)){
+        SymTable_free(oSymTable);
+        return NULL;
+    }
+    pucData = SymTable_fetch(oSymTable, uPage, 1);
+    if(pucData == NULL){
+        SymTable_free(oSymTable);
+        return NULL;
+    }
+    pPage = (struct DiskPage*)(void*)pucData;
+    pPage->uNext = NO_PAGE;
+    pPage->uLocalDepth = 0;
+    SymTable_unpin(oSymTable, uPage, 1);
+    oSymTable->puDirectory[0] = uPage;
+    return oSymTable;
+}
+
+/*--------------------------------------------------------------------*/
+
+SymTable_T SymTable_new(void){
+    return SymTable_create(&defaultAllocator, NULL,
+        (size_t)DEFAULT_CACHE_PAGES * DISK_PAGE_SIZE);
+}
+
+/*--------------------------------------------------------------------*/
+
+SymTable_T SymTable_newWithAllocator(const SymTable_Allocator *pAllocator){
+    return SymTable_create(pAllocator, NULL,
+        (size_t)DEFAULT_CACHE_PAGES * DISK_PAGE_SIZE);
+}
+
+/*--------------------------------------------------------------------*/
+
+SymTable_T SymTable_newOnDisk(const char *pcDirectory, size_t uCacheBytes){
+    return SymTable_create(&defaultAllocator, pcDirectory, uCacheBytes);
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t SymTable_memoryUsage(SymTable_T oSymTable){
+    assert(oSymTable != NULL);
+
+    return oSymTable->uBytes;
+}
+
+/*--------------------------------------------------------------------*/
+
+void SymTable_free(SymTable_T oSymTable){
+    size_t u;
+
+    assert(oSymTable != NULL);
+
+    if(oSymTable->iFd >= 0){
+        (void)close(oSymTable->iFd);
+    }
+    for(u = 0; u < oSymTable->uFrameCount; u++){
+        SymTable_release(oSymTable, oSymTable->pFrames[u].pucData,
+            DISK_PAGE_SIZE);
+    }
+    SymTable_release(oSymTable, oSymTable->pFrames,
+        oSymTable->uFrameCapacity * sizeof(struct DiskFrame));
+    SymTable_release(oSymTable, oSymTable->puFrameOf,
+        oSymTable->uFrameOfCapacity * sizeof(uint32_t));
+    SymTable_release(oSymTable, oSymTable->puFree,
+        oSymTable->uFreeCapacity * sizeof(uint32_t));
+    SymTable_release(oSymTable, oSymTable->puDirectory,
+        oSymTable->uDirectoryCapacity * sizeof(uint32_t));
+    SymTable_release(oSymTable, oSymTable->pucScratch, DISK_PAGE_SIZE);
+    SymTable_release(oSymTable, oSymTable->pcKeyBuffer,
+        oSymTable->uKeyBufferSize);
+    SymTable_release(oSymTable, oSymTable, sizeof(struct SymTable));
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t SymTable_getLength(SymTable_T oSymTable){
+    assert(oSymTable != NULL);
+
+    return oSymTable->size;
+}
+
+/*--------------------------------------------------------------------*/
+
+int SymTable_put(SymTable_T oSymTable, const char *pcKey,
+    const void *pvValue){
+    uint32_t uPage;
+    uint32_t uPrev;
+    uint32_t uBlob = NO_PAGE;
+    uint32_t uDepth = 0;
+    uint64_t uHash;
+    size_t uOffset;
+    size_t uSlot;
+    size_t strLength;
+    int iResult;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    strLength = strlen(pcKey);
+    if(strLength >= NO_PAGE){
+        return 0;
+    }
+    uHash = SymTable_hash(pcKey, strLength);
+    iResult = SymTable_find(oSymTable, pcKey, strLength, uHash, &uPage,
+        &uOffset, &uPrev);
+    if(iResult != 0){
+        if(iResult > 0){
+            SymTable_unpin(oSymTable, uPage, 0);
+        }
+        return 0;
+    }
+
+    if(strLength > MAX_INLINE_KEY
+        && !SymTable_writeBlob(oSymTable, pcKey, strLength, &uBlob)){
+        return 0;
+    }
+
+    /* Split the bucket until the record fits, or give it more pages
+       once it cannot split */
+    for(;;){
+        uSlot = (size_t)uHash
+            & (((size_t)1 << oSymTable->uGlobalDepth) - 1);
+        iResult = SymTable_append(oSymTable,
+            oSymTable->puDirectory[uSlot], pcKey, strLength, uHash,
+            pvValue, uBlob, &uDepth);
+        if(iResult > 0){
+            break;
+        }
+        if(iResult < 0
+            || (uDepth < MAX_DEPTH && !SymTable_split(oSymTable, uSlot))
+            || (uDepth == MAX_DEPTH && !SymTable_addOverflow(oSymTable,
+                oSymTable->puDirectory[uSlot]))){
+            SymTable_freeBlob(oSymTable, uBlob);
+            return 0;
+        }
+    }
+    oSymTable->size++;
+    return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *SymTable_replace(SymTable_T oSymTable, const char *pcKey,
+    const void *pvValue){
+    struct DiskRecord *pRecord;
+    unsigned char *pucData;
+    const void *pOldValue;
+    uint32_t uPage;
+    uint32_t uPrev;
+    size_t uOffset;
+    size_t strLength;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    strLength = strlen(pcKey);
+    if(SymTable_find(oSymTable, pcKey, strLength,
+        SymTable_hash(pcKey, strLength), &uPage, &uOffset, &uPrev) <= 0){
+        return NULL;
+    }
+    pucData = oSymTable->pFrames[oSymTable->puFrameOf[uPage] - 1].pucData;
+    pRecord = SymTable_recordAt(pucData, uOffset);
+    pOldValue = pRecord->pvValue;
+    pRecord->pvValue = pvValue;
+    SymTable_unpin(oSymTable, uPage, 1);
+    return (void*) pOldValue;
+}
+
+/*--------------------------------------------------------------------*/
+
+int SymTable_contains(SymTable_T oSymTable, const char *pcKey){
+    uint32_t uPage;
+    uint32_t uPrev;
+    size_t uOffset;
+    size_t strLength;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    strLength = strlen(pcKey);
+    if(SymTable_find(oSymTable, pcKey, strLength,
+        SymTable_hash(pcKey, strLength), &uPage, &uOffset, &uPrev) <= 0){
+        return 0;
+    }
+    SymTable_unpin(oSymTable, uPage, 0);
+    return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *SymTable_get(SymTable_T oSymTable, const char *pcKey){
+    unsigned char *pucData;
+    const void *pvValue;
+    uint32_t uPage;
+    uint32_t uPrev;
+    size_t uOffset;
+    size_t strLength;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    strLength = strlen(pcKey);
+    if(SymTable_find(oSymTable, pcKey, strLength,
+        SymTable_hash(pcKey, strLength), &uPage, &uOffset, &uPrev) <= 0){
+        return NULL;
+    }
+    pucData = oSymTable->pFrames[oSymTable->puFrameOf[uPage] - 1].pucData;
+    pvValue = SymTable_recordAt(pucData, uOffset)->pvValue;
+    SymTable_unpin(oSymTable, uPage, 0);
+    return (void*)pvValue;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *SymTable_remove(SymTable_T oSymTable, const char *pcKey){
+    struct DiskPage *pPage;
+    struct DiskPage *pPrevPage;
+    struct DiskRecord *pRecord;
+    unsigned char *pucData;
+    unsigned char *pucPrevData;
+    const void *pOldValue;
+    uint32_t uPage;
+    uint32_t uPrev;
+    uint32_t uBlob = NO_PAGE;
+    uint64_t uHash;
+    size_t uOffset;
+    size_t uSize;
+    size_t strLength;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    strLength = strlen(pcKey);
+    uHash = SymTable_hash(pcKey, strLength);
+    if(SymTable_find(oSymTable, pcKey, strLength, uHash, &uPage, &uOffset,
+        &uPrev) <= 0){
+        return NULL;
+    }
+    pucData = oSymTable->pFrames[oSymTable->puFrameOf[uPage] - 1].pucData;
+    pPage = (struct DiskPage*)(void*)pucData;
+    pRecord = SymTable_recordAt(pucData, uOffset);
+    pOldValue = pRecord->pvValue;
+    if(pRecord->uKeyLength > MAX_INLINE_KEY){
+        uBlob = SymTable_blobOf(pRecord);
+    }
+
+    /* The records after it move up */
+    uSize = SymTable_recordSize(pRecord->uKeyLength);
+    memmove(pucData + uOffset, pucData + uOffset + uSize,
+        sizeof(struct DiskPage) + pPage->uUsed - uOffset - uSize);
+    pPage->uUsed -= (uint32_t)uSize;
+    pPage->uCount--;
+    oSymTable->size--;
+
+    /* An empty page after the first of its bucket goes */
+    if(pPage->uCount == 0 && uPrev != NO_PAGE){
+        pucPrevData = SymTable_fetch(oSymTable, uPrev, 0);
+        if(pucPrevData != NULL){
+            pPrevPage = (struct DiskPage*)(void*)pucPrevData;
+            pPrevPage->uNext = pPage->uNext;
+            SymTable_unpin(oSymTable, uPrev, 1);
+            SymTable_unpin(oSymTable, uPage, 1);
+            SymTable_freePage(oSymTable, uPage);
+            uPage = NO_PAGE;
+        }
+    }
+    if(uPage != NO_PAGE){
+        SymTable_unpin(oSymTable, uPage, 1);
+    }
+
+    SymTable_freeBlob(oSymTable, uBlob);
+    SymTable_coalesce(oSymTable, (size_t)uHash);
+    return (void*) pOldValue;
+}
+
+/*--------------------------------------------------------------------*/
+
+void SymTable_map(SymTable_T oSymTable, void (*pfApply)
+    (const char *pcKey, void *pvValue, void *pvExtra),
+    const void *pvExtra){
+    struct DiskPage *pPage;
+    struct DiskRecord *pRecord;
+    unsigned char *pucData;
+    const char *pcKey;
+    size_t uOffset;
+    size_t counter;
+    uint32_t uPage;
+    uint32_t uNext;
+
+    assert(oSymTable != NULL);
+    assert(pfApply != NULL);
+
+    for(counter = 0; counter < ((size_t)1 << oSymTable->uGlobalDepth);
+        counter++){
+        if(!SymTable_isFirstSlot(oSymTable, counter)){
+            continue;
+        }
+        /* A page that cannot be read is passed over */
+        for(uPage = oSymTable->puDirectory[counter]; uPage != NO_PAGE;
+            uPage = uNext){
+            pucData = SymTable_fetch(oSymTable, uPage, 0);
+            if(pucData == NULL){
+                break;
+            }
+            pPage = (struct DiskPage*)(void*)pucData;
+            for(uOffset = sizeof(struct DiskPage);
+                uOffset < sizeof(struct DiskPage) + pPage->uUsed;
+                uOffset += SymTable_recordSize(pRecord->uKeyLength)){
+                pRecord = SymTable_recordAt(pucData, uOffset);
+                pcKey = SymTable_keyOf(oSymTable, pRecord);
+                if(pcKey != NULL){
+                    (*pfApply)(pcKey, (void*)pRecord->pvValue,
+                        (void*) pvExtra);
+                }
+            }
+            uNext = pPage->uNext;
+            SymTable_unpin(oSymTable, uPage, 0);
+        }
+    }
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t SymTable_removeIf(SymTable_T oSymTable, int (*pfPredicate)
+    (const char *pcKey, void *pvValue, void *pvExtra),
+    const void *pvExtra, void (*pfRemoved)
+    (const char *pcKey, void *pvValue, void *pvExtra)){
+    struct DiskPage *pPage;
+    struct DiskPage *pPrevPage;
+    struct DiskRecord *pRecord;
+    unsigned char *pucData;
+    unsigned char *pucPrevData;
+    const char *pcKey;
+    size_t uRemoved = 0;
+    size_t uRead;
+    size_t uWrite;
+    size_t uEnd;
+    size_t uSize;
+    size_t counter;
+    uint32_t uPage;
+    uint32_t uPrev;
+    uint32_t uNext;
+    int iChanged;
+
+    assert(oSymTable != NULL);
+    assert(pfPredicate != NULL);
+
+    for(counter = 0; counter < ((size_t)1 << oSymTable->uGlobalDepth);
+        counter++){
+        if(!SymTable_isFirstSlot(oSymTable, counter)){
+            continue;
+        }
+        uPrev = NO_PAGE;
+        for(uPage = oSymTable->puDirectory[counter]; uPage != NO_PAGE;
+            uPage = uNext){
+            pucData = SymTable_fetch(oSymTable, uPage, 0);
+            if(pucData == NULL){
+                break;
+            }
+            pPage = (struct DiskPage*)(void*)pucData;
+
+            /* The records kept move up over those removed */
+            iChanged = 0;
+            uWrite = sizeof(struct DiskPage);
+            uEnd = sizeof(struct DiskPage) + pPage->uUsed;
+            for(uRead = sizeof(struct DiskPage); uRead < uEnd;
+                uRead += uSize){
+                pRecord = SymTable_recordAt(pucData, uRead);
+                uSize = SymTable_recordSize(pRecord->uKeyLength);
+                pcKey = SymTable_keyOf(oSymTable, pRecord);
+                if(pcKey == NULL
+                    || ! (*pfPredicate)(pcKey, (void*)pRecord->pvValue,
+                        (void*) pvExtra)){
+                    if(uWrite != uRead){
+                        memmove(pucData + uWrite, pRecord, uSize);
+                    }
+                    uWrite += uSize;
+                    continue;
+                }
+                if(pfRemoved != NULL){
+                    (*pfRemoved)(pcKey, (void*)pRecord->pvValue,
+                        (void*) pvExtra);
+                }
+                if(pRecord->uKeyLength > MAX_INLINE_KEY){
+                    SymTable_freeBlob(oSymTable, SymTable_blobOf(pRecord));
+                }
+                pPage->uCount--;
+                iChanged = 1;
+                uRemoved++;
+            }
+            pPage->uUsed = (uint32_t)(uWrite - sizeof(struct DiskPage));
+            uNext = pPage->uNext;
+
+            /* An empty page after the first of its bucket goes */
+            if(pPage->uCount == 0 && uPrev != NO_PAGE){
+                pucPrevData = SymTable_fetch(oSymTable, uPrev, 0);
+                if(pucPrevData != NULL){
+                    pPrevPage = (struct DiskPage*)(void*)pucPrevData;
+                    pPrevPage->uNext = uNext;
+                    SymTable_unpin(oSymTable, uPrev, 1);
+                    SymTable_unpin(oSymTable, uPage, 1);
+                    SymTable_freePage(oSymTable, uPage);
+                    continue;
+                }
+            }
+            SymTable_unpin(oSymTable, uPage, iChanged);
+            uPrev = uPage;
+        }
+    }
+    oSymTable->size -= uRemoved;
+
+    /* Buckets left sparse merge, and the directory shrinks with them */
+    if(uRemoved != 0){
+        for(counter = 0; counter < ((size_t)1 << oSymTable->uGlobalDepth);
+            counter++){
+            if(SymTable_isFirstSlot(oSymTable, counter)){
+                SymTable_coalesce(oSymTable, counter);
+            }
+        }
+    }
+    return uRemoved;
+}
@@ -0,0 +1,36 @@
+/*--------------------------------------------------------------------*/
+/*                                                                    */
+/* Header file for SymTable objects whose bindings live in a scratch  */
+/* file, with a bounded number of its pages cached in memory          */
+/*                                                                    */
+/* Author: Maxwell Lloyd                                              */
+/*                                                                    */
+/*--------------------------------------------------------------------*/
+
+
+#ifndef SYMTABLEDISK_INCLUDED
+#define SYMTABLEDISK_INCLUDED
+
+#include <stddef.h>
+#include "symtable.h"
+
+/*--------------------------------------------------------------------*/
+
+/* Return a new empty SymTable object whose bindings are kept in 4KB
+   pages of a new file in the directory pcDirectory, or in $TMPDIR or
+   /tmp if pcDirectory is NULL, and which holds at most uCacheBytes of
+   those pages in memory, or NULL if the file cannot be made or there
+   is not enough memory available. A cache of fewer than 8 pages holds
+   8. The file is unlinked at once and its space goes back when the
+   table is freed. Values are stored as the pointers they are, so the
+   file means nothing to any other process. The cache keeps the pages
+   used most recently, and gives pages back when the allocator refuses
+   a block, so a table that outgrows its cache or its memory reads and
+   writes the file instead of failing. SymTable_new and
+   SymTable_newWithAllocator make tables in the default directory with
+   a 64MB cache. An operation whose read or write of the file fails
+   fails as if there were not enough memory available */
+SymTable_T SymTable_newOnDisk(const char *pcDirectory, size_t uCacheBytes);
+
+
+#endif
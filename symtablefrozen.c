@@ -0,0 +1,503 @@
+/*--------------------------------------------------------------------*/
+/*                                                                    */
+/* Read-only copy of a SymTable object that finds each key with a     */
+/* minimal perfect hash built by hash-and-displace                    */
+/*                                                                    */
+/* Author: Maxwell Lloyd                                              */
+/*                                                                    */
+/*--------------------------------------------------------------------*/
+
+
+
+#include <stddef.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "symtablefrozen.h"
+
+/*--------------------------------------------------------------------*/
+
+/* Average number of keys that share one displacement. With 16-bit
+   displacements this costs 16 / FROZEN_BUCKET_SIZE bits per key */
+enum {FROZEN_BUCKET_SIZE = 5};
+
+/* Slots are built FROZEN_SLACK percent larger than the key count so
+   the last keys placed still find free slots quickly. The keys that
+   land past the end are then moved into the holes left below it */
+enum {FROZEN_SLACK = 1};
+
+/* Number of seeds tried before giving up on a set of keys */
+enum {FROZEN_MAX_SEEDS = 32};
+
+/* Largest displacement that fits in a bucket's 16 bits */
+enum {FROZEN_MAX_DISPLACEMENT = 65535};
+
+/*--------------------------------------------------------------------*/
+
+/* Each binding lives in the slot the perfect hash gives its key */
+struct FrozenSlot{
+    /* Offset of the key in pcKeys */
+    size_t uKeyOffset;
+
+    /* Value of the binding */
+    const void *pvValue;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* SymTableFrozen object holds the bindings in uCount slots, indexed
+   by a hash function and one displacement per bucket of keys */
+struct SymTableFrozen{
+    /* Seed of the hash function the displacements were found for */
+    uint64_t uSeed;
+
+    /* Number of bindings, which is also the number of slots */
+    size_t uCount;
+
+    /* Number of positions the displaced hash can give */
+    size_t uRange;
+
+    /* Number of buckets, each with its own displacement */
+    size_t uBucketCount;
+
+    /* Displacement of each bucket */
+    uint16_t *puDisplacements;
+
+    /* Slot for each position from uCount up to uRange */
+    uint32_t *puRemap;
+
+    /* The bindings */
+    struct FrozenSlot *pSlots;
+
+    /* Every key with its '\0', one after another */
+    char *pcKeys;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* The bindings of a table gathered by SymTableFrozen_collect */
+struct FrozenEntries{
+    /* Keys of the bindings */
+    const char **ppcKeys;
+
+    /* Values of the bindings, in the same order as ppcKeys */
+    const void **ppvValues;
+
+    /* Number of bindings gathered so far */
+    size_t uCount;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Return u with its bits mixed so that every input bit affects every
+   output bit. */
+
+static uint64_t SymTableFrozen_mix(uint64_t u)
+{
+    u ^= u >> 33;
+    u *= UINT64_C(0xff51afd7ed558ccd);
+    u ^= u >> 33;
+    u *= UINT64_C(0xc4ceb9fe1a85ec53);
+    u ^= u >> 33;
+    return u;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the 64-bit hash code of pcKey for the seed uSeed. */
+
+static uint64_t SymTableFrozen_hash(const char *pcKey, uint64_t uSeed)
+{
+    const uint64_t FNV_PRIME = UINT64_C(1099511628211);
+    uint64_t uHash = UINT64_C(14695981039346656037) ^ uSeed;
+    const unsigned char *pucKey = (const unsigned char*)pcKey;
+
+    assert(pcKey != NULL);
+
+    while(*pucKey != '\0'){
+        uHash = (uHash ^ *pucKey) * FNV_PRIME;
+        pucKey++;
+    }
+    return SymTableFrozen_mix(uHash);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the position between 0 and uRange-1 that the key with hash
+   code uHash takes when its bucket has displacement uDisplacement. */
+
+static size_t SymTableFrozen_position(uint64_t uHash,
+    uint64_t uDisplacement, size_t uRange)
+{
+    const uint64_t GOLDEN_RATIO = UINT64_C(0x9e3779b97f4a7c15);
+
+    return (size_t)(SymTableFrozen_mix(uHash
+        ^ ((uDisplacement + 1) * GOLDEN_RATIO)) % uRange);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the slot of the binding for pcKey in oSymTableFrozen, or
+   NULL if there is none. */
+
+static const struct FrozenSlot *SymTableFrozen_find(
+    SymTableFrozen_T oSymTableFrozen, const char *pcKey)
+{
+    const struct FrozenSlot *pSlot;
+    uint64_t uHash;
+    size_t uPosition;
+
+    assert(oSymTableFrozen != NULL);
+    assert(pcKey != NULL);
+
+    if(oSymTableFrozen->uCount == 0){
+        return NULL;
+    }
+
+    uHash = SymTableFrozen_hash(pcKey, oSymTableFrozen->uSeed);
+    uPosition = SymTableFrozen_position(uHash,
+        oSymTableFrozen->puDisplacements[
+            uHash % oSymTableFrozen->uBucketCount],
+        oSymTableFrozen->uRange);
+    if(uPosition >= oSymTableFrozen->uCount){
+        uPosition = oSymTableFrozen->puRemap[
+            uPosition - oSymTableFrozen->uCount];
+    }
+
+    /* Any key lands on some slot, so the key there must be checked */
+    pSlot = &oSymTableFrozen->pSlots[uPosition];
+    if(strcmp(oSymTableFrozen->pcKeys + pSlot->uKeyOffset, pcKey) != 0){
+        return NULL;
+    }
+    return pSlot;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Find a displacement for every bucket of oSymTableFrozen so that the
+   uCount keys with hash codes puHashes take distinct positions, and
+   store each key's position in puPositions. Returns 1 for success, 0
+   if some bucket has no displacement that fits or there is not enough
+   memory available. */
+
+static int SymTableFrozen_place(SymTableFrozen_T oSymTableFrozen,
+    const uint64_t *puHashes, size_t *puPositions)
+{
+    size_t *puStart = NULL;
+    size_t *puMembers = NULL;
+    size_t *puOrder = NULL;
+    size_t *puSizeStart = NULL;
+    unsigned char *pucTaken = NULL;
+    size_t uBucketCount;
+    size_t uMaxSize = 0;
+    size_t uBucket;
+    size_t uSize;
+    size_t uDisplacement;
+    size_t u;
+    size_t i;
+    size_t j;
+    int success = 0;
+
+    assert(oSymTableFrozen != NULL);
+    assert(puHashes != NULL);
+    assert(puPositions != NULL);
+
+    uBucketCount = oSymTableFrozen->uBucketCount;
+    puStart = calloc(uBucketCount + 1, sizeof(size_t));
+    puMembers = malloc((oSymTableFrozen->uCount + 1) * sizeof(size_t));
+    puOrder = malloc(uBucketCount * sizeof(size_t));
+    pucTaken = calloc(oSymTableFrozen->uRange, 1);
+    if(puStart == NULL || puMembers == NULL || puOrder == NULL
+        || pucTaken == NULL){
+        goto cleanup;
+    }
+
+    /* Group the keys by bucket */
+    for(i = 0; i < oSymTableFrozen->uCount; i++){
+        puStart[puHashes[i] % uBucketCount + 1]++;
+    }
+    for(u = 0; u < uBucketCount; u++){
+        if(puStart[u + 1] > uMaxSize){
+            uMaxSize = puStart[u + 1];
+        }
+        puStart[u + 1] += puStart[u];
+    }
+    for(i = 0; i < oSymTableFrozen->uCount; i++){
+        puMembers[puStart[puHashes[i] % uBucketCount]++] = i;
+    }
+    for(u = uBucketCount; u > 0; u--){
+        puStart[u] = puStart[u - 1];
+    }
+    puStart[0] = 0;
+
+    /* Place the largest buckets first, while most slots are free */
+    puSizeStart = calloc(uMaxSize + 2, sizeof(size_t));
+    if(puSizeStart == NULL){
+        goto cleanup;
+    }
+    for(u = 0; u < uBucketCount; u++){
+        puSizeStart[uMaxSize - (puStart[u + 1] - puStart[u]) + 1]++;
+    }
+    for(u = 0; u <= uMaxSize; u++){
+        puSizeStart[u + 1] += puSizeStart[u];
+    }
+    for(u = 0; u < uBucketCount; u++){
+        puOrder[puSizeStart[uMaxSize - (puStart[u + 1] - puStart[u])]++]
+            = u;
+    }
+
+    for(u = 0; u < uBucketCount; u++){
+        uBucket = puOrder[u];
+        uSize = puStart[uBucket + 1] - puStart[uBucket];
+        if(uSize == 0){
+            break;
+        }
+        for(uDisplacement = 0; ; uDisplacement++){
+            if(uDisplacement > FROZEN_MAX_DISPLACEMENT){
+                goto cleanup;
+            }
+            /* Try the displacement, undoing it on a clash */
+            for(i = 0; i < uSize; i++){
+                j = puMembers[puStart[uBucket] + i];
+                puPositions[j] = SymTableFrozen_position(puHashes[j],
+                    uDisplacement, oSymTableFrozen->uRange);
+                if(pucTaken[puPositions[j]]){
+                    break;
+                }
+                pucTaken[puPositions[j]] = 1;
+            }
+            if(i == uSize){
+                break;
+            }
+            while(i > 0){
+                i--;
+                pucTaken[puPositions[puMembers[puStart[uBucket] + i]]]
+                    = 0;
+            }
+        }
+        oSymTableFrozen->puDisplacements[uBucket]
+            = (uint16_t)uDisplacement;
+    }
+    success = 1;
+
+cleanup:
+    free(puStart);
+    free(puMembers);
+    free(puOrder);
+    free(puSizeStart);
+    free(pucTaken);
+    return success;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Append the binding pcKey, pvValue to the FrozenEntries pvExtra. */
+
+static void SymTableFrozen_collect(const char *pcKey, void *pvValue,
+    void *pvExtra)
+{
+    struct FrozenEntries *pEntries = (struct FrozenEntries*)pvExtra;
+
+    assert(pcKey != NULL);
+    assert(pvExtra != NULL);
+
+    pEntries->ppcKeys[pEntries->uCount] = pcKey;
+    pEntries->ppvValues[pEntries->uCount] = pvValue;
+    pEntries->uCount++;
+}
+
+/*--------------------------------------------------------------------*/
+
+SymTableFrozen_T SymTable_freeze(SymTable_T oSymTable){
+    SymTableFrozen_T oSymTableFrozen;
+    struct FrozenEntries entries;
+    uint64_t *puHashes = NULL;
+    size_t *puPositions = NULL;
+    unsigned char *pucFull = NULL;
+    size_t uKeyBytes = 0;
+    size_t uCount;
+    size_t uFree;
+    size_t u;
+    size_t i;
+    int success = 0;
+
+    assert(oSymTable != NULL);
+
+    uCount = SymTable_getLength(oSymTable);
+    if(uCount > UINT32_MAX){
+        return NULL;
+    }
+
+    oSymTableFrozen = (SymTableFrozen_T)calloc(1,
+        sizeof(struct SymTableFrozen));
+    if(oSymTableFrozen == NULL){
+        return NULL;
+    }
+    oSymTableFrozen->uCount = uCount;
+    oSymTableFrozen->uRange = uCount + uCount * FROZEN_SLACK / 100 + 1;
+    oSymTableFrozen->uBucketCount = uCount / FROZEN_BUCKET_SIZE + 1;
+
+    entries.ppcKeys = malloc((uCount + 1) * sizeof(const char*));
+    entries.ppvValues = malloc((uCount + 1) * sizeof(const void*));
+    entries.uCount = 0;
+    puHashes = malloc((uCount + 1) * sizeof(uint64_t));
+    puPositions = malloc((uCount + 1) * sizeof(size_t));
+    pucFull = calloc(uCount + 1, 1);
+    oSymTableFrozen->puDisplacements = calloc(
+        oSymTableFrozen->uBucketCount, sizeof(uint16_t));
+    oSymTableFrozen->puRemap = malloc(
+        (oSymTableFrozen->uRange - uCount) * sizeof(uint32_t));
+    oSymTableFrozen->pSlots = malloc(
+        (uCount + 1) * sizeof(struct FrozenSlot));
+    if(entries.ppcKeys == NULL || entries.ppvValues == NULL
+        || puHashes == NULL || puPositions == NULL || pucFull == NULL
+        || oSymTableFrozen->puDisplacements == NULL
+        || oSymTableFrozen->puRemap == NULL
+        || oSymTableFrozen->pSlots == NULL){
+        goto cleanup;
+    }
+
+    SymTable_map(oSymTable, SymTableFrozen_collect, &entries);
+    assert(entries.uCount == uCount);
+
+    for(i = 0; i < uCount; i++){
+        uKeyBytes += strlen(entries.ppcKeys[i]) + 1;
+    }
+    oSymTableFrozen->pcKeys = malloc(uKeyBytes + 1);
+    if(oSymTableFrozen->pcKeys == NULL){
+        goto cleanup;
+    }
+
+    /* A seed can fail when keys collide, so try others */
+    for(oSymTableFrozen->uSeed = 0;
+        oSymTableFrozen->uSeed < FROZEN_MAX_SEEDS;
+        oSymTableFrozen->uSeed++){
+        for(i = 0; i < uCount; i++){
+            puHashes[i] = SymTableFrozen_hash(entries.ppcKeys[i],
+                oSymTableFrozen->uSeed);
+        }
+        if(SymTableFrozen_place(oSymTableFrozen, puHashes, puPositions)){
+            break;
+        }
+    }
+    if(oSymTableFrozen->uSeed == FROZEN_MAX_SEEDS){
+        goto cleanup;
+    }
+
+    /* Positions past the last slot move into the unused slots, in
+       order, so the slots are exactly full */
+    for(u = 0; u < oSymTableFrozen->uRange - uCount; u++){
+        oSymTableFrozen->puRemap[u] = UINT32_MAX;
+    }
+    for(i = 0; i < uCount; i++){
+        if(puPositions[i] >= uCount){
+            oSymTableFrozen->puRemap[puPositions[i] - uCount] = 0;
+        }
+        else{
+            pucFull[puPositions[i]] = 1;
+        }
+    }
+    uFree = 0;
+    for(u = 0; u < oSymTableFrozen->uRange - uCount; u++){
+        /* Only unknown keys reach unused positions; any slot will do */
+        if(oSymTableFrozen->puRemap[u] == UINT32_MAX){
+            oSymTableFrozen->puRemap[u] = 0;
+            continue;
+        }
+        while(pucFull[uFree]){
+            uFree++;
+        }
+        oSymTableFrozen->puRemap[u] = (uint32_t)uFree;
+        pucFull[uFree] = 1;
+    }
+
+    uKeyBytes = 0;
+    for(i = 0; i < uCount; i++){
+        u = puPositions[i];
+        if(u >= uCount){
+            u = oSymTableFrozen->puRemap[u - uCount];
+        }
+        oSymTableFrozen->pSlots[u].uKeyOffset = uKeyBytes;
+        oSymTableFrozen->pSlots[u].pvValue = entries.ppvValues[i];
+        strcpy(oSymTableFrozen->pcKeys + uKeyBytes, entries.ppcKeys[i]);
+        uKeyBytes += strlen(entries.ppcKeys[i]) + 1;
+    }
+    success = 1;
+
+cleanup:
+    free(entries.ppcKeys);
+    free(entries.ppvValues);
+    free(puHashes);
+    free(puPositions);
+    free(pucFull);
+    if(!success){
+        SymTableFrozen_free(oSymTableFrozen);
+        return NULL;
+    }
+    return oSymTableFrozen;
+}
+
+/*--------------------------------------------------------------------*/
+
+void SymTableFrozen_free(SymTableFrozen_T oSymTableFrozen){
+    assert(oSymTableFrozen != NULL);
+
+    free(oSymTableFrozen->puDisplacements);
+    free(oSymTableFrozen->puRemap);
+    free(oSymTableFrozen->pSlots);
+    free(oSymTableFrozen->pcKeys);
+    free(oSymTableFrozen);
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t SymTableFrozen_getLength(SymTableFrozen_T oSymTableFrozen){
+    assert(oSymTableFrozen != NULL);
+
+    return oSymTableFrozen->uCount;
+}
+
+/*--------------------------------------------------------------------*/
+
+int SymTableFrozen_contains(SymTableFrozen_T oSymTableFrozen,
+    const char *pcKey){
+    assert(oSymTableFrozen != NULL);
+    assert(pcKey != NULL);
+
+    return SymTableFrozen_find(oSymTableFrozen, pcKey) != NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *SymTableFrozen_get(SymTableFrozen_T oSymTableFrozen,
+    const char *pcKey){
+    const struct FrozenSlot *pSlot;
+
+    assert(oSymTableFrozen != NULL);
+    assert(pcKey != NULL);
+
+    pSlot = SymTableFrozen_find(oSymTableFrozen, pcKey);
+    if(pSlot == NULL){
+        return NULL;
+    }
+    return (void*)pSlot->pvValue;
+}
+
+/*--------------------------------------------------------------------*/
+
+void SymTableFrozen_map(SymTableFrozen_T oSymTableFrozen,
+    void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+    const void *pvExtra){
+    const struct FrozenSlot *pSlot;
+    size_t u;
+
+    assert(oSymTableFrozen != NULL);
+    assert(pfApply != NULL);
+
+    for(u = 0; u < oSymTableFrozen->uCount; u++){
+        pSlot = &oSymTableFrozen->pSlots[u];
+        (*pfApply)(oSymTableFrozen->pcKeys + pSlot->uKeyOffset,
+            (void*)pSlot->pvValue, (void*) pvExtra);
+    }
+}
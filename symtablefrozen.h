@@ -0,0 +1,65 @@
+/*--------------------------------------------------------------------*/
+/*                                                                    */
+/* Header file for a read-only copy of a SymTable object that finds   */
+/* each key with a minimal perfect hash                               */
+/*                                                                    */
+/* Author: Maxwell Lloyd                                              */
+/*                                                                    */
+/*--------------------------------------------------------------------*/
+
+
+#ifndef SYMTABLEFROZEN_INCLUDED
+#define SYMTABLEFROZEN_INCLUDED
+
+#include <stddef.h>
+#include "symtable.h"
+
+/*--------------------------------------------------------------------*/
+
+/* SymTableFrozen_T is an immutable table whose keys are stored in one
+   block, found with one probe each. Since nothing changes it, it can
+   be shared by threads without locking */
+typedef struct SymTableFrozen* SymTableFrozen_T;
+
+/*--------------------------------------------------------------------*/
+
+/* Return a new SymTableFrozen object holding the bindings of
+   parameter oSymTable, or NULL if there is not enough memory
+   available. oSymTable is not changed and can be freed afterwards;
+   the values are not copied */
+SymTableFrozen_T SymTable_freeze(SymTable_T oSymTable);
+
+/*--------------------------------------------------------------------*/
+
+/* Free parameter oSymTableFrozen and its keys */
+void SymTableFrozen_free(SymTableFrozen_T oSymTableFrozen);
+
+/*--------------------------------------------------------------------*/
+
+/* Returns the number of bindings in parameter oSymTableFrozen */
+size_t SymTableFrozen_getLength(SymTableFrozen_T oSymTableFrozen);
+
+/*--------------------------------------------------------------------*/
+
+/* Checks to see if there is a binding pcKey in parameter
+   oSymTableFrozen. If so, return 1, otherwise return 0 */
+int SymTableFrozen_contains(SymTableFrozen_T oSymTableFrozen,
+    const char *pcKey);
+
+/*--------------------------------------------------------------------*/
+
+/* Returns the value of the binding pcKey in parameter oSymTableFrozen,
+   or NULL if there is none */
+void *SymTableFrozen_get(SymTableFrozen_T oSymTableFrozen,
+    const char *pcKey);
+
+/*--------------------------------------------------------------------*/
+
+/* Uses the function pfApply on every binding of the parameter
+   oSymTableFrozen, using function pfApply(pcKey, pvValue, pvExtra) */
+void SymTableFrozen_map(SymTableFrozen_T oSymTableFrozen,
+    void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+    const void *pvExtra);
+
+
+#endif
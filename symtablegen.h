@@ -0,0 +1,344 @@
+/*--------------------------------------------------------------------*/
+/*                                                                    */
+/* Header-only generator of hash tables specialized to one key type   */
+/* and one value type, with the algorithms of symtablehash.c          */
+/*                                                                    */
+/* Author: Maxwell Lloyd                                              */
+/*                                                                    */
+/*--------------------------------------------------------------------*/
+
+
+#ifndef SYMTABLEGEN_INCLUDED
+#define SYMTABLEGEN_INCLUDED
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <assert.h>
+
+/*--------------------------------------------------------------------*/
+
+/* All values of bucket sizes when resizing, as in symtablehash.c */
+static const size_t SymTableGen_buckets[] = {509, 1021, 2039, 4093, 8191,
+    16381, 32749, 65521, 131071, 262139, 524287, 1048573, 2097143,
+    4194301, 8388593, 16777213, 33554393, 67108859, 134217689, 268435399,
+    536870909, 1073741789, 2147483647};
+
+/*--------------------------------------------------------------------*/
+
+/* Return the bucket count that follows uBucketCount, or uBucketCount
+   itself if it is the largest. */
+
+static inline size_t SymTableGen_nextBucketCount(size_t uBucketCount)
+{
+    size_t index;
+    size_t uLast = sizeof(SymTableGen_buckets)
+        / sizeof(SymTableGen_buckets[0]) - 1;
+
+    for(index = 0; index < uLast; index++){
+        if(SymTableGen_buckets[index] > uBucketCount){
+            return SymTableGen_buckets[index];
+        }
+    }
+    return SymTableGen_buckets[uLast];
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return a hash code for the integer uKey. Bucket counts are prime, so
+   the bits only need to be spread enough that nearby keys do not
+   share a pattern modulo the count. */
+
+static inline size_t SymTableGen_hashUint64(uint64_t uKey)
+{
+    uKey ^= uKey >> 33;
+    uKey *= UINT64_C(0xff51afd7ed558ccd);
+    uKey ^= uKey >> 33;
+    return (size_t)uKey;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the hash code of symtablehash.c for the string pcKey. */
+
+static inline size_t SymTableGen_hashString(const char *pcKey)
+{
+    const size_t HASH_MULTIPLIER = 65599;
+    size_t u;
+    size_t uHash = 0;
+
+    assert(pcKey != NULL);
+
+    for (u = 0; pcKey[u] != '\0'; u++)
+        uHash = uHash * HASH_MULTIPLIER + (size_t)pcKey[u];
+
+    return uHash;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* SYMTABLE_DEFINE(Name, KeyType, ValueType, hashFn, eqFn) defines the
+   table type Name_T and its functions, each a static inline function
+   named Name_operation. hashFn(key) returns a size_t hash code for a
+   KeyType, and eqFn(key1, key2) returns nonzero if two KeyTypes are
+   equal; either may be a function or a function-like macro, and the
+   compiler sees its body at every call.
+
+   Keys and values are copied into the nodes by assignment, so a
+   pointer key is not a defensive copy: its referent must outlive the
+   binding. Since a ValueType cannot hold a "no binding" sentinel,
+   Name_get returns a pointer to the stored value, or NULL, and
+   Name_replace and Name_remove report the old value through an out
+   parameter. The functions are:
+
+   Name_T Name_new(void)
+       Return a new empty table, or NULL if there is not enough memory
+       available.
+   void Name_free(Name_T oTable)
+   size_t Name_getLength(Name_T oTable)
+   int Name_put(Name_T oTable, KeyType key, ValueType value)
+       Add the binding if key is not bound. Returns 1 if it was added,
+       or 0 if key is bound or there is not enough memory available.
+   int Name_replace(Name_T oTable, KeyType key, ValueType value,
+       ValueType *pOldValue)
+       Replace the value of key, storing the old one in *pOldValue
+       unless pOldValue is NULL. Returns 1 if key is bound, 0 if not.
+   int Name_contains(Name_T oTable, KeyType key)
+   ValueType *Name_get(Name_T oTable, KeyType key)
+       Return the address of the value of key, valid until the binding
+       is removed, or NULL if key is not bound.
+   int Name_remove(Name_T oTable, KeyType key, ValueType *pOldValue)
+       Remove the binding of key, storing its value in *pOldValue
+       unless pOldValue is NULL. Returns 1 if key was bound, 0 if not.
+   void Name_map(Name_T oTable,
+       void (*pfApply)(KeyType key, ValueType *pValue, void *pvExtra),
+       const void *pvExtra) */
+
+#define SYMTABLE_DEFINE(Name, KeyType, ValueType, hashFn, eqFn)          \
+                                                                         \
+typedef struct Name *Name##_T;                                           \
+                                                                         \
+/* Each binding is stored in a Name##Node to form a linked list */       \
+struct Name##Node{                                                       \
+    /* Key of the node */                                                \
+    KeyType key;                                                         \
+                                                                         \
+    /* Value of the node */                                              \
+    ValueType value;                                                     \
+                                                                         \
+    /* The address of the next node in the bucket */                     \
+    struct Name##Node *pNextNode;                                        \
+};                                                                       \
+                                                                         \
+struct Name{                                                             \
+    /* First node of each bucket */                                      \
+    struct Name##Node **ppBuckets;                                       \
+                                                                         \
+    /* Number of buckets */                                              \
+    size_t limit;                                                        \
+                                                                         \
+    /* Number of bindings */                                             \
+    size_t size;                                                         \
+};                                                                       \
+                                                                         \
+static inline struct Name##Node **Name##_bucket(Name##_T oTable,         \
+    KeyType key)                                                         \
+{                                                                        \
+    return &oTable->ppBuckets[(size_t)(hashFn(key)) % oTable->limit];    \
+}                                                                        \
+                                                                         \
+static inline Name##_T Name##_new(void)                                  \
+{                                                                        \
+    Name##_T oTable;                                                     \
+                                                                         \
+    oTable = (Name##_T)malloc(sizeof(struct Name));                      \
+    if(oTable == NULL){                                                  \
+        return NULL;                                                     \
+    }                                                                    \
+    oTable->limit = SymTableGen_buckets[0];                              \
+    oTable->ppBuckets = (struct Name##Node**)calloc(oTable->limit,       \
+        sizeof(struct Name##Node*));                                     \
+    if(oTable->ppBuckets == NULL){                                       \
+        free(oTable);                                                    \
+        return NULL;                                                     \
+    }                                                                    \
+    oTable->size = 0;                                                    \
+    return oTable;                                                       \
+}                                                                        \
+                                                                         \
+static inline void Name##_free(Name##_T oTable)                          \
+{                                                                        \
+    struct Name##Node *pNode;                                            \
+    struct Name##Node *pNextNode;                                        \
+    size_t counter;                                                      \
+                                                                         \
+    assert(oTable != NULL);                                              \
+                                                                         \
+    for(counter = 0; counter < oTable->limit; counter++){                \
+        for(pNode = oTable->ppBuckets[counter]; pNode != NULL;           \
+            pNode = pNextNode){                                          \
+            pNextNode = pNode->pNextNode;                                \
+            free(pNode);                                                 \
+        }                                                                \
+    }                                                                    \
+    free(oTable->ppBuckets);                                             \
+    free(oTable);                                                        \
+}                                                                        \
+                                                                         \
+static inline size_t Name##_getLength(Name##_T oTable)                   \
+{                                                                        \
+    assert(oTable != NULL);                                              \
+                                                                         \
+    return oTable->size;                                                 \
+}                                                                        \
+                                                                         \
+/* Move every node into newLimit buckets. A failure leaves the table    \
+   as it was, with longer chains. */                                     \
+static inline void Name##_rehash(Name##_T oTable, size_t newLimit)       \
+{                                                                        \
+    struct Name##Node **ppNewBuckets;                                    \
+    struct Name##Node **ppOldBuckets;                                    \
+    struct Name##Node *pNode;                                            \
+    struct Name##Node *pNextNode;                                        \
+    size_t oldLimit;                                                     \
+    size_t counter;                                                      \
+                                                                         \
+    ppNewBuckets = (struct Name##Node**)calloc(newLimit,                 \
+        sizeof(struct Name##Node*));                                     \
+    if(ppNewBuckets == NULL){                                            \
+        return;                                                          \
+    }                                                                    \
+    ppOldBuckets = oTable->ppBuckets;                                    \
+    oldLimit = oTable->limit;                                            \
+    oTable->ppBuckets = ppNewBuckets;                                    \
+    oTable->limit = newLimit;                                            \
+    for(counter = 0; counter < oldLimit; counter++){                     \
+        for(pNode = ppOldBuckets[counter]; pNode != NULL;                \
+            pNode = pNextNode){                                          \
+            struct Name##Node **ppBucket =                               \
+                Name##_bucket(oTable, pNode->key);                       \
+            pNextNode = pNode->pNextNode;                                \
+            pNode->pNextNode = *ppBucket;                                \
+            *ppBucket = pNode;                                           \
+        }                                                                \
+    }                                                                    \
+    free(ppOldBuckets);                                                  \
+}                                                                        \
+                                                                         \
+static inline int Name##_put(Name##_T oTable, KeyType key,               \
+    ValueType value)                                                     \
+{                                                                        \
+    struct Name##Node **ppBucket;                                        \
+    struct Name##Node *pNode;                                            \
+                                                                         \
+    assert(oTable != NULL);                                              \
+                                                                         \
+    ppBucket = Name##_bucket(oTable, key);                               \
+    for(pNode = *ppBucket; pNode != NULL; pNode = pNode->pNextNode){     \
+        if(eqFn(pNode->key, key)){                                       \
+            return 0;                                                    \
+        }                                                                \
+    }                                                                    \
+                                                                         \
+    pNode = (struct Name##Node*)malloc(sizeof(struct Name##Node));       \
+    if(pNode == NULL){                                                   \
+        return 0;                                                        \
+    }                                                                    \
+    pNode->key = key;                                                    \
+    pNode->value = value;                                                \
+    pNode->pNextNode = *ppBucket;                                        \
+    *ppBucket = pNode;                                                   \
+    oTable->size++;                                                      \
+                                                                         \
+    if(oTable->size > oTable->limit){                                    \
+        size_t newLimit = SymTableGen_nextBucketCount(oTable->limit);    \
+        if(newLimit != oTable->limit){                                   \
+            Name##_rehash(oTable, newLimit);                             \
+        }                                                                \
+    }                                                                    \
+    return 1;                                                            \
+}                                                                        \
+                                                                         \
+static inline ValueType *Name##_get(Name##_T oTable, KeyType key)        \
+{                                                                        \
+    struct Name##Node *pNode;                                            \
+                                                                         \
+    assert(oTable != NULL);                                              \
+                                                                         \
+    for(pNode = *Name##_bucket(oTable, key); pNode != NULL;              \
+        pNode = pNode->pNextNode){                                       \
+        if(eqFn(pNode->key, key)){                                       \
+            return &pNode->value;                                        \
+        }                                                                \
+    }                                                                    \
+    return NULL;                                                         \
+}                                                                        \
+                                                                         \
+static inline int Name##_contains(Name##_T oTable, KeyType key)          \
+{                                                                        \
+    return Name##_get(oTable, key) != NULL;                              \
+}                                                                        \
+                                                                         \
+static inline int Name##_replace(Name##_T oTable, KeyType key,           \
+    ValueType value, ValueType *pOldValue)                               \
+{                                                                        \
+    ValueType *pValue;                                                   \
+                                                                         \
+    pValue = Name##_get(oTable, key);                                    \
+    if(pValue == NULL){                                                  \
+        return 0;                                                        \
+    }                                                                    \
+    if(pOldValue != NULL){                                               \
+        *pOldValue = *pValue;                                            \
+    }                                                                    \
+    *pValue = value;                                                     \
+    return 1;                                                            \
+}                                                                        \
+                                                                         \
+static inline int Name##_remove(Name##_T oTable, KeyType key,            \
+    ValueType *pOldValue)                                                \
+{                                                                        \
+    struct Name##Node **ppLink;                                          \
+    struct Name##Node *pNode;                                            \
+                                                                         \
+    assert(oTable != NULL);                                              \
+                                                                         \
+    for(ppLink = Name##_bucket(oTable, key); *ppLink != NULL;            \
+        ppLink = &(*ppLink)->pNextNode){                                 \
+        pNode = *ppLink;                                                 \
+        if(eqFn(pNode->key, key)){                                       \
+            if(pOldValue != NULL){                                       \
+                *pOldValue = pNode->value;                               \
+            }                                                            \
+            *ppLink = pNode->pNextNode;                                  \
+            free(pNode);                                                 \
+            oTable->size--;                                              \
+            return 1;                                                    \
+        }                                                                \
+    }                                                                    \
+    return 0;                                                            \
+}                                                                        \
+                                                                         \
+static inline void Name##_map(Name##_T oTable,                           \
+    void (*pfApply)(KeyType key, ValueType *pValue, void *pvExtra),      \
+    const void *pvExtra)                                                 \
+{                                                                        \
+    struct Name##Node *pNode;                                            \
+    struct Name##Node *pNextNode;                                        \
+    size_t counter;                                                      \
+                                                                         \
+    assert(oTable != NULL);                                              \
+    assert(pfApply != NULL);                                             \
+                                                                         \
+    for(counter = 0; counter < oTable->limit; counter++){                \
+        for(pNode = oTable->ppBuckets[counter]; pNode != NULL;           \
+            pNode = pNextNode){                                          \
+            pNextNode = pNode->pNextNode;                                \
+            (*pfApply)(pNode->key, &pNode->value, (void*)pvExtra);       \
+        }                                                                \
+    }                                                                    \
+}
+
+
+#endif
@@ -0,0 +1,1224 @@
+/*--------------------------------------------------------------------*/
+/*                                                                    */
+/* Implementation of the SymTable ADT as a persistent hash array      */
+/* mapped trie, so that tables can be cloned in constant time         */
+/*                                                                    */
+/* Author: Maxwell Lloyd                                              */
+/*                                                                    */
+/*--------------------------------------------------------------------*/
+
+
+
+#include <stddef.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "symtablehamt.h"
+
+/* Bits of the hash code that pick a child at each level */
+enum {HAMT_BITS = 5};
+
+/* Most children a node can have */
+enum {HAMT_WIDTH = 1 << HAMT_BITS};
+
+/* Bits in a hash code; no node is deeper than this many bits */
+enum {HAMT_HASH_BITS = 64};
+
+/*--------------------------------------------------------------------*/
+
+/* Kinds of entries in the trie */
+enum HamtKind {
+    /* A HamtNode whose children are picked by the hash code */
+    HAMT_NODE,
+
+    /* A HamtNode holding leaves whose hash codes are all equal */
+    HAMT_COLLISION,
+
+    /* A HamtLeaf holding one binding */
+    HAMT_LEAF
+};
+
+/* Every node and leaf starts with a HamtEntry. Entries are shared by
+   every table and node that points to them, and are only changed in
+   place while one of them does */
+struct HamtEntry{
+    /* Number of tables and nodes pointing to this entry */
+    size_t uRefs;
+
+    /* What kind of entry this is */
+    enum HamtKind eKind;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Each binding is stored in a HamtLeaf */
+struct HamtLeaf{
+    /* Common header */
+    struct HamtEntry entry;
+
+    /* Full hash code of the key */
+    uint64_t uHash;
+
+    /* Value of the binding */
+    const void *pvValue;
+
+    /* Key of the binding */
+    char acKey[];
+};
+
+/*--------------------------------------------------------------------*/
+
+/* A HamtNode holds only the children that are present, in order */
+struct HamtNode{
+    /* Common header */
+    struct HamtEntry entry;
+
+    /* Bit i is set if the child for hash bits i is present; unused in
+       a collision node */
+    uint32_t uBitmap;
+
+    /* Number of children */
+    unsigned uCount;
+
+    /* Number of children there is room for */
+    unsigned uCapacity;
+
+    /* The children */
+    struct HamtEntry *apChildren[];
+};
+
+/*--------------------------------------------------------------------*/
+
+/* A HamtPath is the way SymTable_removeIf reached a node, kept so that
+   the node and those above it can be made unshared only once a leaf
+   in it is removed */
+struct HamtPath{
+    /* The node, replaced by its copy once it is made unshared */
+    struct HamtNode *pNode;
+
+    /* The slot of the table holding pNode, if pParent is NULL */
+    struct HamtEntry **ppRoot;
+
+    /* The way to the parent of pNode, or NULL for the root */
+    struct HamtPath *pParent;
+
+    /* Position of pNode among the children of its parent */
+    unsigned uPos;
+
+    /* 1 if pNode and every node above it are unshared */
+    int iOwned;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* What a table and all of its clones share */
+struct HamtFamily{
+    /* Source of every block the tables hold */
+    SymTable_Allocator allocator;
+
+    /* Bytes currently held from allocator */
+    size_t uBytes;
+
+    /* Number of tables in the family */
+    size_t uTables;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* SymTable object is a manager pointing to the root node of a trie
+   that may be shared with its clones */
+struct SymTable{
+    /* Root node of the trie, never a leaf */
+    struct HamtEntry *pRoot;
+
+    /* size of the entire symtable */
+    size_t size;
+
+    /* Allocator and memory count shared with the clones */
+    struct HamtFamily *pFamily;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Return uSize bytes from malloc. pvContext is unused. */
+
+static void *SymTable_defaultAlloc(size_t uSize, void *pvContext)
+{
+    (void)pvContext;
+    return malloc(uSize);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Free pvBlock, which SymTable_defaultAlloc returned. */
+
+static void SymTable_defaultFree(void *pvBlock, size_t uSize,
+    void *pvContext)
+{
+    (void)uSize;
+    (void)pvContext;
+    free(pvBlock);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* The allocator of tables made by SymTable_new */
+static const SymTable_Allocator defaultAllocator = {
+    SymTable_defaultAlloc, SymTable_defaultFree, NULL};
+
+/*--------------------------------------------------------------------*/
+
+/* Return uSize bytes from the allocator of pFamily, or NULL if it
+   refuses. */
+
+static void *SymTable_alloc(struct HamtFamily *pFamily, size_t uSize)
+{
+    void *pvBlock;
+
+    assert(pFamily != NULL);
+
+    pvBlock = (*pFamily->allocator.pfAlloc)(uSize,
+        pFamily->allocator.pvContext);
+    if(pvBlock != NULL){
+        pFamily->uBytes += uSize;
+    }
+    return pvBlock;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Give the uSize bytes at pvBlock back to the allocator of
+   pFamily. */
+
+static void SymTable_release(struct HamtFamily *pFamily, void *pvBlock,
+    size_t uSize)
+{
+    assert(pFamily != NULL);
+    assert(pvBlock != NULL);
+
+    pFamily->uBytes -= uSize;
+    (*pFamily->allocator.pfFree)(pvBlock, uSize,
+        pFamily->allocator.pvContext);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the hash code for pcKey. Every bit of it is used to pick
+   children, so the bits are mixed well. */
+
+static uint64_t SymTable_hash(const char *pcKey)
+{
+    uint64_t uHash = UINT64_C(14695981039346656037);
+    size_t u;
+
+    assert(pcKey != NULL);
+
+    for(u = 0; pcKey[u] != '\0'; u++){
+        uHash ^= (unsigned char)pcKey[u];
+        uHash *= UINT64_C(1099511628211);
+    }
+
+    uHash ^= uHash >> 33;
+    uHash *= UINT64_C(0xff51afd7ed558ccd);
+    uHash ^= uHash >> 33;
+    uHash *= UINT64_C(0xc4ceb9fe1a85ec53);
+    uHash ^= uHash >> 33;
+    return uHash;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the child slot that uHash picks at the level uShift. */
+
+static unsigned SymTable_index(uint64_t uHash, unsigned uShift)
+{
+    assert(uShift < HAMT_HASH_BITS);
+
+    return (unsigned)(uHash >> uShift) & (HAMT_WIDTH - 1);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the number of bits set in uBits. */
+
+static unsigned SymTable_popCount(uint32_t uBits)
+{
+#ifdef __GNUC__
+    return (unsigned)__builtin_popcount(uBits);
+#else
+    unsigned uCount = 0;
+    while(uBits != 0){
+        uBits &= uBits - 1;
+        uCount++;
+    }
+    return uCount;
+#endif
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the number of bytes a node with room for uCapacity children
+   takes. */
+
+static size_t SymTable_nodeSize(unsigned uCapacity)
+{
+    return sizeof(struct HamtNode)
+        + uCapacity * sizeof(struct HamtEntry*);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the number of bytes pLeaf takes. */
+
+static size_t SymTable_leafSize(const struct HamtLeaf *pLeaf)
+{
+    assert(pLeaf != NULL);
+
+    return sizeof(struct HamtLeaf) + strlen(pLeaf->acKey) + 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the full hash code of the keys below pEntry, which is a leaf
+   or a collision node. */
+
+static uint64_t SymTable_entryHash(const struct HamtEntry *pEntry)
+{
+    const struct HamtNode *pNode;
+
+    assert(pEntry != NULL);
+    assert(pEntry->eKind != HAMT_NODE);
+
+    if(pEntry->eKind == HAMT_COLLISION){
+        pNode = (const struct HamtNode*)pEntry;
+        pEntry = pNode->apChildren[0];
+    }
+    return ((const struct HamtLeaf*)pEntry)->uHash;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return a new node of kind eKind with no children and room for
+   uCapacity of them, or NULL if there is not enough memory
+   available. */
+
+static struct HamtNode *SymTable_newNode(struct HamtFamily *pFamily,
+    enum HamtKind eKind, unsigned uCapacity)
+{
+    struct HamtNode *pNode;
+
+    pNode = (struct HamtNode*)SymTable_alloc(pFamily,
+        SymTable_nodeSize(uCapacity));
+    if(pNode == NULL){
+        return NULL;
+    }
+    pNode->entry.uRefs = 1;
+    pNode->entry.eKind = eKind;
+    pNode->uBitmap = 0;
+    pNode->uCount = 0;
+    pNode->uCapacity = uCapacity;
+    return pNode;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return a new leaf binding a copy of pcKey, whose hash code is uHash,
+   to pvValue, or NULL if there is not enough memory available. */
+
+static struct HamtLeaf *SymTable_newLeaf(struct HamtFamily *pFamily,
+    const char *pcKey, uint64_t uHash, const void *pvValue)
+{
+    struct HamtLeaf *pLeaf;
+    size_t strLength;
+
+    assert(pcKey != NULL);
+
+    /* Defensive copy */
+    strLength = strlen(pcKey) + 1;
+    pLeaf = (struct HamtLeaf*)SymTable_alloc(pFamily,
+        sizeof(struct HamtLeaf) + strLength);
+    if(pLeaf == NULL){
+        return NULL;
+    }
+    pLeaf->entry.uRefs = 1;
+    pLeaf->entry.eKind = HAMT_LEAF;
+    pLeaf->uHash = uHash;
+    pLeaf->pvValue = pvValue;
+    memcpy(pLeaf->acKey, pcKey, strLength);
+    return pLeaf;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Drop one reference to pEntry, freeing it and dropping its
+   references to its children if it was the last. */
+
+static void SymTable_drop(struct HamtFamily *pFamily,
+    struct HamtEntry *pEntry)
+{
+    struct HamtNode *pNode;
+    unsigned u;
+
+    assert(pEntry != NULL);
+    assert(pEntry->uRefs > 0);
+
+    pEntry->uRefs--;
+    if(pEntry->uRefs != 0){
+        return;
+    }
+
+    if(pEntry->eKind == HAMT_LEAF){
+        SymTable_release(pFamily, pEntry,
+            SymTable_leafSize((struct HamtLeaf*)pEntry));
+        return;
+    }
+    pNode = (struct HamtNode*)pEntry;
+    for(u = 0; u < pNode->uCount; u++){
+        SymTable_drop(pFamily, pNode->apChildren[u]);
+    }
+    SymTable_release(pFamily, pNode, SymTable_nodeSize(pNode->uCapacity));
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Make sure that the entry in *ppSlot is referenced only from there,
+   by replacing it with a copy if it is shared, so it can be changed
+   in place. Return the entry, or NULL if there is not enough memory
+   available to copy it. */
+
+static struct HamtEntry *SymTable_own(struct HamtFamily *pFamily,
+    struct HamtEntry **ppSlot)
+{
+    struct HamtEntry *pEntry;
+    struct HamtLeaf *pLeaf;
+    struct HamtNode *pNode;
+    struct HamtNode *pCopy;
+    unsigned u;
+
+    assert(ppSlot != NULL);
+    assert(*ppSlot != NULL);
+
+    pEntry = *ppSlot;
+    if(pEntry->uRefs == 1){
+        return pEntry;
+    }
+
+    if(pEntry->eKind == HAMT_LEAF){
+        pLeaf = (struct HamtLeaf*)pEntry;
+        pLeaf = SymTable_newLeaf(pFamily, pLeaf->acKey, pLeaf->uHash,
+            pLeaf->pvValue);
+        if(pLeaf == NULL){
+            return NULL;
+        }
+        pEntry->uRefs--;
+        *ppSlot = &pLeaf->entry;
+        return *ppSlot;
+    }
+
+    /* The copy and the original now both point to the children */
+    pNode = (struct HamtNode*)pEntry;
+    pCopy = SymTable_newNode(pFamily, pEntry->eKind, pNode->uCount);
+    if(pCopy == NULL){
+        return NULL;
+    }
+    pCopy->uBitmap = pNode->uBitmap;
+    pCopy->uCount = pNode->uCount;
+    for(u = 0; u < pNode->uCount; u++){
+        pCopy->apChildren[u] = pNode->apChildren[u];
+        pCopy->apChildren[u]->uRefs++;
+    }
+    pEntry->uRefs--;
+    *ppSlot = &pCopy->entry;
+    return *ppSlot;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Insert pChild before child uPos of the node in *ppSlot, which must
+   not be shared, growing the node if it is full. uBit is the bit of
+   pChild in the bitmap, or 0 in a collision node. Returns 1 for
+   success or 0 for failure, in which case nothing changes. */
+
+static int SymTable_insertChild(struct HamtFamily *pFamily,
+    struct HamtEntry **ppSlot, unsigned uPos, uint32_t uBit,
+    struct HamtEntry *pChild)
+{
+    struct HamtNode *pNode;
+    struct HamtNode *pGrown;
+
+    assert(ppSlot != NULL);
+    assert((*ppSlot)->uRefs == 1);
+    assert(pChild != NULL);
+
+    pNode = (struct HamtNode*)*ppSlot;
+    assert(uPos <= pNode->uCount);
+
+    /* Nodes grow one child at a time, since clones keep old nodes */
+    if(pNode->uCount == pNode->uCapacity){
+        pGrown = SymTable_newNode(pFamily, pNode->entry.eKind,
+            pNode->uCount + 1);
+        if(pGrown == NULL){
+            return 0;
+        }
+        pGrown->uBitmap = pNode->uBitmap;
+        pGrown->uCount = pNode->uCount;
+        memcpy(pGrown->apChildren, pNode->apChildren,
+            pNode->uCount * sizeof(struct HamtEntry*));
+        SymTable_release(pFamily, pNode,
+            SymTable_nodeSize(pNode->uCapacity));
+        pNode = pGrown;
+        *ppSlot = &pNode->entry;
+    }
+
+    memmove(&pNode->apChildren[uPos + 1], &pNode->apChildren[uPos],
+        (pNode->uCount - uPos) * sizeof(struct HamtEntry*));
+    pNode->apChildren[uPos] = pChild;
+    pNode->uBitmap |= uBit;
+    pNode->uCount++;
+    return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Remove child uPos from pNode, which must not be shared, and drop
+   the node's reference to it. uBit is the bit of the child in the
+   bitmap, or 0 in a collision node. */
+
+static void SymTable_removeChild(struct HamtFamily *pFamily,
+    struct HamtNode *pNode, unsigned uPos, uint32_t uBit)
+{
+    assert(pNode != NULL);
+    assert(pNode->entry.uRefs == 1);
+    assert(uPos < pNode->uCount);
+
+    SymTable_drop(pFamily, pNode->apChildren[uPos]);
+    memmove(&pNode->apChildren[uPos], &pNode->apChildren[uPos + 1],
+        (pNode->uCount - uPos - 1) * sizeof(struct HamtEntry*));
+    pNode->uBitmap &= ~uBit;
+    pNode->uCount--;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Free the nodes that SymTable_merge made below pNode, but not the
+   leaves and collision nodes it merged. */
+
+static void SymTable_freeMerged(struct HamtFamily *pFamily,
+    struct HamtNode *pNode)
+{
+    unsigned u;
+
+    assert(pNode != NULL);
+
+    for(u = 0; u < pNode->uCount; u++){
+        if(pNode->apChildren[u]->eKind == HAMT_NODE){
+            SymTable_freeMerged(pFamily,
+                (struct HamtNode*)pNode->apChildren[u]);
+        }
+    }
+    SymTable_release(pFamily, pNode, SymTable_nodeSize(pNode->uCapacity));
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return a new subtree at the level uShift holding pFirst, a leaf or
+   collision node whose keys hash to uFirstHash, and the leaf pSecond,
+   or NULL if there is not enough memory available. The subtree takes
+   over the references to both. */
+
+static struct HamtEntry *SymTable_merge(struct HamtFamily *pFamily,
+    struct HamtEntry *pFirst, uint64_t uFirstHash,
+    struct HamtLeaf *pSecond, unsigned uShift)
+{
+    struct HamtNode *pNode;
+    struct HamtEntry *pChild;
+    unsigned uFirstIndex;
+    unsigned uSecondIndex;
+
+    assert(pFirst != NULL);
+    assert(pSecond != NULL);
+
+    /* Keys with the same full hash code can only share a list */
+    if(uFirstHash == pSecond->uHash){
+        assert(pFirst->eKind == HAMT_LEAF);
+        pNode = SymTable_newNode(pFamily, HAMT_COLLISION, 2);
+        if(pNode == NULL){
+            return NULL;
+        }
+        pNode->apChildren[0] = pFirst;
+        pNode->apChildren[1] = &pSecond->entry;
+        pNode->uCount = 2;
+        return &pNode->entry;
+    }
+
+    uFirstIndex = SymTable_index(uFirstHash, uShift);
+    uSecondIndex = SymTable_index(pSecond->uHash, uShift);
+
+    if(uFirstIndex == uSecondIndex){
+        pChild = SymTable_merge(pFamily, pFirst, uFirstHash, pSecond,
+            uShift + HAMT_BITS);
+        if(pChild == NULL){
+            return NULL;
+        }
+        /* The hash codes differ, so pChild is a node */
+        pNode = SymTable_newNode(pFamily, HAMT_NODE, 1);
+        if(pNode == NULL){
+            SymTable_freeMerged(pFamily, (struct HamtNode*)pChild);
+            return NULL;
+        }
+        pNode->apChildren[0] = pChild;
+        pNode->uBitmap = (uint32_t)1 << uFirstIndex;
+        pNode->uCount = 1;
+        return &pNode->entry;
+    }
+
+    pNode = SymTable_newNode(pFamily, HAMT_NODE, 2);
+    if(pNode == NULL){
+        return NULL;
+    }
+    if(uFirstIndex < uSecondIndex){
+        pNode->apChildren[0] = pFirst;
+        pNode->apChildren[1] = &pSecond->entry;
+    }
+    else{
+        pNode->apChildren[0] = &pSecond->entry;
+        pNode->apChildren[1] = pFirst;
+    }
+    pNode->uBitmap = ((uint32_t)1 << uFirstIndex)
+        | ((uint32_t)1 << uSecondIndex);
+    pNode->uCount = 2;
+    return &pNode->entry;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the leaf of pcKey, whose hash code is uHash, in oSymTable, or
+   NULL if there is none. */
+
+static struct HamtLeaf *SymTable_find(SymTable_T oSymTable,
+    const char *pcKey, uint64_t uHash)
+{
+    struct HamtEntry *pEntry;
+    struct HamtNode *pNode;
+    struct HamtLeaf *pLeaf;
+    uint32_t uBit;
+    unsigned uShift;
+    unsigned u;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    pEntry = oSymTable->pRoot;
+    uShift = 0;
+    while(pEntry->eKind == HAMT_NODE){
+        pNode = (struct HamtNode*)pEntry;
+        uBit = (uint32_t)1 << SymTable_index(uHash, uShift);
+        if((pNode->uBitmap & uBit) == 0){
+            return NULL;
+        }
+        pEntry = pNode->apChildren[
+            SymTable_popCount(pNode->uBitmap & (uBit - 1))];
+        uShift += HAMT_BITS;
+    }
+
+    if(pEntry->eKind == HAMT_LEAF){
+        pLeaf = (struct HamtLeaf*)pEntry;
+        if(pLeaf->uHash == uHash && strcmp(pLeaf->acKey, pcKey) == 0){
+            return pLeaf;
+        }
+        return NULL;
+    }
+
+    pNode = (struct HamtNode*)pEntry;
+    for(u = 0; u < pNode->uCount; u++){
+        pLeaf = (struct HamtLeaf*)pNode->apChildren[u];
+        if(pLeaf->uHash == uHash && strcmp(pLeaf->acKey, pcKey) == 0){
+            return pLeaf;
+        }
+    }
+    return NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the slot in oSymTable that points to the leaf of pcKey, whose
+   hash code is uHash, after making every node on the way to it
+   unshared so the slot can be changed. pcKey must be in the table.
+   Return NULL if there is not enough memory available, in which case
+   the bindings are unchanged. */
+
+static struct HamtEntry **SymTable_ownPath(SymTable_T oSymTable,
+    const char *pcKey, uint64_t uHash)
+{
+    struct HamtEntry **ppSlot;
+    struct HamtNode *pNode;
+    struct HamtLeaf *pLeaf;
+    uint32_t uBit;
+    unsigned uShift;
+    unsigned u;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    ppSlot = &oSymTable->pRoot;
+    uShift = 0;
+    for(;;){
+        if((*ppSlot)->eKind == HAMT_LEAF){
+            return ppSlot;
+        }
+        pNode = (struct HamtNode*)SymTable_own(oSymTable->pFamily, ppSlot);
+        if(pNode == NULL){
+            return NULL;
+        }
+        if(pNode->entry.eKind == HAMT_NODE){
+            uBit = (uint32_t)1 << SymTable_index(uHash, uShift);
+            assert((pNode->uBitmap & uBit) != 0);
+            ppSlot = &pNode->apChildren[
+                SymTable_popCount(pNode->uBitmap & (uBit - 1))];
+            uShift += HAMT_BITS;
+            continue;
+        }
+        for(u = 0; u < pNode->uCount; u++){
+            pLeaf = (struct HamtLeaf*)pNode->apChildren[u];
+            if(strcmp(pLeaf->acKey, pcKey) == 0){
+                return &pNode->apChildren[u];
+            }
+        }
+        assert(0);
+        return NULL;
+    }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Add pLeaf, whose key is not yet in the trie, below *ppSlot, a node
+   at the level uShift. Returns 1 for success or 0 for failure, in
+   which case the bindings are unchanged. */
+
+static int SymTable_insert(struct HamtFamily *pFamily,
+    struct HamtEntry **ppSlot, struct HamtLeaf *pLeaf)
+{
+    struct HamtNode *pNode;
+    struct HamtEntry *pChild;
+    struct HamtEntry *pMerged;
+    uint32_t uBit;
+    unsigned uShift;
+    unsigned uPos;
+
+    assert(ppSlot != NULL);
+    assert(pLeaf != NULL);
+
+    uShift = 0;
+    for(;;){
+        pNode = (struct HamtNode*)SymTable_own(pFamily, ppSlot);
+        if(pNode == NULL){
+            return 0;
+        }
+        uBit = (uint32_t)1 << SymTable_index(pLeaf->uHash, uShift);
+        uPos = SymTable_popCount(pNode->uBitmap & (uBit - 1));
+        if((pNode->uBitmap & uBit) == 0){
+            return SymTable_insertChild(pFamily, ppSlot, uPos, uBit,
+                &pLeaf->entry);
+        }
+
+        ppSlot = &pNode->apChildren[uPos];
+        pChild = *ppSlot;
+        uShift += HAMT_BITS;
+        if(pChild->eKind == HAMT_NODE){
+            continue;
+        }
+
+        if(pChild->eKind == HAMT_COLLISION
+            && SymTable_entryHash(pChild) == pLeaf->uHash){
+            if(SymTable_own(pFamily, ppSlot) == NULL){
+                return 0;
+            }
+            return SymTable_insertChild(pFamily, ppSlot, 0, 0,
+                &pLeaf->entry);
+        }
+
+        /* Push the leaf or collision node down a level */
+        pMerged = SymTable_merge(pFamily, pChild,
+            SymTable_entryHash(pChild), pLeaf, uShift);
+        if(pMerged == NULL){
+            return 0;
+        }
+        *ppSlot = pMerged;
+        return 1;
+    }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Remove the leaf of pcKey, whose hash code is uHash, from below
+   *ppSlot, a node at the level uShift, and store its value in
+   *ppvValue. pcKey must be in the trie. Returns 1 for success or 0
+   for failure, in which case the bindings are unchanged. */
+
+static int SymTable_removeBelow(struct HamtFamily *pFamily,
+    struct HamtEntry **ppSlot, const char *pcKey, uint64_t uHash,
+    unsigned uShift, const void **ppvValue)
+{
+    struct HamtNode *pNode;
+    struct HamtNode *pChild = NULL;
+    struct HamtEntry *pOnly;
+    struct HamtLeaf *pLeaf = NULL;
+    uint32_t uBit;
+    unsigned uPos;
+    unsigned u;
+
+    assert(ppSlot != NULL);
+    assert(pcKey != NULL);
+    assert(ppvValue != NULL);
+
+    pNode = (struct HamtNode*)SymTable_own(pFamily, ppSlot);
+    if(pNode == NULL){
+        return 0;
+    }
+    uBit = (uint32_t)1 << SymTable_index(uHash, uShift);
+    assert((pNode->uBitmap & uBit) != 0);
+    uPos = SymTable_popCount(pNode->uBitmap & (uBit - 1));
+
+    switch(pNode->apChildren[uPos]->eKind){
+    case HAMT_LEAF:
+        pLeaf = (struct HamtLeaf*)pNode->apChildren[uPos];
+        *ppvValue = pLeaf->pvValue;
+        SymTable_removeChild(pFamily, pNode, uPos, uBit);
+        return 1;
+
+    case HAMT_COLLISION:
+        pChild = (struct HamtNode*)SymTable_own(pFamily,
+            &pNode->apChildren[uPos]);
+        if(pChild == NULL){
+            return 0;
+        }
+        for(u = 0; u < pChild->uCount; u++){
+            pLeaf = (struct HamtLeaf*)pChild->apChildren[u];
+            if(strcmp(pLeaf->acKey, pcKey) == 0){
+                break;
+            }
+        }
+        assert(u < pChild->uCount);
+        assert(pLeaf != NULL);
+        *ppvValue = pLeaf->pvValue;
+        SymTable_removeChild(pFamily, pChild, u, 0);
+        break;
+
+    case HAMT_NODE:
+        if(!SymTable_removeBelow(pFamily, &pNode->apChildren[uPos],
+            pcKey, uHash, uShift + HAMT_BITS, ppvValue)){
+            return 0;
+        }
+        pChild = (struct HamtNode*)pNode->apChildren[uPos];
+        break;
+    }
+
+    /* A node left with one leaf or collision node is replaced by it,
+       so that every node below the root holds at least two bindings.
+       The child was made unshared above, so it is freed. */
+    if(pChild->uCount == 1 && pChild->apChildren[0]->eKind != HAMT_NODE){
+        pOnly = pChild->apChildren[0];
+        SymTable_release(pFamily, pChild,
+            SymTable_nodeSize(pChild->uCapacity));
+        pNode->apChildren[uPos] = pOnly;
+    }
+    return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Make the node of pPath and every node above it unshared, updating
+   the pNode of each. Returns 1 for success or 0 if there is not
+   enough memory available, in which case the bindings are
+   unchanged. */
+
+static int SymTable_ownAlong(struct HamtFamily *pFamily,
+    struct HamtPath *pPath)
+{
+    struct HamtEntry **ppSlot;
+    struct HamtNode *pNode;
+
+    assert(pPath != NULL);
+
+    if(pPath->iOwned){
+        return 1;
+    }
+    ppSlot = pPath->ppRoot;
+    if(pPath->pParent != NULL){
+        if(!SymTable_ownAlong(pFamily, pPath->pParent)){
+            return 0;
+        }
+        ppSlot = &pPath->pParent->pNode->apChildren[pPath->uPos];
+    }
+    pNode = (struct HamtNode*)SymTable_own(pFamily, ppSlot);
+    if(pNode == NULL){
+        return 0;
+    }
+    pPath->pNode = pNode;
+    pPath->iOwned = 1;
+    return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Remove every leaf below the node of pPath for which pfPredicate
+   returns nonzero, passing each to pfRemoved if it is not NULL, and
+   add the number removed to *puRemoved. Shared nodes are only read;
+   a node and those above it are made unshared once a leaf in it is
+   removed. Returns 1 for success or 0 if there is not enough memory
+   available, in which case the pass stops, but the leaves removed so
+   far stay removed. */
+
+static int SymTable_removeIfBelow(struct HamtFamily *pFamily,
+    struct HamtPath *pPath, int (*pfPredicate)
+    (const char *pcKey, void *pvValue, void *pvExtra),
+    const void *pvExtra, void (*pfRemoved)
+    (const char *pcKey, void *pvValue, void *pvExtra),
+    size_t *puRemoved)
+{
+    struct HamtPath childPath;
+    struct HamtNode *pNode;
+    struct HamtNode *pChild;
+    struct HamtEntry *pOnly;
+    struct HamtLeaf *pLeaf;
+    uint32_t uRest;
+    uint32_t uBit;
+    unsigned u;
+    int iDone;
+
+    assert(pPath != NULL);
+    assert(pfPredicate != NULL);
+    assert(puRemoved != NULL);
+
+    /* uRest holds the bits of child u and those after it. pNode is
+       read again after each step, since owning copies it. */
+    uRest = pPath->pNode->uBitmap;
+    u = 0;
+    while(u < pPath->pNode->uCount){
+        pNode = pPath->pNode;
+        uBit = 0;
+        if(pNode->entry.eKind == HAMT_NODE){
+            uBit = uRest & (~uRest + 1);
+        }
+
+        if(pNode->apChildren[u]->eKind == HAMT_LEAF){
+            pLeaf = (struct HamtLeaf*)pNode->apChildren[u];
+            if(! (*pfPredicate)(pLeaf->acKey, (void*)pLeaf->pvValue,
+                (void*) pvExtra)){
+                uRest &= ~uBit;
+                u++;
+                continue;
+            }
+            if(!SymTable_ownAlong(pFamily, pPath)){
+                return 0;
+            }
+            pNode = pPath->pNode;
+            if(pfRemoved != NULL){
+                (*pfRemoved)(pLeaf->acKey, (void*)pLeaf->pvValue,
+                    (void*) pvExtra);
+            }
+            SymTable_removeChild(pFamily, pNode, u, uBit);
+            uRest &= ~uBit;
+            (*puRemoved)++;
+            continue;
+        }
+
+        childPath.pNode = (struct HamtNode*)pNode->apChildren[u];
+        childPath.ppRoot = NULL;
+        childPath.pParent = pPath;
+        childPath.uPos = u;
+        childPath.iOwned = 0;
+        iDone = SymTable_removeIfBelow(pFamily, &childPath, pfPredicate,
+            pvExtra, pfRemoved, puRemoved);
+
+        /* A child nothing was removed from is left as it is. As in
+           SymTable_removeBelow, one left with one leaf or collision
+           node is replaced by it, and one left empty goes */
+        pNode = pPath->pNode;
+        pChild = childPath.pNode;
+        if(childPath.iOwned && pChild->uCount == 0){
+            SymTable_removeChild(pFamily, pNode, u, uBit);
+            uRest &= ~uBit;
+        }
+        else{
+            if(childPath.iOwned && pChild->uCount == 1
+                && pChild->apChildren[0]->eKind != HAMT_NODE){
+                assert(pChild->entry.uRefs == 1);
+                pOnly = pChild->apChildren[0];
+                SymTable_release(pFamily, pChild,
+                    SymTable_nodeSize(pChild->uCapacity));
+                pNode->apChildren[u] = pOnly;
+            }
+            uRest &= ~uBit;
+            u++;
+        }
+        if(!iDone){
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Call pfApply on every binding below pEntry. */
+
+static void SymTable_mapBelow(const struct HamtEntry *pEntry,
+    void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+    const void *pvExtra)
+{
+    const struct HamtNode *pNode;
+    const struct HamtLeaf *pLeaf;
+    unsigned u;
+
+    assert(pEntry != NULL);
+    assert(pfApply != NULL);
+
+    if(pEntry->eKind == HAMT_LEAF){
+        pLeaf = (const struct HamtLeaf*)pEntry;
+        (*pfApply)(pLeaf->acKey, (void*)pLeaf->pvValue, (void*)pvExtra);
+        return;
+    }
+    pNode = (const struct HamtNode*)pEntry;
+    for(u = 0; u < pNode->uCount; u++){
+        SymTable_mapBelow(pNode->apChildren[u], pfApply, pvExtra);
+    }
+}
+
+/*--------------------------------------------------------------------*/
+
+SymTable_T SymTable_new(void){
+    return SymTable_newWithAllocator(&defaultAllocator);
+}
+
+/*--------------------------------------------------------------------*/
+
+SymTable_T SymTable_newWithAllocator(const SymTable_Allocator *pAllocator){
+    struct HamtFamily *pFamily;
+    struct HamtNode *pRoot;
+    SymTable_T oSymTable;
+
+    assert(pAllocator != NULL);
+    assert(pAllocator->pfAlloc != NULL);
+    assert(pAllocator->pfFree != NULL);
+
+    pFamily = (struct HamtFamily*)(*pAllocator->pfAlloc)(
+        sizeof(struct HamtFamily), pAllocator->pvContext);
+    if(pFamily == NULL){
+        return NULL;
+    }
+    pFamily->allocator = *pAllocator;
+    pFamily->uBytes = sizeof(struct HamtFamily);
+    pFamily->uTables = 1;
+
+    oSymTable = (SymTable_T)SymTable_alloc(pFamily, sizeof(struct SymTable));
+    pRoot = SymTable_newNode(pFamily, HAMT_NODE, 0);
+    if(oSymTable == NULL || pRoot == NULL){
+        if(oSymTable != NULL){
+            SymTable_release(pFamily, oSymTable, sizeof(struct SymTable));
+        }
+        if(pRoot != NULL){
+            SymTable_release(pFamily, pRoot, SymTable_nodeSize(0));
+        }
+        SymTable_release(pFamily, pFamily, sizeof(struct HamtFamily));
+        return NULL;
+    }
+
+    oSymTable->pRoot = &pRoot->entry;
+    oSymTable->size = 0;
+    oSymTable->pFamily = pFamily;
+    return oSymTable;
+}
+
+/*--------------------------------------------------------------------*/
+
+SymTable_T SymTable_clone(SymTable_T oSymTable){
+    SymTable_T oClone;
+
+    assert(oSymTable != NULL);
+
+    oClone = (SymTable_T)SymTable_alloc(oSymTable->pFamily,
+        sizeof(struct SymTable));
+    if(oClone == NULL){
+        return NULL;
+    }
+    oClone->pRoot = oSymTable->pRoot;
+    oClone->pRoot->uRefs++;
+    oClone->size = oSymTable->size;
+    oClone->pFamily = oSymTable->pFamily;
+    oClone->pFamily->uTables++;
+    return oClone;
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t SymTable_memoryUsage(SymTable_T oSymTable){
+    assert(oSymTable != NULL);
+
+    return oSymTable->pFamily->uBytes;
+}
+
+/*--------------------------------------------------------------------*/
+
+void SymTable_free(SymTable_T oSymTable){
+    struct HamtFamily *pFamily;
+
+    assert(oSymTable != NULL);
+
+    pFamily = oSymTable->pFamily;
+    SymTable_drop(pFamily, oSymTable->pRoot);
+    SymTable_release(pFamily, oSymTable, sizeof(struct SymTable));
+
+    /* The last table of the family frees it */
+    pFamily->uTables--;
+    if(pFamily->uTables == 0){
+        SymTable_release(pFamily, pFamily, sizeof(struct HamtFamily));
+    }
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t SymTable_getLength(SymTable_T oSymTable){
+    assert(oSymTable != NULL);
+
+    return oSymTable->size;
+}
+
+/*--------------------------------------------------------------------*/
+
+int SymTable_put(SymTable_T oSymTable, const char *pcKey,
+    const void *pvValue){
+    struct HamtLeaf *pLeaf;
+    uint64_t uHash;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    /* Checking first avoids copying shared nodes for nothing */
+    uHash = SymTable_hash(pcKey);
+    if(SymTable_find(oSymTable, pcKey, uHash) != NULL){
+        return 0;
+    }
+
+    pLeaf = SymTable_newLeaf(oSymTable->pFamily, pcKey, uHash, pvValue);
+    if(pLeaf == NULL){
+        return 0;
+    }
+    if(!SymTable_insert(oSymTable->pFamily, &oSymTable->pRoot, pLeaf)){
+        SymTable_drop(oSymTable->pFamily, &pLeaf->entry);
+        return 0;
+    }
+    oSymTable->size++;
+    return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *SymTable_replace(SymTable_T oSymTable, const char *pcKey,
+    const void *pvValue){
+    struct HamtEntry **ppSlot;
+    struct HamtLeaf *pLeaf;
+    const void *pOldValue;
+    uint64_t uHash;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    uHash = SymTable_hash(pcKey);
+    if(SymTable_find(oSymTable, pcKey, uHash) == NULL){
+        return NULL;
+    }
+
+    ppSlot = SymTable_ownPath(oSymTable, pcKey, uHash);
+    if(ppSlot == NULL){
+        return NULL;
+    }
+    pLeaf = (struct HamtLeaf*)SymTable_own(oSymTable->pFamily, ppSlot);
+    if(pLeaf == NULL){
+        return NULL;
+    }
+    pOldValue = pLeaf->pvValue;
+    pLeaf->pvValue = pvValue;
+    return (void*) pOldValue;
+}
+
+/*--------------------------------------------------------------------*/
+
+int SymTable_contains(SymTable_T oSymTable, const char *pcKey){
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    return SymTable_find(oSymTable, pcKey, SymTable_hash(pcKey)) != NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *SymTable_get(SymTable_T oSymTable, const char *pcKey){
+    struct HamtLeaf *pLeaf;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    pLeaf = SymTable_find(oSymTable, pcKey, SymTable_hash(pcKey));
+    if(pLeaf == NULL){
+        return NULL;
+    }
+    return (void*)(pLeaf->pvValue);
+}
+
+/*--------------------------------------------------------------------*/
+
+void *SymTable_remove(SymTable_T oSymTable, const char *pcKey){
+    const void *pOldValue = NULL;
+    uint64_t uHash;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    uHash = SymTable_hash(pcKey);
+    if(SymTable_find(oSymTable, pcKey, uHash) == NULL){
+        return NULL;
+    }
+
+    if(!SymTable_removeBelow(oSymTable->pFamily, &oSymTable->pRoot,
+        pcKey, uHash, 0, &pOldValue)){
+        return NULL;
+    }
+    oSymTable->size--;
+    return (void*) pOldValue;
+}
+
+/*--------------------------------------------------------------------*/
+
+void SymTable_map(SymTable_T oSymTable, void (*pfApply)
+    (const char *pcKey, void *pvValue, void *pvExtra),
+    const void *pvExtra){
+    assert(oSymTable != NULL);
+    assert(pfApply != NULL);
+
+    SymTable_mapBelow(oSymTable->pRoot, pfApply, pvExtra);
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t SymTable_removeIf(SymTable_T oSymTable, int (*pfPredicate)
+    (const char *pcKey, void *pvValue, void *pvExtra),
+    const void *pvExtra, void (*pfRemoved)
+    (const char *pcKey, void *pvValue, void *pvExtra)){
+    struct HamtPath rootPath;
+    size_t uRemoved = 0;
+
+    assert(oSymTable != NULL);
+    assert(pfPredicate != NULL);
+
+    rootPath.pNode = (struct HamtNode*)oSymTable->pRoot;
+    rootPath.ppRoot = &oSymTable->pRoot;
+    rootPath.pParent = NULL;
+    rootPath.uPos = 0;
+    rootPath.iOwned = 0;
+    (void)SymTable_removeIfBelow(oSymTable->pFamily, &rootPath,
+        pfPredicate, pvExtra, pfRemoved, &uRemoved);
+    oSymTable->size -= uRemoved;
+    return uRemoved;
+}
@@ -0,0 +1,34 @@
+/*--------------------------------------------------------------------*/
+/*                                                                    */
+/* Header file for the functions that only the hash array mapped      */
+/* trie implementation of the SymTable ADT provides                   */
+/*                                                                    */
+/* Author: Maxwell Lloyd                                              */
+/*                                                                    */
+/*--------------------------------------------------------------------*/
+
+
+#ifndef SYMTABLEHAMT_INCLUDED
+#define SYMTABLEHAMT_INCLUDED
+
+#include "symtable.h"
+
+/*--------------------------------------------------------------------*/
+
+/* Return a new SymTable object with the same bindings as parameter
+   oSymTable, or NULL if there is not enough memory available. This
+   takes constant time: the two tables share every node until one of
+   them changes, which then copies only the nodes on the path to the
+   changed binding. Either table can be changed or freed without
+   affecting the other. Clones share oSymTable's allocator, and
+   SymTable_memoryUsage reports the bytes held by all of them
+   together. Since a change may have to copy shared nodes,
+   SymTable_replace and SymTable_remove can also return NULL when
+   there is not enough memory available. SymTable_removeIf copies
+   only the nodes above the bindings it removes, and if it runs out of
+   memory it stops early and returns the number of bindings removed
+   so far */
+SymTable_T SymTable_clone(SymTable_T oSymTable);
+
+
+#endif
@@ -0,0 +1,66 @@
+/*--------------------------------------------------------------------*/
+/*                                                                    */
+/* Header file for the binding handles that the linked list and hash  */
+/* table implementations of the SymTable ADT provide                  */
+/*                                                                    */
+/* Author: Maxwell Lloyd                                              */
+/*                                                                    */
+/*--------------------------------------------------------------------*/
+
+
+#ifndef SYMTABLEHANDLE_INCLUDED
+#define SYMTABLEHANDLE_INCLUDED
+
+#include "symtable.h"
+
+/*--------------------------------------------------------------------*/
+
+/* A SymTable_Handle names one binding of a SymTable object, so that
+   it can be read, replaced or removed again without looking its key
+   up. A handle stays valid until its binding is removed by any means,
+   including eviction, expiry and the popping of the scope that bound
+   it, or its table is compacted or freed; after that it must not be
+   used */
+typedef struct SymTableNode* SymTable_Handle;
+
+/*--------------------------------------------------------------------*/
+
+/* Same as SymTable_put, but returns a handle to the new binding, or
+   NULL if pcKey is bound or there is not enough memory available */
+SymTable_Handle SymTable_putHandle(SymTable_T oSymTable,
+    const char *pcKey, const void *pvValue);
+
+/*--------------------------------------------------------------------*/
+
+/* Return a handle to the binding of pcKey in parameter oSymTable, or
+   NULL if pcKey is not bound. A mapped snapshot of the hash table has
+   no handles, so this returns NULL for it */
+SymTable_Handle SymTable_find(SymTable_T oSymTable, const char *pcKey);
+
+/*--------------------------------------------------------------------*/
+
+/* Return the value of the binding oHandle of parameter oSymTable.
+   Like the functions below, this neither hashes nor compares the key
+   and takes constant time; SymTable_handleRemove of the hash table
+   finds the node's link in its chain by address, which takes constant
+   expected time, except as noted below */
+void *SymTable_handleValue(SymTable_T oSymTable, SymTable_Handle oHandle);
+
+/*--------------------------------------------------------------------*/
+
+/* Replace the value of the binding oHandle of parameter oSymTable
+   with pvValue and return the old value */
+void *SymTable_handleReplace(SymTable_T oSymTable, SymTable_Handle oHandle,
+    const void *pvValue);
+
+/*--------------------------------------------------------------------*/
+
+/* Remove the binding oHandle from parameter oSymTable and return its
+   value. oHandle is no longer valid. In a hash table bucket whose
+   chain grew long enough to be indexed by a tree, the binding's tree
+   entry is found by comparing keys, so this compares the key with
+   O(log n) others there, as SymTable_remove would */
+void *SymTable_handleRemove(SymTable_T oSymTable, SymTable_Handle oHandle);
+
+
+#endif
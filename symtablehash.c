@@ -10,15 +10,99 @@
 
 
 
+/* mmap and the file descriptor calls are POSIX */
+#define _POSIX_C_SOURCE 200809L
+
 #include <stddef.h>
 #include <assert.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
-#include "symtable.h"
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <pthread.h>
+#include "symtablehash.h"
+#include "symtablehandle.h"
+
+/* SYMTABLE_COUNT(statement) updates the counters of SymTable_getStats,
+   and compiles to nothing unless SYMTABLE_STATS is defined */
+#ifdef SYMTABLE_STATS
+#define SYMTABLE_COUNT(statement) statement
+#else
+#define SYMTABLE_COUNT(statement)
+#endif
 
 /* All values of bucket sizes when resizing */
-static const size_t buckets[] = {509, 1021, 2039, 4093, 8191, 16381, 32749, 65521};
+static const size_t buckets[] = {509, 1021, 2039, 4093, 8191, 16381,
+    32749, 65521, 131071, 262139, 524287, 1048573, 2097143, 4194301,
+    8388593, 16777213, 33554393, 67108859, 134217689, 268435399,
+    536870909, 1073741789, 2147483647};
+
+/*--------------------------------------------------------------------*/
+
+/* The timing wheel of deadlines has WHEEL_LEVELS levels of
+   WHEEL_SLOTS slots; each level counts time in units WHEEL_SLOTS
+   times as long as the level below, so that together they cover every
+   uint64_t deadline */
+enum {WHEEL_BITS = 6, WHEEL_SLOTS = 1 << WHEEL_BITS, WHEEL_LEVELS = 11};
+
+/* The deadline of a binding put by SymTable_putWithTTL, kept in a
+   slot of the timing wheel */
+struct SymTableTimer{
+    /* Time from which the binding has expired */
+    uint64_t uDeadline;
+
+    /* Node whose binding expires */
+    struct SymTableNode *pNode;
+
+    /* Next timer of the slot */
+    struct SymTableTimer *pNext;
+
+    /* Link that points to this timer: the slot, or pNext of the timer
+       before it */
+    struct SymTableTimer **ppPrev;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* A binding that a binding of the same key in an inner scope shadows,
+   kept on a stack per key */
+struct SymTableShadow{
+    /* Value of the shadowed binding */
+    const void *pValue;
+
+    /* Scope the shadowed binding belongs to */
+    size_t uScope;
+
+    /* 0 if the key was removed in that scope rather than bound */
+    int iBound;
+
+    /* Next binding down the stack, in an outer scope */
+    struct SymTableShadow *pNext;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Scope state of a node bound or removed while a scope was open. A
+   node without one is bound in the outermost scope. */
+struct SymTableScoped{
+    /* Scope the current binding of the node belongs to */
+    size_t uScope;
+
+    /* 0 if the key was removed, but the node must stay because the
+       undo log still names it */
+    int iBound;
+
+    /* Number of entries of the undo log that name the node */
+    size_t uLogRefs;
+
+    /* Bindings the current one shadows, innermost first */
+    struct SymTableShadow *pShadowed;
+};
 
 /*--------------------------------------------------------------------*/
 
@@ -27,6 +111,10 @@ struct SymTableNode{
    /* Key of each node */
    const char* pKey;
 
+   /* Full hash code of the key, so that resizing and the set
+      operations never hash it again */
+   size_t uHash;
+
    /* Value of each node */
    const void* pValue;
 
@@ -34,6 +122,36 @@ struct SymTableNode{
    struct SymTableNode *pNextNode;
 };
 
+/* A node of a table from SymTable_newBounded is followed by an int
+   that is 1 if the key was looked up since the eviction hand last
+   passed the node. The scope state and the timer of a node are kept
+   in a SymTableSideIndex of the table instead, so that a node of a
+   table that uses none of these is no bigger than the fields above. */
+
+/*--------------------------------------------------------------------*/
+
+/* An entry of a SymTableSideIndex */
+struct SymTableSideEntry{
+    /* Node the entry is for, or NULL for an empty slot */
+    const struct SymTableNode *pNode;
+
+    /* State of the node */
+    void *pvState;
+};
+
+/* Open addressing table from a node to its state, for the few nodes
+   that have one */
+struct SymTableSideIndex{
+    /* Slots, or NULL while no node has state */
+    struct SymTableSideEntry *pEntries;
+
+    /* Number of slots, a power of 2, or 0 */
+    size_t uCapacity;
+
+    /* Number of nodes with state */
+    size_t uCount;
+};
+
 /*--------------------------------------------------------------------*/
 struct SymTableBucket{
     /* Pointer to a linked list for this bucket */
@@ -42,6 +160,53 @@ struct SymTableBucket{
 
 /*--------------------------------------------------------------------*/
 
+/* A chain longer than TREEIFY_THRESHOLD is also indexed by a balanced
+   tree, until it is shorter than UNTREEIFY_THRESHOLD again */
+enum {TREEIFY_THRESHOLD = 8, UNTREEIFY_THRESHOLD = 6};
+
+/* An entry of the AVL tree that indexes a long chain by hash code,
+   then key */
+struct SymTableTreeEntry{
+    /* Node of the chain the entry stands for */
+    struct SymTableNode *pNode;
+
+    /* Node before pNode in the chain, or NULL if pNode is first, so
+       that pNode can be unlinked without walking the chain */
+    struct SymTableNode *pPrevNode;
+
+    /* Subtrees of smaller and greater keys */
+    struct SymTableTreeEntry *pLeft;
+    struct SymTableTreeEntry *pRight;
+
+    /* Number of levels of the subtree the entry roots */
+    int iHeight;
+};
+
+/* The tree of one bucket */
+struct SymTableTree{
+    /* Root entry */
+    struct SymTableTreeEntry *pRoot;
+
+    /* Number of entries, which is the length of the chain */
+    size_t uCount;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* A block that SymTable_compact moves the nodes of a run of buckets
+   into, chain after chain, each node followed by its key. The nodes
+   of a slab are not freed one by one; the slab is freed with the last
+   of them. */
+struct SymTableSlab{
+    /* Bytes of the slab, with this header */
+    size_t uSize;
+
+    /* Number of nodes in the slab not freed yet */
+    size_t uLive;
+};
+
+/*--------------------------------------------------------------------*/
+
 /* SymTable object is a manager pointing to the first node of a 
    SymTable_T object */
 struct SymTable{
@@ -53,373 +218,4173 @@ struct SymTable{
 
     /* limit of buckets until expansion */
     size_t limit;
+
+    /* Snapshot mapped by SymTable_openMapped, or NULL if the table
+       owns its nodes */
+    const unsigned char *pucMap;
+
+    /* Length in bytes of pucMap */
+    size_t uMapLength;
+
+    /* Source of every block the table holds */
+    SymTable_Allocator allocator;
+
+    /* Bytes currently held from allocator */
+    size_t uBytes;
+
+    /* Undo log: each entry names a node that was given a binding in
+       an open scope, innermost scope last */
+    struct SymTableNode **ppUndoLog;
+    size_t uUndoLength;
+    size_t uUndoCapacity;
+
+    /* uUndoLength when each open scope was pushed */
+    size_t *puScopeStarts;
+
+    /* Number of open scopes */
+    size_t uDepth;
+
+    /* Number of entries puScopeStarts has room for */
+    size_t uScopeCapacity;
+
+    /* Most bindings a table from SymTable_newBounded holds, or 0 if
+       the table is unbounded */
+    size_t uMaxBindings;
+
+    /* Called with each binding evicted, and its extra argument */
+    SymTable_Evictor pfEvict;
+    const void *pvEvictExtra;
+
+    /* Bucket the eviction hand points to */
+    size_t uHand;
+
+    /* WHEEL_LEVELS * WHEEL_SLOTS timer lists, level by level, or NULL
+       until the first SymTable_putWithTTL */
+    struct SymTableTimer **ppWheel;
+
+    /* Time up to which SymTable_expire has removed every expired
+       binding; every timer in the wheel is later */
+    uint64_t uWheelTime;
+
+    /* Latest time the table was given; bindings whose deadline is not
+       after it have expired */
+    uint64_t uClock;
+
+    /* Timer of each binding that expires */
+    struct SymTableSideIndex timers;
+
+    /* Scope state of each node bound or removed in an open scope */
+    struct SymTableSideIndex scoped;
+
+    /* Tree of each bucket whose chain has one, or NULL until some
+       chain first grows past TREEIFY_THRESHOLD */
+    struct SymTableTree **ppTrees;
+
+    /* Number of buckets with a tree */
+    size_t uTrees;
+
+    /* Bytes of the value each node of a table from SymTable_newInline
+       holds right after itself, or 0 if nodes hold value pointers */
+    size_t uValueSize;
+
+    /* Slabs holding compacted nodes in order of address, so that the
+       slab of a node is found by binary search, or NULL if there are
+       none */
+    struct SymTableSlab **ppSlabs;
+    size_t uSlabs;
+    size_t uSlabCapacity;
+
+    /* Bucket the next SymTable_compactStep starts from */
+    size_t uCompactNext;
+
+#ifdef SYMTABLE_STATS
+    /* Operation and resize counters; the other fields are unused */
+    struct SymTable_Stats counters;
+#endif
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Identifies a snapshot file written by SymTable_save */
+static const char SNAPSHOT_MAGIC[8] = {'S', 'Y', 'M', 'T', 'A', 'B', 0, 1};
+
+/* A snapshot starts with a SnapshotHeader, followed by uBucketCount 
+   offsets of the first record of each bucket (0 for an empty bucket),
+   followed by uCount records. All offsets are from the start of the 
+   file, so the snapshot can be mapped at any address. */
+struct SnapshotHeader{
+    /* SNAPSHOT_MAGIC */
+    char acMagic[8];
+
+    /* Number of bindings */
+    uint64_t uCount;
+
+    /* Number of buckets */
+    uint64_t uBucketCount;
+
+    /* Length of the whole file, to detect truncation */
+    uint64_t uLength;
+};
+
+/* Each binding is a SnapshotRecord followed by the key and its 
+   terminating '\0', then the value bytes, each padded to 8 bytes */
+struct SnapshotRecord{
+    /* Offset of the next record in the same bucket, or 0 */
+    uint64_t uNext;
+
+    /* Full hash code of the key */
+    uint64_t uHash;
+
+    /* Length of the key, without the '\0' */
+    uint64_t uKeyLength;
+
+    /* Length of the value bytes, 0 for a NULL value */
+    uint64_t uValueLength;
 };
 
 /*--------------------------------------------------------------------*/
 
-/* Return a hash code for pcKey that is between 0 and uBucketCount-1,
-   inclusive. */
+/* Return uSize bytes from malloc. pvContext is unused. */
+
+static void *SymTable_defaultAlloc(size_t uSize, void *pvContext)
+{
+    (void)pvContext;
+    return malloc(uSize);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Free pvBlock, which SymTable_defaultAlloc returned. */
+
+static void SymTable_defaultFree(void *pvBlock, size_t uSize,
+    void *pvContext)
+{
+    (void)uSize;
+    (void)pvContext;
+    free(pvBlock);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* The allocator of tables made by SymTable_new */
+static const SymTable_Allocator defaultAllocator = {
+    SymTable_defaultAlloc, SymTable_defaultFree, NULL};
+
+/* A SymTableSideIndex that holds no node */
+static const struct SymTableSideIndex emptySideIndex = {NULL, 0, 0};
+
+/*--------------------------------------------------------------------*/
+
+/* Return uSize bytes from the allocator of oSymTable, or NULL if it 
+   refuses. */
+
+static void *SymTable_alloc(SymTable_T oSymTable, size_t uSize)
+{
+    void *pvBlock;
+
+    assert(oSymTable != NULL);
+
+    pvBlock = (*oSymTable->allocator.pfAlloc)(uSize,
+        oSymTable->allocator.pvContext);
+    if(pvBlock != NULL){
+        oSymTable->uBytes += uSize;
+    }
+    return pvBlock;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Give the uSize bytes at pvBlock back to the allocator of 
+   oSymTable. */
+
+static void SymTable_release(SymTable_T oSymTable, void *pvBlock,
+    size_t uSize)
+{
+    assert(oSymTable != NULL);
+    assert(pvBlock != NULL);
+
+    oSymTable->uBytes -= uSize;
+    (*oSymTable->allocator.pfFree)(pvBlock, uSize,
+        oSymTable->allocator.pvContext);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the slot of pIndex where the search for pNode starts. */
+
+static size_t SymTable_sideHome(const struct SymTableSideIndex *pIndex,
+    const struct SymTableNode *pNode)
+{
+    uint64_t uMixed;
+
+    assert(pIndex != NULL);
+    assert(pIndex->uCapacity != 0);
+
+    uMixed = (uint64_t)(uintptr_t)pNode * UINT64_C(0x9e3779b97f4a7c15);
+    return (size_t)(uMixed >> 32) & (pIndex->uCapacity - 1);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the slot of pIndex that holds pNode, or uCapacity if pNode
+   has no state. */
+
+static size_t SymTable_sideSlot(const struct SymTableSideIndex *pIndex,
+    const struct SymTableNode *pNode)
+{
+    size_t uSlot;
+
+    assert(pIndex != NULL);
+    assert(pNode != NULL);
+
+    if(pIndex->uCount == 0){
+        return pIndex->uCapacity;
+    }
+    uSlot = SymTable_sideHome(pIndex, pNode);
+    while(pIndex->pEntries[uSlot].pNode != NULL){
+        if(pIndex->pEntries[uSlot].pNode == pNode){
+            return uSlot;
+        }
+        uSlot = (uSlot + 1) & (pIndex->uCapacity - 1);
+    }
+    return pIndex->uCapacity;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the state of pNode in pIndex, or NULL if it has none. */
+
+static void *SymTable_sideFind(const struct SymTableSideIndex *pIndex,
+    const struct SymTableNode *pNode)
+{
+    size_t uSlot;
+
+    assert(pIndex != NULL);
+
+    uSlot = SymTable_sideSlot(pIndex, pNode);
+    return (uSlot == pIndex->uCapacity) ? NULL
+        : pIndex->pEntries[uSlot].pvState;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Put pNode, which has no state in pIndex, and pvState into a free
+   slot of pIndex, which must have one to spare. */
+
+static void SymTable_sidePlace(struct SymTableSideIndex *pIndex,
+    const struct SymTableNode *pNode, void *pvState)
+{
+    size_t uSlot;
+
+    assert(pIndex != NULL);
+    assert(pNode != NULL);
+    assert(2 * (pIndex->uCount + 1) <= pIndex->uCapacity);
+
+    uSlot = SymTable_sideHome(pIndex, pNode);
+    while(pIndex->pEntries[uSlot].pNode != NULL){
+        assert(pIndex->pEntries[uSlot].pNode != pNode);
+        uSlot = (uSlot + 1) & (pIndex->uCapacity - 1);
+    }
+    pIndex->pEntries[uSlot].pNode = pNode;
+    pIndex->pEntries[uSlot].pvState = pvState;
+    pIndex->uCount++;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Make sure pIndex of oSymTable has room for one more node, so that
+   SymTable_sidePlace cannot fail. Slots are kept at most half full.
+   Returns 1 for success or 0 for failure. */
+
+static int SymTable_sideReserve(SymTable_T oSymTable,
+    struct SymTableSideIndex *pIndex)
+{
+    struct SymTableSideIndex grown;
+    size_t counter;
+
+    assert(oSymTable != NULL);
+    assert(pIndex != NULL);
+
+    if(2 * (pIndex->uCount + 1) <= pIndex->uCapacity){
+        return 1;
+    }
+    grown.uCapacity = (pIndex->uCapacity == 0) ? 16
+        : 2 * pIndex->uCapacity;
+    grown.uCount = 0;
+    grown.pEntries = (struct SymTableSideEntry*)SymTable_alloc(oSymTable,
+        grown.uCapacity * sizeof(struct SymTableSideEntry));
+    if(grown.pEntries == NULL){
+        return 0;
+    }
+    for(counter = 0; counter < grown.uCapacity; counter++){
+        grown.pEntries[counter].pNode = NULL;
+        grown.pEntries[counter].pvState = NULL;
+    }
+    for(counter = 0; counter < pIndex->uCapacity; counter++){
+        if(pIndex->pEntries[counter].pNode != NULL){
+            SymTable_sidePlace(&grown, pIndex->pEntries[counter].pNode,
+                pIndex->pEntries[counter].pvState);
+        }
+    }
+    if(pIndex->pEntries != NULL){
+        SymTable_release(oSymTable, pIndex->pEntries,
+            pIndex->uCapacity * sizeof(struct SymTableSideEntry));
+    }
+    *pIndex = grown;
+    return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Empty the slot uSlot of pIndex, moving later entries of its run
+   back so that every entry can still be found from its home slot. */
+
+static void SymTable_sideErase(struct SymTableSideIndex *pIndex,
+    size_t uSlot)
+{
+    size_t uMask;
+    size_t uNext;
+    size_t uHome;
+
+    assert(pIndex != NULL);
+    assert(uSlot < pIndex->uCapacity);
+
+    uMask = pIndex->uCapacity - 1;
+    uNext = (uSlot + 1) & uMask;
+    while(pIndex->pEntries[uNext].pNode != NULL){
+        uHome = SymTable_sideHome(pIndex, pIndex->pEntries[uNext].pNode);
+        /* The entry may fill the hole unless its home lies after the
+           hole, up to its own slot */
+        if(((uNext - uHome) & uMask) >= ((uNext - uSlot) & uMask)){
+            pIndex->pEntries[uSlot] = pIndex->pEntries[uNext];
+            uSlot = uNext;
+        }
+        uNext = (uNext + 1) & uMask;
+    }
+    pIndex->pEntries[uSlot].pNode = NULL;
+    pIndex->pEntries[uSlot].pvState = NULL;
+    pIndex->uCount--;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Take pNode and its state out of pIndex, if it is there, and return
+   the state, or NULL if it has none. The slots stay, so that room
+   reserved by SymTable_sideReserve is not lost. */
+
+static void *SymTable_sideRemove(struct SymTableSideIndex *pIndex,
+    const struct SymTableNode *pNode)
+{
+    void *pvState;
+    size_t uSlot;
+
+    assert(pIndex != NULL);
+
+    uSlot = SymTable_sideSlot(pIndex, pNode);
+    if(uSlot == pIndex->uCapacity){
+        return NULL;
+    }
+    pvState = pIndex->pEntries[uSlot].pvState;
+    SymTable_sideErase(pIndex, uSlot);
+    return pvState;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Free the slots of pIndex of oSymTable if no node has state. */
+
+static void SymTable_sideTrim(SymTable_T oSymTable,
+    struct SymTableSideIndex *pIndex)
+{
+    assert(oSymTable != NULL);
+    assert(pIndex != NULL);
+
+    if(pIndex->uCount != 0 || pIndex->pEntries == NULL){
+        return;
+    }
+    SymTable_release(oSymTable, pIndex->pEntries,
+        pIndex->uCapacity * sizeof(struct SymTableSideEntry));
+    *pIndex = emptySideIndex;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Make the state of pOldNode in pIndex, if it has one, that of
+   pNewNode instead, and return it, or NULL if it has none. */
+
+static void *SymTable_sideMove(struct SymTableSideIndex *pIndex,
+    const struct SymTableNode *pOldNode,
+    const struct SymTableNode *pNewNode)
+{
+    void *pvState;
+    size_t uSlot;
+
+    assert(pIndex != NULL);
+
+    uSlot = SymTable_sideSlot(pIndex, pOldNode);
+    if(uSlot == pIndex->uCapacity){
+        return NULL;
+    }
+    pvState = pIndex->pEntries[uSlot].pvState;
+    SymTable_sideErase(pIndex, uSlot);
+    SymTable_sidePlace(pIndex, pNewNode, pvState);
+    return pvState;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Take the timer of pNode of oSymTable, if it has one, out of the
+   timing wheel and free it, so that the binding no longer expires. */
+
+static void SymTable_cancelTimer(SymTable_T oSymTable,
+    struct SymTableNode *pNode)
+{
+    struct SymTableTimer *pTimer;
+
+    assert(oSymTable != NULL);
+    assert(pNode != NULL);
+
+    pTimer = (struct SymTableTimer*)SymTable_sideRemove(
+        &oSymTable->timers, pNode);
+    if(pTimer == NULL){
+        return;
+    }
+    *pTimer->ppPrev = pTimer->pNext;
+    if(pTimer->pNext != NULL){
+        pTimer->pNext->ppPrev = pTimer->ppPrev;
+    }
+    SymTable_release(oSymTable, pTimer, sizeof(struct SymTableTimer));
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the number of bytes a node of oSymTable takes, with its
+   inline value if the table has them and its reference bit if the
+   table is bounded. */
+
+static size_t SymTable_nodeSize(SymTable_T oSymTable)
+{
+    assert(oSymTable != NULL);
+
+    return sizeof(struct SymTableNode) + oSymTable->uValueSize
+        + ((oSymTable->uMaxBindings == 0) ? 0 : sizeof(int));
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the reference bit of pNode of oSymTable, which is bounded. */
+
+static int *SymTable_referenced(SymTable_T oSymTable,
+    struct SymTableNode *pNode)
+{
+    assert(oSymTable != NULL);
+    assert(oSymTable->uMaxBindings != 0);
+    assert(pNode != NULL);
+
+    return (int*)(void*)((char*)(pNode + 1) + oSymTable->uValueSize);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Record that the key of pNode of oSymTable was looked up, if the
+   table is bounded. */
+
+static void SymTable_touch(SymTable_T oSymTable,
+    struct SymTableNode *pNode)
+{
+    assert(oSymTable != NULL);
+    assert(pNode != NULL);
+
+    if(oSymTable->uMaxBindings != 0){
+        *SymTable_referenced(oSymTable, pNode) = 1;
+    }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Make pvValue the value of pNode of oSymTable. A node with an inline
+   value gets a copy of the bytes pvValue points to instead. */
+
+static void SymTable_setValue(SymTable_T oSymTable,
+    struct SymTableNode *pNode, const void *pvValue)
+{
+    assert(oSymTable != NULL);
+    assert(pNode != NULL);
+
+    if(oSymTable->uValueSize == 0){
+        pNode->pValue = pvValue;
+        return;
+    }
+    assert(pvValue != NULL);
+    pNode->pValue = pNode + 1;
+    memmove(pNode + 1, pvValue, oSymTable->uValueSize);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the entry of the slab array of oSymTable for the slab that
+   holds pvBlock, or NULL if pvBlock is not in a slab. */
+
+static struct SymTableSlab **SymTable_slabOf(SymTable_T oSymTable,
+    const void *pvBlock)
+{
+    struct SymTableSlab *pSlab;
+    uintptr_t uAddress;
+    size_t uLow;
+    size_t uHigh;
+    size_t uMiddle;
+
+    assert(oSymTable != NULL);
+
+    /* Find the last slab that starts at or before pvBlock */
+    uAddress = (uintptr_t)pvBlock;
+    uLow = 0;
+    uHigh = oSymTable->uSlabs;
+    while(uLow < uHigh){
+        uMiddle = uLow + (uHigh - uLow) / 2;
+        if((uintptr_t)oSymTable->ppSlabs[uMiddle] <= uAddress){
+            uLow = uMiddle + 1;
+        }
+        else{
+            uHigh = uMiddle;
+        }
+    }
+    if(uLow == 0){
+        return NULL;
+    }
+    pSlab = oSymTable->ppSlabs[uLow - 1];
+    if(uAddress - (uintptr_t)pSlab >= pSlab->uSize){
+        return NULL;
+    }
+    return &oSymTable->ppSlabs[uLow - 1];
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Give back the memory of pNode of oSymTable and its key: their own
+   blocks, or their share of the slab that holds them, which is freed
+   once no node in it is left. */
+
+static void SymTable_dropNode(SymTable_T oSymTable,
+    struct SymTableNode *pNode)
+{
+    struct SymTableSlab **ppSlab;
+    struct SymTableSlab *pSlab;
+    size_t uIndex;
+
+    assert(oSymTable != NULL);
+    assert(pNode != NULL);
+
+    ppSlab = (oSymTable->uSlabs == 0) ? NULL
+        : SymTable_slabOf(oSymTable, pNode);
+    if(ppSlab == NULL){
+        SymTable_release(oSymTable, (void*)pNode->pKey,
+            strlen(pNode->pKey) + 1);
+        SymTable_release(oSymTable, pNode, SymTable_nodeSize(oSymTable));
+        return;
+    }
+
+    pSlab = *ppSlab;
+    assert(pSlab->uLive != 0);
+    if(--pSlab->uLive != 0){
+        return;
+    }
+    uIndex = (size_t)(ppSlab - oSymTable->ppSlabs);
+    memmove(ppSlab, ppSlab + 1,
+        (oSymTable->uSlabs - uIndex - 1) * sizeof(struct SymTableSlab*));
+    oSymTable->uSlabs--;
+    SymTable_release(oSymTable, pSlab, pSlab->uSize);
+    if(oSymTable->uSlabs == 0){
+        SymTable_release(oSymTable, oSymTable->ppSlabs,
+            oSymTable->uSlabCapacity * sizeof(struct SymTableSlab*));
+        oSymTable->ppSlabs = NULL;
+        oSymTable->uSlabCapacity = 0;
+    }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Free pNode of oSymTable, its key, its scope state and its timer. */
+
+static void SymTable_freeNode(SymTable_T oSymTable,
+    struct SymTableNode *pNode)
+{
+    struct SymTableScoped *pScoped;
+    struct SymTableShadow *pShadow;
+
+    assert(oSymTable != NULL);
+    assert(pNode != NULL);
+
+    SymTable_cancelTimer(oSymTable, pNode);
+
+    pScoped = (struct SymTableScoped*)SymTable_sideRemove(
+        &oSymTable->scoped, pNode);
+    if(pScoped != NULL){
+        while(pScoped->pShadowed != NULL){
+            pShadow = pScoped->pShadowed;
+            pScoped->pShadowed = pShadow->pNext;
+            SymTable_release(oSymTable, pShadow,
+                sizeof(struct SymTableShadow));
+        }
+        SymTable_release(oSymTable, pScoped,
+            sizeof(struct SymTableScoped));
+    }
+    SymTable_dropNode(oSymTable, pNode);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the full hash code for pcKey, before it is reduced to a 
+   bucket. */
+
+static size_t SymTable_hashKey(const char *pcKey)
+{
+    const size_t HASH_MULTIPLIER = 65599;
+    size_t u;
+    size_t uHash = 0;
+
+    assert(pcKey != NULL);
+
+    for (u = 0; pcKey[u] != '\0'; u++)
+        uHash = uHash * HASH_MULTIPLIER + (size_t)pcKey[u];
+
+    return uHash;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Compare pcKey, whose full hash code is uHash, with the key of pNode
+   in the order of the chain trees: by hash code, then by strcmp.
+   Returns a negative, zero or positive number as strcmp does. */
+
+static int SymTable_compareNode(const char *pcKey, size_t uHash,
+    const struct SymTableNode *pNode)
+{
+    assert(pcKey != NULL);
+    assert(pNode != NULL);
+
+    if(uHash != pNode->uHash){
+        return (uHash < pNode->uHash) ? -1 : 1;
+    }
+    return strcmp(pcKey, pNode->pKey);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the height of the subtree pEntry roots, 0 if it is empty. */
+
+static int SymTable_treeHeight(const struct SymTableTreeEntry *pEntry)
+{
+    return (pEntry == NULL) ? 0 : pEntry->iHeight;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Rotate the subtree pEntry roots so that its taller child is no more
+   than one level taller than the other, and return its new root. The
+   children of pEntry must be balanced already. */
+
+static struct SymTableTreeEntry *SymTable_treeBalance(
+    struct SymTableTreeEntry *pEntry)
+{
+    struct SymTableTreeEntry *pChild;
+    struct SymTableTreeEntry *pGrandchild;
+    int iLeft;
+    int iRight;
+
+    assert(pEntry != NULL);
+
+    iLeft = SymTable_treeHeight(pEntry->pLeft);
+    iRight = SymTable_treeHeight(pEntry->pRight);
+    if(iLeft > iRight + 1){
+        pChild = pEntry->pLeft;
+        if(SymTable_treeHeight(pChild->pRight)
+            > SymTable_treeHeight(pChild->pLeft)){
+            /* Left-right case: rotate the child left first */
+            pGrandchild = pChild->pRight;
+            pChild->pRight = pGrandchild->pLeft;
+            pGrandchild->pLeft = pChild;
+            pChild->iHeight = 1 + SymTable_treeHeight(pChild->pLeft);
+            if(SymTable_treeHeight(pChild->pRight) + 1 > pChild->iHeight){
+                pChild->iHeight = SymTable_treeHeight(pChild->pRight) + 1;
+            }
+            pChild = pGrandchild;
+        }
+        pEntry->pLeft = pChild->pRight;
+        pChild->pRight = pEntry;
+        pEntry->iHeight = 1 + SymTable_treeHeight(pEntry->pRight);
+        if(SymTable_treeHeight(pEntry->pLeft) + 1 > pEntry->iHeight){
+            pEntry->iHeight = SymTable_treeHeight(pEntry->pLeft) + 1;
+        }
+        pEntry = pChild;
+    }
+    else if(iRight > iLeft + 1){
+        pChild = pEntry->pRight;
+        if(SymTable_treeHeight(pChild->pLeft)
+            > SymTable_treeHeight(pChild->pRight)){
+            /* Right-left case: rotate the child right first */
+            pGrandchild = pChild->pLeft;
+            pChild->pLeft = pGrandchild->pRight;
+            pGrandchild->pRight = pChild;
+            pChild->iHeight = 1 + SymTable_treeHeight(pChild->pRight);
+            if(SymTable_treeHeight(pChild->pLeft) + 1 > pChild->iHeight){
+                pChild->iHeight = SymTable_treeHeight(pChild->pLeft) + 1;
+            }
+            pChild = pGrandchild;
+        }
+        pEntry->pRight = pChild->pLeft;
+        pChild->pLeft = pEntry;
+        pEntry->iHeight = 1 + SymTable_treeHeight(pEntry->pLeft);
+        if(SymTable_treeHeight(pEntry->pRight) + 1 > pEntry->iHeight){
+            pEntry->iHeight = SymTable_treeHeight(pEntry->pRight) + 1;
+        }
+        pEntry = pChild;
+    }
+
+    iLeft = SymTable_treeHeight(pEntry->pLeft);
+    iRight = SymTable_treeHeight(pEntry->pRight);
+    pEntry->iHeight = 1 + ((iLeft > iRight) ? iLeft : iRight);
+    return pEntry;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Add pNewEntry, whose key is not in it, to the tree pEntry roots and
+   return the new root. */
+
+static struct SymTableTreeEntry *SymTable_treeInsert(
+    struct SymTableTreeEntry *pEntry, struct SymTableTreeEntry *pNewEntry)
+{
+    assert(pNewEntry != NULL);
+
+    if(pEntry == NULL){
+        return pNewEntry;
+    }
+    if(SymTable_compareNode(pNewEntry->pNode->pKey,
+        pNewEntry->pNode->uHash, pEntry->pNode) < 0){
+        pEntry->pLeft = SymTable_treeInsert(pEntry->pLeft, pNewEntry);
+    }
+    else{
+        pEntry->pRight = SymTable_treeInsert(pEntry->pRight, pNewEntry);
+    }
+    return SymTable_treeBalance(pEntry);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Take the entry of pcKey, whose full hash code is uHash, out of the
+   tree pEntry roots, store it in *ppRemoved and return the new root.
+   The key must be in the tree. */
+
+static struct SymTableTreeEntry *SymTable_treeRemove(
+    struct SymTableTreeEntry *pEntry, const char *pcKey, size_t uHash,
+    struct SymTableTreeEntry **ppRemoved)
+{
+    struct SymTableTreeEntry *pSuccessor;
+    int iCompare;
+
+    assert(pEntry != NULL);
+    assert(ppRemoved != NULL);
+
+    iCompare = SymTable_compareNode(pcKey, uHash, pEntry->pNode);
+    if(iCompare < 0){
+        pEntry->pLeft = SymTable_treeRemove(pEntry->pLeft, pcKey, uHash,
+            ppRemoved);
+        return SymTable_treeBalance(pEntry);
+    }
+    if(iCompare > 0){
+        pEntry->pRight = SymTable_treeRemove(pEntry->pRight, pcKey, uHash,
+            ppRemoved);
+        return SymTable_treeBalance(pEntry);
+    }
+
+    *ppRemoved = pEntry;
+    if(pEntry->pLeft == NULL){
+        return pEntry->pRight;
+    }
+    if(pEntry->pRight == NULL){
+        return pEntry->pLeft;
+    }
+    /* The smallest entry on the right takes the removed one's place */
+    pSuccessor = pEntry->pRight;
+    while(pSuccessor->pLeft != NULL){
+        pSuccessor = pSuccessor->pLeft;
+    }
+    pSuccessor->pRight = SymTable_treeRemove(pEntry->pRight,
+        pSuccessor->pNode->pKey, pSuccessor->pNode->uHash, &pSuccessor);
+    pSuccessor->pLeft = pEntry->pLeft;
+    return SymTable_treeBalance(pSuccessor);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the entry of pcKey, whose full hash code is uHash, in the
+   tree pEntry roots, or NULL if it has none. Adds the number of
+   entries visited to *puProbes. */
+
+static struct SymTableTreeEntry *SymTable_treeFind(
+    struct SymTableTreeEntry *pEntry, const char *pcKey, size_t uHash,
+    size_t *puProbes)
+{
+    int iCompare;
+
+    assert(pcKey != NULL);
+    assert(puProbes != NULL);
+
+    while(pEntry != NULL){
+        (*puProbes)++;
+        iCompare = SymTable_compareNode(pcKey, uHash, pEntry->pNode);
+        if(iCompare == 0){
+            return pEntry;
+        }
+        pEntry = (iCompare < 0) ? pEntry->pLeft : pEntry->pRight;
+    }
+    return NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the tree of bucket uBucket of oSymTable, or NULL if its
+   chain has none. */
+
+static struct SymTableTree *SymTable_treeOf(SymTable_T oSymTable,
+    size_t uBucket)
+{
+    assert(oSymTable != NULL);
+
+    return (oSymTable->ppTrees == NULL) ? NULL
+        : oSymTable->ppTrees[uBucket];
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Give back every entry of the tree pEntry roots to the allocator of
+   oSymTable. The nodes are not touched. */
+
+static void SymTable_freeEntries(SymTable_T oSymTable,
+    struct SymTableTreeEntry *pEntry)
+{
+    struct SymTableTreeEntry *pRight;
+
+    assert(oSymTable != NULL);
+
+    while(pEntry != NULL){
+        SymTable_freeEntries(oSymTable, pEntry->pLeft);
+        pRight = pEntry->pRight;
+        SymTable_release(oSymTable, pEntry,
+            sizeof(struct SymTableTreeEntry));
+        pEntry = pRight;
+    }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Free the tree of bucket uBucket of oSymTable, leaving its chain a
+   plain list again. */
+
+static void SymTable_dropTree(SymTable_T oSymTable, size_t uBucket)
+{
+    struct SymTableTree *pTree;
+
+    assert(oSymTable != NULL);
+
+    pTree = SymTable_treeOf(oSymTable, uBucket);
+    if(pTree == NULL){
+        return;
+    }
+    SymTable_freeEntries(oSymTable, pTree->pRoot);
+    SymTable_release(oSymTable, pTree, sizeof(struct SymTableTree));
+    oSymTable->ppTrees[uBucket] = NULL;
+    oSymTable->uTrees--;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Free every tree of oSymTable and the array that holds them. */
+
+static void SymTable_dropTrees(SymTable_T oSymTable)
+{
+    size_t counter;
+
+    assert(oSymTable != NULL);
+
+    if(oSymTable->ppTrees == NULL){
+        return;
+    }
+    for(counter = 0; counter < oSymTable->limit && oSymTable->uTrees != 0;
+        counter++){
+        SymTable_dropTree(oSymTable, counter);
+    }
+    SymTable_release(oSymTable, oSymTable->ppTrees,
+        oSymTable->limit * sizeof(struct SymTableTree*));
+    oSymTable->ppTrees = NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Index the chain of bucket uBucket of oSymTable by a tree. The tree
+   only speeds up lookups, so if there is not enough memory the chain
+   simply stays a list. */
+
+static void SymTable_treeify(SymTable_T oSymTable, size_t uBucket)
+{
+    struct SymTableTree *pTree;
+    struct SymTableTreeEntry *pEntry;
+    struct SymTableNode *pPrevNode;
+    struct SymTableNode *pNode;
+
+    assert(oSymTable != NULL);
+    assert(SymTable_treeOf(oSymTable, uBucket) == NULL);
+
+    if(oSymTable->ppTrees == NULL){
+        oSymTable->ppTrees = (struct SymTableTree**)SymTable_alloc(
+            oSymTable, oSymTable->limit * sizeof(struct SymTableTree*));
+        if(oSymTable->ppTrees == NULL){
+            return;
+        }
+        memset(oSymTable->ppTrees, 0,
+            oSymTable->limit * sizeof(struct SymTableTree*));
+    }
+    pTree = (struct SymTableTree*)SymTable_alloc(oSymTable,
+        sizeof(struct SymTableTree));
+    if(pTree == NULL){
+        return;
+    }
+    pTree->pRoot = NULL;
+    pTree->uCount = 0;
+    oSymTable->ppTrees[uBucket] = pTree;
+    oSymTable->uTrees++;
+
+    pPrevNode = NULL;
+    for(pNode = oSymTable->pFirstBucket[uBucket].pFirstBucketNode;
+        pNode != NULL; pNode = pNode->pNextNode){
+        pEntry = (struct SymTableTreeEntry*)SymTable_alloc(oSymTable,
+            sizeof(struct SymTableTreeEntry));
+        if(pEntry == NULL){
+            SymTable_dropTree(oSymTable, uBucket);
+            return;
+        }
+        pEntry->pNode = pNode;
+        pEntry->pPrevNode = pPrevNode;
+        pEntry->pLeft = NULL;
+        pEntry->pRight = NULL;
+        pEntry->iHeight = 1;
+        pTree->pRoot = SymTable_treeInsert(pTree->pRoot, pEntry);
+        pTree->uCount++;
+        pPrevNode = pNode;
+    }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Give every chain of oSymTable longer than TREEIFY_THRESHOLD and
+   without a tree one. */
+
+static void SymTable_treeifyLong(SymTable_T oSymTable)
+{
+    struct SymTableNode *pNode;
+    size_t uLength;
+    size_t counter;
+
+    assert(oSymTable != NULL);
+
+    for(counter = 0; counter < oSymTable->limit; counter++){
+        if(SymTable_treeOf(oSymTable, counter) != NULL){
+            continue;
+        }
+        uLength = 0;
+        for(pNode = oSymTable->pFirstBucket[counter].pFirstBucketNode;
+            pNode != NULL; pNode = pNode->pNextNode){
+            uLength++;
+        }
+        if(uLength > TREEIFY_THRESHOLD){
+            SymTable_treeify(oSymTable, counter);
+        }
+    }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Link pNode, whose key is not in the chain, at the front of bucket
+   uBucket of oSymTable, keeping the bucket's tree if it has one. */
+
+static void SymTable_chainInsert(SymTable_T oSymTable, size_t uBucket,
+    struct SymTableNode *pNode)
+{
+    struct SymTableBucket *pbCurrent;
+    struct SymTableTree *pTree;
+    struct SymTableTreeEntry *pEntry;
+    size_t uProbes = 0;
+
+    assert(oSymTable != NULL);
+    assert(pNode != NULL);
+
+    pbCurrent = &oSymTable->pFirstBucket[uBucket];
+    pTree = SymTable_treeOf(oSymTable, uBucket);
+    if(pTree != NULL){
+        pEntry = (struct SymTableTreeEntry*)SymTable_alloc(oSymTable,
+            sizeof(struct SymTableTreeEntry));
+        if(pEntry == NULL){
+            SymTable_dropTree(oSymTable, uBucket);
+        }
+        else{
+            if(pbCurrent->pFirstBucketNode != NULL){
+                SymTable_treeFind(pTree->pRoot,
+                    pbCurrent->pFirstBucketNode->pKey,
+                    pbCurrent->pFirstBucketNode->uHash, &uProbes)
+                    ->pPrevNode = pNode;
+            }
+            pEntry->pNode = pNode;
+            pEntry->pPrevNode = NULL;
+            pEntry->pLeft = NULL;
+            pEntry->pRight = NULL;
+            pEntry->iHeight = 1;
+            pTree->pRoot = SymTable_treeInsert(pTree->pRoot, pEntry);
+            pTree->uCount++;
+        }
+    }
+    pNode->pNextNode = pbCurrent->pFirstBucketNode;
+    pbCurrent->pFirstBucketNode = pNode;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Unlink pNode from the chain of bucket uBucket of oSymTable, keeping
+   the bucket's tree if it has one. ppLink is the link that points to
+   pNode, or NULL to find it. */
+
+static void SymTable_chainUnlink(SymTable_T oSymTable, size_t uBucket,
+    struct SymTableNode **ppLink, struct SymTableNode *pNode)
+{
+    struct SymTableTree *pTree;
+    struct SymTableTreeEntry *pEntry = NULL;
+    size_t uProbes = 0;
+
+    assert(oSymTable != NULL);
+    assert(pNode != NULL);
+
+    pTree = SymTable_treeOf(oSymTable, uBucket);
+    if(pTree != NULL){
+        pTree->pRoot = SymTable_treeRemove(pTree->pRoot, pNode->pKey,
+            pNode->uHash, &pEntry);
+        pTree->uCount--;
+        if(ppLink == NULL){
+            ppLink = (pEntry->pPrevNode == NULL)
+                ? &oSymTable->pFirstBucket[uBucket].pFirstBucketNode
+                : &pEntry->pPrevNode->pNextNode;
+        }
+        if(pNode->pNextNode != NULL){
+            SymTable_treeFind(pTree->pRoot, pNode->pNextNode->pKey,
+                pNode->pNextNode->uHash, &uProbes)->pPrevNode
+                = pEntry->pPrevNode;
+        }
+        SymTable_release(oSymTable, pEntry,
+            sizeof(struct SymTableTreeEntry));
+        if(pTree->uCount < UNTREEIFY_THRESHOLD){
+            SymTable_dropTree(oSymTable, uBucket);
+        }
+    }
+    else if(ppLink == NULL){
+        ppLink = &oSymTable->pFirstBucket[uBucket].pFirstBucketNode;
+        while(*ppLink != pNode){
+            ppLink = &(*ppLink)->pNextNode;
+        }
+    }
+    assert(*ppLink == pNode);
+    *ppLink = pNode->pNextNode;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the node of pcKey, whose full hash code is uHash, in
+   oSymTable, which owns its nodes, or NULL if there is none. Uses the
+   tree of the key's bucket if it has one, or walks its chain. Adds the
+   number of nodes visited to *puProbes; after a miss in a chain with
+   no tree that is its length. If ppLink is not NULL, stores in *ppLink
+   the link that points to the node after a walk, or NULL after a
+   tree lookup, as SymTable_chainUnlink takes it. */
+
+static struct SymTableNode *SymTable_lookup(SymTable_T oSymTable,
+    const char *pcKey, size_t uHash, struct SymTableNode ***pppLink,
+    size_t *puProbes)
+{
+    struct SymTableTree *pTree;
+    struct SymTableTreeEntry *pEntry;
+    struct SymTableNode **ppLink;
+
+    assert(oSymTable != NULL);
+    assert(oSymTable->pucMap == NULL);
+    assert(pcKey != NULL);
+    assert(puProbes != NULL);
+
+    pTree = SymTable_treeOf(oSymTable, uHash % oSymTable->limit);
+    if(pTree != NULL){
+        if(pppLink != NULL){
+            *pppLink = NULL;
+        }
+        pEntry = SymTable_treeFind(pTree->pRoot, pcKey, uHash, puProbes);
+        return (pEntry == NULL) ? NULL : pEntry->pNode;
+    }
+
+    ppLink = &oSymTable->pFirstBucket[uHash % oSymTable->limit]
+        .pFirstBucketNode;
+    while(*ppLink != NULL){
+        (*puProbes)++;
+        if((*ppLink)->uHash == uHash
+            && strcmp((*ppLink)->pKey, pcKey) == 0){
+            if(pppLink != NULL){
+                *pppLink = ppLink;
+            }
+            return *ppLink;
+        }
+        ppLink = &(*ppLink)->pNextNode;
+    }
+    return NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Move every node of oSymTable into a new array of newLimit buckets.
+   Returns the 1 for success, 0 for failure. */
+
+static int SymTable_rehash(SymTable_T oSymTable, size_t newLimit)
+{
+    size_t oldLimit;
+    size_t counter;
+    struct SymTableBucket* oldTableCurrentBucket;
+    struct SymTableBucket* pbCurrent;
+    struct SymTableBucket* newBucket;
+    struct SymTableNode* pCurrentNode;
+    struct SymTableNode* pOldNode;
+    struct SymTableNode* pNextNode;
+    int iHadTrees;
+#ifdef SYMTABLE_STATS
+    struct timespec sStart;
+    struct timespec sEnd;
+
+    clock_gettime(CLOCK_MONOTONIC, &sStart);
+#endif
+
+    assert(oSymTable != NULL);
+    
+    oldLimit = oSymTable->limit;
+ 
+    /* newLimit elements for a new hash table */
+    newBucket = SymTable_alloc(oSymTable,
+        newLimit * sizeof(struct SymTableBucket));
+    if (newBucket == NULL){
+        return 0;
+    }
+    memset(newBucket, 0, newLimit * sizeof(struct SymTableBucket));
+
+    /* The chains are rebuilt, so their trees go and are made again
+       below for the chains still long */
+    iHadTrees = (oSymTable->uTrees != 0);
+    SymTable_dropTrees(oSymTable);
+
+    oldTableCurrentBucket = oSymTable->pFirstBucket;
+
+    counter = 0;
+    while(counter < oldLimit){
+        /* all non empty buckets */
+        if(oldTableCurrentBucket->pFirstBucketNode != NULL){
+            /* rewire their nodes */
+            for (pCurrentNode = oldTableCurrentBucket->pFirstBucketNode;
+                pCurrentNode != NULL;
+                pCurrentNode = pNextNode)
+            {
+                pNextNode = pCurrentNode->pNextNode;
+
+                /* finds the position of the new bucket */
+                pbCurrent = &newBucket[
+                    pCurrentNode->uHash % newLimit
+                ];
+
+                pOldNode = pbCurrent->pFirstBucketNode;
+                pbCurrent->pFirstBucketNode = pCurrentNode;
+                pCurrentNode->pNextNode = pOldNode;
+            }
+        }
+        oldTableCurrentBucket++;
+        counter++;
+    }
+
+    
+
+    SymTable_release(oSymTable, oSymTable->pFirstBucket,
+        oldLimit * sizeof(struct SymTableBucket));
+    oSymTable->limit = newLimit;
+    oSymTable->pFirstBucket = newBucket;
+
+    /* The chains a compaction pass laid out are gone, so the next
+       pass starts over, and the eviction hand must point to a bucket
+       that still exists */
+    oSymTable->uCompactNext = 0;
+    oSymTable->uHand %= newLimit;
+
+    if(iHadTrees){
+        SymTable_treeifyLong(oSymTable);
+    }
+
+#ifdef SYMTABLE_STATS
+    clock_gettime(CLOCK_MONOTONIC, &sEnd);
+    oSymTable->counters.ulResizes++;
+    oSymTable->counters.dResizeSeconds +=
+        (double)(sEnd.tv_sec - sStart.tv_sec)
+        + (double)(sEnd.tv_nsec - sStart.tv_nsec) / 1e9;
+#endif
+
+    return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Resize the list of oSymTable buckets in oSymTable to the next 
+   iteration. Returns the 1 for success, 0 for failure. */
+
+static int SymTable_resize(SymTable_T oSymTable)
+{
+    size_t oldLimit;
+    size_t index;
+
+    assert(oSymTable != NULL);
+    
+    oldLimit = oSymTable->limit;
+
+    /* Edge case for max size */
+    if(oldLimit == buckets[sizeof(buckets)/sizeof(buckets[0]) - 1]){
+        return 1;
+    }
+
+    /* find new limit */
+    index = 0;
+    while(oldLimit > buckets[index]){
+        index++;
+    }
+
+    return SymTable_rehash(oSymTable, buckets[index + 1]);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Shrink the buckets of oSymTable once fewer than a quarter of them
+   hold a binding's worth, to the fewest that keep it at most half
+   full. If the buckets cannot shrink the table stays as it is. */
+
+static void SymTable_shrink(SymTable_T oSymTable)
+{
+    size_t index;
+
+    assert(oSymTable != NULL);
+
+    if(oSymTable->size >= oSymTable->limit / 4){
+        return;
+    }
+    index = 0;
+    while(index < sizeof(buckets)/sizeof(buckets[0]) - 1
+        && buckets[index] < 2 * oSymTable->size){
+        index++;
+    }
+    if(buckets[index] < oSymTable->limit){
+        (void)SymTable_rehash(oSymTable, buckets[index]);
+    }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return u rounded up to a multiple of 8, the alignment of every 
+   record in a snapshot. */
+
+static size_t SymTable_pad8(size_t u)
+{
+    return (u + 7) & ~(size_t)7;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the number of bytes pRecord takes in a snapshot, including 
+   its key and value. */
+
+static size_t SymTable_recordSize(const struct SnapshotRecord *pRecord)
+{
+    assert(pRecord != NULL);
+
+    return sizeof(struct SnapshotRecord)
+        + SymTable_pad8((size_t)pRecord->uKeyLength + 1)
+        + SymTable_pad8((size_t)pRecord->uValueLength);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the key stored in pRecord. */
+
+static const char *SymTable_recordKey(const struct SnapshotRecord *pRecord)
+{
+    assert(pRecord != NULL);
+
+    return (const char*)(pRecord + 1);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the address of the value bytes stored in pRecord, or NULL if
+   the value was saved as NULL. */
+
+static void *SymTable_recordValue(const struct SnapshotRecord *pRecord)
+{
+    assert(pRecord != NULL);
+
+    if(pRecord->uValueLength == 0){
+        return NULL;
+    }
+    return (void*)(SymTable_recordKey(pRecord)
+        + SymTable_pad8((size_t)pRecord->uKeyLength + 1));
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the record at uOffset of the snapshot mapped by oSymTable, or
+   NULL if uOffset is 0 or the record, its key or its value would reach
+   past the end of the mapping. The key must end in '\0' where its
+   length says, and the next record of its bucket must come after it,
+   so that a corrupt file cannot make a chain loop. */
+
+static const struct SnapshotRecord *SymTable_recordAt(SymTable_T oSymTable,
+    uint64_t uOffset)
+{
+    const struct SnapshotRecord *pRecord;
+    size_t uRoom;
+
+    assert(oSymTable != NULL);
+    assert(oSymTable->pucMap != NULL);
+
+    if(uOffset < sizeof(struct SnapshotHeader)
+            + oSymTable->limit * sizeof(uint64_t)
+        || uOffset % 8 != 0
+        || uOffset > oSymTable->uMapLength - sizeof(struct SnapshotRecord)){
+        return NULL;
+    }
+    pRecord = (const struct SnapshotRecord*)(oSymTable->pucMap + uOffset);
+    uRoom = oSymTable->uMapLength - (size_t)uOffset
+        - sizeof(struct SnapshotRecord);
+    if(pRecord->uKeyLength >= uRoom
+        || SymTable_pad8((size_t)pRecord->uKeyLength + 1) > uRoom
+        || pRecord->uValueLength > uRoom
+            - SymTable_pad8((size_t)pRecord->uKeyLength + 1)
+        || SymTable_recordKey(pRecord)[pRecord->uKeyLength] != '\0'
+        || (pRecord->uNext != 0 && pRecord->uNext <= uOffset)){
+        return NULL;
+    }
+    return pRecord;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the record for pcKey, whose full hash code is uHash, in the
+   snapshot mapped by oSymTable, or NULL if there is none. A chain
+   that leads outside the mapping ends there. */
+
+static const struct SnapshotRecord *SymTable_findRecord(
+    SymTable_T oSymTable, const char *pcKey, size_t uHash)
+{
+    const uint64_t *puBucketOffsets;
+    const struct SnapshotRecord *pRecord;
+    uint64_t uOffset;
+
+    assert(oSymTable != NULL);
+    assert(oSymTable->pucMap != NULL);
+    assert(pcKey != NULL);
+
+    puBucketOffsets = (const uint64_t*)(oSymTable->pucMap
+        + sizeof(struct SnapshotHeader));
+
+    uOffset = puBucketOffsets[uHash % oSymTable->limit];
+    while(uOffset != 0){
+        pRecord = SymTable_recordAt(oSymTable, uOffset);
+        if(pRecord == NULL){
+            return NULL;
+        }
+        SYMTABLE_COUNT(oSymTable->counters.ulLookupProbes++);
+        if(pRecord->uHash == (uint64_t)uHash
+            && strcmp(SymTable_recordKey(pRecord), pcKey) == 0){
+            return pRecord;
+        }
+        uOffset = pRecord->uNext;
+    }
+    return NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the scope state of pNode of oSymTable, or NULL for a
+   binding in the outermost scope. */
+
+static struct SymTableScoped *SymTable_scopedOf(SymTable_T oSymTable,
+    const struct SymTableNode *pNode)
+{
+    assert(oSymTable != NULL);
+
+    return (struct SymTableScoped*)SymTable_sideFind(&oSymTable->scoped,
+        pNode);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return 1 if pNode of oSymTable holds a binding, or 0 if its key was
+   removed. */
+
+static int SymTable_isBound(SymTable_T oSymTable,
+    const struct SymTableNode *pNode)
+{
+    struct SymTableScoped *pScoped;
+
+    assert(oSymTable != NULL);
+    assert(pNode != NULL);
+
+    pScoped = SymTable_scopedOf(oSymTable, pNode);
+    return pScoped == NULL || pScoped->iBound;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return 1 if pNode of oSymTable holds a binding that has not
+   expired, or 0 otherwise. */
+
+static int SymTable_isLive(SymTable_T oSymTable,
+    const struct SymTableNode *pNode)
+{
+    struct SymTableTimer *pTimer;
+
+    assert(oSymTable != NULL);
+    assert(pNode != NULL);
+
+    if(! SymTable_isBound(oSymTable, pNode)){
+        return 0;
+    }
+    pTimer = (struct SymTableTimer*)SymTable_sideFind(&oSymTable->timers,
+        pNode);
+    return pTimer == NULL || pTimer->uDeadline > oSymTable->uClock;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the scope the current binding of pNode of oSymTable belongs
+   to. */
+
+static size_t SymTable_scopeOf(SymTable_T oSymTable,
+    const struct SymTableNode *pNode)
+{
+    struct SymTableScoped *pScoped;
+
+    assert(pNode != NULL);
+
+    pScoped = SymTable_scopedOf(oSymTable, pNode);
+    return (pScoped == NULL) ? 0 : pScoped->uScope;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Give pNode of oSymTable a scope state if it has none, bound in the
+   outermost scope, and return it, or NULL if there is not enough
+   memory available. */
+
+static struct SymTableScoped *SymTable_makeScoped(SymTable_T oSymTable,
+    struct SymTableNode *pNode)
+{
+    struct SymTableScoped *pScoped;
+
+    assert(oSymTable != NULL);
+    assert(pNode != NULL);
+
+    pScoped = SymTable_scopedOf(oSymTable, pNode);
+    if(pScoped != NULL){
+        return pScoped;
+    }
+    if(! SymTable_sideReserve(oSymTable, &oSymTable->scoped)){
+        return NULL;
+    }
+    pScoped = (struct SymTableScoped*)SymTable_alloc(oSymTable,
+        sizeof(struct SymTableScoped));
+    if(pScoped == NULL){
+        return NULL;
+    }
+    pScoped->uScope = 0;
+    pScoped->iBound = 1;
+    pScoped->uLogRefs = 0;
+    pScoped->pShadowed = NULL;
+    SymTable_sidePlace(&oSymTable->scoped, pNode, pScoped);
+    return pScoped;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Free the scope state of pNode of oSymTable, which shadows no
+   binding, making the node a plain one bound in the outermost
+   scope. */
+
+static void SymTable_dropScoped(SymTable_T oSymTable,
+    struct SymTableNode *pNode)
+{
+    struct SymTableScoped *pScoped;
+
+    assert(oSymTable != NULL);
+    assert(pNode != NULL);
+
+    pScoped = (struct SymTableScoped*)SymTable_sideRemove(
+        &oSymTable->scoped, pNode);
+    assert(pScoped != NULL);
+    assert(pScoped->pShadowed == NULL);
+    SymTable_release(oSymTable, pScoped, sizeof(struct SymTableScoped));
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Make room for one more entry in the undo log of oSymTable. Returns
+   1 for success or 0 for failure. */
+
+static int SymTable_reserveUndo(SymTable_T oSymTable)
+{
+    struct SymTableNode **ppUndoLog;
+    size_t uCapacity;
+
+    assert(oSymTable != NULL);
+
+    if(oSymTable->uUndoLength < oSymTable->uUndoCapacity){
+        return 1;
+    }
+    uCapacity = (oSymTable->uUndoCapacity == 0) ? 16
+        : oSymTable->uUndoCapacity * 2;
+    ppUndoLog = (struct SymTableNode**)SymTable_alloc(oSymTable,
+        uCapacity * sizeof(struct SymTableNode*));
+    if(ppUndoLog == NULL){
+        return 0;
+    }
+    if(oSymTable->ppUndoLog != NULL){
+        memcpy(ppUndoLog, oSymTable->ppUndoLog,
+            oSymTable->uUndoLength * sizeof(struct SymTableNode*));
+        SymTable_release(oSymTable, oSymTable->ppUndoLog,
+            oSymTable->uUndoCapacity * sizeof(struct SymTableNode*));
+    }
+    oSymTable->ppUndoLog = ppUndoLog;
+    oSymTable->uUndoCapacity = uCapacity;
+    return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Record in the undo log of oSymTable that pNode, which has a scope
+   state, was given a binding in the innermost scope. The log must
+   have room, from SymTable_reserveUndo. */
+
+static void SymTable_logNode(SymTable_T oSymTable,
+    struct SymTableNode *pNode)
+{
+    struct SymTableScoped *pScoped;
+
+    assert(oSymTable != NULL);
+    assert(pNode != NULL);
+    assert(oSymTable->uUndoLength < oSymTable->uUndoCapacity);
+
+    pScoped = SymTable_scopedOf(oSymTable, pNode);
+    assert(pScoped != NULL);
+    pScoped->uScope = oSymTable->uDepth;
+    pScoped->uLogRefs++;
+    oSymTable->ppUndoLog[oSymTable->uUndoLength++] = pNode;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Unlink pNode from its bucket of oSymTable. */
+
+static void SymTable_unlinkNode(SymTable_T oSymTable,
+    struct SymTableNode *pNode)
+{
+    assert(oSymTable != NULL);
+    assert(pNode != NULL);
+
+    SymTable_chainUnlink(oSymTable, pNode->uHash % oSymTable->limit,
+        NULL, pNode);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Once the undo log of oSymTable no longer names pNode, return it to
+   a plain node bound in the outermost scope, or free it if its key was
+   removed. */
+
+static void SymTable_settle(SymTable_T oSymTable,
+    struct SymTableNode *pNode)
+{
+    struct SymTableScoped *pScoped;
+
+    assert(oSymTable != NULL);
+    assert(pNode != NULL);
+
+    pScoped = SymTable_scopedOf(oSymTable, pNode);
+    if(pScoped == NULL || pScoped->uLogRefs != 0){
+        return;
+    }
+    /* Only bindings of open scopes are shadowing others */
+    assert(pScoped->pShadowed == NULL);
+
+    if(pScoped->iBound){
+        SymTable_dropScoped(oSymTable, pNode);
+    }
+    else{
+        SymTable_unlinkNode(oSymTable, pNode);
+        SymTable_freeNode(oSymTable, pNode);
+    }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* End the current binding of pNode of oSymTable, which has a scope
+   state, revealing the binding it shadows if there is one. The caller
+   accounts for the binding that ends. */
+
+static void SymTable_unbind(SymTable_T oSymTable,
+    struct SymTableNode *pNode)
+{
+    struct SymTableScoped *pScoped;
+    struct SymTableShadow *pShadow;
+
+    assert(oSymTable != NULL);
+    assert(pNode != NULL);
+
+    pScoped = SymTable_scopedOf(oSymTable, pNode);
+    assert(pScoped != NULL);
+    pShadow = pScoped->pShadowed;
+    if(pShadow == NULL){
+        pScoped->iBound = 0;
+    }
+    else{
+        pScoped->pShadowed = pShadow->pNext;
+        pNode->pValue = pShadow->pValue;
+        pScoped->uScope = pShadow->uScope;
+        pScoped->iBound = pShadow->iBound;
+        if(pScoped->iBound){
+            oSymTable->size++;
+        }
+        SymTable_release(oSymTable, pShadow, sizeof(struct SymTableShadow));
+    }
+    SymTable_settle(oSymTable, pNode);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Bind pcKey's existing pNode of oSymTable to pvValue in the
+   innermost scope, shadowing its binding from an outer scope. Returns
+   1 for success, or 0 if the key is bound in the innermost scope
+   already or there is not enough memory available. */
+
+static int SymTable_shadow(SymTable_T oSymTable,
+    struct SymTableNode *pNode, const void *pvValue)
+{
+    struct SymTableScoped *pScoped;
+    struct SymTableShadow *pShadow;
+    int iHadScope;
+
+    assert(oSymTable != NULL);
+    assert(pNode != NULL);
+
+    if(SymTable_scopeOf(oSymTable, pNode) == oSymTable->uDepth){
+        if(SymTable_isBound(oSymTable, pNode)){
+            return 0;
+        }
+        /* Removed earlier in the same scope */
+        SymTable_scopedOf(oSymTable, pNode)->iBound = 1;
+        pNode->pValue = pvValue;
+        oSymTable->size++;
+        return 1;
+    }
+
+    iHadScope = (SymTable_scopedOf(oSymTable, pNode) != NULL);
+    pScoped = SymTable_makeScoped(oSymTable, pNode);
+    if(pScoped == NULL){
+        return 0;
+    }
+    pShadow = (struct SymTableShadow*)SymTable_alloc(oSymTable,
+        sizeof(struct SymTableShadow));
+    if(pShadow == NULL || ! SymTable_reserveUndo(oSymTable)){
+        if(pShadow != NULL){
+            SymTable_release(oSymTable, pShadow,
+                sizeof(struct SymTableShadow));
+        }
+        if(! iHadScope){
+            SymTable_dropScoped(oSymTable, pNode);
+        }
+        return 0;
+    }
+
+    pShadow->pValue = pNode->pValue;
+    pShadow->uScope = pScoped->uScope;
+    pShadow->iBound = pScoped->iBound;
+    pShadow->pNext = pScoped->pShadowed;
+    pScoped->pShadowed = pShadow;
+    if(! pScoped->iBound){
+        oSymTable->size++;
+    }
+    pScoped->iBound = 1;
+    pNode->pValue = pvValue;
+    SymTable_logNode(oSymTable, pNode);
+    return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Evict one binding of oSymTable, which is bounded and not empty, by
+   the CLOCK rule: the hand sweeps the buckets in order, giving each
+   node it passes with its reference bit set a second chance by
+   clearing the bit, and evicts the first node whose bit is clear. A
+   hand stopped inside a bucket starts that bucket again next time;
+   the nodes it already passed have their bits clear and go first. */
+
+static void SymTable_evict(SymTable_T oSymTable)
+{
+    struct SymTableNode **ppLink;
+    struct SymTableNode *pNode;
+
+    assert(oSymTable != NULL);
+    assert(oSymTable->uMaxBindings != 0);
+    assert(oSymTable->size != 0);
+
+    for(;;){
+        ppLink = &oSymTable->pFirstBucket[oSymTable->uHand]
+            .pFirstBucketNode;
+        while(*ppLink != NULL){
+            pNode = *ppLink;
+            if(*SymTable_referenced(oSymTable, pNode)){
+                *SymTable_referenced(oSymTable, pNode) = 0;
+                ppLink = &pNode->pNextNode;
+                continue;
+            }
+            SymTable_chainUnlink(oSymTable, oSymTable->uHand, ppLink,
+                pNode);
+            oSymTable->size--;
+            if(oSymTable->pfEvict != NULL){
+                (*oSymTable->pfEvict)(pNode->pKey, (void*)pNode->pValue,
+                    (void*)oSymTable->pvEvictExtra);
+            }
+            SymTable_freeNode(oSymTable, pNode);
+            return;
+        }
+        oSymTable->uHand = (oSymTable->uHand + 1) % oSymTable->limit;
+    }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Evict bindings of oSymTable until it holds no more than its bound,
+   if it has one. */
+
+static void SymTable_evictExcess(SymTable_T oSymTable)
+{
+    assert(oSymTable != NULL);
+
+    while(oSymTable->uMaxBindings != 0
+        && oSymTable->size > oSymTable->uMaxBindings){
+        SymTable_evict(oSymTable);
+    }
+}
+
+/*--------------------------------------------------------------------*/
+
+SymTable_T SymTable_new(void){
+    return SymTable_newWithAllocator(&defaultAllocator);
+}
+
+/*--------------------------------------------------------------------*/
+
+SymTable_T SymTable_newWithAllocator(const SymTable_Allocator *pAllocator){
+    SymTable_T oSymTable;
+
+    assert(pAllocator != NULL);
+    assert(pAllocator->pfAlloc != NULL);
+    assert(pAllocator->pfFree != NULL);
+
+    oSymTable = (SymTable_T)(*pAllocator->pfAlloc)(sizeof(struct SymTable),
+        pAllocator->pvContext);
+    if (oSymTable == NULL)
+       return NULL;
+    oSymTable->allocator = *pAllocator;
+    oSymTable->uBytes = sizeof(struct SymTable);
+ 
+    /* 509 elements for a new hash table */
+    oSymTable->pFirstBucket = SymTable_alloc(oSymTable,
+        buckets[0] * sizeof(struct SymTableBucket));
+    if (oSymTable->pFirstBucket == NULL){
+        SymTable_release(oSymTable, oSymTable, sizeof(struct SymTable));
+        return NULL;
+    }
+    memset(oSymTable->pFirstBucket, 0,
+        buckets[0] * sizeof(struct SymTableBucket));
+
+    oSymTable->size = 0;
+    oSymTable->limit = buckets[0];
+    oSymTable->pucMap = NULL;
+    oSymTable->uMapLength = 0;
+    oSymTable->ppUndoLog = NULL;
+    oSymTable->uUndoLength = 0;
+    oSymTable->uUndoCapacity = 0;
+    oSymTable->puScopeStarts = NULL;
+    oSymTable->uDepth = 0;
+    oSymTable->uScopeCapacity = 0;
+    oSymTable->uMaxBindings = 0;
+    oSymTable->pfEvict = NULL;
+    oSymTable->pvEvictExtra = NULL;
+    oSymTable->uHand = 0;
+    oSymTable->ppWheel = NULL;
+    oSymTable->uWheelTime = 0;
+    oSymTable->uClock = 0;
+    oSymTable->timers = emptySideIndex;
+    oSymTable->scoped = emptySideIndex;
+    oSymTable->ppTrees = NULL;
+    oSymTable->uTrees = 0;
+    oSymTable->uValueSize = 0;
+    oSymTable->ppSlabs = NULL;
+    oSymTable->uSlabs = 0;
+    oSymTable->uSlabCapacity = 0;
+    oSymTable->uCompactNext = 0;
+#ifdef SYMTABLE_STATS
+    memset(&oSymTable->counters, 0, sizeof(oSymTable->counters));
+#endif
+    return oSymTable;
+}
+
+/*--------------------------------------------------------------------*/
+
+SymTable_T SymTable_newBounded(size_t uMaxBindings,
+    SymTable_Evictor pfEvict, const void *pvExtra){
+    SymTable_T oSymTable;
+
+    assert(uMaxBindings != 0);
+
+    oSymTable = SymTable_new();
+    if(oSymTable == NULL){
+        return NULL;
+    }
+    oSymTable->uMaxBindings = uMaxBindings;
+    oSymTable->pfEvict = pfEvict;
+    oSymTable->pvEvictExtra = pvExtra;
+    return oSymTable;
+}
+
+/*--------------------------------------------------------------------*/
+
+SymTable_T SymTable_newInline(size_t uValueSize){
+    SymTable_T oSymTable;
+
+    assert(uValueSize != 0);
+
+    oSymTable = SymTable_new();
+    if(oSymTable == NULL){
+        return NULL;
+    }
+    oSymTable->uValueSize = uValueSize;
+    return oSymTable;
+}
+
+/*--------------------------------------------------------------------*/
+
+int SymTable_putValue(SymTable_T oSymTable, const char *pcKey,
+    const void *pvValue){
+    assert(oSymTable != NULL);
+    assert(oSymTable->uValueSize != 0);
+    assert(pcKey != NULL);
+    assert(pvValue != NULL);
+
+    return SymTable_putHandle(oSymTable, pcKey, pvValue) != NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *SymTable_getValuePtr(SymTable_T oSymTable, const char *pcKey){
+    assert(oSymTable != NULL);
+    assert(oSymTable->uValueSize != 0);
+    assert(pcKey != NULL);
+
+    return SymTable_get(oSymTable, pcKey);
+}
+
+/*--------------------------------------------------------------------*/
+
+int SymTable_add(SymTable_T oSymTable, const char *pcKey, long lDelta){
+    struct SymTableNode *pNode;
+    size_t uHash;
+    size_t uProbes = 0;
+
+    assert(oSymTable != NULL);
+    assert(oSymTable->uValueSize == sizeof(long));
+    assert(pcKey != NULL);
+
+    if(oSymTable->pucMap != NULL){
+        return 0;
+    }
+
+    SYMTABLE_COUNT(oSymTable->counters.ulLookups++);
+
+    /* The count is changed where it lies, found by one lookup */
+    uHash = SymTable_hashKey(pcKey);
+    pNode = SymTable_lookup(oSymTable, pcKey, uHash, NULL, &uProbes);
+    SYMTABLE_COUNT(oSymTable->counters.ulLookupProbes += uProbes);
+    if(pNode != NULL && SymTable_isLive(oSymTable, pNode)){
+        SymTable_touch(oSymTable, pNode);
+        *(long*)(pNode + 1) += lDelta;
+        return 1;
+    }
+    return SymTable_putHandle(oSymTable, pcKey, &lDelta) != NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+int SymTable_removeValue(SymTable_T oSymTable, const char *pcKey,
+    void *pvOldValue){
+    struct SymTableNode **ppLink;
+    struct SymTableNode *pNode;
+    size_t uHash;
+    size_t uProbes = 0;
+    int iLive;
+
+    assert(oSymTable != NULL);
+    assert(oSymTable->uValueSize != 0);
+    assert(pcKey != NULL);
+
+    SYMTABLE_COUNT(oSymTable->counters.ulRemoves++);
+
+    uHash = SymTable_hashKey(pcKey);
+    pNode = SymTable_lookup(oSymTable, pcKey, uHash, &ppLink, &uProbes);
+    SYMTABLE_COUNT(oSymTable->counters.ulRemoveProbes += uProbes);
+    if(pNode == NULL){
+        return 0;
+    }
+    /* Scopes are never opened on an inline table. An expired binding
+       goes now, but was not bound. */
+    assert(SymTable_scopedOf(oSymTable, pNode) == NULL);
+    iLive = SymTable_isLive(oSymTable, pNode);
+    if(iLive && pvOldValue != NULL){
+        memcpy(pvOldValue, pNode + 1, oSymTable->uValueSize);
+    }
+    oSymTable->size--;
+    SymTable_chainUnlink(oSymTable, uHash % oSymTable->limit, ppLink,
+        pNode);
+    SymTable_freeNode(oSymTable, pNode);
+    return iLive;
+}
+
+/*--------------------------------------------------------------------*/
+
+void SymTable_free(SymTable_T oSymTable){
+    struct SymTableBucket *pCurrentBucket;
+    struct SymTableNode *pCurrentNode;
+    struct SymTableNode *pNextNode;
+    size_t counter;
+ 
+    assert(oSymTable != NULL);
+
+    if(oSymTable->pucMap != NULL){
+        munmap((void*)oSymTable->pucMap, oSymTable->uMapLength);
+        SymTable_release(oSymTable, oSymTable, sizeof(struct SymTable));
+        return;
+    }
+
+    counter = 0;
+    pCurrentBucket = oSymTable->pFirstBucket;
+    while(counter < oSymTable->limit){
+        /* Free the linked list associated with the bucket*/
+        if(pCurrentBucket->pFirstBucketNode != NULL){
+            for (pCurrentNode = pCurrentBucket->pFirstBucketNode;
+                pCurrentNode != NULL;
+                pCurrentNode = pNextNode)
+            {
+                pNextNode = pCurrentNode->pNextNode;
+                SymTable_freeNode(oSymTable, pCurrentNode);
+            }
+        }
+        pCurrentBucket++;
+        counter++;
+    }
+    /* The last node of each slab freed it */
+    assert(oSymTable->uSlabs == 0);
+
+    /* Free the chain trees, then the buckets */
+    SymTable_dropTrees(oSymTable);
+    SymTable_release(oSymTable, oSymTable->pFirstBucket,
+        oSymTable->limit * sizeof(struct SymTableBucket));
+
+    /* Free the undo log */
+    if(oSymTable->ppUndoLog != NULL){
+        SymTable_release(oSymTable, oSymTable->ppUndoLog,
+            oSymTable->uUndoCapacity * sizeof(struct SymTableNode*));
+    }
+    if(oSymTable->puScopeStarts != NULL){
+        SymTable_release(oSymTable, oSymTable->puScopeStarts,
+            oSymTable->uScopeCapacity * sizeof(size_t));
+    }
+    if(oSymTable->ppWheel != NULL){
+        SymTable_release(oSymTable, oSymTable->ppWheel,
+            WHEEL_LEVELS * WHEEL_SLOTS * sizeof(struct SymTableTimer*));
+    }
+
+    /* Freeing the nodes emptied the side indexes */
+    SymTable_sideTrim(oSymTable, &oSymTable->timers);
+    SymTable_sideTrim(oSymTable, &oSymTable->scoped);
+
+    /* Free table */
+    SymTable_release(oSymTable, oSymTable, sizeof(struct SymTable));
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t SymTable_memoryUsage(SymTable_T oSymTable){
+    assert(oSymTable != NULL);
+
+    return oSymTable->uBytes;
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t SymTable_getLength(SymTable_T oSymTable){
+    assert(oSymTable != NULL);
+    
+    return oSymTable->size;
+}
+
+/*--------------------------------------------------------------------*/
+
+int SymTable_put(SymTable_T oSymTable, const char *pcKey, 
+    const void *pvValue){
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    return SymTable_putHandle(oSymTable, pcKey, pvValue) != NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+SymTable_Handle SymTable_putHandle(SymTable_T oSymTable,
+    const char *pcKey, const void *pvValue){
+    char *pKey;
+    size_t bucketNumber;
+    size_t uHash;
+    size_t strLength;
+    size_t uLength = 0;
+    struct SymTableNode *pNewNode;
+    struct SymTableNode *pOldNode;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    /* A mapped snapshot is read-only */
+    if(oSymTable->pucMap != NULL){
+        return NULL;
+    }
+
+    SYMTABLE_COUNT(oSymTable->counters.ulPuts++);
+
+    /* Find position of the bucket assocaited with the hash */
+    uHash = SymTable_hashKey(pcKey);
+    pOldNode = SymTable_lookup(oSymTable, pcKey, uHash, NULL, &uLength);
+    SYMTABLE_COUNT(oSymTable->counters.ulPutProbes += uLength);
+    if(pOldNode != NULL){
+        /* An expired binding SymTable_expire has not removed yet is
+           bound again, without a deadline */
+        if(SymTable_sideFind(&oSymTable->timers, pOldNode) != NULL
+            && ! SymTable_isLive(oSymTable, pOldNode)){
+            SymTable_cancelTimer(oSymTable, pOldNode);
+            SymTable_setValue(oSymTable, pOldNode, pvValue);
+            if(oSymTable->uMaxBindings != 0){
+                *SymTable_referenced(oSymTable, pOldNode) = 0;
+            }
+            return pOldNode;
+        }
+        /* A key the table knows can only be bound again in a scope
+           inside the one it belongs to */
+        return SymTable_shadow(oSymTable, pOldNode, pvValue)
+            ? pOldNode : NULL;
+    }
+
+    pNewNode = (struct SymTableNode*)SymTable_alloc(oSymTable,
+        SymTable_nodeSize(oSymTable));
+    if(pNewNode == NULL){
+        return NULL;
+    }
+
+    /* Defensive copy */
+    strLength = strlen(pcKey) + 1;
+    pKey = (char*)SymTable_alloc(oSymTable, strLength * sizeof(char));
+    if(pKey == NULL){
+        SymTable_release(oSymTable, pNewNode,
+            SymTable_nodeSize(oSymTable));
+        return NULL;
+    }
+    strcpy(pKey, pcKey);
+
+    pNewNode->pKey = pKey;
+    pNewNode->uHash = uHash;
+    SymTable_setValue(oSymTable, pNewNode, pvValue);
+    pNewNode->pNextNode = NULL;
+    if(oSymTable->uMaxBindings != 0){
+        *SymTable_referenced(oSymTable, pNewNode) = 0;
+    }
+
+    /* A full bounded table makes room before the node goes in, so
+       that the new binding is never the one evicted */
+    if(oSymTable->uMaxBindings != 0
+        && oSymTable->size >= oSymTable->uMaxBindings){
+        SymTable_evict(oSymTable);
+    }
+
+    /* A binding made in an open scope goes in its undo log */
+    if(oSymTable->uDepth != 0){
+        if(! SymTable_makeScoped(oSymTable, pNewNode)
+            || ! SymTable_reserveUndo(oSymTable)){
+            SymTable_freeNode(oSymTable, pNewNode);
+            return NULL;
+        }
+        SymTable_logNode(oSymTable, pNewNode);
+    }
+
+    /* Add node to the start of the bucket's chain. A chain with no
+       tree that grows past the threshold gets one; uLength is its old
+       length, unless the eviction above shortened it */
+    bucketNumber = uHash % oSymTable->limit;
+    SymTable_chainInsert(oSymTable, bucketNumber, pNewNode);
+    oSymTable->size++;
+    if(uLength >= TREEIFY_THRESHOLD
+        && SymTable_treeOf(oSymTable, bucketNumber) == NULL){
+        SymTable_treeify(oSymTable, bucketNumber);
+    }
+
+    /* Resize if size exceeds limit, but only below maximum. If the 
+       buckets cannot grow, the binding is still in the table and the 
+       chains are just longer */
+    if(oSymTable->limit != buckets[sizeof(buckets)/sizeof(buckets[0]) - 1] && oSymTable->size > oSymTable->limit){
+        (void)SymTable_resize(oSymTable);
+    }
+
+
+    return pNewNode;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *SymTable_replace(SymTable_T oSymTable, const char *pcKey, 
+    const void *pvValue){
+    struct SymTableNode *pCurrentNode;
+    const void* pOldValue;
+    size_t uHash;
+    size_t uProbes = 0;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    /* An inline value has no old value to return apart from the new */
+    if(oSymTable->pucMap != NULL || oSymTable->uValueSize != 0){
+        return NULL;
+    }
+
+    SYMTABLE_COUNT(oSymTable->counters.ulLookups++);
+
+    uHash = SymTable_hashKey(pcKey);
+    pCurrentNode = SymTable_lookup(oSymTable, pcKey, uHash, NULL,
+        &uProbes);
+    SYMTABLE_COUNT(oSymTable->counters.ulLookupProbes += uProbes);
+    if(pCurrentNode == NULL || ! SymTable_isLive(oSymTable, pCurrentNode)){
+        return NULL;
+    }
+    SymTable_touch(oSymTable, pCurrentNode);
+    pOldValue = pCurrentNode->pValue;
+    SymTable_setValue(oSymTable, pCurrentNode, pvValue);
+    return (void*) pOldValue;
+}
+
+/*--------------------------------------------------------------------*/
+
+int SymTable_contains(SymTable_T oSymTable, const char *pcKey){
+    struct SymTableNode *pCurrentNode;
+    size_t uHash;
+    size_t uProbes = 0;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    SYMTABLE_COUNT(oSymTable->counters.ulLookups++);
+
+    if(oSymTable->pucMap != NULL){
+        return SymTable_findRecord(oSymTable, pcKey,
+            SymTable_hashKey(pcKey)) != NULL;
+    }
+
+    uHash = SymTable_hashKey(pcKey);
+    pCurrentNode = SymTable_lookup(oSymTable, pcKey, uHash, NULL,
+        &uProbes);
+    SYMTABLE_COUNT(oSymTable->counters.ulLookupProbes += uProbes);
+    if(pCurrentNode == NULL || ! SymTable_isLive(oSymTable, pCurrentNode)){
+        return 0;
+    }
+    SymTable_touch(oSymTable, pCurrentNode);
+    return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *SymTable_get(SymTable_T oSymTable, const char *pcKey){
+    struct SymTableNode *pCurrentNode;
+    const struct SnapshotRecord *pRecord;
+    size_t uHash;
+    size_t uProbes = 0;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    SYMTABLE_COUNT(oSymTable->counters.ulLookups++);
+
+    if(oSymTable->pucMap != NULL){
+        pRecord = SymTable_findRecord(oSymTable, pcKey,
+            SymTable_hashKey(pcKey));
+        if(pRecord == NULL){
+            return NULL;
+        }
+        return SymTable_recordValue(pRecord);
+    }
+
+    uHash = SymTable_hashKey(pcKey);
+    pCurrentNode = SymTable_lookup(oSymTable, pcKey, uHash, NULL,
+        &uProbes);
+    SYMTABLE_COUNT(oSymTable->counters.ulLookupProbes += uProbes);
+    if(pCurrentNode == NULL || ! SymTable_isLive(oSymTable, pCurrentNode)){
+        return NULL;
+    }
+    SymTable_touch(oSymTable, pCurrentNode);
+    return (void*)(pCurrentNode->pValue);
+}
+
+/*--------------------------------------------------------------------*/
+
+void *SymTable_remove(SymTable_T oSymTable, const char *pcKey){
+    struct SymTableNode **ppLink;
+    struct SymTableNode *pCurrentNode;
+    size_t uHash;
+    size_t uProbes = 0;
+    const void* pOldValue;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    /* An inline value goes with its node; SymTable_removeValue copies
+       it out first */
+    if(oSymTable->pucMap != NULL || oSymTable->uValueSize != 0){
+        return NULL;
+    }
+
+    SYMTABLE_COUNT(oSymTable->counters.ulRemoves++);
+
+    uHash = SymTable_hashKey(pcKey);
+    pCurrentNode = SymTable_lookup(oSymTable, pcKey, uHash, &ppLink,
+        &uProbes);
+    SYMTABLE_COUNT(oSymTable->counters.ulRemoveProbes += uProbes);
+    if(pCurrentNode == NULL || ! SymTable_isBound(oSymTable, pCurrentNode)){
+        return NULL;
+    }
+    /* An expired binding goes now, but was not bound */
+    pOldValue = SymTable_isLive(oSymTable, pCurrentNode)
+        ? pCurrentNode->pValue : NULL;
+    oSymTable->size--;
+
+    /* A scoped binding may reveal the one it shadows, and its node
+       stays while the undo log names it */
+    if(SymTable_scopedOf(oSymTable, pCurrentNode) != NULL){
+        SymTable_unbind(oSymTable, pCurrentNode);
+        return (void*) pOldValue;
+    }
+    SymTable_chainUnlink(oSymTable, uHash % oSymTable->limit, ppLink,
+        pCurrentNode);
+    SymTable_freeNode(oSymTable, pCurrentNode);
+    return (void*) pOldValue;
+}
+
+/*--------------------------------------------------------------------*/
+
+void SymTable_map(SymTable_T oSymTable, void (*pfApply)
+    (const char *pcKey, void *pvValue, void *pvExtra), 
+    const void *pvExtra){
+    struct SymTableNode *pCurrentNode;
+    struct SymTableNode *pNextNode;
+    struct SymTableBucket *pCurrentBucket;
+    const struct SnapshotRecord *pRecord;
+    size_t uOffset;
+    size_t counter;
+
+    assert(oSymTable != NULL);
+    assert(pfApply != NULL);
+
+    /* Records of a mapped snapshot are stored one after another */
+    if(oSymTable->pucMap != NULL){
+        uOffset = sizeof(struct SnapshotHeader)
+            + oSymTable->limit * sizeof(uint64_t);
+        for(counter = 0; counter < oSymTable->size; counter++){
+            pRecord = SymTable_recordAt(oSymTable, uOffset);
+            if(pRecord == NULL){
+                return;
+            }
+            (*pfApply)(SymTable_recordKey(pRecord),
+                SymTable_recordValue(pRecord), (void*) pvExtra);
+            uOffset += SymTable_recordSize(pRecord);
+        }
+        return;
+    }
+
+    pCurrentBucket = oSymTable->pFirstBucket;
+    counter = 0;
+    while(counter < oSymTable->limit){
+        /* Free the linked list associated with the bucket*/
+        if(pCurrentBucket->pFirstBucketNode != NULL){
+            for (pCurrentNode = pCurrentBucket->pFirstBucketNode;
+                pCurrentNode != NULL;
+                pCurrentNode = pNextNode)
+            {
+                pNextNode = pCurrentNode->pNextNode;
+                if(SymTable_isLive(oSymTable, pCurrentNode)){
+                    (*pfApply)(pCurrentNode->pKey,
+                        (void*)pCurrentNode->pValue, (void*) pvExtra);
+                }
+            }
+        }
+        counter++;
+        pCurrentBucket++;
+    }
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t SymTable_removeIf(SymTable_T oSymTable, int (*pfPredicate)
+    (const char *pcKey, void *pvValue, void *pvExtra),
+    const void *pvExtra, void (*pfRemoved)
+    (const char *pcKey, void *pvValue, void *pvExtra)){
+    struct SymTableNode **ppLink;
+    struct SymTableNode *pCurrentNode;
+    size_t uRemoved = 0;
+    size_t counter;
+
+    assert(oSymTable != NULL);
+    assert(pfPredicate != NULL);
+
+    /* A mapped snapshot is read-only */
+    if(oSymTable->pucMap != NULL){
+        return 0;
+    }
+
+    for(counter = 0; counter < oSymTable->limit; counter++){
+        ppLink = &oSymTable->pFirstBucket[counter].pFirstBucketNode;
+        while((pCurrentNode = *ppLink) != NULL){
+            /* An expired binding is left for SymTable_expire */
+            if(! SymTable_isLive(oSymTable, pCurrentNode)
+                || ! (*pfPredicate)(pCurrentNode->pKey,
+                    (void*)pCurrentNode->pValue, (void*) pvExtra)){
+                ppLink = &pCurrentNode->pNextNode;
+                continue;
+            }
+            uRemoved++;
+            oSymTable->size--;
+            if(pfRemoved != NULL){
+                (*pfRemoved)(pCurrentNode->pKey,
+                    (void*)pCurrentNode->pValue, (void*) pvExtra);
+            }
+
+            /* A scoped binding may reveal the one it shadows, and its
+               node stays while the undo log names it; either way the
+               chain goes on after it */
+            if(SymTable_scopedOf(oSymTable, pCurrentNode) != NULL){
+                SymTable_unbind(oSymTable, pCurrentNode);
+                if(*ppLink == pCurrentNode){
+                    ppLink = &pCurrentNode->pNextNode;
+                }
+                continue;
+            }
+            SymTable_chainUnlink(oSymTable, counter, ppLink,
+                pCurrentNode);
+            SymTable_freeNode(oSymTable, pCurrentNode);
+        }
+    }
+
+    if(uRemoved != 0){
+        SymTable_shrink(oSymTable);
+    }
+    return uRemoved;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* The bindings of a table gathered by SymTable_collect */
+struct SymTableEntries{
+    /* Keys of the bindings */
+    const char **ppcKeys;
+
+    /* Values of the bindings, in the same order as ppcKeys */
+    const void **ppvValues;
+
+    /* Number of bindings gathered so far */
+    size_t uCount;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Append the binding pcKey, pvValue to the SymTableEntries pvExtra. */
+
+static void SymTable_collect(const char *pcKey, void *pvValue,
+    void *pvExtra)
+{
+    struct SymTableEntries *pEntries = (struct SymTableEntries*)pvExtra;
+
+    assert(pcKey != NULL);
+    assert(pvExtra != NULL);
+
+    pEntries->ppcKeys[pEntries->uCount] = pcKey;
+    pEntries->ppvValues[pEntries->uCount] = pvValue;
+    pEntries->uCount++;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Write the uLength bytes at pvBytes to psFile followed by zeros up to
+   a multiple of 8 bytes. Returns 1 for success, 0 for failure. */
+
+static int SymTable_writePadded(FILE *psFile, const void *pvBytes,
+    size_t uLength)
+{
+    static const unsigned char aucZeros[8] = {0};
+    size_t uPadding;
+
+    assert(psFile != NULL);
+
+    uPadding = SymTable_pad8(uLength) - uLength;
+    if(uLength != 0 && fwrite(pvBytes, 1, uLength, psFile) != uLength){
+        return 0;
+    }
+    if(uPadding != 0
+        && fwrite(aucZeros, 1, uPadding, psFile) != uPadding){
+        return 0;
+    }
+    return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+int SymTable_save(SymTable_T oSymTable, const char *pcPath,
+    SymTable_ValueSerializer pfSerialize){
+    struct SymTableEntries entries;
+    struct SnapshotHeader header;
+    struct SnapshotRecord record;
+    const void **ppvBytes = NULL;
+    size_t *puLengths = NULL;
+    size_t *puHashes = NULL;
+    size_t *puOrder = NULL;
+    size_t *puStart = NULL;
+    uint64_t *puBucketOffsets = NULL;
+    uint64_t uOffset;
+    size_t uBucketCount;
+    size_t uCount;
+    size_t u;
+    size_t i;
+    int success = 0;
+    FILE *psFile = NULL;
+
+    assert(oSymTable != NULL);
+    assert(pcPath != NULL);
+
+    uCount = oSymTable->size;
+    /* One bucket per binding keeps chains short without resizing */
+    uBucketCount = uCount | 1;
+
+    entries.ppcKeys = malloc((uCount + 1) * sizeof(const char*));
+    entries.ppvValues = malloc((uCount + 1) * sizeof(const void*));
+    entries.uCount = 0;
+    ppvBytes = malloc((uCount + 1) * sizeof(const void*));
+    puLengths = malloc((uCount + 1) * sizeof(size_t));
+    puHashes = malloc((uCount + 1) * sizeof(size_t));
+    puOrder = malloc((uCount + 1) * sizeof(size_t));
+    puStart = calloc(uBucketCount + 1, sizeof(size_t));
+    puBucketOffsets = calloc(uBucketCount, sizeof(uint64_t));
+    if(entries.ppcKeys == NULL || entries.ppvValues == NULL
+        || ppvBytes == NULL || puLengths == NULL || puHashes == NULL
+        || puOrder == NULL || puStart == NULL
+        || puBucketOffsets == NULL){
+        goto cleanup;
+    }
+
+    /* Expired bindings that SymTable_expire has not removed yet are
+       left out */
+    SymTable_map(oSymTable, SymTable_collect, &entries);
+    uCount = entries.uCount;
+
+    /* Serialize the values and sort the bindings by bucket, so that 
+       each chain is stored contiguously */
+    for(i = 0; i < uCount; i++){
+        puHashes[i] = SymTable_hashKey(entries.ppcKeys[i]);
+        puStart[puHashes[i] % uBucketCount + 1]++;
+        ppvBytes[i] = NULL;
+        puLengths[i] = 0;
+        if(pfSerialize != NULL){
+            puLengths[i] = (*pfSerialize)(entries.ppvValues[i],
+                &ppvBytes[i]);
+        }
+    }
+    for(u = 0; u < uBucketCount; u++){
+        puStart[u + 1] += puStart[u];
+    }
+    for(i = 0; i < uCount; i++){
+        puOrder[puStart[puHashes[i] % uBucketCount]++] = i;
+    }
+
+    /* Lay out the records and link each bucket's chain */
+    uOffset = sizeof(struct SnapshotHeader)
+        + uBucketCount * sizeof(uint64_t);
+    for(u = 0; u < uCount; u++){
+        i = puOrder[u];
+        if(puBucketOffsets[puHashes[i] % uBucketCount] == 0){
+            puBucketOffsets[puHashes[i] % uBucketCount] = uOffset;
+        }
+        uOffset += sizeof(struct SnapshotRecord)
+            + SymTable_pad8(strlen(entries.ppcKeys[i]) + 1)
+            + SymTable_pad8(puLengths[i]);
+    }
+
+    memcpy(header.acMagic, SNAPSHOT_MAGIC, sizeof(header.acMagic));
+    header.uCount = uCount;
+    header.uBucketCount = uBucketCount;
+    header.uLength = uOffset;
+
+    psFile = fopen(pcPath, "wb");
+    if(psFile == NULL){
+        goto cleanup;
+    }
+    if(fwrite(&header, sizeof(header), 1, psFile) != 1
+        || fwrite(puBucketOffsets, sizeof(uint64_t), uBucketCount,
+            psFile) != uBucketCount){
+        goto cleanup;
+    }
+
+    uOffset = sizeof(struct SnapshotHeader)
+        + uBucketCount * sizeof(uint64_t);
+    for(u = 0; u < uCount; u++){
+        i = puOrder[u];
+        record.uHash = puHashes[i];
+        record.uKeyLength = strlen(entries.ppcKeys[i]);
+        record.uValueLength = puLengths[i];
+        uOffset += SymTable_recordSize(&record);
+        record.uNext = 0;
+        if(u + 1 < uCount && puHashes[puOrder[u + 1]] % uBucketCount
+            == puHashes[i] % uBucketCount){
+            record.uNext = uOffset;
+        }
+        if(fwrite(&record, sizeof(record), 1, psFile) != 1
+            || !SymTable_writePadded(psFile, entries.ppcKeys[i],
+                (size_t)record.uKeyLength + 1)
+            || !SymTable_writePadded(psFile, ppvBytes[i], puLengths[i])){
+            goto cleanup;
+        }
+    }
+    /* The snapshot must be on disk before it replaces anything */
+    if(fflush(psFile) == 0 && fsync(fileno(psFile)) == 0){
+        success = 1;
+    }
+
+cleanup:
+    if(psFile != NULL && fclose(psFile) != 0){
+        success = 0;
+    }
+    if(psFile != NULL && !success){
+        remove(pcPath);
+    }
+    free(entries.ppcKeys);
+    free(entries.ppvValues);
+    free(ppvBytes);
+    free(puLengths);
+    free(puHashes);
+    free(puOrder);
+    free(puStart);
+    free(puBucketOffsets);
+    return success;
+}
+
+/*--------------------------------------------------------------------*/
+
+SymTable_T SymTable_openMapped(const char *pcPath){
+    SymTable_T oSymTable;
+    const struct SnapshotHeader *pHeader;
+    struct stat sStat;
+    void *pvMap;
+    size_t uLength;
+    int iFd;
+
+    assert(pcPath != NULL);
+
+    iFd = open(pcPath, O_RDONLY);
+    if(iFd < 0){
+        return NULL;
+    }
+    if(fstat(iFd, &sStat) != 0
+        || (size_t)sStat.st_size < sizeof(struct SnapshotHeader)){
+        close(iFd);
+        return NULL;
+    }
+    uLength = (size_t)sStat.st_size;
+
+    /* The mapping stays valid after the descriptor is closed */
+    pvMap = mmap(NULL, uLength, PROT_READ, MAP_PRIVATE, iFd, 0);
+    close(iFd);
+    if(pvMap == MAP_FAILED){
+        return NULL;
+    }
+
+    pHeader = (const struct SnapshotHeader*)pvMap;
+    if(memcmp(pHeader->acMagic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC))
+        != 0 || pHeader->uLength != uLength || pHeader->uBucketCount == 0
+        || pHeader->uBucketCount > (uLength - sizeof(*pHeader))
+            / sizeof(uint64_t)
+        || pHeader->uCount > (uLength - sizeof(*pHeader)
+            - (size_t)pHeader->uBucketCount * sizeof(uint64_t))
+            / sizeof(struct SnapshotRecord)){
+        munmap(pvMap, uLength);
+        return NULL;
+    }
+
+    oSymTable = (SymTable_T)SymTable_defaultAlloc(sizeof(struct SymTable),
+        NULL);
+    if(oSymTable == NULL){
+        munmap(pvMap, uLength);
+        return NULL;
+    }
+    oSymTable->allocator = defaultAllocator;
+    oSymTable->uBytes = sizeof(struct SymTable);
+    oSymTable->pFirstBucket = NULL;
+    oSymTable->size = (size_t)pHeader->uCount;
+    oSymTable->limit = (size_t)pHeader->uBucketCount;
+    oSymTable->pucMap = (const unsigned char*)pvMap;
+    oSymTable->uMapLength = uLength;
+    oSymTable->ppUndoLog = NULL;
+    oSymTable->uUndoLength = 0;
+    oSymTable->uUndoCapacity = 0;
+    oSymTable->puScopeStarts = NULL;
+    oSymTable->uDepth = 0;
+    oSymTable->uScopeCapacity = 0;
+    oSymTable->uMaxBindings = 0;
+    oSymTable->pfEvict = NULL;
+    oSymTable->pvEvictExtra = NULL;
+    oSymTable->uHand = 0;
+    oSymTable->ppWheel = NULL;
+    oSymTable->uWheelTime = 0;
+    oSymTable->uClock = 0;
+    oSymTable->timers = emptySideIndex;
+    oSymTable->scoped = emptySideIndex;
+    oSymTable->ppTrees = NULL;
+    oSymTable->uTrees = 0;
+    oSymTable->uValueSize = 0;
+    oSymTable->ppSlabs = NULL;
+    oSymTable->uSlabs = 0;
+    oSymTable->uSlabCapacity = 0;
+    oSymTable->uCompactNext = 0;
+#ifdef SYMTABLE_STATS
+    memset(&oSymTable->counters, 0, sizeof(oSymTable->counters));
+#endif
+    return oSymTable;
+}
+
+/*--------------------------------------------------------------------*/
+
+int SymTable_reserve(SymTable_T oSymTable, size_t uCount){
+    size_t index;
+
+    assert(oSymTable != NULL);
+
+    if(oSymTable->pucMap != NULL){
+        return 0;
+    }
+
+    /* Smallest bucket count that holds uCount bindings, or the max */
+    index = 0;
+    while(index < sizeof(buckets)/sizeof(buckets[0]) - 1
+        && buckets[index] < uCount){
+        index++;
+    }
+    if(buckets[index] <= oSymTable->limit){
+        return 1;
+    }
+    return SymTable_rehash(oSymTable, buckets[index]);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Most threads SymTable_buildParallel uses */
+enum {MAX_BUILD_THREADS = 64};
+
+/* The share of one thread of SymTable_buildParallel. The buckets of
+   the table are cut into as many ranges as there are threads, and
+   each thread links the bindings of one range, so no two threads ever
+   touch the same chain. */
+struct SymTableBuilder{
+    /* Table being built */
+    SymTable_T oSymTable;
+
+    /* Keys and values given to SymTable_buildParallel */
+    const char *const *ppcKeys;
+    const void *const *ppvValues;
+
+    /* Full hash code of each key */
+    size_t *puHashes;
+
+    /* Indices of the keys, grouped by the range of their bucket and in
+       the order given within each range */
+    size_t *puOrder;
+
+    /* Keys uFirst to uLast-1 are hashed and placed by this thread */
+    size_t uFirst;
+    size_t uLast;
+
+    /* Number of threads, which is the number of ranges */
+    size_t uThreads;
+
+    /* auPlaces[r] is first the number of this thread's keys whose
+       bucket is in range r, then where the next of them goes in
+       puOrder */
+    size_t auPlaces[MAX_BUILD_THREADS];
+
+    /* Entries uOrderFirst to uOrderLast-1 of puOrder are the keys
+       this thread links, those of the range numbered as the thread */
+    size_t uOrderFirst;
+    size_t uOrderLast;
+
+    /* Number of bindings linked and bytes allocated for them, added to
+       the table once every thread is done */
+    size_t uLinked;
+    size_t uBytes;
+
+    /* Keys this thread linked after the first TREEIFY_THRESHOLD nodes
+       of a chain, as an open addressing table of uSeenMask+1 slots
+       holding key indices plus 1, or 0 for an empty slot; NULL while
+       there are none */
+    size_t *puSeen;
+    size_t uSeenMask;
+    size_t uSeen;
+
+    /* 1 if a chain grew longer than TREEIFY_THRESHOLD */
+    int iLongChain;
+
+    /* 1 if there was not enough memory available */
+    int iFailed;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Return the range of bucket uBucket when the buckets of oSymTable
+   are cut into uThreads ranges. */
+
+static size_t SymTable_rangeOf(SymTable_T oSymTable, size_t uBucket,
+    size_t uThreads)
+{
+    assert(oSymTable != NULL);
+
+    return (size_t)((uint64_t)uBucket * uThreads / oSymTable->limit);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* First pass of SymTable_buildParallel: hash the keys of the
+   SymTableBuilder pvBuilder and count them by range. */
+
+static void *SymTable_buildHash(void *pvBuilder)
+{
+    struct SymTableBuilder *pBuilder = (struct SymTableBuilder*)pvBuilder;
+    size_t uHash;
+    size_t counter;
+
+    assert(pBuilder != NULL);
+
+    for(counter = pBuilder->uFirst; counter < pBuilder->uLast; counter++){
+        assert(pBuilder->ppcKeys[counter] != NULL);
+        uHash = SymTable_hashKey(pBuilder->ppcKeys[counter]);
+        pBuilder->puHashes[counter] = uHash;
+        pBuilder->auPlaces[SymTable_rangeOf(pBuilder->oSymTable,
+            uHash % pBuilder->oSymTable->limit, pBuilder->uThreads)]++;
+    }
+    return NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Second pass of SymTable_buildParallel: place the keys of the
+   SymTableBuilder pvBuilder in puOrder. */
+
+static void *SymTable_buildScatter(void *pvBuilder)
+{
+    struct SymTableBuilder *pBuilder = (struct SymTableBuilder*)pvBuilder;
+    size_t uRange;
+    size_t counter;
+
+    assert(pBuilder != NULL);
+
+    for(counter = pBuilder->uFirst; counter < pBuilder->uLast; counter++){
+        uRange = SymTable_rangeOf(pBuilder->oSymTable,
+            pBuilder->puHashes[counter] % pBuilder->oSymTable->limit,
+            pBuilder->uThreads);
+        pBuilder->puOrder[pBuilder->auPlaces[uRange]++] = counter;
+    }
+    return NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the slot of the seen table of the SymTableBuilder pBuilder
+   that holds a key equal to key uIndex, or the empty slot where the
+   search for it ends. */
+
+static size_t SymTable_buildSlot(const struct SymTableBuilder *pBuilder,
+    size_t uIndex)
+{
+    size_t uHash;
+    size_t uSlot;
+    size_t uOther;
+
+    assert(pBuilder != NULL);
+    assert(pBuilder->puSeen != NULL);
+
+    uHash = pBuilder->puHashes[uIndex];
+    uSlot = (size_t)(((uint64_t)uHash * UINT64_C(0x9e3779b97f4a7c15))
+        >> 32) & pBuilder->uSeenMask;
+    while(pBuilder->puSeen[uSlot] != 0){
+        uOther = pBuilder->puSeen[uSlot] - 1;
+        if(pBuilder->puHashes[uOther] == uHash
+            && strcmp(pBuilder->ppcKeys[uOther],
+                pBuilder->ppcKeys[uIndex]) == 0){
+            break;
+        }
+        uSlot = (uSlot + 1) & pBuilder->uSeenMask;
+    }
+    return uSlot;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Put key uIndex of the SymTableBuilder pBuilder, which is not there,
+   in its seen table, growing the table to stay at most half full.
+   Returns 1 for success or 0 for failure. */
+
+static int SymTable_buildRemember(struct SymTableBuilder *pBuilder,
+    size_t uIndex)
+{
+    size_t *puOld;
+    size_t uOldMask;
+    size_t counter;
+
+    assert(pBuilder != NULL);
+
+    if(2 * (pBuilder->uSeen + 1) > pBuilder->uSeenMask + 1){
+        puOld = pBuilder->puSeen;
+        uOldMask = pBuilder->uSeenMask;
+        pBuilder->uSeenMask = (puOld == NULL) ? 15 : 2 * uOldMask + 1;
+        pBuilder->puSeen = (size_t*)calloc(pBuilder->uSeenMask + 1,
+            sizeof(size_t));
+        if(pBuilder->puSeen == NULL){
+            pBuilder->puSeen = puOld;
+            pBuilder->uSeenMask = uOldMask;
+            return 0;
+        }
+        for(counter = 0; puOld != NULL && counter <= uOldMask;
+            counter++){
+            if(puOld[counter] != 0){
+                pBuilder->puSeen[SymTable_buildSlot(pBuilder,
+                    puOld[counter] - 1)] = puOld[counter];
+            }
+        }
+        free(puOld);
+    }
+    pBuilder->puSeen[SymTable_buildSlot(pBuilder, uIndex)] = uIndex + 1;
+    pBuilder->uSeen++;
+    return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Last pass of SymTable_buildParallel: link a node for each key of
+   the range of the SymTableBuilder pvBuilder, skipping keys given
+   earlier. The first TREEIFY_THRESHOLD nodes of a chain are searched
+   in place. A node linked after them goes in the builder's seen table
+   instead of the chain's head, so that a long chain is never searched
+   and colliding keys do not take quadratic time. Allocates without
+   SymTable_alloc, whose byte count the threads share. */
+
+static void *SymTable_buildLink(void *pvBuilder)
+{
+    struct SymTableBuilder *pBuilder = (struct SymTableBuilder*)pvBuilder;
+    SymTable_T oSymTable;
+    struct SymTableNode **ppLink;
+    struct SymTableNode *pNode;
+    const char *pcKey;
+    char *pKey;
+    size_t uLength;
+    size_t uKeyBytes;
+    size_t uHash;
+    size_t uIndex;
+    size_t counter;
+
+    assert(pBuilder != NULL);
+
+    oSymTable = pBuilder->oSymTable;
+    for(counter = pBuilder->uOrderFirst; counter < pBuilder->uOrderLast;
+        counter++){
+        uIndex = pBuilder->puOrder[counter];
+        pcKey = pBuilder->ppcKeys[uIndex];
+        uHash = pBuilder->puHashes[uIndex];
+
+        /* The new node goes right after the first TREEIFY_THRESHOLD
+           nodes, or at the end of a shorter chain */
+        uLength = 0;
+        for(ppLink = &oSymTable->pFirstBucket[uHash % oSymTable->limit]
+            .pFirstBucketNode; *ppLink != NULL
+            && uLength < TREEIFY_THRESHOLD;
+            ppLink = &(*ppLink)->pNextNode){
+            if((*ppLink)->uHash == uHash
+                && strcmp((*ppLink)->pKey, pcKey) == 0){
+                break;
+            }
+            uLength++;
+        }
+        if(*ppLink != NULL && uLength < TREEIFY_THRESHOLD){
+            continue;
+        }
+        if(uLength == TREEIFY_THRESHOLD){
+            if(pBuilder->puSeen != NULL && pBuilder->puSeen[
+                SymTable_buildSlot(pBuilder, uIndex)] != 0){
+                continue;
+            }
+            if(! SymTable_buildRemember(pBuilder, uIndex)){
+                pBuilder->iFailed = 1;
+                break;
+            }
+            pBuilder->iLongChain = 1;
+        }
+
+        pNode = (struct SymTableNode*)(*oSymTable->allocator.pfAlloc)(
+            sizeof(struct SymTableNode), oSymTable->allocator.pvContext);
+        if(pNode == NULL){
+            pBuilder->iFailed = 1;
+            break;
+        }
+        uKeyBytes = strlen(pcKey) + 1;
+        pKey = (char*)(*oSymTable->allocator.pfAlloc)(uKeyBytes,
+            oSymTable->allocator.pvContext);
+        if(pKey == NULL){
+            (*oSymTable->allocator.pfFree)(pNode,
+                sizeof(struct SymTableNode), oSymTable->allocator.pvContext);
+            pBuilder->iFailed = 1;
+            break;
+        }
+        memcpy(pKey, pcKey, uKeyBytes);
+
+        pNode->pKey = pKey;
+        pNode->uHash = uHash;
+        pNode->pValue = pBuilder->ppvValues[uIndex];
+        pNode->pNextNode = *ppLink;
+        *ppLink = pNode;
+
+        pBuilder->uLinked++;
+        pBuilder->uBytes += sizeof(struct SymTableNode) + uKeyBytes;
+    }
+    free(pBuilder->puSeen);
+    pBuilder->puSeen = NULL;
+    return NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Run pfPass on each of the uThreads SymTableBuilders pBuilders at
+   once, and return when all are done. The calling thread takes the
+   first; a builder whose thread cannot be started is run by the
+   calling thread too. */
+
+static void SymTable_runBuilders(struct SymTableBuilder *pBuilders,
+    size_t uThreads, void *(*pfPass)(void *pvBuilder))
+{
+    pthread_t aThreads[MAX_BUILD_THREADS];
+    int aiStarted[MAX_BUILD_THREADS];
+    size_t counter;
+
+    assert(pBuilders != NULL);
+    assert(uThreads >= 1 && uThreads <= MAX_BUILD_THREADS);
+    assert(pfPass != NULL);
+
+    for(counter = 1; counter < uThreads; counter++){
+        aiStarted[counter] = pthread_create(&aThreads[counter], NULL,
+            pfPass, &pBuilders[counter]) == 0;
+    }
+    (void)(*pfPass)(&pBuilders[0]);
+    for(counter = 1; counter < uThreads; counter++){
+        if(aiStarted[counter]){
+            (void)pthread_join(aThreads[counter], NULL);
+        }
+        else{
+            (void)(*pfPass)(&pBuilders[counter]);
+        }
+    }
+}
+
+/*--------------------------------------------------------------------*/
+
+SymTable_T SymTable_buildParallel(const char *const *ppcKeys,
+    const void *const *ppvValues, size_t uCount, size_t uThreads){
+    SymTable_T oSymTable;
+    struct SymTableBuilder *pBuilders;
+    size_t *puHashes;
+    size_t *puOrder;
+    size_t uOffset;
+    size_t uPlaced;
+    size_t uRange;
+    size_t counter;
+    int iLongChain = 0;
+    int iFailed = 0;
+
+    assert(ppcKeys != NULL || uCount == 0);
+    assert(ppvValues != NULL || uCount == 0);
+
+    oSymTable = SymTable_new();
+    if(oSymTable == NULL){
+        return NULL;
+    }
+    if(! SymTable_reserve(oSymTable, uCount)){
+        SymTable_free(oSymTable);
+        return NULL;
+    }
+    if(uCount == 0){
+        return oSymTable;
+    }
+
+    if(uThreads == 0){
+        uThreads = 1;
+    }
+    if(uThreads > MAX_BUILD_THREADS){
+        uThreads = MAX_BUILD_THREADS;
+    }
+    if(uThreads > uCount){
+        uThreads = uCount;
+    }
+
+    pBuilders = (struct SymTableBuilder*)calloc(uThreads,
+        sizeof(struct SymTableBuilder));
+    puHashes = (size_t*)malloc(uCount * sizeof(size_t));
+    puOrder = (size_t*)malloc(uCount * sizeof(size_t));
+    if(pBuilders == NULL || puHashes == NULL || puOrder == NULL){
+        free(pBuilders);
+        free(puHashes);
+        free(puOrder);
+        SymTable_free(oSymTable);
+        return NULL;
+    }
+
+    for(counter = 0; counter < uThreads; counter++){
+        pBuilders[counter].oSymTable = oSymTable;
+        pBuilders[counter].ppcKeys = ppcKeys;
+        pBuilders[counter].ppvValues = ppvValues;
+        pBuilders[counter].puHashes = puHashes;
+        pBuilders[counter].puOrder = puOrder;
+        pBuilders[counter].uFirst =
+            (size_t)((uint64_t)uCount * counter / uThreads);
+        pBuilders[counter].uLast =
+            (size_t)((uint64_t)uCount * (counter + 1) / uThreads);
+        pBuilders[counter].uThreads = uThreads;
+    }
+    SymTable_runBuilders(pBuilders, uThreads, SymTable_buildHash);
+
+    /* Range by range, and within a range thread by thread, so that
+       each range keeps the keys in the order given and the first of
+       any duplicates is the one bound */
+    uOffset = 0;
+    for(uRange = 0; uRange < uThreads; uRange++){
+        pBuilders[uRange].uOrderFirst = uOffset;
+        for(counter = 0; counter < uThreads; counter++){
+            uPlaced = pBuilders[counter].auPlaces[uRange];
+            pBuilders[counter].auPlaces[uRange] = uOffset;
+            uOffset += uPlaced;
+        }
+        pBuilders[uRange].uOrderLast = uOffset;
+    }
+    assert(uOffset == uCount);
+    SymTable_runBuilders(pBuilders, uThreads, SymTable_buildScatter);
+    SymTable_runBuilders(pBuilders, uThreads, SymTable_buildLink);
+
+    for(counter = 0; counter < uThreads; counter++){
+        oSymTable->size += pBuilders[counter].uLinked;
+        oSymTable->uBytes += pBuilders[counter].uBytes;
+        iLongChain |= pBuilders[counter].iLongChain;
+        iFailed |= pBuilders[counter].iFailed;
+    }
+    free(pBuilders);
+    free(puHashes);
+    free(puOrder);
+
+    if(iFailed){
+        SymTable_free(oSymTable);
+        return NULL;
+    }
+    if(iLongChain){
+        SymTable_treeifyLong(oSymTable);
+    }
+    return oSymTable;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Move the nodes of buckets uFirst to uLast-1 of oSymTable, which
+   owns its nodes, and their keys into one new slab, chain after
+   chain, each node followed by its key, and free their old blocks.
+   The trees of the buckets are built again over the moved nodes.
+   Returns 1 for success or 0 if there is not enough memory available,
+   in which case nothing changes. */
+
+static int SymTable_compactRange(SymTable_T oSymTable, size_t uFirst,
+    size_t uLast)
+{
+    struct SymTableSlab **ppNewSlabs;
+    struct SymTableSlab *pSlab;
+    struct SymTableNode **ppLink;
+    struct SymTableNode *pNode;
+    struct SymTableNode *pNewNode;
+    struct SymTableTimer *pTimer;
+    unsigned char *pucNext;
+    size_t uNodeBytes;
+    size_t uKeyBytes;
+    size_t uSize;
+    size_t uCount;
+    size_t uCapacity;
+    size_t uIndex;
+    size_t counter;
+    int iHadTree;
+
+    assert(oSymTable != NULL);
+    assert(oSymTable->pucMap == NULL);
+    /* Scope states only live while a scope is open */
+    assert(oSymTable->scoped.uCount == 0);
+    assert(uFirst <= uLast && uLast <= oSymTable->limit);
+
+    /* Every node and key starts on a multiple of 8 bytes, as they
+       would from malloc */
+    uNodeBytes = SymTable_pad8(SymTable_nodeSize(oSymTable));
+    uSize = SymTable_pad8(sizeof(struct SymTableSlab));
+    uCount = 0;
+    for(counter = uFirst; counter < uLast; counter++){
+        for(pNode = oSymTable->pFirstBucket[counter].pFirstBucketNode;
+            pNode != NULL; pNode = pNode->pNextNode){
+            uSize += uNodeBytes + SymTable_pad8(strlen(pNode->pKey) + 1);
+            uCount++;
+        }
+    }
+    if(uCount == 0){
+        return 1;
+    }
+
+    /* Room for the slab in the slab array comes first, so that nothing
+       can fail once nodes move */
+    if(oSymTable->uSlabs == oSymTable->uSlabCapacity){
+        uCapacity = (oSymTable->uSlabCapacity == 0) ? 8
+            : oSymTable->uSlabCapacity * 2;
+        ppNewSlabs = (struct SymTableSlab**)SymTable_alloc(oSymTable,
+            uCapacity * sizeof(struct SymTableSlab*));
+        if(ppNewSlabs == NULL){
+            return 0;
+        }
+        if(oSymTable->uSlabs != 0){
+            memcpy(ppNewSlabs, oSymTable->ppSlabs,
+                oSymTable->uSlabs * sizeof(struct SymTableSlab*));
+            SymTable_release(oSymTable, oSymTable->ppSlabs,
+                oSymTable->uSlabCapacity * sizeof(struct SymTableSlab*));
+        }
+        oSymTable->ppSlabs = ppNewSlabs;
+        oSymTable->uSlabCapacity = uCapacity;
+    }
+    pSlab = (struct SymTableSlab*)SymTable_alloc(oSymTable, uSize);
+    if(pSlab == NULL){
+        return 0;
+    }
+    pSlab->uSize = uSize;
+    pSlab->uLive = uCount;
+
+    /* Keep the slab array in order of address */
+    uIndex = oSymTable->uSlabs;
+    while(uIndex > 0
+        && (uintptr_t)oSymTable->ppSlabs[uIndex - 1] > (uintptr_t)pSlab){
+        oSymTable->ppSlabs[uIndex] = oSymTable->ppSlabs[uIndex - 1];
+        uIndex--;
+    }
+    oSymTable->ppSlabs[uIndex] = pSlab;
+    oSymTable->uSlabs++;
+
+    pucNext = (unsigned char*)pSlab
+        + SymTable_pad8(sizeof(struct SymTableSlab));
+    for(counter = uFirst; counter < uLast; counter++){
+        /* The tree names the old nodes */
+        iHadTree = (SymTable_treeOf(oSymTable, counter) != NULL);
+        SymTable_dropTree(oSymTable, counter);
+
+        for(ppLink = &oSymTable->pFirstBucket[counter].pFirstBucketNode;
+            *ppLink != NULL; ppLink = &pNewNode->pNextNode){
+            pNode = *ppLink;
+            pNewNode = (struct SymTableNode*)pucNext;
+            memcpy(pNewNode, pNode, SymTable_nodeSize(oSymTable));
+            if(oSymTable->uValueSize != 0){
+                pNewNode->pValue = pNewNode + 1;
+            }
+            pTimer = (struct SymTableTimer*)SymTable_sideMove(
+                &oSymTable->timers, pNode, pNewNode);
+            if(pTimer != NULL){
+                pTimer->pNode = pNewNode;
+            }
+
+            uKeyBytes = strlen(pNode->pKey) + 1;
+            memcpy(pucNext + uNodeBytes, pNode->pKey, uKeyBytes);
+            pNewNode->pKey = (const char*)(pucNext + uNodeBytes);
+            pucNext += uNodeBytes + SymTable_pad8(uKeyBytes);
+
+            *ppLink = pNewNode;
+            SymTable_dropNode(oSymTable, pNode);
+        }
+
+        if(iHadTree){
+            SymTable_treeify(oSymTable, counter);
+        }
+    }
+    assert(pucNext == (unsigned char*)pSlab + uSize);
+    return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+int SymTable_compact(SymTable_T oSymTable){
+    assert(oSymTable != NULL);
+
+    if(oSymTable->pucMap != NULL || oSymTable->uDepth != 0){
+        return 0;
+    }
+    if(! SymTable_compactRange(oSymTable, 0, oSymTable->limit)){
+        return 0;
+    }
+    oSymTable->uCompactNext = 0;
+    return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+int SymTable_compactStep(SymTable_T oSymTable, size_t uMaxBindings){
+    struct SymTableNode *pNode;
+    size_t uFirst;
+    size_t uLast;
+    size_t uCount;
+
+    assert(oSymTable != NULL);
+
+    if(oSymTable->pucMap != NULL || oSymTable->uDepth != 0){
+        return -1;
+    }
+
+    /* Whole chains, at least one, until uMaxBindings nodes are taken */
+    uFirst = oSymTable->uCompactNext;
+    uLast = uFirst;
+    uCount = 0;
+    while(uLast < oSymTable->limit
+        && (uLast == uFirst || uCount < uMaxBindings)){
+        for(pNode = oSymTable->pFirstBucket[uLast].pFirstBucketNode;
+            pNode != NULL; pNode = pNode->pNextNode){
+            uCount++;
+        }
+        uLast++;
+    }
+
+    if(! SymTable_compactRange(oSymTable, uFirst, uLast)){
+        return -1;
+    }
+    if(uLast == oSymTable->limit){
+        oSymTable->uCompactNext = 0;
+        return 0;
+    }
+    oSymTable->uCompactNext = uLast;
+    return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* A SymTable_Visitor is called by SymTable_visit with each binding of
+   a table and the full hash code of its key. */
+typedef void (*SymTable_Visitor)(const char *pcKey, size_t uHash,
+    const void *pvValue, void *pvExtra);
+
+/*--------------------------------------------------------------------*/
+
+/* Call pfVisit(pcKey, uHash, pvValue, pvExtra) for every binding of
+   oSymTable, using the hash codes the table already holds. */
+
+static void SymTable_visit(SymTable_T oSymTable, SymTable_Visitor pfVisit,
+    void *pvExtra)
+{
+    const struct SnapshotRecord *pRecord;
+    struct SymTableNode *pCurrentNode;
+    size_t uOffset;
+    size_t counter;
+
+    assert(oSymTable != NULL);
+    assert(pfVisit != NULL);
+
+    if(oSymTable->pucMap != NULL){
+        uOffset = sizeof(struct SnapshotHeader)
+            + oSymTable->limit * sizeof(uint64_t);
+        for(counter = 0; counter < oSymTable->size; counter++){
+            pRecord = SymTable_recordAt(oSymTable, uOffset);
+            if(pRecord == NULL){
+                return;
+            }
+            (*pfVisit)(SymTable_recordKey(pRecord), (size_t)pRecord->uHash,
+                SymTable_recordValue(pRecord), pvExtra);
+            uOffset += SymTable_recordSize(pRecord);
+        }
+        return;
+    }
+
+    for(counter = 0; counter < oSymTable->limit; counter++){
+        for(pCurrentNode = oSymTable->pFirstBucket[counter].pFirstBucketNode;
+            pCurrentNode != NULL;
+            pCurrentNode = pCurrentNode->pNextNode){
+            if(SymTable_isLive(oSymTable, pCurrentNode)){
+                (*pfVisit)(pCurrentNode->pKey, pCurrentNode->uHash,
+                    pCurrentNode->pValue, pvExtra);
+            }
+        }
+    }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the node of pcKey, whose full hash code is uHash, in
+   oSymTable, which owns its nodes, or NULL if there is none. */
+
+static struct SymTableNode *SymTable_findNode(SymTable_T oSymTable,
+    const char *pcKey, size_t uHash)
+{
+    size_t uProbes = 0;
+
+    assert(oSymTable != NULL);
+    assert(oSymTable->pucMap == NULL);
+    assert(pcKey != NULL);
+
+    return SymTable_lookup(oSymTable, pcKey, uHash, NULL, &uProbes);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return 1 if pcKey, whose full hash code is uHash, is bound in
+   oSymTable, storing its value in *ppvValue, or 0 otherwise. */
+
+static int SymTable_findHashed(SymTable_T oSymTable, const char *pcKey,
+    size_t uHash, const void **ppvValue)
+{
+    const struct SnapshotRecord *pRecord;
+    struct SymTableNode *pNode;
+
+    assert(oSymTable != NULL);
+    assert(ppvValue != NULL);
+
+    if(oSymTable->pucMap != NULL){
+        pRecord = SymTable_findRecord(oSymTable, pcKey, uHash);
+        if(pRecord == NULL){
+            return 0;
+        }
+        *ppvValue = SymTable_recordValue(pRecord);
+        return 1;
+    }
+
+    pNode = SymTable_findNode(oSymTable, pcKey, uHash);
+    if(pNode == NULL || ! SymTable_isLive(oSymTable, pNode)){
+        return 0;
+    }
+    *ppvValue = pNode->pValue;
+    return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return a new node of oSymTable for a copy of pcKey, whose full hash
+   code is uHash, and pvValue, or NULL if there is not enough memory
+   available. The node is not in any bucket. */
+
+static struct SymTableNode *SymTable_newNode(SymTable_T oSymTable,
+    const char *pcKey, size_t uHash, const void *pvValue)
+{
+    struct SymTableNode *pNode;
+    char *pKey;
+    size_t strLength;
+
+    assert(oSymTable != NULL);
+    assert(oSymTable->uValueSize == 0);
+    assert(pcKey != NULL);
+
+    pNode = (struct SymTableNode*)SymTable_alloc(oSymTable,
+        SymTable_nodeSize(oSymTable));
+    if(pNode == NULL){
+        return NULL;
+    }
+    strLength = strlen(pcKey) + 1;
+    pKey = (char*)SymTable_alloc(oSymTable, strLength);
+    if(pKey == NULL){
+        SymTable_release(oSymTable, pNode, SymTable_nodeSize(oSymTable));
+        return NULL;
+    }
+    memcpy(pKey, pcKey, strLength);
+
+    pNode->pKey = pKey;
+    pNode->uHash = uHash;
+    pNode->pValue = pvValue;
+    pNode->pNextNode = NULL;
+    if(oSymTable->uMaxBindings != 0){
+        *SymTable_referenced(oSymTable, pNode) = 0;
+    }
+    return pNode;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Link pNode, whose key is not bound in oSymTable, into its bucket. */
+
+static void SymTable_linkNode(SymTable_T oSymTable,
+    struct SymTableNode *pNode)
+{
+    assert(oSymTable != NULL);
+    assert(pNode != NULL);
+
+    SymTable_chainInsert(oSymTable, pNode->uHash % oSymTable->limit, pNode);
+    oSymTable->size++;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* What the visitors of the set operations share */
+struct SymTableSetOp{
+    /* Table whose bindings are being looked up */
+    SymTable_T oOther;
+
+    /* Table being built or changed */
+    SymTable_T oResult;
+
+    /* New nodes of oResult that are not linked yet, through
+       pNextNode */
+    struct SymTableNode *pPending;
+
+    /* 1 if the visited binding is kept when oOther binds its key, 0
+       if it is kept when oOther does not */
+    int iKeepShared;
+
+    /* 1 if oOther is the first table of an intersection, whose values
+       win */
+    int iTakeOtherValue;
+
+    /* 1 once a node could not be allocated */
+    int iFailed;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Make a pending node of the SymTableSetOp pvExtra for the binding
+   pcKey, pvValue, unless oResult already binds pcKey. */
+
+static void SymTable_collectNew(const char *pcKey, size_t uHash,
+    const void *pvValue, void *pvExtra)
+{
+    struct SymTableSetOp *pOp = (struct SymTableSetOp*)pvExtra;
+    struct SymTableNode *pNode;
+
+    assert(pOp != NULL);
+
+    if(pOp->iFailed
+        || SymTable_findNode(pOp->oResult, pcKey, uHash) != NULL){
+        return;
+    }
+    pNode = SymTable_newNode(pOp->oResult, pcKey, uHash, pvValue);
+    if(pNode == NULL){
+        pOp->iFailed = 1;
+        return;
+    }
+    pNode->pNextNode = pOp->pPending;
+    pOp->pPending = pNode;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Give the binding of pcKey in oResult of the SymTableSetOp pvExtra
+   the value pvValue, if oResult binds pcKey and iTakeOtherValue, or if
+   the binding has expired, in which case it no longer does. */
+
+static void SymTable_takeValue(const char *pcKey, size_t uHash,
+    const void *pvValue, void *pvExtra)
+{
+    struct SymTableSetOp *pOp = (struct SymTableSetOp*)pvExtra;
+    struct SymTableNode *pNode;
+
+    assert(pOp != NULL);
+
+    pNode = SymTable_findNode(pOp->oResult, pcKey, uHash);
+    if(pNode == NULL){
+        return;
+    }
+    if(! SymTable_isLive(pOp->oResult, pNode)){
+        SymTable_cancelTimer(pOp->oResult, pNode);
+    }
+    else if(! pOp->iTakeOtherValue){
+        return;
+    }
+    pNode->pValue = pvValue;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Add the binding pcKey, pvValue to oResult of the SymTableSetOp
+   pvExtra if whether oOther binds pcKey matches iKeepShared. */
+
+static void SymTable_filter(const char *pcKey, size_t uHash,
+    const void *pvValue, void *pvExtra)
+{
+    struct SymTableSetOp *pOp = (struct SymTableSetOp*)pvExtra;
+    struct SymTableNode *pNode;
+    const void *pvOtherValue;
+    int iShared;
+
+    assert(pOp != NULL);
+
+    if(pOp->iFailed){
+        return;
+    }
+    iShared = SymTable_findHashed(pOp->oOther, pcKey, uHash,
+        &pvOtherValue);
+    if(iShared != pOp->iKeepShared){
+        return;
+    }
+    if(iShared && pOp->iTakeOtherValue){
+        pvValue = pvOtherValue;
+    }
+    pNode = SymTable_newNode(pOp->oResult, pcKey, uHash, pvValue);
+    if(pNode == NULL){
+        pOp->iFailed = 1;
+        return;
+    }
+    SymTable_linkNode(pOp->oResult, pNode);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Free every node of the list that starts at pNode, which belongs to
+   oSymTable. */
+
+static void SymTable_freeList(SymTable_T oSymTable,
+    struct SymTableNode *pNode)
+{
+    struct SymTableNode *pNextNode;
+
+    for(; pNode != NULL; pNode = pNextNode){
+        pNextNode = pNode->pNextNode;
+        SymTable_freeNode(oSymTable, pNode);
+    }
+}
+
+/*--------------------------------------------------------------------*/
+
+int SymTable_merge(SymTable_T oDest, SymTable_T oSource,
+    enum SymTable_MergePolicy ePolicy){
+    struct SymTableSetOp op;
+    struct SymTableNode *pNode;
+    struct SymTableNode *pNextNode;
+
+    assert(oDest != NULL);
+    assert(oSource != NULL);
+
+    if(oDest->pucMap != NULL || oDest->uDepth != 0
+        || oDest->uValueSize != 0 || oSource->uValueSize != 0){
+        return 0;
+    }
+    if(oDest == oSource){
+        return 1;
+    }
+
+    /* Growing once up front avoids a cascade of resizes. If it fails,
+       the chains are just longer. */
+    (void)SymTable_reserve(oDest, oDest->size + oSource->size);
+
+    /* Allocate every new node before changing anything, so that a
+       failure leaves oDest as it was */
+    op.oOther = oSource;
+    op.oResult = oDest;
+    op.pPending = NULL;
+    op.iKeepShared = 0;
+    op.iTakeOtherValue = 0;
+    op.iFailed = 0;
+    SymTable_visit(oSource, SymTable_collectNew, &op);
+    if(op.iFailed){
+        SymTable_freeList(oDest, op.pPending);
+        return 0;
+    }
+
+    /* Keys whose binding in oDest expired take the value of oSource
+       whatever the policy */
+    op.iTakeOtherValue = (ePolicy == SYMTABLE_TAKE_SOURCE);
+    if(op.iTakeOtherValue || oDest->timers.uCount != 0){
+        SymTable_visit(oSource, SymTable_takeValue, &op);
+    }
+    for(pNode = op.pPending; pNode != NULL; pNode = pNextNode){
+        pNextNode = pNode->pNextNode;
+        SymTable_linkNode(oDest, pNode);
+    }
+    SymTable_evictExcess(oDest);
+    return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+int SymTable_mergeAndFree(SymTable_T oDest, SymTable_T oSource,
+    enum SymTable_MergePolicy ePolicy){
+    struct SymTableNode *pNode;
+    struct SymTableNode *pNextNode;
+    struct SymTableNode *pOldNode;
+    size_t uNodeBytes;
+    size_t counter;
+
+    assert(oDest != NULL);
+    assert(oSource != NULL);
+    assert(oDest != oSource);
 
-static size_t SymTable_hash(const char *pcKey, size_t uBucketCount)
-{
-    const size_t HASH_MULTIPLIER = 65599;
-    size_t u;
-    size_t uHash = 0;
+    if(oDest->pucMap != NULL || oDest->uDepth != 0
+        || oDest->uValueSize != 0 || oSource->uValueSize != 0){
+        return 0;
+    }
 
-    assert(pcKey != NULL);
+    /* Nodes can only move between tables that share an allocator, and
+       only plain nodes, which a table has once its scopes are closed,
+       in blocks of their own rather than in slabs, and of the size
+       the other table's nodes have */
+    if(oSource->pucMap != NULL || oSource->uDepth != 0
+        || oSource->uSlabs != 0
+        || SymTable_nodeSize(oSource) != SymTable_nodeSize(oDest)
+        || oSource->allocator.pfAlloc != oDest->allocator.pfAlloc
+        || oSource->allocator.pfFree != oDest->allocator.pfFree
+        || oSource->allocator.pvContext != oDest->allocator.pvContext){
+        if(! SymTable_merge(oDest, oSource, ePolicy)){
+            return 0;
+        }
+        SymTable_free(oSource);
+        return 1;
+    }
 
-    for (u = 0; pcKey[u] != '\0'; u++)
-        uHash = uHash * HASH_MULTIPLIER + (size_t)pcKey[u];
+    (void)SymTable_reserve(oDest, oDest->size + oSource->size);
 
-    return uHash % uBucketCount;
+    for(counter = 0; counter < oSource->limit; counter++){
+        for(pNode = oSource->pFirstBucket[counter].pFirstBucketNode;
+            pNode != NULL; pNode = pNextNode){
+            pNextNode = pNode->pNextNode;
+            if(! SymTable_isLive(oSource, pNode)){
+                SymTable_freeNode(oSource, pNode);
+                continue;
+            }
+            /* Bindings move without their deadlines */
+            SymTable_cancelTimer(oSource, pNode);
+            pOldNode = SymTable_findNode(oDest, pNode->pKey, pNode->uHash);
+            if(pOldNode != NULL){
+                if(! SymTable_isLive(oDest, pOldNode)){
+                    SymTable_cancelTimer(oDest, pOldNode);
+                    pOldNode->pValue = pNode->pValue;
+                }
+                else if(ePolicy == SYMTABLE_TAKE_SOURCE){
+                    pOldNode->pValue = pNode->pValue;
+                }
+                SymTable_freeNode(oSource, pNode);
+                continue;
+            }
+            uNodeBytes = SymTable_nodeSize(oSource)
+                + strlen(pNode->pKey) + 1;
+            oSource->uBytes -= uNodeBytes;
+            oDest->uBytes += uNodeBytes;
+            SymTable_linkNode(oDest, pNode);
+        }
+        oSource->pFirstBucket[counter].pFirstBucketNode = NULL;
+    }
+    oSource->size = 0;
+    SymTable_free(oSource);
+    SymTable_evictExcess(oDest);
+    return 1;
 }
 
 /*--------------------------------------------------------------------*/
 
-/* Resize the list of oSymTable buckets in oSymTable to the next 
-   iteration. Returns the 1 for success, 0 for failure. */
+/* Return a new table, with the allocator of oFirst, holding the
+   bindings of oVisited whose keys oOther binds if iKeepShared, or does
+   not bind otherwise, with the values of oOther if iTakeOtherValue.
+   Returns NULL if there is not enough memory available. */
 
-static int SymTable_resize(SymTable_T oSymTable)
+static SymTable_T SymTable_select(SymTable_T oFirst, SymTable_T oVisited,
+    SymTable_T oOther, int iKeepShared, int iTakeOtherValue,
+    size_t uExpected)
 {
-    size_t oldLimit;
-    size_t newLimit;
-    size_t index;
-    size_t counter;
-    struct SymTableBucket* oldTableCurrentBucket;
-    struct SymTableBucket* pbCurrent;
-    struct SymTableBucket* newBucket;
-    struct SymTableNode* pCurrentNode;
-    struct SymTableNode* pOldNode;
-    struct SymTableNode* pNextNode;
-    
+    struct SymTableSetOp op;
+    SymTable_T oResult;
 
-    assert(oSymTable != NULL);
-    
-    oldLimit = oSymTable->limit;
+    assert(oFirst != NULL);
+    assert(oVisited != NULL);
+    assert(oOther != NULL);
 
-    /* Edge case for max size */
-    if(oldLimit == buckets[sizeof(buckets)/sizeof(buckets[0]) - 1]){
-        return 1;
+    /* Values stored inline would have to be copied between nodes */
+    if(oVisited->uValueSize != 0 || oOther->uValueSize != 0){
+        return NULL;
     }
 
-    /* find new limit */
-    index = 0;
-    while(oldLimit > buckets[index]){
-        index++;
+    oResult = SymTable_newWithAllocator(&oFirst->allocator);
+    if(oResult == NULL){
+        return NULL;
     }
-    newLimit = buckets[index + 1];
+    (void)SymTable_reserve(oResult, uExpected);
 
- 
-    /* newLimit elements for a new hash table */
-    newBucket = calloc(newLimit, sizeof(struct SymTableBucket));
-    if (newBucket == NULL){
-        return 0;
+    op.oOther = oOther;
+    op.oResult = oResult;
+    op.pPending = NULL;
+    op.iKeepShared = iKeepShared;
+    op.iTakeOtherValue = iTakeOtherValue;
+    op.iFailed = 0;
+    SymTable_visit(oVisited, SymTable_filter, &op);
+    if(op.iFailed){
+        SymTable_free(oResult);
+        return NULL;
     }
+    return oResult;
+}
 
-    oldTableCurrentBucket = oSymTable->pFirstBucket;
-
-    counter = 0;
-    while(counter < oldLimit){
-        /* all non empty buckets */
-        if(oldTableCurrentBucket->pFirstBucketNode != NULL){
-            /* rewire their nodes */
-            for (pCurrentNode = oldTableCurrentBucket->pFirstBucketNode;
-                pCurrentNode != NULL;
-                pCurrentNode = pNextNode)
-            {
-                pNextNode = pCurrentNode->pNextNode;
+/*--------------------------------------------------------------------*/
 
-                /* finds the position of the new bucket */
-                pbCurrent = &newBucket[
-                    SymTable_hash(pCurrentNode->pKey, newLimit)
-                ];
+SymTable_T SymTable_intersect(SymTable_T oFirst, SymTable_T oSecond){
+    assert(oFirst != NULL);
+    assert(oSecond != NULL);
 
-                pOldNode = pbCurrent->pFirstBucketNode;
-                pbCurrent->pFirstBucketNode = pCurrentNode;
-                pCurrentNode->pNextNode = pOldNode;
-            }
-        }
-        oldTableCurrentBucket++;
-        counter++;
+    /* Walk the smaller table and look up each key in the larger */
+    if(oFirst->size <= oSecond->size){
+        return SymTable_select(oFirst, oFirst, oSecond, 1, 0,
+            oFirst->size);
     }
+    return SymTable_select(oFirst, oSecond, oFirst, 1, 1, oSecond->size);
+}
 
-    
+/*--------------------------------------------------------------------*/
 
-    free(oSymTable->pFirstBucket);
-    oSymTable->limit = newLimit;
-    oSymTable->pFirstBucket = newBucket;
+SymTable_T SymTable_difference(SymTable_T oFirst, SymTable_T oSecond){
+    assert(oFirst != NULL);
+    assert(oSecond != NULL);
 
-    return 1;
+    return SymTable_select(oFirst, oFirst, oSecond, 0, 0, oFirst->size);
 }
-   
+
 /*--------------------------------------------------------------------*/
 
-SymTable_T SymTable_new(void){
-    SymTable_T oSymTable;
+int SymTable_pushScope(SymTable_T oSymTable){
+    size_t *puScopeStarts;
+    size_t uCapacity;
 
-    oSymTable = (SymTable_T)malloc(sizeof(struct SymTable));
-    if (oSymTable == NULL)
-       return NULL;
- 
-    /* 509 elements for a new hash table */
-    oSymTable->pFirstBucket = calloc(buckets[0], sizeof(struct SymTableBucket));
-    if (oSymTable->pFirstBucket == NULL)
-        return NULL;
+    assert(oSymTable != NULL);
 
-    oSymTable->size = 0;
-    oSymTable->limit = buckets[0];
-    return oSymTable;
+    if(oSymTable->pucMap != NULL || oSymTable->uMaxBindings != 0
+        || oSymTable->timers.uCount != 0 || oSymTable->uValueSize != 0){
+        return 0;
+    }
+
+    if(oSymTable->uDepth == oSymTable->uScopeCapacity){
+        uCapacity = (oSymTable->uScopeCapacity == 0) ? 8
+            : oSymTable->uScopeCapacity * 2;
+        puScopeStarts = (size_t*)SymTable_alloc(oSymTable,
+            uCapacity * sizeof(size_t));
+        if(puScopeStarts == NULL){
+            return 0;
+        }
+        if(oSymTable->puScopeStarts != NULL){
+            memcpy(puScopeStarts, oSymTable->puScopeStarts,
+                oSymTable->uDepth * sizeof(size_t));
+            SymTable_release(oSymTable, oSymTable->puScopeStarts,
+                oSymTable->uScopeCapacity * sizeof(size_t));
+        }
+        oSymTable->puScopeStarts = puScopeStarts;
+        oSymTable->uScopeCapacity = uCapacity;
+    }
+
+    oSymTable->puScopeStarts[oSymTable->uDepth] = oSymTable->uUndoLength;
+    oSymTable->uDepth++;
+    return 1;
 }
 
 /*--------------------------------------------------------------------*/
 
-void SymTable_free(SymTable_T oSymTable){
-    struct SymTableBucket *pCurrentBucket;
-    struct SymTableNode *pCurrentNode;
-    struct SymTableNode *pNextNode;
-    size_t counter;
- 
+int SymTable_popScope(SymTable_T oSymTable){
+    struct SymTableScoped *pScoped;
+    struct SymTableNode *pNode;
+    size_t uStart;
+
     assert(oSymTable != NULL);
 
-    counter = 0;
-    pCurrentBucket = oSymTable->pFirstBucket;
-    while(counter < oSymTable->limit){
-        /* Free the linked list associated with the bucket*/
-        if(pCurrentBucket->pFirstBucketNode != NULL){
-            for (pCurrentNode = pCurrentBucket->pFirstBucketNode;
-                pCurrentNode != NULL;
-                pCurrentNode = pNextNode)
-            {
-                pNextNode = pCurrentNode->pNextNode;
-                free((void*)pCurrentNode->pKey);
-                free(pCurrentNode);
+    if(oSymTable->uDepth == 0){
+        return 0;
+    }
+
+    /* Undo the scope's bindings, latest first. An entry whose binding
+       was already removed only drops its reference. */
+    uStart = oSymTable->puScopeStarts[oSymTable->uDepth - 1];
+    while(oSymTable->uUndoLength > uStart){
+        pNode = oSymTable->ppUndoLog[--oSymTable->uUndoLength];
+        pScoped = SymTable_scopedOf(oSymTable, pNode);
+        pScoped->uLogRefs--;
+        if(pScoped->uScope == oSymTable->uDepth){
+            if(pScoped->iBound){
+                oSymTable->size--;
             }
+            SymTable_unbind(oSymTable, pNode);
+        }
+        else{
+            SymTable_settle(oSymTable, pNode);
         }
-        pCurrentBucket++;
-        counter++;
     }
-    /* Free buckets */
-    free(oSymTable->pFirstBucket);
-        
-    /* Free table */
-    free(oSymTable);
+    oSymTable->uDepth--;
+    if(oSymTable->uDepth == 0){
+        SymTable_sideTrim(oSymTable, &oSymTable->scoped);
+    }
+    return 1;
 }
 
 /*--------------------------------------------------------------------*/
 
-size_t SymTable_getLength(SymTable_T oSymTable){
+size_t SymTable_getScopeDepth(SymTable_T oSymTable){
     assert(oSymTable != NULL);
-    
-    return oSymTable->size;
+
+    return oSymTable->uDepth;
 }
 
 /*--------------------------------------------------------------------*/
 
-int SymTable_put(SymTable_T oSymTable, const char *pcKey, 
-    const void *pvValue){
-    char *pKey;
-    int success;
-    size_t bucketNumber;
-    size_t strLength;
-    struct SymTableNode *pNewNode;
-    struct SymTableNode *pOldNode;
-    struct SymTableBucket *pbCurrent;    
+/* Put pTimer of oSymTable into the slot of the timing wheel that
+   SymTable_expire reaches once it is due: the level of the highest
+   digit in which its deadline differs from the wheel time, and the
+   slot of that digit. Every timer of a level thus has a digit greater
+   than that of the wheel time, at the same higher digits. A deadline
+   the wheel time has reached waits in the next unit of level 0. */
+
+static void SymTable_schedule(SymTable_T oSymTable,
+    struct SymTableTimer *pTimer)
+{
+    struct SymTableTimer **ppSlot;
+    uint64_t uSlotTime;
+    uint64_t uDiff;
+    size_t uLevel;
 
     assert(oSymTable != NULL);
-    assert(pcKey != NULL);
+    assert(oSymTable->ppWheel != NULL);
+    assert(pTimer != NULL);
 
-    if(SymTable_contains(oSymTable, pcKey)){
-        return 0;
+    uSlotTime = pTimer->uDeadline;
+    if(uSlotTime <= oSymTable->uWheelTime){
+        uSlotTime = oSymTable->uWheelTime + 1;
     }
-
-    pNewNode = (struct SymTableNode*)malloc(sizeof(struct SymTableNode));
-    if(pNewNode == NULL){
-        return 0;
+    uDiff = (uSlotTime ^ oSymTable->uWheelTime) >> WHEEL_BITS;
+    for(uLevel = 0; uDiff != 0; uLevel++){
+        uDiff >>= WHEEL_BITS;
     }
 
-    /* Defensive copy */
-    strLength = strlen(pcKey) + 1;
-    pKey = (char*) malloc(strLength * sizeof(char));
-    if(pKey == NULL){
-        free(pNewNode);
-        return 0;
+    ppSlot = &oSymTable->ppWheel[uLevel * WHEEL_SLOTS
+        + ((uSlotTime >> (uLevel * WHEEL_BITS)) & (WHEEL_SLOTS - 1))];
+    pTimer->pNext = *ppSlot;
+    if(pTimer->pNext != NULL){
+        pTimer->pNext->ppPrev = &pTimer->pNext;
     }
-    strcpy(pKey, pcKey);
+    pTimer->ppPrev = ppSlot;
+    *ppSlot = pTimer;
+}
 
-    /* Find position of the bucket assocaited with the hash */
-    bucketNumber = SymTable_hash(pKey, oSymTable->limit);
-    pbCurrent = &oSymTable->pFirstBucket[bucketNumber];
+/*--------------------------------------------------------------------*/
 
-    pNewNode->pKey = pKey;
-    pNewNode->pValue = pvValue;
-    pNewNode->pNextNode = NULL;
+int SymTable_putWithTTL(SymTable_T oSymTable, const char *pcKey,
+    const void *pvValue, uint64_t uNow, uint64_t uTTL){
+    struct SymTableTimer *pTimer;
+    struct SymTableNode *pNode;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
 
-    /* Add node to first bucket if empty, or start of linked list otherwise */
-    if(pbCurrent->pFirstBucketNode == NULL){
-        pbCurrent->pFirstBucketNode = pNewNode;
+    if(oSymTable->pucMap != NULL || oSymTable->uDepth != 0){
+        return 0;
     }
-    else{
-        pOldNode = pbCurrent->pFirstBucketNode;
-        pbCurrent->pFirstBucketNode = pNewNode;
-        pNewNode->pNextNode = pOldNode;
+    if(uNow > oSymTable->uClock){
+        oSymTable->uClock = uNow;
     }
-    oSymTable->size++;
-
-    /* Resize if size exceeds limit, but only below maximum */
-    
 
-    if(oSymTable->limit != buckets[sizeof(buckets)/sizeof(buckets[0]) - 1] && oSymTable->size > oSymTable->limit){
-        success = SymTable_resize(oSymTable);
-        if(success == 0){
+    if(oSymTable->ppWheel == NULL){
+        oSymTable->ppWheel = (struct SymTableTimer**)SymTable_alloc(
+            oSymTable,
+            WHEEL_LEVELS * WHEEL_SLOTS * sizeof(struct SymTableTimer*));
+        if(oSymTable->ppWheel == NULL){
             return 0;
         }
+        memset(oSymTable->ppWheel, 0,
+            WHEEL_LEVELS * WHEEL_SLOTS * sizeof(struct SymTableTimer*));
+    }
+    if(! SymTable_sideReserve(oSymTable, &oSymTable->timers)){
+        return 0;
+    }
+    pTimer = (struct SymTableTimer*)SymTable_alloc(oSymTable,
+        sizeof(struct SymTableTimer));
+    if(pTimer == NULL){
+        return 0;
     }
+    pTimer->uDeadline = (uTTL > UINT64_MAX - uNow) ? UINT64_MAX
+        : uNow + uTTL;
 
+    /* SymTable_putHandle binds the key again if its binding expired,
+       and drops the old deadline */
+    pNode = SymTable_putHandle(oSymTable, pcKey, pvValue);
+    if(pNode == NULL){
+        SymTable_release(oSymTable, pTimer, sizeof(struct SymTableTimer));
+        return 0;
+    }
+    assert(SymTable_sideFind(&oSymTable->timers, pNode) == NULL);
 
+    pTimer->pNode = pNode;
+    SymTable_sidePlace(&oSymTable->timers, pNode, pTimer);
+    SymTable_schedule(oSymTable, pTimer);
     return 1;
 }
 
 /*--------------------------------------------------------------------*/
 
-void *SymTable_replace(SymTable_T oSymTable, const char *pcKey, 
-    const void *pvValue){
-    struct SymTableNode *pCurrentNode;
-    struct SymTableBucket *pbCurrent;
-    const void* pOldValue;
-    size_t bucketNumber;
+size_t SymTable_expire(SymTable_T oSymTable, uint64_t uNow,
+    SymTable_Evictor pfExpire, const void *pvExtra){
+    struct SymTableTimer **ppSlot;
+    struct SymTableTimer *pTimer;
+    struct SymTableTimer *pNextTimer;
+    struct SymTableNode *pNode;
+    uint64_t uOld;
+    uint64_t uElapsed;
+    size_t uLevel;
+    size_t uSlot;
+    size_t uLast;
+    size_t uExpired = 0;
 
     assert(oSymTable != NULL);
-    assert(pcKey != NULL);
 
-    /* Find position of the bucket assocaited with the hash */
-    bucketNumber = SymTable_hash(pcKey, oSymTable->limit);
-    pbCurrent = &oSymTable->pFirstBucket[bucketNumber];
+    if(uNow > oSymTable->uClock){
+        oSymTable->uClock = uNow;
+    }
+    if(oSymTable->ppWheel == NULL || uNow <= oSymTable->uWheelTime){
+        return 0;
+    }
 
-    pCurrentNode = pbCurrent->pFirstBucketNode;
-    while(pCurrentNode != NULL){
-        if(strcmp(pCurrentNode->pKey, pcKey) == 0){
-            pOldValue = pCurrentNode->pValue;
-            pCurrentNode->pValue = pvValue;
-            return (void*) pOldValue;
+    /* A timer is due once the wheel time reaches its slot. At each
+       level those are the slots after the digit of the old wheel time,
+       up to the digit of uNow or the end of the level. A due timer
+       that has not expired yet moves down to a finer level. */
+    uOld = oSymTable->uWheelTime;
+    oSymTable->uWheelTime = uNow;
+    for(uLevel = 0; uLevel < WHEEL_LEVELS; uLevel++){
+        uElapsed = (uNow >> (uLevel * WHEEL_BITS))
+            - (uOld >> (uLevel * WHEEL_BITS));
+        if(uElapsed == 0){
+            break;
+        }
+        uSlot = (size_t)((uOld >> (uLevel * WHEEL_BITS))
+            & (WHEEL_SLOTS - 1));
+        uLast = (uElapsed >= WHEEL_SLOTS - 1 - uSlot) ? WHEEL_SLOTS - 1
+            : uSlot + (size_t)uElapsed;
+        for(uSlot++; uSlot <= uLast; uSlot++){
+            ppSlot = &oSymTable->ppWheel[uLevel * WHEEL_SLOTS + uSlot];
+            pTimer = *ppSlot;
+            *ppSlot = NULL;
+            for(; pTimer != NULL; pTimer = pNextTimer){
+                pNextTimer = pTimer->pNext;
+                if(pTimer->uDeadline > uNow){
+                    SymTable_schedule(oSymTable, pTimer);
+                    continue;
+                }
+                pNode = pTimer->pNode;
+                (void)SymTable_sideRemove(&oSymTable->timers, pNode);
+                SymTable_release(oSymTable, pTimer,
+                    sizeof(struct SymTableTimer));
+                SymTable_unlinkNode(oSymTable, pNode);
+                oSymTable->size--;
+                if(pfExpire != NULL){
+                    (*pfExpire)(pNode->pKey, (void*)pNode->pValue,
+                        (void*)pvExtra);
+                }
+                SymTable_freeNode(oSymTable, pNode);
+                uExpired++;
+            }
         }
-        pCurrentNode = pCurrentNode->pNextNode;
     }
-    return NULL;
+    SymTable_sideTrim(oSymTable, &oSymTable->timers);
+    return uExpired;
 }
 
 /*--------------------------------------------------------------------*/
 
-int SymTable_contains(SymTable_T oSymTable, const char *pcKey){
+SymTable_Handle SymTable_find(SymTable_T oSymTable, const char *pcKey){
     struct SymTableNode *pCurrentNode;
-    struct SymTableBucket *pbCurrent;
-    size_t bucketNumber;
+    size_t uHash;
+    size_t uProbes = 0;
 
     assert(oSymTable != NULL);
     assert(pcKey != NULL);
 
-    /* Find position of the bucket assocaited with the hash */
-    bucketNumber = SymTable_hash(pcKey, oSymTable->limit);
-    pbCurrent = &oSymTable->pFirstBucket[bucketNumber];
+    if(oSymTable->pucMap != NULL){
+        return NULL;
+    }
 
-    pCurrentNode = pbCurrent->pFirstBucketNode;
-    while(pCurrentNode != NULL){
-        if(strcmp(pCurrentNode->pKey, pcKey) == 0){
-            return 1;
-        }
-        pCurrentNode = pCurrentNode->pNextNode;
+    SYMTABLE_COUNT(oSymTable->counters.ulLookups++);
+
+    uHash = SymTable_hashKey(pcKey);
+    pCurrentNode = SymTable_lookup(oSymTable, pcKey, uHash, NULL,
+        &uProbes);
+    SYMTABLE_COUNT(oSymTable->counters.ulLookupProbes += uProbes);
+    if(pCurrentNode == NULL || ! SymTable_isLive(oSymTable, pCurrentNode)){
+        return NULL;
     }
-    return 0;
+    SymTable_touch(oSymTable, pCurrentNode);
+    return pCurrentNode;
 }
 
 /*--------------------------------------------------------------------*/
 
-void *SymTable_get(SymTable_T oSymTable, const char *pcKey){
-    struct SymTableNode *pCurrentNode;
-    struct SymTableBucket *pbCurrent;
-    size_t bucketNumber;
-
+void *SymTable_handleValue(SymTable_T oSymTable, SymTable_Handle oHandle){
     assert(oSymTable != NULL);
-    assert(pcKey != NULL);
+    assert(oHandle != NULL);
+    assert(SymTable_isBound(oSymTable, oHandle));
 
-    /* Find position of the bucket assocaited with the hash */
-    bucketNumber = SymTable_hash(pcKey, oSymTable->limit);
-    pbCurrent = &oSymTable->pFirstBucket[bucketNumber];
+    /* A binding that expired since the handle was taken reads as
+       unbound until SymTable_expire removes it */
+    if(! SymTable_isLive(oSymTable, oHandle)){
+        return NULL;
+    }
+    SymTable_touch(oSymTable, oHandle);
+    return (void*)oHandle->pValue;
+}
 
-    pCurrentNode = pbCurrent->pFirstBucketNode;
-    while(pCurrentNode != NULL){
-        if(strcmp(pCurrentNode->pKey, pcKey) == 0){
-            return (void*)(pCurrentNode->pValue);
-        }
-        pCurrentNode = pCurrentNode->pNextNode;
+/*--------------------------------------------------------------------*/
+
+void *SymTable_handleReplace(SymTable_T oSymTable, SymTable_Handle oHandle,
+    const void *pvValue){
+    const void* pOldValue;
+
+    assert(oSymTable != NULL);
+    assert(oHandle != NULL);
+    assert(SymTable_isBound(oSymTable, oHandle));
+
+    /* As in SymTable_replace, an inline value cannot be replaced */
+    if(oSymTable->uValueSize != 0
+        || ! SymTable_isLive(oSymTable, oHandle)){
+        return NULL;
     }
-    return NULL;
+    SymTable_touch(oSymTable, oHandle);
+    pOldValue = oHandle->pValue;
+    SymTable_setValue(oSymTable, oHandle, pvValue);
+    return (void*) pOldValue;
 }
 
 /*--------------------------------------------------------------------*/
 
-void *SymTable_remove(SymTable_T oSymTable, const char *pcKey){
-    struct SymTableNode *pPrevNode;
-    struct SymTableNode *pCurrentNode;
-    struct SymTableBucket *pbCurrent;
-    size_t bucketNumber;
+void *SymTable_handleRemove(SymTable_T oSymTable, SymTable_Handle oHandle){
     const void* pOldValue;
 
     assert(oSymTable != NULL);
-    assert(pcKey != NULL);
+    assert(oHandle != NULL);
+    assert(SymTable_isBound(oSymTable, oHandle));
 
-    /* Find position of the bucket assocaited with the hash */
-    bucketNumber = SymTable_hash(pcKey, oSymTable->limit);
-    pbCurrent = &oSymTable->pFirstBucket[bucketNumber];
+    /* As in SymTable_remove, an inline binding stays */
+    if(oSymTable->uValueSize != 0){
+        return NULL;
+    }
+    pOldValue = SymTable_isLive(oSymTable, oHandle) ? oHandle->pValue
+        : NULL;
+    oSymTable->size--;
 
-    pCurrentNode = pbCurrent->pFirstBucketNode;
-    pPrevNode = NULL;
-    while(pCurrentNode != NULL){
-        if(strcmp(pCurrentNode->pKey, pcKey) == 0){
-            pOldValue = pCurrentNode->pValue;
-            if(pPrevNode == NULL){
-                pbCurrent->pFirstBucketNode = pCurrentNode->pNextNode;
-            }
-            else{
-                pPrevNode->pNextNode = pCurrentNode->pNextNode;
-            }
-            free((void*)pCurrentNode->pKey);
-            free(pCurrentNode);
-            oSymTable->size--;
-            return (void*) pOldValue;
-        }
-        pPrevNode = pCurrentNode;
-        pCurrentNode = pCurrentNode->pNextNode;
+    /* As in SymTable_remove, a scoped binding may reveal the one it
+       shadows. Otherwise the node comes out of its chain by address,
+       which the stored hash code locates without hashing the key; a
+       chain with a tree still finds the node's entry by key. */
+    if(SymTable_scopedOf(oSymTable, oHandle) != NULL){
+        SymTable_unbind(oSymTable, oHandle);
+        return (void*) pOldValue;
     }
-    return NULL;
+    SymTable_unlinkNode(oSymTable, oHandle);
+    SymTable_freeNode(oSymTable, oHandle);
+    return (void*) pOldValue;
 }
 
 /*--------------------------------------------------------------------*/
 
-void SymTable_map(SymTable_T oSymTable, void (*pfApply)
-    (const char *pcKey, void *pvValue, void *pvExtra), 
-    const void *pvExtra){
+void SymTable_getStats(SymTable_T oSymTable, struct SymTable_Stats *pStats){
+    const uint64_t *puBucketOffsets = NULL;
+    const struct SnapshotRecord *pRecord;
     struct SymTableNode *pCurrentNode;
-    struct SymTableNode *pNextNode;
-    struct SymTableBucket *pCurrentBucket;
+    uint64_t uOffset;
+    size_t uLength;
     size_t counter;
 
     assert(oSymTable != NULL);
-    assert(pfApply != NULL);
+    assert(pStats != NULL);
 
-    pCurrentBucket = oSymTable->pFirstBucket;
-    counter = 0;
-    while(counter < oSymTable->limit){
-        /* Free the linked list associated with the bucket*/
-        if(pCurrentBucket->pFirstBucketNode != NULL){
-            for (pCurrentNode = pCurrentBucket->pFirstBucketNode;
+#ifdef SYMTABLE_STATS
+    *pStats = oSymTable->counters;
+#else
+    memset(pStats, 0, sizeof(*pStats));
+#endif
+    memset(pStats->auChainLengths, 0, sizeof(pStats->auChainLengths));
+    pStats->uBucketCount = oSymTable->limit;
+    pStats->uBindingCount = oSymTable->size;
+    pStats->dLoadFactor = (double)oSymTable->size / (double)oSymTable->limit;
+    pStats->uMaxChain = 0;
+    pStats->uNodeBytes = 0;
+    pStats->uKeyBytes = 0;
+    pStats->uTreeBuckets = oSymTable->uTrees;
+
+    if(oSymTable->pucMap != NULL){
+        puBucketOffsets = (const uint64_t*)(oSymTable->pucMap
+            + sizeof(struct SnapshotHeader));
+        pStats->uBucketBytes = oSymTable->limit * sizeof(uint64_t);
+        pStats->uNodeBytes = oSymTable->uMapLength
+            - sizeof(struct SnapshotHeader) - pStats->uBucketBytes;
+    }
+    else{
+        pStats->uBucketBytes =
+            oSymTable->limit * sizeof(struct SymTableBucket);
+        pStats->uNodeBytes = oSymTable->size * SymTable_nodeSize(oSymTable);
+    }
+
+    for(counter = 0; counter < oSymTable->limit; counter++){
+        uLength = 0;
+        if(puBucketOffsets != NULL){
+            for(uOffset = puBucketOffsets[counter]; uOffset != 0;
+                uOffset = pRecord->uNext){
+                pRecord = SymTable_recordAt(oSymTable, uOffset);
+                if(pRecord == NULL){
+                    break;
+                }
+                uLength++;
+            }
+        }
+        else{
+            for(pCurrentNode = oSymTable->pFirstBucket[counter]
+                    .pFirstBucketNode;
                 pCurrentNode != NULL;
-                pCurrentNode = pNextNode)
-            {
-                (*pfApply)(pCurrentNode->pKey, (void*)pCurrentNode->pValue, (void*) pvExtra);
-                pNextNode = pCurrentNode->pNextNode;
+                pCurrentNode = pCurrentNode->pNextNode){
+                pStats->uKeyBytes += strlen(pCurrentNode->pKey) + 1;
+                uLength++;
             }
         }
-        counter++;
-        pCurrentBucket++;
+
+        if(uLength > pStats->uMaxChain){
+            pStats->uMaxChain = uLength;
+        }
+        if(uLength >= SYMTABLE_CHAIN_HISTOGRAM_SIZE){
+            uLength = SYMTABLE_CHAIN_HISTOGRAM_SIZE - 1;
+        }
+        pStats->auChainLengths[uLength]++;
     }
-}
\ No newline at end of file
+}
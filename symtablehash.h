@@ -0,0 +1,342 @@
+/*--------------------------------------------------------------------*/
+/*                                                                    */
+/* Header file for the functions that only the hash table             */
+/* implementation of the SymTable ADT provides                        */
+/*                                                                    */
+/* Author: Maxwell Lloyd                                              */
+/*                                                                    */
+/*--------------------------------------------------------------------*/
+
+
+#ifndef SYMTABLEHASH_INCLUDED
+#define SYMTABLEHASH_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+#include "symtable.h"
+
+/*--------------------------------------------------------------------*/
+
+/* A SymTable_Evictor is called by a bounded table with the key and
+   value of each binding it evicts, and the extra argument given to
+   SymTable_newBounded. The key is freed once it returns. It must not
+   call any function on the table. */
+typedef void (*SymTable_Evictor)(const char *pcKey, void *pvValue,
+    void *pvExtra);
+
+/*--------------------------------------------------------------------*/
+
+/* Return a new empty SymTable object that holds at most uMaxBindings
+   bindings, or NULL if there is not enough memory available.
+   uMaxBindings must be positive. A SymTable_put of a new key into a
+   full table first evicts one binding by the CLOCK rule: each hit of
+   SymTable_get, SymTable_contains or SymTable_replace sets a bit on
+   its binding, and a hand sweeping the buckets clears set bits and
+   evicts the first binding whose bit is clear. pfEvict, if not NULL,
+   is called with every binding evicted, so that a caller-owned value
+   can be freed; SymTable_free and SymTable_remove do not call it.
+   SymTable_merge into the table evicts down to the bound afterwards,
+   and SymTable_pushScope fails on it */
+SymTable_T SymTable_newBounded(size_t uMaxBindings,
+    SymTable_Evictor pfEvict, const void *pvExtra);
+
+/*--------------------------------------------------------------------*/
+
+/* Return a new empty SymTable object that stores a uValueSize byte
+   value inside each binding's node, or NULL if there is not enough
+   memory available. uValueSize must be positive. The value saves the
+   caller an allocation per binding and a get a pointer chase. On the
+   table, every value argument, as to SymTable_put and
+   SymTable_putWithTTL, points to uValueSize bytes that are copied in,
+   and every value returned, as by SymTable_get and SymTable_map, is
+   the address of the stored bytes, aligned for pointers, integers and
+   doubles; it stays valid until the binding is removed, and the bytes
+   may be changed through it. SymTable_replace and SymTable_remove
+   would have no old value to return but those bytes, so they and
+   SymTable_handleReplace and SymTable_handleRemove fail on it,
+   returning NULL and leaving it unchanged; values are changed through
+   SymTable_getValuePtr and removed by SymTable_removeValue.
+   SymTable_pushScope, SymTable_merge, SymTable_mergeAndFree,
+   SymTable_intersect and SymTable_difference fail on it too */
+SymTable_T SymTable_newInline(size_t uValueSize);
+
+/*--------------------------------------------------------------------*/
+
+/* Same as SymTable_put on a table from SymTable_newInline, copying
+   the value pvValue points to into the new binding */
+int SymTable_putValue(SymTable_T oSymTable, const char *pcKey,
+    const void *pvValue);
+
+/*--------------------------------------------------------------------*/
+
+/* Return the address of the value of pcKey in parameter oSymTable, a
+   table from SymTable_newInline, or NULL if pcKey is not bound */
+void *SymTable_getValuePtr(SymTable_T oSymTable, const char *pcKey);
+
+/*--------------------------------------------------------------------*/
+
+/* Remove the binding of pcKey from parameter oSymTable, a table from
+   SymTable_newInline, first copying its value into the bytes at
+   pvOldValue unless pvOldValue is NULL. Returns 1 for success or 0 if
+   pcKey is not bound */
+int SymTable_removeValue(SymTable_T oSymTable, const char *pcKey,
+    void *pvOldValue);
+
+/*--------------------------------------------------------------------*/
+
+/* Add lDelta to the long value of pcKey in parameter oSymTable, a
+   table from SymTable_newInline(sizeof(long)), in place, or bind
+   pcKey to lDelta if it is not bound: the one lookup a counter needs.
+   The sum must not overflow. Returns 1 for success or 0 if there is
+   not enough memory available or oSymTable is a mapped snapshot */
+int SymTable_add(SymTable_T oSymTable, const char *pcKey, long lDelta);
+
+/*--------------------------------------------------------------------*/
+
+/* Grow the buckets of parameter oSymTable so that it holds uCount 
+   bindings without resizing again. Returns 1 for success or 0 for 
+   failure */
+int SymTable_reserve(SymTable_T oSymTable, size_t uCount);
+
+/*--------------------------------------------------------------------*/
+
+/* Return a new SymTable object binding each of the uCount keys
+   ppcKeys[i] to ppvValues[i], or NULL if there is not enough memory
+   available. A key given more than once keeps its first value, as if
+   each were put in turn. The buckets are reserved for uCount bindings
+   and cut into uThreads ranges, at most 64; each of uThreads threads
+   hashes a share of the keys and then links the keys of one range,
+   without locks. Nothing else may use the keys and values while it
+   runs. The table uses the default allocator and is in every way like
+   one built by SymTable_put. */
+SymTable_T SymTable_buildParallel(const char *const *ppcKeys,
+    const void *const *ppvValues, size_t uCount, size_t uThreads);
+
+/*--------------------------------------------------------------------*/
+
+/* Move every binding of parameter oSymTable into one new block, chain
+   after chain in bucket order, each node followed by its key, so that
+   walking a chain or mapping the table reads memory in order again
+   after heavy churn. The block is freed with the last of its bindings
+   to be removed, and until then SymTable_memoryUsage counts all of it,
+   however few of them are left. Values do not move, but every
+   SymTable_Handle of the table becomes invalid.
+   Returns 1 for success, or 0 if there is not enough memory available
+   for the block, a scope is open or oSymTable is a mapped snapshot,
+   in which case nothing changes */
+int SymTable_compact(SymTable_T oSymTable);
+
+/*--------------------------------------------------------------------*/
+
+/* Do the next step of an incremental SymTable_compact of parameter
+   oSymTable: move the chains of the buckets after those of the last
+   step into a block of their own, whole chains, until about
+   uMaxBindings bindings have moved, so that a pass over a large table
+   can be spread out. Each block is counted by SymTable_memoryUsage
+   as that of SymTable_compact is. Returns 1 if buckets are left for
+   the next step, 0 once the pass has reached the last bucket, the
+   next step then starting a new pass, or -1 if SymTable_compact would
+   fail, in which case nothing moves and the next step tries the same
+   buckets again; a loop that runs while the result is 1 must check
+   for -1 after it. A resize of the buckets restarts the pass */
+int SymTable_compactStep(SymTable_T oSymTable, size_t uMaxBindings);
+
+/*--------------------------------------------------------------------*/
+
+/* A SymTable_ValueSerializer stores the address of the bytes that
+   represent pvValue in *ppvBytes and returns how many bytes there are.
+   The bytes must stay valid until SymTable_save returns. Returning 0 
+   stores the value as NULL. */
+typedef size_t (*SymTable_ValueSerializer)(const void *pvValue,
+    const void **ppvBytes);
+
+/*--------------------------------------------------------------------*/
+
+/* Write every binding of parameter oSymTable to the file pcPath as a
+   snapshot that SymTable_openMapped can use without parsing it. Each
+   value is written as the bytes pfSerialize gives for it, or as NULL
+   if pfSerialize is NULL. Returns 1 for success or 0 for failure */
+int SymTable_save(SymTable_T oSymTable, const char *pcPath,
+    SymTable_ValueSerializer pfSerialize);
+
+/*--------------------------------------------------------------------*/
+
+/* Return a read-only SymTable object that maps the snapshot file
+   pcPath into memory, or NULL if it cannot be mapped or is not a
+   snapshot of its own length. A record that a corrupt file places
+   even partly outside the mapping is not read; lookups and
+   SymTable_map stop at it as at the end of the data. SymTable_get
+   and SymTable_map give the address of the value's bytes inside the
+   mapping, which must not be written to. SymTable_put fails and
+   SymTable_replace and SymTable_remove return NULL on the table.
+   SymTable_free unmaps it. The table comes from malloc, and
+   SymTable_memoryUsage does not count the mapping. */
+SymTable_T SymTable_openMapped(const char *pcPath);
+
+/*--------------------------------------------------------------------*/
+
+/* What SymTable_merge does with a key bound in both tables. The value
+   that loses is not freed. */
+enum SymTable_MergePolicy{
+    /* Keep the value of the destination */
+    SYMTABLE_KEEP_DEST,
+
+    /* Take the value of the source */
+    SYMTABLE_TAKE_SOURCE
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Add every binding of parameter oSource to parameter oDest, settling
+   keys bound in both as ePolicy says. oDest grows once up front and
+   reuses the hash codes oSource holds. Returns 1 for success or 0 for
+   failure, in which case oDest is unchanged. oSource is not changed;
+   it may be a mapped snapshot, but oDest may not */
+int SymTable_merge(SymTable_T oDest, SymTable_T oSource,
+    enum SymTable_MergePolicy ePolicy);
+
+/*--------------------------------------------------------------------*/
+
+/* Same as SymTable_merge, then frees parameter oSource. If both tables
+   use the same allocator, the nodes of oSource move into oDest instead
+   of being copied, and this cannot fail. Returns 1 for success or 0
+   for failure, in which case neither table is changed */
+int SymTable_mergeAndFree(SymTable_T oDest, SymTable_T oSource,
+    enum SymTable_MergePolicy ePolicy);
+
+/*--------------------------------------------------------------------*/
+
+/* Return a new SymTable object holding the bindings of parameter
+   oFirst whose keys parameter oSecond also binds, with the values of
+   oFirst, or NULL if there is not enough memory available. This walks
+   the smaller of the two tables. The new table uses the allocator of
+   oFirst */
+SymTable_T SymTable_intersect(SymTable_T oFirst, SymTable_T oSecond);
+
+/*--------------------------------------------------------------------*/
+
+/* Return a new SymTable object holding the bindings of parameter
+   oFirst whose keys parameter oSecond does not bind, or NULL if there
+   is not enough memory available. The new table uses the allocator of
+   oFirst */
+SymTable_T SymTable_difference(SymTable_T oFirst, SymTable_T oSecond);
+
+/*--------------------------------------------------------------------*/
+
+/* Open a new scope in parameter oSymTable, inside any already open.
+   While it is open, SymTable_put may bind a key that an outer scope
+   binds; the new binding shadows the old one until the scope is
+   popped. Lookups find the innermost binding in one probe, however
+   deep the nesting. Returns 1 for success or 0 if there is not enough
+   memory available, oSymTable is a mapped snapshot or bounded, or a
+   binding of it has a deadline */
+int SymTable_pushScope(SymTable_T oSymTable);
+
+/*--------------------------------------------------------------------*/
+
+/* Close the innermost scope of parameter oSymTable. Every binding put
+   in it disappears, revealing the binding it shadowed if any; this
+   costs time in proportion to the bindings the scope put. A change
+   made by SymTable_replace goes with the binding it changed.
+   SymTable_remove ends the innermost binding and reveals the one it
+   shadowed; a binding of an outer scope removed from an inner one
+   stays removed. Values are not freed. Returns 1, or 0 if no scope is
+   open. SymTable_merge and SymTable_mergeAndFree fail on a table with
+   an open scope */
+int SymTable_popScope(SymTable_T oSymTable);
+
+/*--------------------------------------------------------------------*/
+
+/* Returns the number of open scopes of parameter oSymTable */
+size_t SymTable_getScopeDepth(SymTable_T oSymTable);
+
+/*--------------------------------------------------------------------*/
+
+/* Same as SymTable_put, but the binding expires uTTL time units after
+   uNow, in whatever units the caller's clock counts. An expired
+   binding is not bound: SymTable_get, SymTable_contains,
+   SymTable_replace, SymTable_map and the set operations skip it, and
+   SymTable_put binds its key again. It still counts in
+   SymTable_getLength until SymTable_expire removes it. The table's
+   time becomes the latest uNow given to it. SymTable_remove cancels
+   the deadline in constant time, and SymTable_replace keeps it.
+   Bindings copied or moved by SymTable_merge and SymTable_mergeAndFree
+   do not expire. Returns 1 for success, or 0 if pcKey is bound, there
+   is not enough memory available, a scope is open or oSymTable is a
+   mapped snapshot */
+int SymTable_putWithTTL(SymTable_T oSymTable, const char *pcKey,
+    const void *pvValue, uint64_t uNow, uint64_t uTTL);
+
+/*--------------------------------------------------------------------*/
+
+/* Remove from parameter oSymTable every binding that has expired by
+   time uNow, calling pfExpire, if not NULL, with each of them and
+   pvExtra first, and return how many were removed. The deadlines live
+   in a hierarchical timing wheel, so this costs time in proportion to
+   the bindings removed, plus moving each deadline down the wheel a
+   bounded number of times as it nears. pfExpire must not call any
+   function on the table. SymTable_pushScope fails while a binding of
+   the table has a deadline */
+size_t SymTable_expire(SymTable_T oSymTable, uint64_t uNow,
+    SymTable_Evictor pfExpire, const void *pvExtra);
+
+/*--------------------------------------------------------------------*/
+
+/* Number of chain lengths counted one by one in a SymTable_Stats.
+   Longer chains are counted together in the last entry. */
+enum {SYMTABLE_CHAIN_HISTOGRAM_SIZE = 16};
+
+/* What SymTable_getStats reports about a table */
+struct SymTable_Stats{
+    /* Number of buckets */
+    size_t uBucketCount;
+
+    /* Number of bindings */
+    size_t uBindingCount;
+
+    /* Bindings per bucket */
+    double dLoadFactor;
+
+    /* auChainLengths[i] is the number of buckets holding i bindings */
+    size_t auChainLengths[SYMTABLE_CHAIN_HISTOGRAM_SIZE];
+
+    /* Number of bindings in the longest chain */
+    size_t uMaxChain;
+
+    /* Number of buckets whose chain grew past 8 bindings and is also
+       indexed by a balanced tree, ordered by hash code and then key,
+       so that a lookup in it takes logarithmic time however many keys
+       collide. A tree is dropped when its chain falls below 6. */
+    size_t uTreeBuckets;
+
+    /* Bytes held by the nodes, the key copies and the bucket array. A
+       mapped snapshot counts its records as node bytes. */
+    size_t uNodeBytes;
+    size_t uKeyBytes;
+    size_t uBucketBytes;
+
+    /* The counters below stay 0 unless symtablehash.c is built with
+       SYMTABLE_STATS defined. Lookups are calls to SymTable_get,
+       SymTable_contains and SymTable_replace. Probes are nodes
+       visited. */
+    unsigned long ulLookups;
+    unsigned long ulLookupProbes;
+    unsigned long ulPuts;
+    unsigned long ulPutProbes;
+    unsigned long ulRemoves;
+    unsigned long ulRemoveProbes;
+
+    /* Number of times the buckets were resized, and the seconds
+       spent doing it */
+    unsigned long ulResizes;
+    double dResizeSeconds;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Fill *pStats with the current shape of parameter oSymTable and the
+   counters gathered since it was created. This walks every bucket. */
+void SymTable_getStats(SymTable_T oSymTable, struct SymTable_Stats *pStats);
+
+
+#endif
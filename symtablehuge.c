@@ -0,0 +1,284 @@
+/*--------------------------------------------------------------------*/
+/*                                                                    */
+/* Allocator that gives a SymTable object memory from 2MB aligned     */
+/* mappings advised for transparent huge pages                        */
+/*                                                                    */
+/* Author: Maxwell Lloyd                                              */
+/*                                                                    */
+/*--------------------------------------------------------------------*/
+
+
+
+/* MADV_HUGEPAGE and syscall are not POSIX */
+#define _DEFAULT_SOURCE
+
+#include <stddef.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+#include "symtablehuge.h"
+
+/*--------------------------------------------------------------------*/
+
+/* Size and alignment of a huge page, and of each mapping */
+enum {HUGE_PAGE_SIZE = 2 * 1024 * 1024};
+
+/* Blocks this large or larger get a mapping of their own */
+enum {HUGE_MIN_MAPPED = HUGE_PAGE_SIZE / 2};
+
+/* Blocks of up to HUGE_CLASS_COUNT * HUGE_GRANULE bytes come from the
+   arenas, rounded up to a multiple of HUGE_GRANULE, which is also
+   their alignment */
+enum {HUGE_GRANULE = 8, HUGE_CLASS_COUNT = 32};
+
+/* Bytes at the start of each arena that link it to the next */
+enum {HUGE_ARENA_HEADER = 16};
+
+/* Number of NUMA nodes a mapping can be bound to, and the policy
+   that prefers one node, as <numaif.h> numbers it */
+enum {HUGE_MAX_NODES = 1024, HUGE_MPOL_PREFERRED = 1};
+
+/*--------------------------------------------------------------------*/
+
+/* The context of the allocator of one table */
+struct HugeArena{
+    /* Next free byte of the arena being carved, and its end */
+    unsigned char *pucNext;
+    unsigned char *pucEnd;
+
+    /* Most recent arena, each linked to the one before it through its
+       first bytes */
+    void *pvArenas;
+
+    /* Blocks given back, one list per size, linked through their
+       first bytes */
+    void *apvFree[HUGE_CLASS_COUNT];
+
+    /* NUMA node the mappings prefer, or -1 */
+    int iNode;
+
+    /* Number of blocks given out and not taken back, plus one while
+       SymTable_newHugePages holds the context. At 0 the arenas are
+       unmapped and the context freed. */
+    size_t uLive;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Return uSize rounded up to a whole number of huge pages. */
+
+static size_t SymTableHuge_roundUp(size_t uSize)
+{
+    return (uSize + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Ask that the uLength bytes at pvStart, which nothing has touched
+   yet, come from NUMA node iNode if it is not negative. The request
+   is only advice; failure is ignored. */
+
+static void SymTableHuge_bind(void *pvStart, size_t uLength, int iNode)
+{
+#if defined(__linux__) && defined(SYS_mbind)
+    enum {BITS = 8 * sizeof(unsigned long)};
+    unsigned long aulMask[HUGE_MAX_NODES / BITS];
+
+    if(iNode < 0 || iNode >= HUGE_MAX_NODES){
+        return;
+    }
+    memset(aulMask, 0, sizeof(aulMask));
+    aulMask[iNode / BITS] = 1UL << (iNode % BITS);
+    (void)syscall(SYS_mbind, pvStart, uLength,
+        (unsigned long)HUGE_MPOL_PREFERRED, aulMask,
+        (unsigned long)HUGE_MAX_NODES + 1, 0UL);
+#else
+    (void)pvStart;
+    (void)uLength;
+    (void)iNode;
+#endif
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return a new mapping of uSize bytes, rounded up to whole huge pages,
+   that starts on a huge page boundary and is advised for huge pages
+   and bound as pArena says, or NULL if it cannot be mapped. */
+
+static void *SymTableHuge_map(struct HugeArena *pArena, size_t uSize)
+{
+    unsigned char *pucMapping;
+    unsigned char *pucStart;
+    size_t uLength;
+    size_t uHead;
+
+    assert(pArena != NULL);
+
+    uLength = SymTableHuge_roundUp(uSize);
+    if(uLength < uSize || uLength + HUGE_PAGE_SIZE < uLength){
+        return NULL;
+    }
+
+    /* Map a huge page more than needed, then trim both ends so that
+       what is left is aligned */
+    pucMapping = (unsigned char*)mmap(NULL, uLength + HUGE_PAGE_SIZE,
+        PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(pucMapping == (unsigned char*)MAP_FAILED){
+        return NULL;
+    }
+    uHead = (HUGE_PAGE_SIZE - (uintptr_t)pucMapping % HUGE_PAGE_SIZE)
+        % HUGE_PAGE_SIZE;
+    pucStart = pucMapping + uHead;
+    if(uHead != 0){
+        (void)munmap(pucMapping, uHead);
+    }
+    (void)munmap(pucStart + uLength, HUGE_PAGE_SIZE - uHead);
+
+#ifdef MADV_HUGEPAGE
+    (void)madvise(pucStart, uLength, MADV_HUGEPAGE);
+#endif
+    SymTableHuge_bind(pucStart, uLength, pArena->iNode);
+    return pucStart;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Drop one hold on pArena, and unmap its arenas and free it once
+   nothing holds it. */
+
+static void SymTableHuge_release(struct HugeArena *pArena)
+{
+    void *pvArena;
+    void *pvNext;
+
+    assert(pArena != NULL);
+    assert(pArena->uLive != 0);
+
+    if(--pArena->uLive != 0){
+        return;
+    }
+    for(pvArena = pArena->pvArenas; pvArena != NULL; pvArena = pvNext){
+        memcpy(&pvNext, pvArena, sizeof(void*));
+        (void)munmap(pvArena, HUGE_PAGE_SIZE);
+    }
+    free(pArena);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return uSize bytes from the HugeArena pvContext, or NULL if there is
+   not enough memory available. */
+
+static void *SymTableHuge_alloc(size_t uSize, void *pvContext)
+{
+    struct HugeArena *pArena = (struct HugeArena*)pvContext;
+    unsigned char *pucArena;
+    void *pvBlock;
+    size_t uClass;
+    size_t uBlockSize;
+
+    assert(pArena != NULL);
+
+    if(uSize == 0){
+        uSize = 1;
+    }
+
+    if(uSize >= HUGE_MIN_MAPPED){
+        pvBlock = SymTableHuge_map(pArena, uSize);
+    }
+    else if(uSize > HUGE_CLASS_COUNT * HUGE_GRANULE){
+        pvBlock = malloc(uSize);
+    }
+    else{
+        uClass = (uSize - 1) / HUGE_GRANULE;
+        uBlockSize = (uClass + 1) * HUGE_GRANULE;
+        pvBlock = pArena->apvFree[uClass];
+        if(pvBlock != NULL){
+            memcpy(&pArena->apvFree[uClass], pvBlock, sizeof(void*));
+        }
+        else{
+            /* The rest of a full arena is left unused */
+            if((size_t)(pArena->pucEnd - pArena->pucNext) < uBlockSize){
+                pucArena = (unsigned char*)SymTableHuge_map(pArena,
+                    HUGE_PAGE_SIZE);
+                if(pucArena == NULL){
+                    return NULL;
+                }
+                memcpy(pucArena, &pArena->pvArenas, sizeof(void*));
+                pArena->pvArenas = pucArena;
+                pArena->pucNext = pucArena + HUGE_ARENA_HEADER;
+                pArena->pucEnd = pucArena + HUGE_PAGE_SIZE;
+            }
+            pvBlock = pArena->pucNext;
+            pArena->pucNext += uBlockSize;
+        }
+    }
+
+    if(pvBlock != NULL){
+        pArena->uLive++;
+    }
+    return pvBlock;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Take back pvBlock of uSize bytes, which SymTableHuge_alloc returned
+   from the HugeArena pvContext. */
+
+static void SymTableHuge_free(void *pvBlock, size_t uSize,
+    void *pvContext)
+{
+    struct HugeArena *pArena = (struct HugeArena*)pvContext;
+    size_t uClass;
+
+    assert(pvBlock != NULL);
+    assert(pArena != NULL);
+
+    if(uSize == 0){
+        uSize = 1;
+    }
+
+    if(uSize >= HUGE_MIN_MAPPED){
+        (void)munmap(pvBlock, SymTableHuge_roundUp(uSize));
+    }
+    else if(uSize > HUGE_CLASS_COUNT * HUGE_GRANULE){
+        free(pvBlock);
+    }
+    else{
+        uClass = (uSize - 1) / HUGE_GRANULE;
+        memcpy(pvBlock, &pArena->apvFree[uClass], sizeof(void*));
+        pArena->apvFree[uClass] = pvBlock;
+    }
+    SymTableHuge_release(pArena);
+}
+
+/*--------------------------------------------------------------------*/
+
+SymTable_T SymTable_newHugePages(int iNumaNode){
+    SymTable_Allocator allocator;
+    struct HugeArena *pArena;
+    SymTable_T oSymTable;
+
+    pArena = (struct HugeArena*)calloc(1, sizeof(struct HugeArena));
+    if(pArena == NULL){
+        return NULL;
+    }
+    pArena->iNode = iNumaNode;
+    pArena->uLive = 1;
+
+    allocator.pfAlloc = SymTableHuge_alloc;
+    allocator.pfFree = SymTableHuge_free;
+    allocator.pvContext = pArena;
+    oSymTable = SymTable_newWithAllocator(&allocator);
+
+    /* From here the table's own blocks keep the context alive, or, if
+       there is no table, nothing does */
+    SymTableHuge_release(pArena);
+    return oSymTable;
+}
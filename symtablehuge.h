@@ -0,0 +1,32 @@
+/*--------------------------------------------------------------------*/
+/*                                                                    */
+/* Header file for SymTable objects whose memory comes from huge      */
+/* pages, optionally on one NUMA node                                 */
+/*                                                                    */
+/* Author: Maxwell Lloyd                                              */
+/*                                                                    */
+/*--------------------------------------------------------------------*/
+
+
+#ifndef SYMTABLEHUGE_INCLUDED
+#define SYMTABLEHUGE_INCLUDED
+
+#include "symtable.h"
+
+/*--------------------------------------------------------------------*/
+
+/* Return a new empty SymTable object whose memory comes from 2MB
+   aligned mappings advised for transparent huge pages, or NULL if
+   there is not enough memory available. Blocks of a megabyte or more,
+   such as the bucket array of a large table, get mappings of their
+   own. Nodes and keys are carved from 2MB arenas, so that the
+   bindings of a table share few pages; the arenas are unmapped when
+   the table is freed. If iNumaNode is not negative the mappings prefer
+   that NUMA node. The kernel may ignore both requests, for example if
+   its huge page setting is "never" or the node does not exist, and
+   then the table simply uses ordinary pages. A table is used by one
+   thread at a time, as any other */
+SymTable_T SymTable_newHugePages(int iNumaNode);
+
+
+#endif
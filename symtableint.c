@@ -0,0 +1,450 @@
+/*--------------------------------------------------------------------*/
+/*                                                                    */
+/* Implementation of SymTableInt, an open addressing hash table with  */
+/* 64-bit integer keys, its keys and values in parallel arrays        */
+/*                                                                    */
+/* Author: Maxwell Lloyd                                              */
+/*                                                                    */
+/*--------------------------------------------------------------------*/
+
+
+
+#include <stddef.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "symtableint.h"
+
+/* Number of slots in a new table, a power of 2 */
+enum {INITIAL_CAPACITY = 16};
+
+/* The table grows before more than this percent of its slots are in
+   use */
+enum {MAX_LOAD_PERCENT = 75};
+
+/* 2^64 divided by the golden ratio. Multiplying by it and keeping the
+   top bits spreads consecutive keys evenly over the slots. */
+#define FIBONACCI_MULTIPLIER UINT64_C(11400714819323198485)
+
+/*--------------------------------------------------------------------*/
+
+/* SymTableInt object is a manager pointing to the slots of a
+   SymTableInt_T object. An empty slot holds the key 0, so a binding of
+   the key 0 is kept apart from the slots. */
+struct SymTableInt{
+    /* Key of each slot, or 0 if the slot is empty */
+    uint64_t *puKeys;
+
+    /* Value of each slot, in the same block as puKeys */
+    const void **ppvValues;
+
+    /* Number of slots, a power of 2 */
+    size_t uCapacity;
+
+    /* 64 minus the base 2 logarithm of uCapacity */
+    unsigned uShift;
+
+    /* Number of bindings, including the binding of 0 */
+    size_t size;
+
+    /* 1 if the key 0 is bound, or 0 otherwise */
+    int iHasZero;
+
+    /* Value of the key 0 if iHasZero */
+    const void *pvZeroValue;
+
+    /* Source of every block the table holds */
+    SymTable_Allocator allocator;
+
+    /* Bytes currently held from allocator */
+    size_t uBytes;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Return uSize bytes from malloc. pvContext is unused. */
+
+static void *SymTableInt_defaultAlloc(size_t uSize, void *pvContext)
+{
+    (void)pvContext;
+    return malloc(uSize);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Free pvBlock, which SymTableInt_defaultAlloc returned. */
+
+static void SymTableInt_defaultFree(void *pvBlock, size_t uSize,
+    void *pvContext)
+{
+    (void)uSize;
+    (void)pvContext;
+    free(pvBlock);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* The allocator of tables made by SymTableInt_new */
+static const SymTable_Allocator defaultAllocator = {
+    SymTableInt_defaultAlloc, SymTableInt_defaultFree, NULL};
+
+/*--------------------------------------------------------------------*/
+
+/* Return uSize bytes from the allocator of oSymTableInt, or NULL if it
+   refuses. */
+
+static void *SymTableInt_alloc(SymTableInt_T oSymTableInt, size_t uSize)
+{
+    void *pvBlock;
+
+    assert(oSymTableInt != NULL);
+
+    pvBlock = (*oSymTableInt->allocator.pfAlloc)(uSize,
+        oSymTableInt->allocator.pvContext);
+    if(pvBlock != NULL){
+        oSymTableInt->uBytes += uSize;
+    }
+    return pvBlock;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Give the uSize bytes at pvBlock back to the allocator of
+   oSymTableInt. */
+
+static void SymTableInt_release(SymTableInt_T oSymTableInt,
+    void *pvBlock, size_t uSize)
+{
+    assert(oSymTableInt != NULL);
+    assert(pvBlock != NULL);
+
+    oSymTableInt->uBytes -= uSize;
+    (*oSymTableInt->allocator.pfFree)(pvBlock, uSize,
+        oSymTableInt->allocator.pvContext);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the number of bytes the slots of a table of uCapacity slots
+   take. */
+
+static size_t SymTableInt_slotBytes(size_t uCapacity)
+{
+    return uCapacity * (sizeof(uint64_t) + sizeof(const void*));
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the slot where the search for uKey starts in oSymTableInt. */
+
+static size_t SymTableInt_home(SymTableInt_T oSymTableInt, uint64_t uKey)
+{
+    return (size_t)((uKey * FIBONACCI_MULTIPLIER) >> oSymTableInt->uShift);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the slot of oSymTableInt that holds the nonzero key uKey, or
+   the empty slot where it would go if it is not bound. */
+
+static size_t SymTableInt_find(SymTableInt_T oSymTableInt, uint64_t uKey)
+{
+    size_t uMask = oSymTableInt->uCapacity - 1;
+    size_t uSlot;
+
+    assert(uKey != 0);
+
+    for(uSlot = SymTableInt_home(oSymTableInt, uKey);
+        oSymTableInt->puKeys[uSlot] != 0; uSlot = (uSlot + 1) & uMask){
+        if(oSymTableInt->puKeys[uSlot] == uKey){
+            break;
+        }
+    }
+    return uSlot;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Make oSymTableInt use uCapacity new slots, allocated as one block of
+   keys followed by values, and move every binding into them. Returns
+   1 for success or 0 for failure, in which case nothing changes. */
+
+static int SymTableInt_rehash(SymTableInt_T oSymTableInt,
+    size_t uCapacity)
+{
+    uint64_t *puOldKeys;
+    const void **ppvOldValues;
+    size_t uOldCapacity;
+    size_t uSlot;
+    size_t u;
+    unsigned uShift;
+    void *pvBlock;
+
+    assert(oSymTableInt != NULL);
+
+    pvBlock = SymTableInt_alloc(oSymTableInt,
+        SymTableInt_slotBytes(uCapacity));
+    if(pvBlock == NULL){
+        return 0;
+    }
+
+    uShift = 64;
+    for(u = uCapacity; u > 1; u >>= 1){
+        uShift--;
+    }
+
+    puOldKeys = oSymTableInt->puKeys;
+    ppvOldValues = oSymTableInt->ppvValues;
+    uOldCapacity = oSymTableInt->uCapacity;
+
+    oSymTableInt->puKeys = (uint64_t*)pvBlock;
+    oSymTableInt->ppvValues = (const void**)(oSymTableInt->puKeys
+        + uCapacity);
+    oSymTableInt->uCapacity = uCapacity;
+    oSymTableInt->uShift = uShift;
+    memset(oSymTableInt->puKeys, 0, uCapacity * sizeof(uint64_t));
+
+    for(u = 0; u < uOldCapacity; u++){
+        if(puOldKeys[u] != 0){
+            uSlot = SymTableInt_find(oSymTableInt, puOldKeys[u]);
+            oSymTableInt->puKeys[uSlot] = puOldKeys[u];
+            oSymTableInt->ppvValues[uSlot] = ppvOldValues[u];
+        }
+    }
+
+    if(puOldKeys != NULL){
+        SymTableInt_release(oSymTableInt, puOldKeys,
+            SymTableInt_slotBytes(uOldCapacity));
+    }
+    return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+SymTableInt_T SymTableInt_new(void){
+    return SymTableInt_newWithAllocator(&defaultAllocator);
+}
+
+/*--------------------------------------------------------------------*/
+
+SymTableInt_T SymTableInt_newWithAllocator(
+    const SymTable_Allocator *pAllocator){
+    SymTableInt_T oSymTableInt;
+
+    assert(pAllocator != NULL);
+    assert(pAllocator->pfAlloc != NULL);
+    assert(pAllocator->pfFree != NULL);
+
+    oSymTableInt = (SymTableInt_T)(*pAllocator->pfAlloc)(
+        sizeof(struct SymTableInt), pAllocator->pvContext);
+    if(oSymTableInt == NULL){
+        return NULL;
+    }
+    oSymTableInt->allocator = *pAllocator;
+    oSymTableInt->uBytes = sizeof(struct SymTableInt);
+    oSymTableInt->puKeys = NULL;
+    oSymTableInt->ppvValues = NULL;
+    oSymTableInt->uCapacity = 0;
+    oSymTableInt->size = 0;
+    oSymTableInt->iHasZero = 0;
+    oSymTableInt->pvZeroValue = NULL;
+
+    if(! SymTableInt_rehash(oSymTableInt, INITIAL_CAPACITY)){
+        SymTableInt_release(oSymTableInt, oSymTableInt,
+            sizeof(struct SymTableInt));
+        return NULL;
+    }
+    return oSymTableInt;
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t SymTableInt_memoryUsage(SymTableInt_T oSymTableInt){
+    assert(oSymTableInt != NULL);
+
+    return oSymTableInt->uBytes;
+}
+
+/*--------------------------------------------------------------------*/
+
+void SymTableInt_free(SymTableInt_T oSymTableInt){
+    assert(oSymTableInt != NULL);
+
+    SymTableInt_release(oSymTableInt, oSymTableInt->puKeys,
+        SymTableInt_slotBytes(oSymTableInt->uCapacity));
+    SymTableInt_release(oSymTableInt, oSymTableInt,
+        sizeof(struct SymTableInt));
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t SymTableInt_getLength(SymTableInt_T oSymTableInt){
+    assert(oSymTableInt != NULL);
+
+    return oSymTableInt->size;
+}
+
+/*--------------------------------------------------------------------*/
+
+int SymTableInt_put(SymTableInt_T oSymTableInt, uint64_t uKey,
+    const void *pvValue){
+    size_t uSlot;
+
+    assert(oSymTableInt != NULL);
+
+    if(uKey == 0){
+        if(oSymTableInt->iHasZero){
+            return 0;
+        }
+        oSymTableInt->iHasZero = 1;
+        oSymTableInt->pvZeroValue = pvValue;
+        oSymTableInt->size++;
+        return 1;
+    }
+
+    uSlot = SymTableInt_find(oSymTableInt, uKey);
+    if(oSymTableInt->puKeys[uSlot] == uKey){
+        return 0;
+    }
+
+    /* Grow first, so the probe sequences stay short. If the slots
+       cannot grow, the binding still fits while one slot is empty. */
+    if((oSymTableInt->size + 1) * 100
+        > oSymTableInt->uCapacity * MAX_LOAD_PERCENT){
+        if(SymTableInt_rehash(oSymTableInt, oSymTableInt->uCapacity * 2)){
+            uSlot = SymTableInt_find(oSymTableInt, uKey);
+        }
+        else if(oSymTableInt->size + 1 >= oSymTableInt->uCapacity){
+            return 0;
+        }
+    }
+
+    oSymTableInt->puKeys[uSlot] = uKey;
+    oSymTableInt->ppvValues[uSlot] = pvValue;
+    oSymTableInt->size++;
+    return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *SymTableInt_replace(SymTableInt_T oSymTableInt, uint64_t uKey,
+    const void *pvValue){
+    const void *pvOldValue;
+    size_t uSlot;
+
+    assert(oSymTableInt != NULL);
+
+    if(uKey == 0){
+        if(! oSymTableInt->iHasZero){
+            return NULL;
+        }
+        pvOldValue = oSymTableInt->pvZeroValue;
+        oSymTableInt->pvZeroValue = pvValue;
+        return (void*)pvOldValue;
+    }
+
+    uSlot = SymTableInt_find(oSymTableInt, uKey);
+    if(oSymTableInt->puKeys[uSlot] != uKey){
+        return NULL;
+    }
+    pvOldValue = oSymTableInt->ppvValues[uSlot];
+    oSymTableInt->ppvValues[uSlot] = pvValue;
+    return (void*)pvOldValue;
+}
+
+/*--------------------------------------------------------------------*/
+
+int SymTableInt_contains(SymTableInt_T oSymTableInt, uint64_t uKey){
+    assert(oSymTableInt != NULL);
+
+    if(uKey == 0){
+        return oSymTableInt->iHasZero;
+    }
+    return oSymTableInt->puKeys[SymTableInt_find(oSymTableInt, uKey)]
+        == uKey;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *SymTableInt_get(SymTableInt_T oSymTableInt, uint64_t uKey){
+    size_t uSlot;
+
+    assert(oSymTableInt != NULL);
+
+    if(uKey == 0){
+        return oSymTableInt->iHasZero
+            ? (void*)oSymTableInt->pvZeroValue : NULL;
+    }
+
+    uSlot = SymTableInt_find(oSymTableInt, uKey);
+    if(oSymTableInt->puKeys[uSlot] != uKey){
+        return NULL;
+    }
+    return (void*)oSymTableInt->ppvValues[uSlot];
+}
+
+/*--------------------------------------------------------------------*/
+
+void *SymTableInt_remove(SymTableInt_T oSymTableInt, uint64_t uKey){
+    const void *pvOldValue;
+    size_t uMask;
+    size_t uHole;
+    size_t uSlot;
+    size_t uHome;
+
+    assert(oSymTableInt != NULL);
+
+    if(uKey == 0){
+        if(! oSymTableInt->iHasZero){
+            return NULL;
+        }
+        oSymTableInt->iHasZero = 0;
+        oSymTableInt->size--;
+        return (void*)oSymTableInt->pvZeroValue;
+    }
+
+    uHole = SymTableInt_find(oSymTableInt, uKey);
+    if(oSymTableInt->puKeys[uHole] != uKey){
+        return NULL;
+    }
+    pvOldValue = oSymTableInt->ppvValues[uHole];
+
+    /* Shift back every key after the hole that may move there, so no
+       probe sequence crosses an empty slot and no tombstones are
+       needed */
+    uMask = oSymTableInt->uCapacity - 1;
+    for(uSlot = (uHole + 1) & uMask; oSymTableInt->puKeys[uSlot] != 0;
+        uSlot = (uSlot + 1) & uMask){
+        uHome = SymTableInt_home(oSymTableInt, oSymTableInt->puKeys[uSlot]);
+        if(((uSlot - uHome) & uMask) >= ((uSlot - uHole) & uMask)){
+            oSymTableInt->puKeys[uHole] = oSymTableInt->puKeys[uSlot];
+            oSymTableInt->ppvValues[uHole] = oSymTableInt->ppvValues[uSlot];
+            uHole = uSlot;
+        }
+    }
+    oSymTableInt->puKeys[uHole] = 0;
+    oSymTableInt->size--;
+    return (void*)pvOldValue;
+}
+
+/*--------------------------------------------------------------------*/
+
+void SymTableInt_map(SymTableInt_T oSymTableInt,
+    void (*pfApply)(uint64_t uKey, void *pvValue, void *pvExtra),
+    const void *pvExtra){
+    size_t u;
+
+    assert(oSymTableInt != NULL);
+    assert(pfApply != NULL);
+
+    if(oSymTableInt->iHasZero){
+        (*pfApply)(0, (void*)oSymTableInt->pvZeroValue, (void*)pvExtra);
+    }
+    for(u = 0; u < oSymTableInt->uCapacity; u++){
+        if(oSymTableInt->puKeys[u] != 0){
+            (*pfApply)(oSymTableInt->puKeys[u],
+                (void*)oSymTableInt->ppvValues[u], (void*)pvExtra);
+        }
+    }
+}
@@ -0,0 +1,95 @@
+/*--------------------------------------------------------------------*/
+/*                                                                    */
+/* Header file for a table with the operations of the SymTable ADT    */
+/* whose keys are 64-bit integers instead of strings                  */
+/*                                                                    */
+/* Author: Maxwell Lloyd                                              */
+/*                                                                    */
+/*--------------------------------------------------------------------*/
+
+
+#ifndef SYMTABLEINT_INCLUDED
+#define SYMTABLEINT_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+#include "symtable.h"
+
+/*--------------------------------------------------------------------*/
+
+/* SymTableInt_T binds uint64_t keys to values. Keys are stored by
+   value, so there is nothing to copy or free for them */
+typedef struct SymTableInt* SymTableInt_T;
+
+/*--------------------------------------------------------------------*/
+
+/* Return a new empty SymTableInt object, or NULL if there is not
+   enough memory available */
+SymTableInt_T SymTableInt_new(void);
+
+/*--------------------------------------------------------------------*/
+
+/* Same as SymTableInt_new, but every block of the new object comes
+   from parameter pAllocator, as in SymTable_newWithAllocator */
+SymTableInt_T SymTableInt_newWithAllocator(
+    const SymTable_Allocator *pAllocator);
+
+/*--------------------------------------------------------------------*/
+
+/* Returns the number of bytes parameter oSymTableInt currently holds
+   from its allocator, including the object itself */
+size_t SymTableInt_memoryUsage(SymTableInt_T oSymTableInt);
+
+/*--------------------------------------------------------------------*/
+
+/* Free parameter oSymTableInt. The values are not freed */
+void SymTableInt_free(SymTableInt_T oSymTableInt);
+
+/*--------------------------------------------------------------------*/
+
+/* Returns the number of bindings in parameter oSymTableInt */
+size_t SymTableInt_getLength(SymTableInt_T oSymTableInt);
+
+/*--------------------------------------------------------------------*/
+
+/* Adds the binding of uKey to pvValue to parameter oSymTableInt if
+   uKey is not bound. Returns 1 if it was added, or 0 if uKey is bound
+   or there is not enough memory available */
+int SymTableInt_put(SymTableInt_T oSymTableInt, uint64_t uKey,
+    const void *pvValue);
+
+/*--------------------------------------------------------------------*/
+
+/* Replaces the value of uKey in parameter oSymTableInt with pvValue
+   and returns the old value, or returns NULL if uKey is not bound */
+void *SymTableInt_replace(SymTableInt_T oSymTableInt, uint64_t uKey,
+    const void *pvValue);
+
+/*--------------------------------------------------------------------*/
+
+/* Returns 1 if uKey is bound in parameter oSymTableInt, or 0
+   otherwise */
+int SymTableInt_contains(SymTableInt_T oSymTableInt, uint64_t uKey);
+
+/*--------------------------------------------------------------------*/
+
+/* Returns the value of uKey in parameter oSymTableInt, or NULL if
+   uKey is not bound */
+void *SymTableInt_get(SymTableInt_T oSymTableInt, uint64_t uKey);
+
+/*--------------------------------------------------------------------*/
+
+/* Removes the binding of uKey from parameter oSymTableInt and returns
+   its value, or returns NULL if uKey is not bound */
+void *SymTableInt_remove(SymTableInt_T oSymTableInt, uint64_t uKey);
+
+/*--------------------------------------------------------------------*/
+
+/* Uses the function pfApply on every binding of the parameter
+   oSymTableInt, using function pfApply(uKey, pvValue, pvExtra) */
+void SymTableInt_map(SymTableInt_T oSymTableInt,
+    void (*pfApply)(uint64_t uKey, void *pvValue, void *pvExtra),
+    const void *pvExtra);
+
+
+#endif
@@ -14,7 +14,7 @@
 #include <assert.h>
 #include <stdlib.h>
 #include <string.h>
-#include "symtable.h"
+#include "symtablehandle.h"
 
 /*--------------------------------------------------------------------*/
 
@@ -28,6 +28,10 @@ struct SymTableNode{
 
    /* The address of the next SymTableNode. */
    struct SymTableNode *pNextNode;
+
+   /* The address of the previous SymTableNode, or NULL for the first,
+      so that a handle can unlink its node without walking the list */
+   struct SymTableNode *pPrevNode;
 };
 
 /*--------------------------------------------------------------------*/
@@ -40,24 +44,129 @@ struct SymTable{
 
     /* size of the entire symtable */
     size_t size;
+
+    /* Source of every block the table holds */
+    SymTable_Allocator allocator;
+
+    /* Bytes currently held from allocator */
+    size_t uBytes;
 };
 
 /*--------------------------------------------------------------------*/
 
+/* Return uSize bytes from malloc. pvContext is unused. */
+
+static void *SymTable_defaultAlloc(size_t uSize, void *pvContext)
+{
+    (void)pvContext;
+    return malloc(uSize);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Free pvBlock, which SymTable_defaultAlloc returned. */
+
+static void SymTable_defaultFree(void *pvBlock, size_t uSize,
+    void *pvContext)
+{
+    (void)uSize;
+    (void)pvContext;
+    free(pvBlock);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* The allocator of tables made by SymTable_new */
+static const SymTable_Allocator defaultAllocator = {
+    SymTable_defaultAlloc, SymTable_defaultFree, NULL};
+
+/*--------------------------------------------------------------------*/
+
+/* Return uSize bytes from the allocator of oSymTable, or NULL if it 
+   refuses. */
+
+static void *SymTable_alloc(SymTable_T oSymTable, size_t uSize)
+{
+    void *pvBlock;
+
+    assert(oSymTable != NULL);
+
+    pvBlock = (*oSymTable->allocator.pfAlloc)(uSize,
+        oSymTable->allocator.pvContext);
+    if(pvBlock != NULL){
+        oSymTable->uBytes += uSize;
+    }
+    return pvBlock;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Give the uSize bytes at pvBlock back to the allocator of 
+   oSymTable. */
+
+static void SymTable_release(SymTable_T oSymTable, void *pvBlock,
+    size_t uSize)
+{
+    assert(oSymTable != NULL);
+    assert(pvBlock != NULL);
+
+    oSymTable->uBytes -= uSize;
+    (*oSymTable->allocator.pfFree)(pvBlock, uSize,
+        oSymTable->allocator.pvContext);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Free pNode of oSymTable and its key. */
+
+static void SymTable_freeNode(SymTable_T oSymTable,
+    struct SymTableNode *pNode)
+{
+    assert(oSymTable != NULL);
+    assert(pNode != NULL);
+
+    SymTable_release(oSymTable, (void*)pNode->pKey,
+        strlen(pNode->pKey) + 1);
+    SymTable_release(oSymTable, pNode, sizeof(struct SymTableNode));
+}
+
+/*--------------------------------------------------------------------*/
+
 SymTable_T SymTable_new(void){
+    return SymTable_newWithAllocator(&defaultAllocator);
+}
+
+/*--------------------------------------------------------------------*/
+
+SymTable_T SymTable_newWithAllocator(const SymTable_Allocator *pAllocator){
     SymTable_T oSymTable;
 
-    oSymTable = (SymTable_T)malloc(sizeof(struct SymTable));
+    assert(pAllocator != NULL);
+    assert(pAllocator->pfAlloc != NULL);
+    assert(pAllocator->pfFree != NULL);
+
+    oSymTable = (SymTable_T)(*pAllocator->pfAlloc)(sizeof(struct SymTable),
+        pAllocator->pvContext);
     if (oSymTable == NULL)
        return NULL;
  
     oSymTable->pFirstNode = NULL;
     oSymTable->size = 0;
+    oSymTable->allocator = *pAllocator;
+    oSymTable->uBytes = sizeof(struct SymTable);
     return oSymTable;
 }
 
 /*--------------------------------------------------------------------*/
 
+size_t SymTable_memoryUsage(SymTable_T oSymTable){
+    assert(oSymTable != NULL);
+
+    return oSymTable->uBytes;
+}
+
+/*--------------------------------------------------------------------*/
+
 void SymTable_free(SymTable_T oSymTable){
     struct SymTableNode *pCurrentNode;
     struct SymTableNode *pNextNode;
@@ -69,11 +178,10 @@ void SymTable_free(SymTable_T oSymTable){
          pCurrentNode = pNextNode)
     {
        pNextNode = pCurrentNode->pNextNode;
-       free((void*)pCurrentNode->pKey);
-       free(pCurrentNode);
+       SymTable_freeNode(oSymTable, pCurrentNode);
     }
 
-    free(oSymTable);
+    SymTable_release(oSymTable, oSymTable, sizeof(struct SymTable));
 }
 
 /*--------------------------------------------------------------------*/
@@ -88,6 +196,16 @@ size_t SymTable_getLength(SymTable_T oSymTable){
 
 int SymTable_put(SymTable_T oSymTable, const char *pcKey, 
     const void *pvValue){
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    return SymTable_putHandle(oSymTable, pcKey, pvValue) != NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+SymTable_Handle SymTable_putHandle(SymTable_T oSymTable,
+    const char *pcKey, const void *pvValue){
     struct SymTableNode *pNewNode;
     char *pKey;
     size_t strLength;
@@ -96,29 +214,34 @@ int SymTable_put(SymTable_T oSymTable, const char *pcKey,
     assert(pcKey != NULL);
 
     if(SymTable_contains(oSymTable, pcKey)){
-        return 0;
+        return NULL;
     }
 
-    pNewNode = (struct SymTableNode*)malloc(sizeof(struct SymTableNode));
+    pNewNode = (struct SymTableNode*)SymTable_alloc(oSymTable,
+        sizeof(struct SymTableNode));
     if(pNewNode == NULL){
-        return 0;
+        return NULL;
     }
 
     /* Defensive copy */
     strLength = strlen(pcKey) + 1;
-    pKey = (char*) malloc(strLength * sizeof(char));
+    pKey = (char*)SymTable_alloc(oSymTable, strLength * sizeof(char));
     if(pKey == NULL){
-        free(pNewNode);
-        return 0;
+        SymTable_release(oSymTable, pNewNode, sizeof(struct SymTableNode));
+        return NULL;
     }
     strcpy(pKey, pcKey);
 
     pNewNode->pKey = pKey;
     pNewNode->pValue = pvValue;
     pNewNode->pNextNode = oSymTable->pFirstNode;
+    pNewNode->pPrevNode = NULL;
+    if(oSymTable->pFirstNode != NULL){
+        oSymTable->pFirstNode->pPrevNode = pNewNode;
+    }
     oSymTable->pFirstNode = pNewNode;
     oSymTable->size++;
-    return 1;
+    return pNewNode;
 }
 
 /*--------------------------------------------------------------------*/
@@ -182,33 +305,16 @@ void *SymTable_get(SymTable_T oSymTable, const char *pcKey){
 /*--------------------------------------------------------------------*/
 
 void *SymTable_remove(SymTable_T oSymTable, const char *pcKey){
-    struct SymTableNode *pPrevNode;
     struct SymTableNode *pCurrentNode;
-    const void* pOldValue;
 
     assert(oSymTable != NULL);
     assert(pcKey != NULL);
 
-    pCurrentNode = oSymTable->pFirstNode;
-    pPrevNode = NULL;
-    while(pCurrentNode != NULL){
-        if(strcmp(pCurrentNode->pKey, pcKey) == 0){
-            pOldValue = pCurrentNode->pValue;
-            if(pPrevNode == NULL){
-                oSymTable->pFirstNode = pCurrentNode->pNextNode;
-            }
-            else{
-                pPrevNode->pNextNode = pCurrentNode->pNextNode;
-            }
-            free((void*)pCurrentNode->pKey);
-            free(pCurrentNode);
-            oSymTable->size--;
-            return (void*) pOldValue;
-        }
-        pPrevNode = pCurrentNode;
-        pCurrentNode = pCurrentNode->pNextNode;
+    pCurrentNode = SymTable_find(oSymTable, pcKey);
+    if(pCurrentNode == NULL){
+        return NULL;
     }
-    return NULL;
+    return SymTable_handleRemove(oSymTable, pCurrentNode);
 }
 
 /*--------------------------------------------------------------------*/
@@ -226,4 +332,105 @@ void SymTable_map(SymTable_T oSymTable, void (*pfApply)
         (*pfApply)(pCurrentNode->pKey, (void*)pCurrentNode->pValue, (void*) pvExtra);
         pCurrentNode = pCurrentNode->pNextNode;
     }
-}
\ No newline at end of file
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t SymTable_removeIf(SymTable_T oSymTable, int (*pfPredicate)
+    (const char *pcKey, void *pvValue, void *pvExtra),
+    const void *pvExtra, void (*pfRemoved)
+    (const char *pcKey, void *pvValue, void *pvExtra)){
+    struct SymTableNode **ppLink;
+    struct SymTableNode *pCurrentNode;
+    struct SymTableNode *pPrevNode = NULL;
+    size_t uRemoved = 0;
+
+    assert(oSymTable != NULL);
+    assert(pfPredicate != NULL);
+
+    /* Each node kept is linked back to the one kept before it */
+    ppLink = &oSymTable->pFirstNode;
+    while((pCurrentNode = *ppLink) != NULL){
+        if(! (*pfPredicate)(pCurrentNode->pKey,
+            (void*)pCurrentNode->pValue, (void*) pvExtra)){
+            pCurrentNode->pPrevNode = pPrevNode;
+            pPrevNode = pCurrentNode;
+            ppLink = &pCurrentNode->pNextNode;
+            continue;
+        }
+        *ppLink = pCurrentNode->pNextNode;
+        if(pfRemoved != NULL){
+            (*pfRemoved)(pCurrentNode->pKey, (void*)pCurrentNode->pValue,
+                (void*) pvExtra);
+        }
+        SymTable_freeNode(oSymTable, pCurrentNode);
+        uRemoved++;
+    }
+    oSymTable->size -= uRemoved;
+    return uRemoved;
+}
+
+/*--------------------------------------------------------------------*/
+
+SymTable_Handle SymTable_find(SymTable_T oSymTable, const char *pcKey){
+    struct SymTableNode *pCurrentNode;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    pCurrentNode = oSymTable->pFirstNode;
+    while(pCurrentNode != NULL){
+        if(strcmp(pCurrentNode->pKey, pcKey) == 0){
+            return pCurrentNode;
+        }
+        pCurrentNode = pCurrentNode->pNextNode;
+    }
+    return NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *SymTable_handleValue(SymTable_T oSymTable, SymTable_Handle oHandle){
+    /* The list needs no table to reach a binding */
+    (void)oSymTable;
+    assert(oHandle != NULL);
+
+    return (void*)oHandle->pValue;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *SymTable_handleReplace(SymTable_T oSymTable, SymTable_Handle oHandle,
+    const void *pvValue){
+    const void* pOldValue;
+
+    (void)oSymTable;
+    assert(oHandle != NULL);
+
+    pOldValue = oHandle->pValue;
+    oHandle->pValue = pvValue;
+    return (void*) pOldValue;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *SymTable_handleRemove(SymTable_T oSymTable, SymTable_Handle oHandle){
+    const void* pOldValue;
+
+    assert(oSymTable != NULL);
+    assert(oHandle != NULL);
+
+    pOldValue = oHandle->pValue;
+    if(oHandle->pPrevNode == NULL){
+        oSymTable->pFirstNode = oHandle->pNextNode;
+    }
+    else{
+        oHandle->pPrevNode->pNextNode = oHandle->pNextNode;
+    }
+    if(oHandle->pNextNode != NULL){
+        oHandle->pNextNode->pPrevNode = oHandle->pPrevNode;
+    }
+    SymTable_freeNode(oSymTable, oHandle);
+    oSymTable->size--;
+    return (void*) pOldValue;
+}
@@ -0,0 +1,668 @@
+/*--------------------------------------------------------------------*/
+/*                                                                    */
+/* Append-only log that makes the changes to a hash table SymTable    */
+/* object survive a restart                                           */
+/*                                                                    */
+/* Author: Maxwell Lloyd                                              */
+/*                                                                    */
+/*--------------------------------------------------------------------*/
+
+
+
+/* open, fstat, fsync and rename of a log file are POSIX */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stddef.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "symtablelog.h"
+
+/*--------------------------------------------------------------------*/
+
+/* Identifies a log file written by a SymTableLog object */
+static const char LOG_MAGIC[8] = {'S', 'Y', 'M', 'L', 'O', 'G', 0, 1};
+
+/* A log compacts itself once it holds more than LOG_COMPACT_FACTOR
+   records per binding, plus LOG_COMPACT_SLACK */
+enum {LOG_COMPACT_FACTOR = 4, LOG_COMPACT_SLACK = 4096};
+
+/* While compacting, the buffer is written out once it holds this many
+   bytes */
+enum {LOG_FLUSH_BYTES = 1 << 16};
+
+/* Kinds of change a LogRecord describes */
+enum {LOG_PUT = 1, LOG_REPLACE = 2, LOG_REMOVE = 3};
+
+/* A log starts with a LogHeader */
+struct LogHeader{
+    /* LOG_MAGIC */
+    char acMagic[8];
+
+    /* Number of bindings written when the log was last compacted,
+       used to presize the table during recovery */
+    uint64_t uCount;
+};
+
+/* Each change is a LogRecord followed by the key, without its '\0',
+   and the value bytes */
+struct LogRecord{
+    /* Checksum of the rest of the record, to detect a torn write */
+    uint32_t uChecksum;
+
+    /* LOG_PUT, LOG_REPLACE or LOG_REMOVE */
+    uint32_t uOp;
+
+    /* Length of the key */
+    uint32_t uKeyLength;
+
+    /* Length of the value bytes */
+    uint32_t uValueLength;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* SymTableLog object is a manager for the log file of one table */
+struct SymTableLog{
+    /* The table whose changes are recorded */
+    SymTable_T oSymTable;
+
+    /* Path of the log file */
+    char *pcPath;
+
+    /* Descriptor the log file is appended through */
+    int iFd;
+
+    /* Gives the bytes written for each value */
+    SymTable_ValueSerializer pfSerialize;
+
+    /* Records not yet written to the file */
+    unsigned char *pucBuffer;
+
+    /* Bytes used in pucBuffer */
+    size_t uBufferLength;
+
+    /* Bytes allocated for pucBuffer */
+    size_t uBufferSize;
+
+    /* Number of records in pucBuffer */
+    size_t uPending;
+
+    /* Number of records written before the file is synced */
+    size_t uGroupSize;
+
+    /* Number of records in the file and in pucBuffer */
+    size_t uRecords;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Return the checksum of pRecord's kind and lengths, followed by the
+   uKeyLength bytes at pvKey and the uValueLength bytes at pvValue. */
+
+static uint32_t SymTableLog_checksum(const struct LogRecord *pRecord,
+    const void *pvKey, const void *pvValue)
+{
+    const uint32_t FNV_PRIME = 16777619u;
+    const unsigned char *pucBytes;
+    uint32_t auFields[3];
+    uint32_t uHash = 2166136261u;
+    size_t u;
+
+    assert(pRecord != NULL);
+
+    auFields[0] = pRecord->uOp;
+    auFields[1] = pRecord->uKeyLength;
+    auFields[2] = pRecord->uValueLength;
+
+    pucBytes = (const unsigned char*)auFields;
+    for(u = 0; u < sizeof(auFields); u++){
+        uHash = (uHash ^ pucBytes[u]) * FNV_PRIME;
+    }
+    pucBytes = (const unsigned char*)pvKey;
+    for(u = 0; u < pRecord->uKeyLength; u++){
+        uHash = (uHash ^ pucBytes[u]) * FNV_PRIME;
+    }
+    pucBytes = (const unsigned char*)pvValue;
+    for(u = 0; u < pRecord->uValueLength; u++){
+        uHash = (uHash ^ pucBytes[u]) * FNV_PRIME;
+    }
+    return uHash;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Write the uLength bytes at pvBytes to the descriptor iFd. Returns
+   the number of bytes written, which is less than uLength only if a
+   write failed. */
+
+static size_t SymTableLog_writeAll(int iFd, const void *pvBytes,
+    size_t uLength)
+{
+    const unsigned char *pucBytes = (const unsigned char*)pvBytes;
+    size_t uWritten = 0;
+    ssize_t iWritten;
+
+    while(uWritten < uLength){
+        iWritten = write(iFd, pucBytes + uWritten, uLength - uWritten);
+        if(iWritten < 0){
+            if(errno == EINTR){
+                continue;
+            }
+            break;
+        }
+        uWritten += (size_t)iWritten;
+    }
+    return uWritten;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Write the buffered records of oSymTableLog to its file. Returns 1
+   for success, 0 for failure. The bytes that did reach the file are
+   dropped from the buffer either way, so that a retry continues right
+   after them instead of writing them again. */
+
+static int SymTableLog_flush(SymTableLog_T oSymTableLog)
+{
+    size_t uWritten;
+
+    assert(oSymTableLog != NULL);
+
+    uWritten = SymTableLog_writeAll(oSymTableLog->iFd,
+        oSymTableLog->pucBuffer, oSymTableLog->uBufferLength);
+    oSymTableLog->uBufferLength -= uWritten;
+    if(oSymTableLog->uBufferLength != 0){
+        memmove(oSymTableLog->pucBuffer,
+            oSymTableLog->pucBuffer + uWritten,
+            oSymTableLog->uBufferLength);
+        return 0;
+    }
+    return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Append a record of kind uOp for pcKey and the serialized pvValue to
+   the buffer of oSymTableLog. Returns 1 for success, 0 for failure. */
+
+static int SymTableLog_append(SymTableLog_T oSymTableLog, uint32_t uOp,
+    const char *pcKey, const void *pvValue)
+{
+    struct LogRecord record;
+    const void *pvBytes = NULL;
+    unsigned char *pucNewBuffer;
+    size_t uValueLength = 0;
+    size_t uKeyLength;
+    size_t uNeeded;
+    size_t uNewSize;
+
+    assert(oSymTableLog != NULL);
+    assert(pcKey != NULL);
+
+    uKeyLength = strlen(pcKey);
+    if(uOp != LOG_REMOVE){
+        uValueLength = (*oSymTableLog->pfSerialize)(pvValue, &pvBytes);
+    }
+    if(uKeyLength > UINT32_MAX || uValueLength > UINT32_MAX){
+        return 0;
+    }
+
+    /* Grow the buffer by doubling */
+    uNeeded = oSymTableLog->uBufferLength + sizeof(record) + uKeyLength
+        + uValueLength;
+    if(uNeeded > oSymTableLog->uBufferSize){
+        uNewSize = oSymTableLog->uBufferSize * 2;
+        if(uNewSize < uNeeded){
+            uNewSize = uNeeded;
+        }
+        pucNewBuffer = realloc(oSymTableLog->pucBuffer, uNewSize);
+        if(pucNewBuffer == NULL){
+            return 0;
+        }
+        oSymTableLog->pucBuffer = pucNewBuffer;
+        oSymTableLog->uBufferSize = uNewSize;
+    }
+
+    record.uOp = uOp;
+    record.uKeyLength = (uint32_t)uKeyLength;
+    record.uValueLength = (uint32_t)uValueLength;
+    record.uChecksum = SymTableLog_checksum(&record, pcKey, pvBytes);
+
+    memcpy(oSymTableLog->pucBuffer + oSymTableLog->uBufferLength,
+        &record, sizeof(record));
+    oSymTableLog->uBufferLength += sizeof(record);
+    memcpy(oSymTableLog->pucBuffer + oSymTableLog->uBufferLength,
+        pcKey, uKeyLength);
+    oSymTableLog->uBufferLength += uKeyLength;
+    if(uValueLength != 0){
+        memcpy(oSymTableLog->pucBuffer + oSymTableLog->uBufferLength,
+            pvBytes, uValueLength);
+        oSymTableLog->uBufferLength += uValueLength;
+    }
+
+    oSymTableLog->uPending++;
+    oSymTableLog->uRecords++;
+    return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Count a change recorded in oSymTableLog, committing the group once
+   it is full. Returns 1 for success, 0 for failure, in which case the
+   group stays waiting for the next sync. */
+
+static int SymTableLog_commit(SymTableLog_T oSymTableLog)
+{
+    assert(oSymTableLog != NULL);
+
+    if(oSymTableLog->uPending < oSymTableLog->uGroupSize){
+        return 1;
+    }
+    return SymTableLog_sync(oSymTableLog);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Append a LOG_PUT record for pcKey and pvValue to the SymTableLog
+   pvExtra while it is being compacted. */
+
+static void SymTableLog_appendBinding(const char *pcKey, void *pvValue,
+    void *pvExtra)
+{
+    SymTableLog_T oSymTableLog = (SymTableLog_T)pvExtra;
+
+    assert(pcKey != NULL);
+    assert(pvExtra != NULL);
+
+    /* A failed flush leaves iFd at -1 */
+    if(oSymTableLog->iFd < 0){
+        return;
+    }
+    if(!SymTableLog_append(oSymTableLog, LOG_PUT, pcKey, pvValue)
+        || (oSymTableLog->uBufferLength >= LOG_FLUSH_BYTES
+            && !SymTableLog_flush(oSymTableLog))){
+        oSymTableLog->iFd = -1;
+    }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Sync the directory that holds pcPath, so that a rename into it is
+   kept. Returns 1 for success, 0 for failure. */
+
+static int SymTableLog_syncDirectory(const char *pcPath)
+{
+    const char *pcSlash;
+    char *pcDirectory;
+    size_t uLength;
+    int iFd;
+    int success;
+
+    assert(pcPath != NULL);
+
+    pcSlash = strrchr(pcPath, '/');
+    uLength = (pcSlash == NULL) ? 1 : (size_t)(pcSlash - pcPath) + 1;
+    pcDirectory = malloc(uLength + 1);
+    if(pcDirectory == NULL){
+        return 0;
+    }
+    if(pcSlash == NULL){
+        strcpy(pcDirectory, ".");
+    }
+    else{
+        memcpy(pcDirectory, pcPath, uLength);
+        pcDirectory[uLength] = '\0';
+    }
+
+    iFd = open(pcDirectory, O_RDONLY);
+    free(pcDirectory);
+    if(iFd < 0){
+        return 0;
+    }
+    success = fsync(iFd) == 0;
+    close(iFd);
+    return success;
+}
+
+/*--------------------------------------------------------------------*/
+
+SymTable_T SymTable_recover(const char *pcPath,
+    SymTable_ValueDeserializer pfDeserialize,
+    void (*pfFree)(void *pvValue)){
+    SymTable_T oSymTable;
+    struct LogHeader header;
+    struct LogRecord record;
+    unsigned char *pucBytes = NULL;
+    unsigned char *pucNewBytes;
+    size_t uBytesSize = 0;
+    size_t uLength;
+    off_t iLeft;
+    void *pvValue;
+    void *pvOld;
+    int success = 0;
+    FILE *psFile;
+    struct stat fileStat;
+
+    assert(pcPath != NULL);
+    assert(pfDeserialize != NULL);
+
+    oSymTable = SymTable_new();
+    if(oSymTable == NULL){
+        return NULL;
+    }
+
+    psFile = fopen(pcPath, "rb");
+    if(psFile == NULL){
+        if(errno == ENOENT){
+            return oSymTable;
+        }
+        SymTable_free(oSymTable);
+        return NULL;
+    }
+
+    if(fstat(fileno(psFile), &fileStat) != 0
+        || fread(&header, sizeof(header), 1, psFile) != 1
+        || memcmp(header.acMagic, LOG_MAGIC, sizeof(LOG_MAGIC)) != 0
+        || !SymTable_reserve(oSymTable, (size_t)header.uCount)){
+        goto cleanup;
+    }
+    iLeft = fileStat.st_size - (off_t)sizeof(header);
+
+    while(fread(&record, sizeof(record), 1, psFile) == 1){
+        /* A record longer than the rest of the file is damaged, and is
+           the end of the log; its lengths are not allocated */
+        iLeft -= (off_t)sizeof(record);
+        if((off_t)record.uKeyLength + (off_t)record.uValueLength
+            > iLeft){
+            break;
+        }
+        iLeft -= (off_t)record.uKeyLength + (off_t)record.uValueLength;
+
+        /* The key gets a '\0' after it */
+        uLength = (size_t)record.uKeyLength + record.uValueLength + 1;
+        if(uLength > uBytesSize){
+            pucNewBytes = realloc(pucBytes, uLength);
+            if(pucNewBytes == NULL){
+                goto cleanup;
+            }
+            pucBytes = pucNewBytes;
+            uBytesSize = uLength;
+        }
+        /* A short or damaged record is the end of the log */
+        if(fread(pucBytes, 1, uLength - 1, psFile) != uLength - 1){
+            break;
+        }
+        memmove(pucBytes + record.uKeyLength + 1,
+            pucBytes + record.uKeyLength, record.uValueLength);
+        pucBytes[record.uKeyLength] = '\0';
+        if(record.uChecksum != SymTableLog_checksum(&record, pucBytes,
+            pucBytes + record.uKeyLength + 1)){
+            break;
+        }
+
+        if(record.uOp == LOG_REMOVE){
+            pvOld = SymTable_remove(oSymTable, (char*)pucBytes);
+            if(pvOld != NULL && pfFree != NULL){
+                (*pfFree)(pvOld);
+            }
+            continue;
+        }
+
+        pvValue = NULL;
+        if(record.uValueLength != 0){
+            pvValue = (*pfDeserialize)(pucBytes + record.uKeyLength + 1,
+                record.uValueLength);
+        }
+        if(record.uOp == LOG_PUT){
+            if(!SymTable_put(oSymTable, (char*)pucBytes, pvValue)){
+                if(pvValue != NULL && pfFree != NULL){
+                    (*pfFree)(pvValue);
+                }
+                if(!SymTable_contains(oSymTable, (char*)pucBytes)){
+                    goto cleanup;
+                }
+            }
+        }
+        else{
+            pvOld = SymTable_replace(oSymTable, (char*)pucBytes, pvValue);
+            if(pvOld != NULL && pfFree != NULL){
+                (*pfFree)(pvOld);
+            }
+        }
+    }
+    success = !ferror(psFile);
+
+cleanup:
+    fclose(psFile);
+    free(pucBytes);
+    if(!success){
+        SymTable_free(oSymTable);
+        return NULL;
+    }
+    return oSymTable;
+}
+
+/*--------------------------------------------------------------------*/
+
+SymTableLog_T SymTableLog_open(SymTable_T oSymTable, const char *pcPath,
+    SymTable_ValueSerializer pfSerialize, size_t uGroupSize){
+    SymTableLog_T oSymTableLog;
+
+    assert(oSymTable != NULL);
+    assert(pcPath != NULL);
+    assert(pfSerialize != NULL);
+
+    oSymTableLog = (SymTableLog_T)malloc(sizeof(struct SymTableLog));
+    if(oSymTableLog == NULL){
+        return NULL;
+    }
+    oSymTableLog->pcPath = malloc(strlen(pcPath) + 1);
+    if(oSymTableLog->pcPath == NULL){
+        free(oSymTableLog);
+        return NULL;
+    }
+    strcpy(oSymTableLog->pcPath, pcPath);
+
+    oSymTableLog->oSymTable = oSymTable;
+    oSymTableLog->iFd = -1;
+    oSymTableLog->pfSerialize = pfSerialize;
+    oSymTableLog->pucBuffer = NULL;
+    oSymTableLog->uBufferLength = 0;
+    oSymTableLog->uBufferSize = 0;
+    oSymTableLog->uPending = 0;
+    oSymTableLog->uGroupSize = (uGroupSize == 0) ? 1 : uGroupSize;
+    oSymTableLog->uRecords = 0;
+
+    /* Start from a log that matches the table exactly */
+    if(!SymTableLog_compact(oSymTableLog)){
+        free(oSymTableLog->pucBuffer);
+        free(oSymTableLog->pcPath);
+        free(oSymTableLog);
+        return NULL;
+    }
+    return oSymTableLog;
+}
+
+/*--------------------------------------------------------------------*/
+
+int SymTableLog_close(SymTableLog_T oSymTableLog){
+    int success;
+
+    assert(oSymTableLog != NULL);
+
+    success = SymTableLog_sync(oSymTableLog);
+    if(oSymTableLog->iFd >= 0 && close(oSymTableLog->iFd) != 0){
+        success = 0;
+    }
+    free(oSymTableLog->pucBuffer);
+    free(oSymTableLog->pcPath);
+    free(oSymTableLog);
+    return success;
+}
+
+/*--------------------------------------------------------------------*/
+
+int SymTableLog_put(SymTableLog_T oSymTableLog, const char *pcKey,
+    const void *pvValue){
+    assert(oSymTableLog != NULL);
+    assert(pcKey != NULL);
+
+    if(!SymTable_put(oSymTableLog->oSymTable, pcKey, pvValue)){
+        return 0;
+    }
+    if(!SymTableLog_append(oSymTableLog, LOG_PUT, pcKey, pvValue)){
+        SymTable_remove(oSymTableLog->oSymTable, pcKey);
+        return 0;
+    }
+    /* A failed commit is reported by the next sync */
+    (void)SymTableLog_commit(oSymTableLog);
+    return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *SymTableLog_replace(SymTableLog_T oSymTableLog,
+    const char *pcKey, const void *pvValue){
+    void *pvOld;
+
+    assert(oSymTableLog != NULL);
+    assert(pcKey != NULL);
+
+    if(!SymTable_contains(oSymTableLog->oSymTable, pcKey)){
+        return NULL;
+    }
+    pvOld = SymTable_replace(oSymTableLog->oSymTable, pcKey, pvValue);
+    if(!SymTableLog_append(oSymTableLog, LOG_REPLACE, pcKey, pvValue)){
+        SymTable_replace(oSymTableLog->oSymTable, pcKey, pvOld);
+        return NULL;
+    }
+    (void)SymTableLog_commit(oSymTableLog);
+    return pvOld;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *SymTableLog_remove(SymTableLog_T oSymTableLog, const char *pcKey){
+    void *pvOld;
+
+    assert(oSymTableLog != NULL);
+    assert(pcKey != NULL);
+
+    if(!SymTable_contains(oSymTableLog->oSymTable, pcKey)){
+        return NULL;
+    }
+    if(!SymTableLog_append(oSymTableLog, LOG_REMOVE, pcKey, NULL)){
+        return NULL;
+    }
+    pvOld = SymTable_remove(oSymTableLog->oSymTable, pcKey);
+    (void)SymTableLog_commit(oSymTableLog);
+    return pvOld;
+}
+
+/*--------------------------------------------------------------------*/
+
+int SymTableLog_sync(SymTableLog_T oSymTableLog){
+    assert(oSymTableLog != NULL);
+
+    if(oSymTableLog->iFd < 0){
+        return 0;
+    }
+    if(oSymTableLog->uPending == 0){
+        return 1;
+    }
+    if(!SymTableLog_flush(oSymTableLog)
+        || fdatasync(oSymTableLog->iFd) != 0){
+        return 0;
+    }
+    oSymTableLog->uPending = 0;
+
+    /* Every change is on disk now; a log left long is compacted by a
+       later sync */
+    if(oSymTableLog->uRecords > LOG_COMPACT_FACTOR
+        * SymTable_getLength(oSymTableLog->oSymTable)
+        + LOG_COMPACT_SLACK){
+        (void)SymTableLog_compact(oSymTableLog);
+    }
+    return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+int SymTableLog_compact(SymTableLog_T oSymTableLog){
+    struct LogHeader header;
+    char *pcTempPath;
+    size_t uOldRecords;
+    int iOldFd;
+    int iFd;
+
+    assert(oSymTableLog != NULL);
+
+    /* Nothing waiting may be lost if compaction fails */
+    if(oSymTableLog->uPending != 0 && !SymTableLog_sync(oSymTableLog)){
+        return 0;
+    }
+
+    pcTempPath = malloc(strlen(oSymTableLog->pcPath) + sizeof(".tmp"));
+    if(pcTempPath == NULL){
+        return 0;
+    }
+    strcpy(pcTempPath, oSymTableLog->pcPath);
+    strcat(pcTempPath, ".tmp");
+
+    iFd = open(pcTempPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(iFd < 0){
+        free(pcTempPath);
+        return 0;
+    }
+
+    memcpy(header.acMagic, LOG_MAGIC, sizeof(header.acMagic));
+    header.uCount = SymTable_getLength(oSymTableLog->oSymTable);
+
+    /* Write the current bindings through the buffer into the new file,
+       keeping the old descriptor aside in case this fails */
+    iOldFd = oSymTableLog->iFd;
+    uOldRecords = oSymTableLog->uRecords;
+    oSymTableLog->iFd = iFd;
+    oSymTableLog->uRecords = 0;
+    if(SymTableLog_writeAll(iFd, &header, sizeof(header))
+        == sizeof(header)){
+        SymTable_map(oSymTableLog->oSymTable, SymTableLog_appendBinding,
+            oSymTableLog);
+    }
+    else{
+        oSymTableLog->iFd = -1;
+    }
+    if(oSymTableLog->iFd < 0 || !SymTableLog_flush(oSymTableLog)
+        || fsync(iFd) != 0
+        || rename(pcTempPath, oSymTableLog->pcPath) != 0){
+        close(iFd);
+        remove(pcTempPath);
+        free(pcTempPath);
+        oSymTableLog->iFd = iOldFd;
+        oSymTableLog->uRecords = uOldRecords;
+        oSymTableLog->uBufferLength = 0;
+        oSymTableLog->uPending = 0;
+        return 0;
+    }
+    free(pcTempPath);
+    SymTableLog_syncDirectory(oSymTableLog->pcPath);
+
+    /* Records written from here on are appended to the new file */
+    if(iOldFd >= 0){
+        close(iOldFd);
+    }
+    if(lseek(iFd, 0, SEEK_END) < 0){
+        oSymTableLog->iFd = -1;
+        close(iFd);
+        return 0;
+    }
+    oSymTableLog->uPending = 0;
+    return 1;
+}
@@ -0,0 +1,110 @@
+/*--------------------------------------------------------------------*/
+/*                                                                    */
+/* Header file for an append-only log that makes the changes to a     */
+/* hash table SymTable object survive a restart                       */
+/*                                                                    */
+/* Author: Maxwell Lloyd                                              */
+/*                                                                    */
+/*--------------------------------------------------------------------*/
+
+
+#ifndef SYMTABLELOG_INCLUDED
+#define SYMTABLELOG_INCLUDED
+
+#include <stddef.h>
+#include "symtablehash.h"
+
+/*--------------------------------------------------------------------*/
+
+/* SymTableLog_T records every change made through it to a SymTable
+   object in a log file */
+typedef struct SymTableLog* SymTableLog_T;
+
+/*--------------------------------------------------------------------*/
+
+/* A SymTable_ValueDeserializer returns a new value made from the
+   uLength bytes at pvBytes that a SymTable_ValueSerializer gave. It is
+   not called for values written as 0 bytes, which come back NULL. */
+typedef void *(*SymTable_ValueDeserializer)(const void *pvBytes,
+    size_t uLength);
+
+/*--------------------------------------------------------------------*/
+
+/* Return a new SymTable object holding the bindings recorded in the
+   log file pcPath, with each value made by pfDeserialize, or NULL if
+   the file cannot be read or there is not enough memory available. A
+   missing file gives an empty table. Values that are replaced or
+   removed while the log is replayed are passed to pfFree unless it is
+   NULL. A torn record at the end of the log is ignored */
+SymTable_T SymTable_recover(const char *pcPath,
+    SymTable_ValueDeserializer pfDeserialize,
+    void (*pfFree)(void *pvValue));
+
+/*--------------------------------------------------------------------*/
+
+/* Return a new SymTableLog object that records the changes to
+   parameter oSymTable in the log file pcPath, or NULL if the file
+   cannot be written or there is not enough memory available. The file
+   is first rewritten to hold exactly the bindings of oSymTable, with
+   each value written as the bytes pfSerialize gives. Changes are
+   written and synced to disk in groups of uGroupSize. A change is made
+   to the table as soon as it is recorded in memory; if writing or
+   syncing its group then fails, the change stays made and waiting,
+   and only SymTableLog_sync and SymTableLog_close report that it has
+   not reached the disk */
+SymTableLog_T SymTableLog_open(SymTable_T oSymTable, const char *pcPath,
+    SymTable_ValueSerializer pfSerialize, size_t uGroupSize);
+
+/*--------------------------------------------------------------------*/
+
+/* Write every change still waiting in parameter oSymTableLog to disk,
+   then free it. The SymTable object is not freed. Returns 1 if every
+   change reached the disk or 0 otherwise */
+int SymTableLog_close(SymTableLog_T oSymTableLog);
+
+/*--------------------------------------------------------------------*/
+
+/* Same as SymTable_put on the table of parameter oSymTableLog, and
+   records the new binding. Returns 1 for success or 0 for failure, in
+   which case the table is unchanged. Success does not mean the
+   binding is on disk yet */
+int SymTableLog_put(SymTableLog_T oSymTableLog, const char *pcKey,
+    const void *pvValue);
+
+/*--------------------------------------------------------------------*/
+
+/* Same as SymTable_replace on the table of parameter oSymTableLog,
+   and records the new value. Returns the old value, or NULL if pcKey
+   is not bound or the change cannot be recorded, in which case the
+   table is unchanged. The new value may not be on disk yet */
+void *SymTableLog_replace(SymTableLog_T oSymTableLog,
+    const char *pcKey, const void *pvValue);
+
+/*--------------------------------------------------------------------*/
+
+/* Same as SymTable_remove on the table of parameter oSymTableLog, and
+   records the removal. Returns the old value, or NULL if pcKey is not
+   bound or the change cannot be recorded, in which case the table is
+   unchanged. The removal may not be on disk yet */
+void *SymTableLog_remove(SymTableLog_T oSymTableLog, const char *pcKey);
+
+/*--------------------------------------------------------------------*/
+
+/* Write every change waiting in parameter oSymTableLog to disk and
+   wait for the disk to keep it. Returns 1 if every change made through
+   oSymTableLog is on disk, or 0 otherwise, in which case the changes
+   still waiting are tried again by the next call. A compaction that
+   this starts and that fails is tried again later and does not make
+   it fail */
+int SymTableLog_sync(SymTableLog_T oSymTableLog);
+
+/*--------------------------------------------------------------------*/
+
+/* Replace the log file of parameter oSymTableLog with one that holds
+   only the current bindings of its table. This also happens on its
+   own once the log grows to several times the size of the table.
+   Returns 1 for success or 0 for failure */
+int SymTableLog_compact(SymTableLog_T oSymTableLog);
+
+
+#endif
@@ -0,0 +1,575 @@
+/*--------------------------------------------------------------------*/
+/*                                                                    */
+/* Implementation of the SymTable ADT as an open addressing hash      */
+/* table using Robin Hood linear probing                              */
+/*                                                                    */
+/* Author: Maxwell Lloyd                                              */
+/*                                                                    */
+/*--------------------------------------------------------------------*/
+
+
+
+#include <stddef.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "symtable.h"
+
+/* Number of slots in a new table */
+enum {INITIAL_SLOTS = 64};
+
+/* The table grows once more than MAX_LOAD_PERCENT of its slots are
+   in use */
+enum {MAX_LOAD_PERCENT = 90};
+
+/*--------------------------------------------------------------------*/
+
+/* Each binding is stored in a RobinEntry */
+struct RobinEntry{
+    /* Full hash code of the key */
+    uint64_t uHash;
+
+    /* Value of the binding */
+    const void *pvValue;
+
+    /* Key of the binding */
+    char acKey[];
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Each slot of the table refers to at most one entry */
+struct RobinSlot{
+    /* 0 if the slot is empty, otherwise 1 more than the distance of
+       the slot from the entry's home slot */
+    uint32_t uProbe;
+
+    /* High bits of the entry's hash code, to skip most mismatches
+       without reading the entry */
+    uint32_t uTag;
+
+    /* The entry */
+    struct RobinEntry *pEntry;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* SymTable object is a manager pointing to the slots of a SymTable_T
+   object */
+struct SymTable{
+    /* The slots */
+    struct RobinSlot *pSlots;
+
+    /* Number of slots, a power of 2 */
+    size_t uSlotCount;
+
+    /* size of the entire symtable */
+    size_t size;
+
+    /* Source of every block the table holds */
+    SymTable_Allocator allocator;
+
+    /* Bytes currently held from allocator */
+    size_t uBytes;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Return uSize bytes from malloc. pvContext is unused. */
+
+static void *SymTable_defaultAlloc(size_t uSize, void *pvContext)
+{
+    (void)pvContext;
+    return malloc(uSize);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Free pvBlock, which SymTable_defaultAlloc returned. */
+
+static void SymTable_defaultFree(void *pvBlock, size_t uSize,
+    void *pvContext)
+{
+    (void)uSize;
+    (void)pvContext;
+    free(pvBlock);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* The allocator of tables made by SymTable_new */
+static const SymTable_Allocator defaultAllocator = {
+    SymTable_defaultAlloc, SymTable_defaultFree, NULL};
+
+/*--------------------------------------------------------------------*/
+
+/* Return uSize bytes from the allocator of oSymTable, or NULL if it
+   refuses. */
+
+static void *SymTable_alloc(SymTable_T oSymTable, size_t uSize)
+{
+    void *pvBlock;
+
+    assert(oSymTable != NULL);
+
+    pvBlock = (*oSymTable->allocator.pfAlloc)(uSize,
+        oSymTable->allocator.pvContext);
+    if(pvBlock != NULL){
+        oSymTable->uBytes += uSize;
+    }
+    return pvBlock;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Give the uSize bytes at pvBlock back to the allocator of
+   oSymTable. */
+
+static void SymTable_release(SymTable_T oSymTable, void *pvBlock,
+    size_t uSize)
+{
+    assert(oSymTable != NULL);
+    assert(pvBlock != NULL);
+
+    oSymTable->uBytes -= uSize;
+    (*oSymTable->allocator.pfFree)(pvBlock, uSize,
+        oSymTable->allocator.pvContext);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Free pEntry of oSymTable. */
+
+static void SymTable_freeEntry(SymTable_T oSymTable,
+    struct RobinEntry *pEntry)
+{
+    assert(pEntry != NULL);
+
+    SymTable_release(oSymTable, pEntry,
+        sizeof(struct RobinEntry) + strlen(pEntry->acKey) + 1);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the hash code for pcKey. The low bits pick the home slot and
+   the high bits make the tag, so the bits are mixed well. */
+
+static uint64_t SymTable_hash(const char *pcKey)
+{
+    uint64_t uHash = UINT64_C(14695981039346656037);
+    size_t u;
+
+    assert(pcKey != NULL);
+
+    for(u = 0; pcKey[u] != '\0'; u++){
+        uHash ^= (unsigned char)pcKey[u];
+        uHash *= UINT64_C(1099511628211);
+    }
+
+    uHash ^= uHash >> 33;
+    uHash *= UINT64_C(0xff51afd7ed558ccd);
+    uHash ^= uHash >> 33;
+    uHash *= UINT64_C(0xc4ceb9fe1a85ec53);
+    uHash ^= uHash >> 33;
+    return uHash;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the slot of oSymTable holding pcKey, whose hash code is
+   uHash, or NULL if there is none. */
+
+static struct RobinSlot *SymTable_find(SymTable_T oSymTable,
+    const char *pcKey, uint64_t uHash)
+{
+    struct RobinSlot *pSlot;
+    size_t uMask;
+    size_t uIndex;
+    uint32_t uTag;
+    uint32_t uProbe;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    uMask = oSymTable->uSlotCount - 1;
+    uIndex = (size_t)uHash & uMask;
+    uTag = (uint32_t)(uHash >> 32);
+
+    /* Entries are ordered by distance from home, so the key is not
+       present once a slot is closer to its home than the key would
+       be */
+    for(uProbe = 1; ; uProbe++){
+        pSlot = &oSymTable->pSlots[uIndex];
+        if(pSlot->uProbe < uProbe){
+            return NULL;
+        }
+        if(pSlot->uProbe == uProbe && pSlot->uTag == uTag
+            && pSlot->pEntry->uHash == uHash
+            && strcmp(pSlot->pEntry->acKey, pcKey) == 0){
+            return pSlot;
+        }
+        uIndex = (uIndex + 1) & uMask;
+    }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Put pEntry, whose key is not in oSymTable, into the slots of
+   oSymTable, which must have an empty slot. An entry farther from its
+   home than the one being placed takes the slot, and the one it
+   displaces is placed further on. */
+
+static void SymTable_place(SymTable_T oSymTable, struct RobinEntry *pEntry)
+{
+    struct RobinSlot carried;
+    struct RobinSlot displaced;
+    struct RobinSlot *pSlot;
+    size_t uMask;
+    size_t uIndex;
+
+    assert(oSymTable != NULL);
+    assert(pEntry != NULL);
+    assert(oSymTable->size < oSymTable->uSlotCount);
+
+    uMask = oSymTable->uSlotCount - 1;
+    uIndex = (size_t)pEntry->uHash & uMask;
+    carried.uProbe = 1;
+    carried.uTag = (uint32_t)(pEntry->uHash >> 32);
+    carried.pEntry = pEntry;
+
+    for(;;){
+        pSlot = &oSymTable->pSlots[uIndex];
+        if(pSlot->uProbe == 0){
+            *pSlot = carried;
+            return;
+        }
+        if(pSlot->uProbe < carried.uProbe){
+            displaced = *pSlot;
+            *pSlot = carried;
+            carried = displaced;
+        }
+        carried.uProbe++;
+        uIndex = (uIndex + 1) & uMask;
+    }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Empty pSlot of oSymTable, whose entry is gone, by shifting the
+   following entries back a slot, each one closer to its home, until
+   one is already home or a slot is empty. No tombstone is left
+   behind. */
+
+static void SymTable_vacate(SymTable_T oSymTable, struct RobinSlot *pSlot)
+{
+    struct RobinSlot *pNext;
+    size_t uMask;
+    size_t uIndex;
+
+    assert(oSymTable != NULL);
+    assert(pSlot != NULL);
+
+    uMask = oSymTable->uSlotCount - 1;
+    uIndex = (size_t)(pSlot - oSymTable->pSlots);
+    for(;;){
+        pNext = &oSymTable->pSlots[(uIndex + 1) & uMask];
+        if(pNext->uProbe <= 1){
+            break;
+        }
+        *pSlot = *pNext;
+        pSlot->uProbe--;
+        pSlot = pNext;
+        uIndex = (uIndex + 1) & uMask;
+    }
+    pSlot->uProbe = 0;
+    pSlot->pEntry = NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Move every entry of oSymTable into a new array of uSlotCount slots.
+   Returns 1 for success or 0 for failure, in which case nothing
+   changes. */
+
+static int SymTable_rehash(SymTable_T oSymTable, size_t uSlotCount)
+{
+    struct RobinSlot *pOldSlots;
+    struct RobinSlot *pNewSlots;
+    size_t uOldCount;
+    size_t u;
+
+    assert(oSymTable != NULL);
+
+    pNewSlots = (struct RobinSlot*)SymTable_alloc(oSymTable,
+        uSlotCount * sizeof(struct RobinSlot));
+    if(pNewSlots == NULL){
+        return 0;
+    }
+    memset(pNewSlots, 0, uSlotCount * sizeof(struct RobinSlot));
+
+    pOldSlots = oSymTable->pSlots;
+    uOldCount = oSymTable->uSlotCount;
+    oSymTable->pSlots = pNewSlots;
+    oSymTable->uSlotCount = uSlotCount;
+    for(u = 0; u < uOldCount; u++){
+        if(pOldSlots[u].uProbe != 0){
+            SymTable_place(oSymTable, pOldSlots[u].pEntry);
+        }
+    }
+
+    SymTable_release(oSymTable, pOldSlots,
+        uOldCount * sizeof(struct RobinSlot));
+    return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+SymTable_T SymTable_new(void){
+    return SymTable_newWithAllocator(&defaultAllocator);
+}
+
+/*--------------------------------------------------------------------*/
+
+SymTable_T SymTable_newWithAllocator(const SymTable_Allocator *pAllocator){
+    SymTable_T oSymTable;
+
+    assert(pAllocator != NULL);
+    assert(pAllocator->pfAlloc != NULL);
+    assert(pAllocator->pfFree != NULL);
+
+    oSymTable = (SymTable_T)(*pAllocator->pfAlloc)(sizeof(struct SymTable),
+        pAllocator->pvContext);
+    if (oSymTable == NULL)
+       return NULL;
+    oSymTable->allocator = *pAllocator;
+    oSymTable->uBytes = sizeof(struct SymTable);
+
+    oSymTable->pSlots = (struct RobinSlot*)SymTable_alloc(oSymTable,
+        INITIAL_SLOTS * sizeof(struct RobinSlot));
+    if(oSymTable->pSlots == NULL){
+        SymTable_release(oSymTable, oSymTable, sizeof(struct SymTable));
+        return NULL;
+    }
+    memset(oSymTable->pSlots, 0, INITIAL_SLOTS * sizeof(struct RobinSlot));
+
+    oSymTable->uSlotCount = INITIAL_SLOTS;
+    oSymTable->size = 0;
+    return oSymTable;
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t SymTable_memoryUsage(SymTable_T oSymTable){
+    assert(oSymTable != NULL);
+
+    return oSymTable->uBytes;
+}
+
+/*--------------------------------------------------------------------*/
+
+void SymTable_free(SymTable_T oSymTable){
+    size_t counter;
+
+    assert(oSymTable != NULL);
+
+    for(counter = 0; counter < oSymTable->uSlotCount; counter++){
+        if(oSymTable->pSlots[counter].uProbe != 0){
+            SymTable_freeEntry(oSymTable, oSymTable->pSlots[counter].pEntry);
+        }
+    }
+    SymTable_release(oSymTable, oSymTable->pSlots,
+        oSymTable->uSlotCount * sizeof(struct RobinSlot));
+    SymTable_release(oSymTable, oSymTable, sizeof(struct SymTable));
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t SymTable_getLength(SymTable_T oSymTable){
+    assert(oSymTable != NULL);
+
+    return oSymTable->size;
+}
+
+/*--------------------------------------------------------------------*/
+
+int SymTable_put(SymTable_T oSymTable, const char *pcKey,
+    const void *pvValue){
+    struct RobinEntry *pEntry;
+    uint64_t uHash;
+    size_t strLength;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    uHash = SymTable_hash(pcKey);
+    if(SymTable_find(oSymTable, pcKey, uHash) != NULL){
+        return 0;
+    }
+
+    if((oSymTable->size + 1) * 100
+        > oSymTable->uSlotCount * MAX_LOAD_PERCENT){
+        if(!SymTable_rehash(oSymTable, oSymTable->uSlotCount * 2)){
+            return 0;
+        }
+    }
+
+    /* Defensive copy */
+    strLength = strlen(pcKey) + 1;
+    pEntry = (struct RobinEntry*)SymTable_alloc(oSymTable,
+        sizeof(struct RobinEntry) + strLength);
+    if(pEntry == NULL){
+        return 0;
+    }
+    pEntry->uHash = uHash;
+    pEntry->pvValue = pvValue;
+    memcpy(pEntry->acKey, pcKey, strLength);
+
+    SymTable_place(oSymTable, pEntry);
+    oSymTable->size++;
+    return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *SymTable_replace(SymTable_T oSymTable, const char *pcKey,
+    const void *pvValue){
+    struct RobinSlot *pSlot;
+    const void *pOldValue;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    pSlot = SymTable_find(oSymTable, pcKey, SymTable_hash(pcKey));
+    if(pSlot == NULL){
+        return NULL;
+    }
+    pOldValue = pSlot->pEntry->pvValue;
+    pSlot->pEntry->pvValue = pvValue;
+    return (void*) pOldValue;
+}
+
+/*--------------------------------------------------------------------*/
+
+int SymTable_contains(SymTable_T oSymTable, const char *pcKey){
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    return SymTable_find(oSymTable, pcKey, SymTable_hash(pcKey)) != NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *SymTable_get(SymTable_T oSymTable, const char *pcKey){
+    struct RobinSlot *pSlot;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    pSlot = SymTable_find(oSymTable, pcKey, SymTable_hash(pcKey));
+    if(pSlot == NULL){
+        return NULL;
+    }
+    return (void*)pSlot->pEntry->pvValue;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *SymTable_remove(SymTable_T oSymTable, const char *pcKey){
+    struct RobinSlot *pSlot;
+    const void *pOldValue;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    pSlot = SymTable_find(oSymTable, pcKey, SymTable_hash(pcKey));
+    if(pSlot == NULL){
+        return NULL;
+    }
+    pOldValue = pSlot->pEntry->pvValue;
+    SymTable_freeEntry(oSymTable, pSlot->pEntry);
+    oSymTable->size--;
+    SymTable_vacate(oSymTable, pSlot);
+    return (void*) pOldValue;
+}
+
+/*--------------------------------------------------------------------*/
+
+void SymTable_map(SymTable_T oSymTable, void (*pfApply)
+    (const char *pcKey, void *pvValue, void *pvExtra),
+    const void *pvExtra){
+    struct RobinEntry *pEntry;
+    size_t counter;
+
+    assert(oSymTable != NULL);
+    assert(pfApply != NULL);
+
+    for(counter = 0; counter < oSymTable->uSlotCount; counter++){
+        if(oSymTable->pSlots[counter].uProbe != 0){
+            pEntry = oSymTable->pSlots[counter].pEntry;
+            (*pfApply)(pEntry->acKey, (void*)pEntry->pvValue,
+                (void*) pvExtra);
+        }
+    }
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t SymTable_removeIf(SymTable_T oSymTable, int (*pfPredicate)
+    (const char *pcKey, void *pvValue, void *pvExtra),
+    const void *pvExtra, void (*pfRemoved)
+    (const char *pcKey, void *pvValue, void *pvExtra)){
+    struct RobinSlot *pSlot;
+    struct RobinEntry *pEntry;
+    size_t uRemoved = 0;
+    size_t uMask;
+    size_t uStart;
+    size_t counter;
+
+    assert(oSymTable != NULL);
+    assert(pfPredicate != NULL);
+
+    /* Start where a run of entries starts. Entries only shift back
+       within their run, so none is shifted into a slot already passed,
+       and after a removal the same slot is looked at again. */
+    uMask = oSymTable->uSlotCount - 1;
+    uStart = 0;
+    while(oSymTable->pSlots[uStart].uProbe > 1){
+        uStart++;
+    }
+
+    counter = 0;
+    while(counter < oSymTable->uSlotCount){
+        pSlot = &oSymTable->pSlots[(uStart + counter) & uMask];
+        pEntry = pSlot->pEntry;
+        if(pSlot->uProbe == 0
+            || ! (*pfPredicate)(pEntry->acKey, (void*)pEntry->pvValue,
+                (void*) pvExtra)){
+            counter++;
+            continue;
+        }
+        if(pfRemoved != NULL){
+            (*pfRemoved)(pEntry->acKey, (void*)pEntry->pvValue,
+                (void*) pvExtra);
+        }
+        SymTable_freeEntry(oSymTable, pEntry);
+        SymTable_vacate(oSymTable, pSlot);
+        uRemoved++;
+    }
+    oSymTable->size -= uRemoved;
+
+    /* Once the table is under an eighth full, the slots halve until it
+       is at least half full. If they cannot, the table stays as it
+       is. */
+    if(oSymTable->size * 8 < oSymTable->uSlotCount){
+        counter = oSymTable->uSlotCount;
+        while(counter / 2 >= INITIAL_SLOTS
+            && oSymTable->size * 2 <= counter / 2){
+            counter /= 2;
+        }
+        if(counter < oSymTable->uSlotCount){
+            (void)SymTable_rehash(oSymTable, counter);
+        }
+    }
+    return uRemoved;
+}
@@ -4,6 +4,15 @@
 /*--------------------------------------------------------------------*/
 
 #include "symtable.h"
+#ifdef SYMTABLE_CLONE
+#include "symtablehamt.h"
+#endif
+#ifdef SYMTABLE_HANDLE
+#include "symtablehandle.h"
+#endif
+#ifdef SYMTABLE_DISK
+#include "symtabledisk.h"
+#endif
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
@@ -699,6 +708,664 @@ static void testTableOfTables(void)
 
 /*--------------------------------------------------------------------*/
 
+/* A Budget is the context of budgetAlloc and budgetFree. It hands out
+   at most uLimit bytes at a time. */
+
+struct Budget
+{
+   size_t uLimit;
+   size_t uInUse;
+   size_t uBlocks;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Return uSize bytes from the Budget pvContext, or NULL if that would
+   exceed its limit. */
+
+static void *budgetAlloc(size_t uSize, void *pvContext)
+{
+   struct Budget *pBudget = (struct Budget*)pvContext;
+   void *pvBlock;
+
+   assert(pBudget != NULL);
+
+   if (pBudget->uInUse + uSize > pBudget->uLimit)
+      return NULL;
+   pvBlock = malloc(uSize);
+   if (pvBlock == NULL)
+      return NULL;
+   pBudget->uInUse += uSize;
+   pBudget->uBlocks++;
+   return pvBlock;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Give the uSize bytes at pvBlock back to the Budget pvContext. */
+
+static void budgetFree(void *pvBlock, size_t uSize, void *pvContext)
+{
+   struct Budget *pBudget = (struct Budget*)pvContext;
+
+   assert(pBudget != NULL);
+   assert(pvBlock != NULL);
+
+   ASSURE(pBudget->uInUse >= uSize);
+   ASSURE(pBudget->uBlocks > 0);
+   pBudget->uInUse -= uSize;
+   pBudget->uBlocks--;
+   free(pvBlock);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTable objects whose memory comes from a SymTable_Allocator,
+   and the accounting of that memory. */
+
+static void testAllocator(void)
+{
+   enum {BINDING_COUNT = 2000, MAX_KEY_LENGTH = 10};
+
+   SymTable_T oSymTable;
+   SymTable_Allocator allocator;
+   struct Budget budget;
+   char acKey[MAX_KEY_LENGTH];
+   char acShortstop[] = "Shortstop";
+   size_t uUsage;
+   int iSuccessful;
+   int iPut;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing SymTable_newWithAllocator() and\n");
+   printf("SymTable_memoryUsage().\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   allocator.pfAlloc = budgetAlloc;
+   allocator.pfFree = budgetFree;
+   allocator.pvContext = &budget;
+
+   /* An allocator that refuses everything gives no table. */
+   budget.uLimit = 0;
+   budget.uInUse = 0;
+   budget.uBlocks = 0;
+   oSymTable = SymTable_newWithAllocator(&allocator);
+   ASSURE(oSymTable == NULL);
+   ASSURE(budget.uInUse == 0);
+
+   /* The usage is exactly what the allocator handed out. */
+   budget.uLimit = (size_t)-1;
+   oSymTable = SymTable_newWithAllocator(&allocator);
+   ASSURE(oSymTable != NULL);
+   ASSURE(SymTable_memoryUsage(oSymTable) == budget.uInUse);
+   ASSURE(budget.uInUse > 0);
+
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      iSuccessful = SymTable_put(oSymTable, acKey, acShortstop);
+      ASSURE(iSuccessful);
+   }
+   ASSURE(SymTable_memoryUsage(oSymTable) == budget.uInUse);
+
+   uUsage = SymTable_memoryUsage(oSymTable);
+   iSuccessful = SymTable_put(oSymTable, "0", acShortstop);
+   ASSURE(! iSuccessful);
+   ASSURE(SymTable_replace(oSymTable, "0", NULL) == acShortstop);
+   ASSURE(SymTable_memoryUsage(oSymTable) == uUsage);
+
+   for (i = 0; i < BINDING_COUNT; i += 2)
+   {
+      sprintf(acKey, "%d", i);
+      SymTable_remove(oSymTable, acKey);
+   }
+   ASSURE(SymTable_memoryUsage(oSymTable) == budget.uInUse);
+   ASSURE(SymTable_memoryUsage(oSymTable) < uUsage);
+
+   SymTable_free(oSymTable);
+   ASSURE(budget.uInUse == 0);
+   ASSURE(budget.uBlocks == 0);
+
+   /* Running out of budget fails the put and leaves the table as it
+      was. A hash table also runs out while growing its buckets. A
+      table on disk gives back cached pages instead, and fails only
+      when it cannot. */
+   budget.uLimit = 20000;
+   oSymTable = SymTable_newWithAllocator(&allocator);
+   ASSURE(oSymTable != NULL);
+   if (oSymTable != NULL)
+   {
+      iPut = 0;
+      for (i = 0; i < BINDING_COUNT; i++)
+      {
+         sprintf(acKey, "%d", i);
+         if (! SymTable_put(oSymTable, acKey, acShortstop))
+            break;
+         iPut++;
+      }
+#ifdef SYMTABLE_DISK
+      ASSURE(iPut == BINDING_COUNT);
+      ASSURE(SymTable_getLength(oSymTable) == (size_t)iPut);
+#else
+      ASSURE(iPut < BINDING_COUNT);
+      ASSURE(SymTable_getLength(oSymTable) == (size_t)iPut);
+      ASSURE(! SymTable_contains(oSymTable, acKey));
+#endif
+      ASSURE(SymTable_memoryUsage(oSymTable) == budget.uInUse);
+      ASSURE(budget.uInUse <= budget.uLimit);
+      for (i = 0; i < iPut; i++)
+      {
+         sprintf(acKey, "%d", i);
+         ASSURE(SymTable_get(oSymTable, acKey) == acShortstop);
+      }
+
+      /* Freeing bindings makes room again. */
+      SymTable_remove(oSymTable, "0");
+      iSuccessful = SymTable_put(oSymTable, "0", acShortstop);
+      ASSURE(iSuccessful);
+
+      SymTable_free(oSymTable);
+   }
+   ASSURE(budget.uInUse == 0);
+   ASSURE(budget.uBlocks == 0);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* A RemoveIfState is the pvExtra of isMultiple and countRemoved. */
+
+struct RemoveIfState
+{
+   int iDivisor;
+   size_t uRemoved;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Return 1 if the int at pvValue is a multiple of the divisor of the
+   RemoveIfState pvExtra, or 0 otherwise. pcKey is unused. */
+
+static int isMultiple(const char *pcKey, void *pvValue, void *pvExtra)
+{
+   struct RemoveIfState *pState = (struct RemoveIfState*)pvExtra;
+
+   assert(pcKey != NULL);
+   assert(pvValue != NULL);
+   assert(pState != NULL);
+
+   return *(int*)pvValue % pState->iDivisor == 0;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Count, in the RemoveIfState pvExtra, the binding whose key is pcKey
+   and whose int value is pvValue, which must be a multiple of its
+   divisor. */
+
+static void countRemoved(const char *pcKey, void *pvValue, void *pvExtra)
+{
+   struct RemoveIfState *pState = (struct RemoveIfState*)pvExtra;
+   char acKey[16];
+
+   assert(pcKey != NULL);
+   assert(pvValue != NULL);
+   assert(pState != NULL);
+
+   sprintf(acKey, "%d", *(int*)pvValue);
+   ASSURE(strcmp(pcKey, acKey) == 0);
+   ASSURE(*(int*)pvValue % pState->iDivisor == 0);
+   pState->uRemoved++;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test the SymTable_removeIf() function. */
+
+static void testRemoveIf(void)
+{
+   enum {BINDING_COUNT = 5000, MAX_KEY_LENGTH = 10};
+
+   SymTable_T oSymTable;
+#ifdef SYMTABLE_CLONE
+   SymTable_T oClone;
+#endif
+   SymTable_Allocator allocator;
+   struct Budget budget;
+   struct RemoveIfState state;
+   int aiValues[BINDING_COUNT];
+   char acKey[MAX_KEY_LENGTH];
+   size_t uUsage;
+   size_t uRemoved;
+   int iSuccessful;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing the SymTable_removeIf() function.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   budget.uLimit = (size_t)-1;
+   budget.uInUse = 0;
+   budget.uBlocks = 0;
+   allocator.pfAlloc = budgetAlloc;
+   allocator.pfFree = budgetFree;
+   allocator.pvContext = &budget;
+
+   oSymTable = SymTable_newWithAllocator(&allocator);
+   ASSURE(oSymTable != NULL);
+
+   /* An empty table has nothing to remove. */
+   state.iDivisor = 1;
+   state.uRemoved = 0;
+   uRemoved = SymTable_removeIf(oSymTable, isMultiple, &state,
+      countRemoved);
+   ASSURE(uRemoved == 0);
+   ASSURE(state.uRemoved == 0);
+
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      aiValues[i] = i;
+      sprintf(acKey, "%d", i);
+      iSuccessful = SymTable_put(oSymTable, acKey, &aiValues[i]);
+      ASSURE(iSuccessful);
+   }
+
+#ifdef SYMTABLE_CLONE
+   /* Removing from a clone leaves the original as it was, and copies
+      only the nodes above the bindings removed. */
+   oClone = SymTable_clone(oSymTable);
+   ASSURE(oClone != NULL);
+   uUsage = SymTable_memoryUsage(oClone);
+   state.iDivisor = BINDING_COUNT;
+   uRemoved = SymTable_removeIf(oClone, isMultiple, &state, NULL);
+   ASSURE(uRemoved == 1);
+   ASSURE(SymTable_memoryUsage(oClone) - uUsage < uUsage / 10);
+   uUsage = SymTable_memoryUsage(oClone);
+   uRemoved = SymTable_removeIf(oClone, isMultiple, &state, NULL);
+   ASSURE(uRemoved == 0);
+   ASSURE(SymTable_memoryUsage(oClone) == uUsage);
+   state.iDivisor = 2;
+   uRemoved = SymTable_removeIf(oClone, isMultiple, &state, NULL);
+   ASSURE(uRemoved == BINDING_COUNT / 2 - 1);
+   ASSURE(SymTable_getLength(oClone) == BINDING_COUNT / 2);
+   ASSURE(SymTable_getLength(oSymTable) == BINDING_COUNT);
+   ASSURE(SymTable_contains(oSymTable, "0"));
+   ASSURE(! SymTable_contains(oClone, "0"));
+   ASSURE(SymTable_get(oClone, "1") == &aiValues[1]);
+   SymTable_free(oClone);
+#endif
+
+   /* Every third binding goes, and each is passed to countRemoved. */
+   state.iDivisor = 3;
+   state.uRemoved = 0;
+   uRemoved = SymTable_removeIf(oSymTable, isMultiple, &state,
+      countRemoved);
+   ASSURE(uRemoved == (BINDING_COUNT + 2) / 3);
+   ASSURE(state.uRemoved == uRemoved);
+   ASSURE(SymTable_getLength(oSymTable) == BINDING_COUNT - uRemoved);
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      if (i % 3 == 0)
+         ASSURE(! SymTable_contains(oSymTable, acKey));
+      else
+         ASSURE(SymTable_get(oSymTable, acKey) == &aiValues[i]);
+   }
+   ASSURE(SymTable_memoryUsage(oSymTable) == budget.uInUse);
+
+   /* A second pass finds nothing more to remove. */
+   uRemoved = SymTable_removeIf(oSymTable, isMultiple, &state, NULL);
+   ASSURE(uRemoved == 0);
+
+   /* Removing the rest leaves an empty table that still works, and
+      that holds less memory than before. */
+   uUsage = SymTable_memoryUsage(oSymTable);
+   state.iDivisor = 1;
+   uRemoved = SymTable_removeIf(oSymTable, isMultiple, &state, NULL);
+   ASSURE(uRemoved == BINDING_COUNT - (BINDING_COUNT + 2) / 3);
+   ASSURE(SymTable_getLength(oSymTable) == 0);
+   ASSURE(SymTable_memoryUsage(oSymTable) < uUsage);
+   ASSURE(SymTable_memoryUsage(oSymTable) == budget.uInUse);
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      ASSURE(! SymTable_contains(oSymTable, acKey));
+      iSuccessful = SymTable_put(oSymTable, acKey, &aiValues[i]);
+      ASSURE(iSuccessful);
+   }
+   ASSURE(SymTable_getLength(oSymTable) == BINDING_COUNT);
+   ASSURE(SymTable_get(oSymTable, "4999") == &aiValues[4999]);
+
+   SymTable_free(oSymTable);
+   ASSURE(budget.uInUse == 0);
+   ASSURE(budget.uBlocks == 0);
+}
+
+#ifdef SYMTABLE_CLONE
+/*--------------------------------------------------------------------*/
+
+/* Test SymTable_clone(), for implementations that provide it. */
+
+static void testClone(void)
+{
+   enum {BINDING_COUNT = 5000, CLONE_COUNT = 100, MAX_KEY_LENGTH = 10};
+
+   SymTable_T oSymTable;
+   SymTable_T oClone;
+   SymTable_T aoClones[CLONE_COUNT];
+   SymTable_Allocator allocator;
+   struct Budget budget;
+   char acKey[MAX_KEY_LENGTH];
+   char acShortstop[] = "Shortstop";
+   char acCatcher[] = "Catcher";
+   size_t uUsage;
+   int iSuccessful;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing SymTable_clone().\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   budget.uLimit = (size_t)-1;
+   budget.uInUse = 0;
+   budget.uBlocks = 0;
+   allocator.pfAlloc = budgetAlloc;
+   allocator.pfFree = budgetFree;
+   allocator.pvContext = &budget;
+
+   oSymTable = SymTable_newWithAllocator(&allocator);
+   ASSURE(oSymTable != NULL);
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      iSuccessful = SymTable_put(oSymTable, acKey, acShortstop);
+      ASSURE(iSuccessful);
+   }
+
+   /* A clone shares everything with its original. */
+   uUsage = SymTable_memoryUsage(oSymTable);
+   oClone = SymTable_clone(oSymTable);
+   ASSURE(oClone != NULL);
+   ASSURE(SymTable_getLength(oClone) == BINDING_COUNT);
+   ASSURE(SymTable_memoryUsage(oSymTable) - uUsage < 100);
+   ASSURE(SymTable_memoryUsage(oClone) == budget.uInUse);
+
+   /* Changing either one leaves the other as it was, and copies only
+      a path. */
+   uUsage = SymTable_memoryUsage(oSymTable);
+   ASSURE(SymTable_replace(oClone, "0", acCatcher) == acShortstop);
+   ASSURE(SymTable_memoryUsage(oSymTable) - uUsage < 2000);
+   ASSURE(SymTable_get(oSymTable, "0") == acShortstop);
+   ASSURE(SymTable_get(oClone, "0") == acCatcher);
+
+   iSuccessful = SymTable_put(oClone, "Jeter", acShortstop);
+   ASSURE(iSuccessful);
+   ASSURE(SymTable_contains(oClone, "Jeter"));
+   ASSURE(! SymTable_contains(oSymTable, "Jeter"));
+
+   ASSURE(SymTable_remove(oSymTable, "1") == acShortstop);
+   ASSURE(! SymTable_contains(oSymTable, "1"));
+   ASSURE(SymTable_get(oClone, "1") == acShortstop);
+   ASSURE(SymTable_getLength(oSymTable) == BINDING_COUNT - 1);
+   ASSURE(SymTable_getLength(oClone) == BINDING_COUNT + 1);
+
+   /* Many versions, each one change apart. */
+   aoClones[0] = SymTable_clone(oSymTable);
+   ASSURE(aoClones[0] != NULL);
+   for (i = 1; i < CLONE_COUNT; i++)
+   {
+      aoClones[i] = SymTable_clone(aoClones[i - 1]);
+      ASSURE(aoClones[i] != NULL);
+      sprintf(acKey, "%d", i);
+      SymTable_remove(aoClones[i], acKey);
+   }
+   for (i = 1; i < CLONE_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      ASSURE(SymTable_contains(aoClones[i - 1], acKey) == (i != 1));
+      ASSURE(! SymTable_contains(aoClones[i], acKey));
+      ASSURE(SymTable_getLength(aoClones[i])
+         == (size_t)(BINDING_COUNT - 1 - i + 1));
+   }
+
+   /* Freeing the original first leaves the clones intact. */
+   SymTable_free(oSymTable);
+   for (i = 2; i < BINDING_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      ASSURE(SymTable_get(oClone, acKey) == acShortstop);
+      ASSURE(SymTable_contains(aoClones[0], acKey));
+   }
+   for (i = 0; i < CLONE_COUNT; i += 2)
+      SymTable_free(aoClones[i]);
+   for (i = 1; i < CLONE_COUNT; i += 2)
+   {
+      sprintf(acKey, "%d", CLONE_COUNT + i);
+      ASSURE(SymTable_contains(aoClones[i], acKey));
+      SymTable_free(aoClones[i]);
+   }
+   SymTable_free(oClone);
+   ASSURE(budget.uInUse == 0);
+   ASSURE(budget.uBlocks == 0);
+}
+#endif
+
+#ifdef SYMTABLE_HANDLE
+/*--------------------------------------------------------------------*/
+
+/* Test the SymTable_Handle functions, for implementations that
+   provide them. */
+
+static void testHandles(void)
+{
+   enum {BINDING_COUNT = 1000, STRIDE = 7, MAX_KEY_LENGTH = 10};
+
+   SymTable_T oSymTable;
+   SymTable_Handle oJeter;
+   SymTable_Handle oMantle;
+   SymTable_Handle oGehrig;
+   SymTable_Handle aoHandles[BINDING_COUNT];
+   char acKey[MAX_KEY_LENGTH];
+   char acShortstop[] = "Shortstop";
+   char acCenterField[] = "Center Field";
+   char acFirstBase[] = "First Base";
+   char acCatcher[] = "Catcher";
+   size_t uUsage;
+   int iRound;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing the SymTable_Handle functions.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+
+   oJeter = SymTable_putHandle(oSymTable, "Jeter", acShortstop);
+   ASSURE(oJeter != NULL);
+   oMantle = SymTable_putHandle(oSymTable, "Mantle", acCenterField);
+   ASSURE(oMantle != NULL);
+   oGehrig = SymTable_putHandle(oSymTable, "Gehrig", acFirstBase);
+   ASSURE(oGehrig != NULL);
+   ASSURE(SymTable_putHandle(oSymTable, "Mantle", acCatcher) == NULL);
+   ASSURE(SymTable_getLength(oSymTable) == 3);
+
+   ASSURE(SymTable_find(oSymTable, "Mantle") == oMantle);
+   ASSURE(SymTable_find(oSymTable, "Ruth") == NULL);
+   ASSURE(SymTable_handleValue(oSymTable, oJeter) == acShortstop);
+
+   ASSURE(SymTable_handleReplace(oSymTable, oMantle, acCatcher)
+      == acCenterField);
+   ASSURE(SymTable_get(oSymTable, "Mantle") == acCatcher);
+   ASSURE(SymTable_handleValue(oSymTable, oMantle) == acCatcher);
+
+   /* Removing the binding in the middle, then at either end, leaves
+      the others reachable by key and by handle. */
+   ASSURE(SymTable_handleRemove(oSymTable, oMantle) == acCatcher);
+   ASSURE(! SymTable_contains(oSymTable, "Mantle"));
+   ASSURE(SymTable_getLength(oSymTable) == 2);
+   ASSURE(SymTable_handleRemove(oSymTable, oGehrig) == acFirstBase);
+   ASSURE(SymTable_get(oSymTable, "Jeter") == acShortstop);
+   ASSURE(SymTable_handleValue(oSymTable, oJeter) == acShortstop);
+   ASSURE(SymTable_handleRemove(oSymTable, oJeter) == acShortstop);
+   ASSURE(SymTable_getLength(oSymTable) == 0);
+
+   /* Handles stay valid as the table grows, and removing through them
+      in any order gives back every byte the bindings took. The first
+      round lets a table that grows keep its size. */
+   for (iRound = 0; iRound < 2; iRound++)
+   {
+      uUsage = SymTable_memoryUsage(oSymTable);
+      for (i = 0; i < BINDING_COUNT; i++)
+      {
+         sprintf(acKey, "%d", i);
+         aoHandles[i] = SymTable_putHandle(oSymTable, acKey,
+            acShortstop);
+         ASSURE(aoHandles[i] != NULL);
+      }
+      for (i = 0; i < BINDING_COUNT; i++)
+      {
+         sprintf(acKey, "%d", i);
+         ASSURE(SymTable_find(oSymTable, acKey) == aoHandles[i]);
+      }
+      for (i = 0; i < BINDING_COUNT; i++)
+         ASSURE(SymTable_handleRemove(oSymTable,
+            aoHandles[i * STRIDE % BINDING_COUNT]) == acShortstop);
+      ASSURE(SymTable_getLength(oSymTable) == 0);
+   }
+   ASSURE(SymTable_memoryUsage(oSymTable) == uUsage);
+
+   SymTable_free(oSymTable);
+}
+#endif
+
+#ifdef SYMTABLE_DISK
+/*--------------------------------------------------------------------*/
+
+/* Add 1 to the size_t at pvExtra. pcKey and pvValue are unused. */
+
+static void countBinding(const char *pcKey, void *pvValue, void *pvExtra)
+{
+   assert(pcKey != NULL);
+   assert(pvExtra != NULL);
+
+   (void)pvValue;
+   (*(size_t*)pvExtra)++;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTable_newOnDisk, and a table with many more bindings than
+   its cache holds. */
+
+static void testDisk(void)
+{
+   enum {BINDING_COUNT = 20000, LONG_KEY_COUNT = 3,
+      LONG_KEY_LENGTH = 10000, MAX_KEY_LENGTH = 10,
+      CACHE_BYTES = 8 * 4096};
+
+   SymTable_T oSymTable;
+   char acKey[MAX_KEY_LENGTH];
+   char *apcLongKeys[LONG_KEY_COUNT];
+   char acShortstop[] = "Shortstop";
+   char acCenterField[] = "Center Field";
+   size_t uCount;
+   int iSuccessful;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing SymTable_newOnDisk().\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oSymTable = SymTable_newOnDisk("/nonexistent/directory", CACHE_BYTES);
+   ASSURE(oSymTable == NULL);
+
+   /* Long keys span pages of their own, and differ only at the end. */
+   for (i = 0; i < LONG_KEY_COUNT; i++)
+   {
+      apcLongKeys[i] = (char*)malloc(LONG_KEY_LENGTH + 1);
+      ASSURE(apcLongKeys[i] != NULL);
+      if (apcLongKeys[i] == NULL) exit(EXIT_FAILURE);
+      memset(apcLongKeys[i], 'x', LONG_KEY_LENGTH);
+      apcLongKeys[i][LONG_KEY_LENGTH - 1] = (char)('a' + i);
+      apcLongKeys[i][LONG_KEY_LENGTH] = '\0';
+   }
+
+   /* A cache smaller than the minimum holds the minimum. */
+   oSymTable = SymTable_newOnDisk(NULL, 0);
+   ASSURE(oSymTable != NULL);
+   if (oSymTable == NULL) exit(EXIT_FAILURE);
+
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      iSuccessful = SymTable_put(oSymTable, acKey, acShortstop);
+      ASSURE(iSuccessful);
+   }
+   for (i = 0; i < LONG_KEY_COUNT; i++)
+   {
+      iSuccessful = SymTable_put(oSymTable, apcLongKeys[i],
+         acCenterField);
+      ASSURE(iSuccessful);
+   }
+   ASSURE(SymTable_getLength(oSymTable)
+      == BINDING_COUNT + LONG_KEY_COUNT);
+
+   /* The bindings far outgrow the cache, which stays within bounds. */
+   ASSURE(SymTable_memoryUsage(oSymTable) < 4 * CACHE_BYTES);
+
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      ASSURE(SymTable_get(oSymTable, acKey) == acShortstop);
+   }
+   for (i = 0; i < LONG_KEY_COUNT; i++)
+   {
+      ASSURE(SymTable_get(oSymTable, apcLongKeys[i]) == acCenterField);
+      iSuccessful = SymTable_put(oSymTable, apcLongKeys[i],
+         acShortstop);
+      ASSURE(! iSuccessful);
+   }
+   apcLongKeys[0][0] = 'y';
+   ASSURE(! SymTable_contains(oSymTable, apcLongKeys[0]));
+   apcLongKeys[0][0] = 'x';
+
+   uCount = 0;
+   SymTable_map(oSymTable, countBinding, &uCount);
+   ASSURE(uCount == BINDING_COUNT + LONG_KEY_COUNT);
+
+   /* Removing every binding leaves the table as good as new. */
+   for (i = 0; i < LONG_KEY_COUNT; i++)
+      ASSURE(SymTable_remove(oSymTable, apcLongKeys[i])
+         == acCenterField);
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      ASSURE(SymTable_remove(oSymTable, acKey) == acShortstop);
+   }
+   ASSURE(SymTable_getLength(oSymTable) == 0);
+   for (i = 0; i < BINDING_COUNT; i += 100)
+   {
+      sprintf(acKey, "%d", i);
+      ASSURE(! SymTable_contains(oSymTable, acKey));
+   }
+   iSuccessful = SymTable_put(oSymTable, apcLongKeys[0], acShortstop);
+   ASSURE(iSuccessful);
+   ASSURE(SymTable_get(oSymTable, apcLongKeys[0]) == acShortstop);
+
+   SymTable_free(oSymTable);
+   for (i = 0; i < LONG_KEY_COUNT; i++)
+      free(apcLongKeys[i]);
+}
+#endif
+
+/*--------------------------------------------------------------------*/
+
 /* Test the ability of a SymTable object to handle collisions.  This
    test assumes that a SymTable object is implemented as a hash table,
    that there are 509 buckets in the hash table, and that the
@@ -962,6 +1629,17 @@ int main(int argc, char *argv[])
    testNullValue();
    testLongKey();
    testTableOfTables();
+   testAllocator();
+   testRemoveIf();
+#ifdef SYMTABLE_CLONE
+   testClone();
+#endif
+#ifdef SYMTABLE_HANDLE
+   testHandles();
+#endif
+#ifdef SYMTABLE_DISK
+   testDisk();
+#endif
    testCollisions();
    testLargeTable(iBindingCount);
 
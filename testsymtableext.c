@@ -0,0 +1,2153 @@
+/*--------------------------------------------------------------------*/
+/* testsymtableext.c                                                  */
+/* Author: Maxwell Lloyd                                              */
+/*--------------------------------------------------------------------*/
+
+#include "symtablehash.h"
+#include "symtablehandle.h"
+#include "symtablehuge.h"
+#include "symtablelog.h"
+#include "symtablefrozen.h"
+#include "symtablegen.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <signal.h>
+#include <assert.h>
+
+#ifndef S_SPLINT_S
+#include <sys/resource.h>
+#endif
+
+/*--------------------------------------------------------------------*/
+
+#define ASSURE(i) assure(i, __LINE__)
+
+/*--------------------------------------------------------------------*/
+
+/* Hash and compare the keys of LongTable, a table generated by
+   SYMTABLE_DEFINE from long keys to double values. */
+
+#define HASH_LONG(lKey) SymTableGen_hashUint64((uint64_t)(lKey))
+#define EQUAL_LONG(lKey1, lKey2) ((lKey1) == (lKey2))
+
+SYMTABLE_DEFINE(LongTable, long, double, HASH_LONG, EQUAL_LONG)
+
+/* Return 1 if the strings pcKey1 and pcKey2 have the same
+   characters, or 0 otherwise. */
+
+static int equalString(const char *pcKey1, const char *pcKey2)
+{
+   return strcmp(pcKey1, pcKey2) == 0;
+}
+
+SYMTABLE_DEFINE(StringTable, const char *, int, SymTableGen_hashString,
+   equalString)
+
+/*--------------------------------------------------------------------*/
+
+/* If !iSuccessful, print a message to stdout indicating that the
+   test at line iLineNum failed. */
+
+static void assure(int iSuccessful, int iLineNum)
+{
+   if (! iSuccessful)
+   {
+      printf("Test at line %d failed.\n", iLineNum);
+      fflush(stdout);
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Serialize the string pvValue, including its '\0'. */
+
+static size_t serializeString(const void *pvValue,
+   const void **ppvBytes)
+{
+   assert(ppvBytes != NULL);
+
+   *ppvBytes = pvValue;
+   if (pvValue == NULL)
+      return 0;
+   return strlen((const char*)pvValue) + 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Add 1 to the count pointed to by pvExtra, after checking that the
+   string value pvValue has the same characters as pcKey, or is NULL
+   for the empty key. */
+
+static void countMatchingBinding(const char *pcKey, void *pvValue,
+   void *pvExtra)
+{
+   assert(pcKey != NULL);
+   assert(pvExtra != NULL);
+
+   if (pvValue == NULL)
+      ASSURE(*pcKey == '\0');
+   else
+      ASSURE(strcmp(pcKey, (char*)pvValue) == 0);
+   (*(size_t*)pvExtra)++;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Write the first uLength bytes of the file pcPath, whose length is
+   uFileLength, to pcCopy, with the 8 bytes at uOffset, if they lie
+   within them, replaced by uValue. Return 1 for success or 0 for
+   failure. */
+
+static int corruptCopy(const char *pcPath, size_t uFileLength,
+   const char *pcCopy, size_t uLength, size_t uOffset, uint64_t uValue)
+{
+   FILE *psFile;
+   unsigned char *pucBytes;
+   int iSuccessful;
+
+   assert(pcPath != NULL);
+   assert(pcCopy != NULL);
+
+   pucBytes = (unsigned char*)malloc(uFileLength);
+   if (pucBytes == NULL)
+      return 0;
+   psFile = fopen(pcPath, "rb");
+   iSuccessful = psFile != NULL
+      && fread(pucBytes, 1, uFileLength, psFile) == uFileLength;
+   if (psFile != NULL)
+      fclose(psFile);
+   if (iSuccessful && uOffset + sizeof(uValue) <= uLength)
+      memcpy(pucBytes + uOffset, &uValue, sizeof(uValue));
+
+   psFile = fopen(pcCopy, "wb");
+   iSuccessful = iSuccessful && psFile != NULL
+      && fwrite(pucBytes, 1, uLength, psFile) == uLength;
+   if (psFile != NULL && fclose(psFile) != 0)
+      iSuccessful = 0;
+   free(pucBytes);
+   return iSuccessful;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTable_save() and SymTable_openMapped(). */
+
+static void testSnapshot(void)
+{
+   enum {BINDING_COUNT = 2000, MAX_KEY_LENGTH = 10};
+
+   const char acPath[] = "testsymtableext.snap";
+   const char acCorrupt[] = "testsymtableext.bad";
+   SymTable_T oSymTable;
+   SymTable_T oMapped;
+   FILE *psFile;
+   char acKey[MAX_KEY_LENGTH];
+   char *pcValue;
+   size_t uFileLength;
+   size_t uBucketCount;
+   size_t uCount;
+   int iSuccessful;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing SymTable_save() and SymTable_openMapped().\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      pcValue = (char*)malloc(strlen(acKey) + 1);
+      ASSURE(pcValue != NULL);
+      strcpy(pcValue, acKey);
+      iSuccessful = SymTable_put(oSymTable, acKey, pcValue);
+      ASSURE(iSuccessful);
+   }
+   iSuccessful = SymTable_put(oSymTable, "", NULL);
+   ASSURE(iSuccessful);
+
+   iSuccessful = SymTable_save(oSymTable, acPath, serializeString);
+   ASSURE(iSuccessful);
+
+   oMapped = SymTable_openMapped(acPath);
+   ASSURE(oMapped != NULL);
+   ASSURE(SymTable_getLength(oMapped) == BINDING_COUNT + 1);
+
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      ASSURE(SymTable_contains(oMapped, acKey));
+      pcValue = (char*)SymTable_get(oMapped, acKey);
+      ASSURE((pcValue != NULL) && (strcmp(pcValue, acKey) == 0));
+   }
+   ASSURE(SymTable_contains(oMapped, ""));
+   ASSURE(SymTable_get(oMapped, "") == NULL);
+   ASSURE(! SymTable_contains(oMapped, "Jeter"));
+   ASSURE(SymTable_get(oMapped, "Jeter") == NULL);
+
+   /* The mapped table is read-only. */
+   ASSURE(! SymTable_put(oMapped, "Jeter", "Shortstop"));
+   ASSURE(SymTable_replace(oMapped, "0", "Shortstop") == NULL);
+   ASSURE(SymTable_remove(oMapped, "0") == NULL);
+   ASSURE(SymTable_getLength(oMapped) == BINDING_COUNT + 1);
+
+   uCount = 0;
+   SymTable_map(oMapped, countMatchingBinding, &uCount);
+   ASSURE(uCount == BINDING_COUNT + 1);
+
+   SymTable_free(oMapped);
+
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      free(SymTable_remove(oSymTable, acKey));
+   }
+   SymTable_free(oSymTable);
+
+   /* A file that is not a snapshot cannot be mapped. */
+   ASSURE(SymTable_openMapped("testsymtableext.c") == NULL);
+   ASSURE(SymTable_openMapped("no such file") == NULL);
+
+   /* Nor can a truncated one, or one that claims more bindings than
+      it has room for. The header is 32 bytes: the magic number, then
+      the binding count, bucket count and length. */
+   psFile = fopen(acPath, "rb");
+   ASSURE(psFile != NULL);
+   if (psFile == NULL) exit(EXIT_FAILURE);
+   fseek(psFile, 0, SEEK_END);
+   uFileLength = (size_t)ftell(psFile);
+   fclose(psFile);
+
+   iSuccessful = corruptCopy(acPath, uFileLength, acCorrupt,
+      uFileLength - 8, 0, 0);
+   ASSURE(iSuccessful);
+   ASSURE(SymTable_openMapped(acCorrupt) == NULL);
+   iSuccessful = corruptCopy(acPath, uFileLength, acCorrupt,
+      uFileLength, 8, uFileLength);
+   ASSURE(iSuccessful);
+   ASSURE(SymTable_openMapped(acCorrupt) == NULL);
+
+   /* Bucket offsets past the end, and a first record whose key is
+      longer than the file, are read as missing bindings. */
+   iSuccessful = corruptCopy(acPath, uFileLength, acCorrupt,
+      uFileLength, 32, uFileLength + 64);
+   ASSURE(iSuccessful);
+   oMapped = SymTable_openMapped(acCorrupt);
+   ASSURE(oMapped != NULL);
+   if (oMapped != NULL)
+   {
+      for (i = 0; i < BINDING_COUNT; i++)
+      {
+         sprintf(acKey, "%d", i);
+         pcValue = (char*)SymTable_get(oMapped, acKey);
+         ASSURE(pcValue == NULL || strcmp(pcValue, acKey) == 0);
+      }
+      SymTable_free(oMapped);
+   }
+   uBucketCount = (BINDING_COUNT + 1) | 1;
+   iSuccessful = corruptCopy(acPath, uFileLength, acCorrupt,
+      uFileLength, 32 + 8 * uBucketCount + 16, (uint64_t)-1);
+   ASSURE(iSuccessful);
+   oMapped = SymTable_openMapped(acCorrupt);
+   ASSURE(oMapped != NULL);
+   if (oMapped != NULL)
+   {
+      uCount = 0;
+      SymTable_map(oMapped, countMatchingBinding, &uCount);
+      ASSURE(uCount == 0);
+      for (i = 0; i < BINDING_COUNT; i++)
+      {
+         sprintf(acKey, "%d", i);
+         pcValue = (char*)SymTable_get(oMapped, acKey);
+         ASSURE(pcValue == NULL || strcmp(pcValue, acKey) == 0);
+      }
+      SymTable_free(oMapped);
+   }
+
+   remove(acCorrupt);
+   remove(acPath);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return a new copy of the uLength bytes at pvBytes. */
+
+static void *deserializeString(const void *pvBytes, size_t uLength)
+{
+   char *pcValue;
+
+   assert(pvBytes != NULL);
+
+   pcValue = (char*)malloc(uLength);
+   if (pcValue != NULL)
+      memcpy(pcValue, pvBytes, uLength);
+   return pcValue;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Free the value pcKey is bound to. pvExtra is unused. */
+
+static void freeValue(const char *pcKey, void *pvValue, void *pvExtra)
+{
+   assert(pcKey != NULL);
+   assert(pvExtra == NULL);
+
+   free(pvValue);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTable_recover() and the SymTableLog functions. */
+
+static void testLog(void)
+{
+   enum {BINDING_COUNT = 15000, MAX_KEY_LENGTH = 10, GROUP_SIZE = 64};
+
+   const char acPath[] = "testsymtableext.log";
+   const uint32_t auTornRecord[4] = {0, 1, UINT32_MAX, UINT32_MAX};
+   SymTable_T oSymTable;
+   SymTableLog_T oSymTableLog;
+   struct rlimit limit;
+   struct rlimit savedLimit;
+   char acKey[MAX_KEY_LENGTH];
+   char acShortstop[] = "Shortstop";
+   char acCatcher[] = "Catcher";
+   char *pcValue;
+   int iSuccessful;
+   int i;
+   FILE *psFile;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing SymTable_recover() and SymTableLog objects.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   remove(acPath);
+
+   /* A missing log recovers as an empty table. */
+   oSymTable = SymTable_recover(acPath, deserializeString, free);
+   ASSURE(oSymTable != NULL);
+   ASSURE(SymTable_getLength(oSymTable) == 0);
+
+   oSymTableLog = SymTableLog_open(oSymTable, acPath, serializeString,
+      GROUP_SIZE);
+   ASSURE(oSymTableLog != NULL);
+
+   iSuccessful = SymTableLog_put(oSymTableLog, "Jeter", acShortstop);
+   ASSURE(iSuccessful);
+   iSuccessful = SymTableLog_put(oSymTableLog, "Jeter", acCatcher);
+   ASSURE(! iSuccessful);
+   iSuccessful = SymTableLog_put(oSymTableLog, "Berra", acShortstop);
+   ASSURE(iSuccessful);
+   pcValue = (char*)SymTableLog_replace(oSymTableLog, "Berra",
+      acCatcher);
+   ASSURE(pcValue == acShortstop);
+   ASSURE(SymTableLog_replace(oSymTableLog, "Ruth", acCatcher) == NULL);
+   iSuccessful = SymTableLog_put(oSymTableLog, "Ruth", NULL);
+   ASSURE(iSuccessful);
+
+   /* Enough churn to compact the log on its own. */
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      iSuccessful = SymTableLog_put(oSymTableLog, acKey, acShortstop);
+      ASSURE(iSuccessful);
+      if (i % 3 != 0)
+      {
+         pcValue = (char*)SymTableLog_remove(oSymTableLog, acKey);
+         ASSURE(pcValue == acShortstop);
+      }
+   }
+   ASSURE(SymTableLog_remove(oSymTableLog, "Mantle") == NULL);
+
+   /* A group that cannot be written leaves its changes made and
+      waiting, and only the syncs fail until it can be. The limit
+      falls inside the group, so part of it reaches the file first. */
+   iSuccessful = SymTableLog_sync(oSymTableLog);
+   ASSURE(iSuccessful);
+   psFile = fopen(acPath, "rb");
+   ASSURE(psFile != NULL);
+   if (psFile == NULL) exit(EXIT_FAILURE);
+   fseek(psFile, 0, SEEK_END);
+   limit.rlim_cur = (rlim_t)ftell(psFile) + 100;
+   fclose(psFile);
+#ifdef SIGXFSZ
+   signal(SIGXFSZ, SIG_IGN);
+#endif
+   getrlimit(RLIMIT_FSIZE, &savedLimit);
+   limit.rlim_max = savedLimit.rlim_max;
+   setrlimit(RLIMIT_FSIZE, &limit);
+   for (i = 0; i < GROUP_SIZE; i++)
+   {
+      sprintf(acKey, "g%d", i);
+      iSuccessful = SymTableLog_put(oSymTableLog, acKey, acCatcher);
+      ASSURE(iSuccessful);
+   }
+   iSuccessful = SymTableLog_put(oSymTableLog, "DiMaggio", acCatcher);
+   ASSURE(iSuccessful);
+   ASSURE(SymTable_get(oSymTable, "DiMaggio") == acCatcher);
+   ASSURE(! SymTableLog_sync(oSymTableLog));
+   setrlimit(RLIMIT_FSIZE, &savedLimit);
+   iSuccessful = SymTableLog_sync(oSymTableLog);
+   ASSURE(iSuccessful);
+
+   iSuccessful = SymTableLog_close(oSymTableLog);
+   ASSURE(iSuccessful);
+   SymTable_free(oSymTable);
+
+   /* A torn record at the end is ignored, even one whose lengths are
+      far larger than the file. */
+   psFile = fopen(acPath, "ab");
+   ASSURE(psFile != NULL);
+   if (psFile != NULL)
+   {
+      fwrite(auTornRecord, sizeof(auTornRecord), 1, psFile);
+      fputs("torn", psFile);
+      fclose(psFile);
+   }
+
+   oSymTable = SymTable_recover(acPath, deserializeString, free);
+   ASSURE(oSymTable != NULL);
+   ASSURE(SymTable_getLength(oSymTable)
+      == 4 + GROUP_SIZE + (BINDING_COUNT + 2) / 3);
+   pcValue = (char*)SymTable_get(oSymTable, "DiMaggio");
+   ASSURE((pcValue != NULL) && (strcmp(pcValue, acCatcher) == 0));
+   pcValue = (char*)SymTable_get(oSymTable, "Jeter");
+   ASSURE((pcValue != NULL) && (strcmp(pcValue, acShortstop) == 0));
+   pcValue = (char*)SymTable_get(oSymTable, "Berra");
+   ASSURE((pcValue != NULL) && (strcmp(pcValue, acCatcher) == 0));
+   ASSURE(SymTable_contains(oSymTable, "Ruth"));
+   ASSURE(SymTable_get(oSymTable, "Ruth") == NULL);
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      ASSURE(SymTable_contains(oSymTable, acKey) == (i % 3 == 0));
+   }
+   for (i = 0; i < GROUP_SIZE; i++)
+   {
+      sprintf(acKey, "g%d", i);
+      pcValue = (char*)SymTable_get(oSymTable, acKey);
+      ASSURE((pcValue != NULL) && (strcmp(pcValue, acCatcher) == 0));
+   }
+
+   SymTable_map(oSymTable, freeValue, NULL);
+   SymTable_free(oSymTable);
+
+   /* A file that is not a log cannot be recovered. */
+   ASSURE(SymTable_recover("testsymtableext.c", deserializeString,
+      free) == NULL);
+
+   remove(acPath);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTable_freeze() and the SymTableFrozen functions. */
+
+static void testFrozen(void)
+{
+   enum {BINDING_COUNT = 20000, MAX_KEY_LENGTH = 10};
+
+   SymTable_T oSymTable;
+   SymTableFrozen_T oSymTableFrozen;
+   char acKey[MAX_KEY_LENGTH];
+   char *pcValue;
+   size_t uCount;
+   int iSuccessful;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing SymTable_freeze() and SymTableFrozen objects.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   /* An empty table freezes too. */
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   oSymTableFrozen = SymTable_freeze(oSymTable);
+   ASSURE(oSymTableFrozen != NULL);
+   ASSURE(SymTableFrozen_getLength(oSymTableFrozen) == 0);
+   ASSURE(! SymTableFrozen_contains(oSymTableFrozen, "Jeter"));
+   ASSURE(SymTableFrozen_get(oSymTableFrozen, "Jeter") == NULL);
+   SymTableFrozen_free(oSymTableFrozen);
+
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      pcValue = (char*)malloc(strlen(acKey) + 1);
+      ASSURE(pcValue != NULL);
+      strcpy(pcValue, acKey);
+      iSuccessful = SymTable_put(oSymTable, acKey, pcValue);
+      ASSURE(iSuccessful);
+   }
+   iSuccessful = SymTable_put(oSymTable, "", NULL);
+   ASSURE(iSuccessful);
+
+   oSymTableFrozen = SymTable_freeze(oSymTable);
+   ASSURE(oSymTableFrozen != NULL);
+
+   /* The frozen table keeps its own copy of the keys. */
+   SymTable_remove(oSymTable, "");
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      free(SymTable_remove(oSymTable, acKey));
+   }
+   ASSURE(SymTableFrozen_getLength(oSymTableFrozen) == BINDING_COUNT + 1);
+
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      ASSURE(SymTableFrozen_contains(oSymTableFrozen, acKey));
+      sprintf(acKey, "%d", BINDING_COUNT + i);
+      ASSURE(! SymTableFrozen_contains(oSymTableFrozen, acKey));
+      ASSURE(SymTableFrozen_get(oSymTableFrozen, acKey) == NULL);
+   }
+   ASSURE(SymTableFrozen_contains(oSymTableFrozen, ""));
+   ASSURE(SymTableFrozen_get(oSymTableFrozen, "") == NULL);
+   ASSURE(! SymTableFrozen_contains(oSymTableFrozen, "Jeter"));
+
+   SymTable_free(oSymTable);
+   SymTableFrozen_free(oSymTableFrozen);
+
+   /* Values and keys still agree after freezing. */
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      pcValue = (char*)malloc(strlen(acKey) + 1);
+      ASSURE(pcValue != NULL);
+      strcpy(pcValue, acKey);
+      iSuccessful = SymTable_put(oSymTable, acKey, pcValue);
+      ASSURE(iSuccessful);
+   }
+   oSymTableFrozen = SymTable_freeze(oSymTable);
+   ASSURE(oSymTableFrozen != NULL);
+   uCount = 0;
+   SymTableFrozen_map(oSymTableFrozen, countMatchingBinding, &uCount);
+   ASSURE(uCount == BINDING_COUNT);
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      pcValue = (char*)SymTableFrozen_get(oSymTableFrozen, acKey);
+      ASSURE((pcValue != NULL) && (strcmp(pcValue, acKey) == 0));
+   }
+   SymTableFrozen_free(oSymTableFrozen);
+
+   SymTable_map(oSymTable, freeValue, NULL);
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTable_getStats(). */
+
+static void testStats(void)
+{
+   enum {BINDING_COUNT = 3000, MAX_KEY_LENGTH = 10};
+
+   struct SymTable_Stats stats;
+   SymTable_T oSymTable;
+   char acKey[MAX_KEY_LENGTH];
+   size_t uBuckets;
+   size_t uBindings;
+   size_t uKeyBytes;
+   int iSuccessful;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing SymTable_getStats().\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+
+   SymTable_getStats(oSymTable, &stats);
+   ASSURE(stats.uBucketCount == 509);
+   ASSURE(stats.uBindingCount == 0);
+   ASSURE(stats.dLoadFactor == 0.0);
+   ASSURE(stats.auChainLengths[0] == 509);
+   ASSURE(stats.uMaxChain == 0);
+   ASSURE(stats.uTreeBuckets == 0);
+   ASSURE(stats.uNodeBytes == 0);
+   ASSURE(stats.uKeyBytes == 0);
+   ASSURE(stats.uBucketBytes >= 509 * sizeof(void*));
+
+   uKeyBytes = 0;
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      uKeyBytes += strlen(acKey) + 1;
+      iSuccessful = SymTable_put(oSymTable, acKey, NULL);
+      ASSURE(iSuccessful);
+   }
+   iSuccessful = SymTable_put(oSymTable, "0", NULL);
+   ASSURE(! iSuccessful);
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      ASSURE(SymTable_contains(oSymTable, acKey));
+   }
+   ASSURE(SymTable_get(oSymTable, "Jeter") == NULL);
+   ASSURE(SymTable_remove(oSymTable, "0") == NULL);
+   uKeyBytes -= 2;
+
+   /* The histogram accounts for every bucket and every binding. */
+   SymTable_getStats(oSymTable, &stats);
+   ASSURE(stats.uBindingCount == BINDING_COUNT - 1);
+   ASSURE(stats.uBucketCount > 509);
+   ASSURE(stats.dLoadFactor > 0.0 && stats.dLoadFactor <= 1.0);
+   ASSURE(stats.uKeyBytes == uKeyBytes);
+   ASSURE(stats.uNodeBytes > 0);
+   uBuckets = 0;
+   uBindings = 0;
+   for (i = 0; i < SYMTABLE_CHAIN_HISTOGRAM_SIZE; i++)
+   {
+      uBuckets += stats.auChainLengths[i];
+      uBindings += (size_t)i * stats.auChainLengths[i];
+      if (stats.auChainLengths[i] != 0)
+         ASSURE((size_t)i <= stats.uMaxChain);
+   }
+   ASSURE(uBuckets == stats.uBucketCount);
+   if (stats.uMaxChain < SYMTABLE_CHAIN_HISTOGRAM_SIZE)
+      ASSURE(uBindings == stats.uBindingCount);
+   else
+      ASSURE(uBindings <= stats.uBindingCount);
+
+#ifdef SYMTABLE_STATS
+   ASSURE(stats.ulPuts == BINDING_COUNT + 1);
+   ASSURE(stats.ulLookups == BINDING_COUNT + 1);
+   ASSURE(stats.ulRemoves == 1);
+   ASSURE(stats.ulRemoveProbes >= 1);
+   /* Every present key is compared at least once when found. */
+   ASSURE(stats.ulLookupProbes >= BINDING_COUNT);
+   ASSURE(stats.ulPutProbes >= 1);
+   ASSURE(stats.ulResizes >= 1);
+   ASSURE(stats.dResizeSeconds >= 0.0);
+#else
+   ASSURE(stats.ulPuts == 0);
+   ASSURE(stats.ulResizes == 0);
+#endif
+
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return a new SymTable object binding the keys iStart to iEnd-1,
+   written in decimal, to pcValue. */
+
+static SymTable_T newRange(int iStart, int iEnd, const char *pcValue)
+{
+   enum {MAX_KEY_LENGTH = 12};
+
+   SymTable_T oSymTable;
+   char acKey[MAX_KEY_LENGTH];
+   int iSuccessful;
+   int i;
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   for (i = iStart; i < iEnd; i++)
+   {
+      sprintf(acKey, "%d", i);
+      iSuccessful = SymTable_put(oSymTable, acKey, pcValue);
+      ASSURE(iSuccessful);
+   }
+   return oSymTable;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return 1 if oSymTable binds exactly the keys iStart to iEnd-1, each
+   to a string equal to pcFirst if the key is below iSplit or to
+   pcSecond otherwise, or 0 if not. */
+
+static int hasRange(SymTable_T oSymTable, int iStart, int iEnd,
+   int iSplit, const char *pcFirst, const char *pcSecond)
+{
+   enum {MAX_KEY_LENGTH = 12};
+
+   char acKey[MAX_KEY_LENGTH];
+   const char *pcValue;
+   int i;
+
+   if (SymTable_getLength(oSymTable) != (size_t)(iEnd - iStart))
+      return 0;
+   for (i = iStart; i < iEnd; i++)
+   {
+      sprintf(acKey, "%d", i);
+      pcValue = (const char*)SymTable_get(oSymTable, acKey);
+      if (pcValue == NULL
+         || strcmp(pcValue, (i < iSplit) ? pcFirst : pcSecond) != 0)
+         return 0;
+   }
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTable_merge(), SymTable_mergeAndFree(),
+   SymTable_intersect() and SymTable_difference(). The first table
+   binds 0 to N-1 to "first" and the second binds N/2 to 5N/4-1 to
+   "second", so the second is the smaller one. */
+
+static void testSetOperations(void)
+{
+   enum {N = 4000};
+
+   const char acPath[] = "testsymtableext.snap";
+   static char acFirst[] = "first";
+   static char acSecond[] = "second";
+   SymTable_T oFirst;
+   SymTable_T oSecond;
+   SymTable_T oDest;
+   SymTable_T oResult;
+   SymTable_T oMapped;
+   int iSuccessful;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing SymTable_merge(), SymTable_mergeAndFree(),\n");
+   printf("SymTable_intersect() and SymTable_difference().\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oFirst = newRange(0, N, acFirst);
+   oSecond = newRange(N / 2, N + N / 4, acSecond);
+
+   oDest = newRange(0, N, acFirst);
+   iSuccessful = SymTable_merge(oDest, oSecond, SYMTABLE_KEEP_DEST);
+   ASSURE(iSuccessful);
+   ASSURE(hasRange(oDest, 0, N + N / 4, N, acFirst, acSecond));
+   ASSURE(hasRange(oSecond, N / 2, N + N / 4, 0, acFirst, acSecond));
+
+   /* Merging a table into itself changes nothing. */
+   iSuccessful = SymTable_merge(oDest, oDest, SYMTABLE_TAKE_SOURCE);
+   ASSURE(iSuccessful);
+   ASSURE(hasRange(oDest, 0, N + N / 4, N, acFirst, acSecond));
+   SymTable_free(oDest);
+
+   oDest = newRange(0, N, acFirst);
+   iSuccessful = SymTable_merge(oDest, oSecond, SYMTABLE_TAKE_SOURCE);
+   ASSURE(iSuccessful);
+   ASSURE(hasRange(oDest, 0, N + N / 4, N / 2, acFirst, acSecond));
+   SymTable_free(oDest);
+
+   /* The nodes of a consumed source move into the destination. */
+   oDest = newRange(0, N, acFirst);
+   iSuccessful = SymTable_mergeAndFree(oDest,
+      newRange(N / 2, N + N / 4, acSecond), SYMTABLE_TAKE_SOURCE);
+   ASSURE(iSuccessful);
+   ASSURE(hasRange(oDest, 0, N + N / 4, N / 2, acFirst, acSecond));
+   iSuccessful = SymTable_mergeAndFree(oDest, SymTable_new(),
+      SYMTABLE_KEEP_DEST);
+   ASSURE(iSuccessful);
+   ASSURE(hasRange(oDest, 0, N + N / 4, N / 2, acFirst, acSecond));
+   SymTable_free(oDest);
+
+   /* Values come from the first table whichever side is walked. */
+   oResult = SymTable_intersect(oFirst, oSecond);
+   ASSURE(oResult != NULL);
+   ASSURE(hasRange(oResult, N / 2, N, N, acFirst, acSecond));
+   SymTable_free(oResult);
+   oResult = SymTable_intersect(oSecond, oFirst);
+   ASSURE(oResult != NULL);
+   ASSURE(hasRange(oResult, N / 2, N, 0, acFirst, acSecond));
+   SymTable_free(oResult);
+
+   oResult = SymTable_difference(oFirst, oSecond);
+   ASSURE(oResult != NULL);
+   ASSURE(hasRange(oResult, 0, N / 2, N, acFirst, acSecond));
+   SymTable_free(oResult);
+   oResult = SymTable_difference(oSecond, oFirst);
+   ASSURE(oResult != NULL);
+   ASSURE(hasRange(oResult, N, N + N / 4, 0, acFirst, acSecond));
+   SymTable_free(oResult);
+
+   /* A mapped snapshot can be the source, but not the destination. */
+   iSuccessful = SymTable_save(oSecond, acPath, serializeString);
+   ASSURE(iSuccessful);
+   oMapped = SymTable_openMapped(acPath);
+   ASSURE(oMapped != NULL);
+   ASSURE(! SymTable_merge(oMapped, oFirst, SYMTABLE_KEEP_DEST));
+   oDest = newRange(0, N, acFirst);
+   iSuccessful = SymTable_merge(oDest, oMapped, SYMTABLE_TAKE_SOURCE);
+   ASSURE(iSuccessful);
+   ASSURE(hasRange(oDest, 0, N + N / 4, N / 2, acFirst, acSecond));
+   SymTable_free(oDest);
+   oResult = SymTable_intersect(oFirst, oMapped);
+   ASSURE(oResult != NULL);
+   ASSURE(hasRange(oResult, N / 2, N, N, acFirst, acSecond));
+   SymTable_free(oResult);
+   SymTable_free(oMapped);
+   remove(acPath);
+
+   SymTable_free(oFirst);
+   SymTable_free(oSecond);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTable_pushScope(), SymTable_popScope() and
+   SymTable_getScopeDepth(). */
+
+static void testScopes(void)
+{
+   enum {DEPTH = 50, MAX_KEY_LENGTH = 12};
+
+   SymTable_T oSymTable;
+   char acKey[MAX_KEY_LENGTH];
+   char acOuter[] = "outer";
+   char acInner[] = "inner";
+   char acLocal[] = "local";
+   char acLevels[DEPTH + 1];
+   int iSuccessful;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing SymTable_pushScope() and SymTable_popScope().\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   ASSURE(SymTable_getScopeDepth(oSymTable) == 0);
+   ASSURE(! SymTable_popScope(oSymTable));
+   iSuccessful = SymTable_put(oSymTable, "x", acOuter);
+   ASSURE(iSuccessful);
+   iSuccessful = SymTable_put(oSymTable, "y", acOuter);
+   ASSURE(iSuccessful);
+
+   /* An inner scope shadows x and adds z. */
+   iSuccessful = SymTable_pushScope(oSymTable);
+   ASSURE(iSuccessful);
+   ASSURE(SymTable_getScopeDepth(oSymTable) == 1);
+   iSuccessful = SymTable_put(oSymTable, "x", acInner);
+   ASSURE(iSuccessful);
+   iSuccessful = SymTable_put(oSymTable, "x", acLocal);
+   ASSURE(! iSuccessful);
+   iSuccessful = SymTable_put(oSymTable, "z", acInner);
+   ASSURE(iSuccessful);
+   ASSURE(SymTable_getLength(oSymTable) == 3);
+   ASSURE(SymTable_get(oSymTable, "x") == acInner);
+   ASSURE(SymTable_get(oSymTable, "y") == acOuter);
+
+   /* Removing the inner x reveals the outer one; it can be bound
+      again in the same scope. */
+   ASSURE(SymTable_remove(oSymTable, "x") == acInner);
+   ASSURE(SymTable_get(oSymTable, "x") == acOuter);
+   ASSURE(SymTable_getLength(oSymTable) == 3);
+   iSuccessful = SymTable_put(oSymTable, "x", acLocal);
+   ASSURE(iSuccessful);
+   ASSURE(SymTable_get(oSymTable, "x") == acLocal);
+
+   /* A key removed in its own scope can be bound again there. */
+   ASSURE(SymTable_remove(oSymTable, "z") == acInner);
+   ASSURE(! SymTable_contains(oSymTable, "z"));
+   iSuccessful = SymTable_put(oSymTable, "z", acLocal);
+   ASSURE(iSuccessful);
+   ASSURE(SymTable_replace(oSymTable, "z", acInner) == acLocal);
+
+   /* Popping restores the outer bindings exactly. */
+   iSuccessful = SymTable_popScope(oSymTable);
+   ASSURE(iSuccessful);
+   ASSURE(SymTable_getScopeDepth(oSymTable) == 0);
+   ASSURE(SymTable_getLength(oSymTable) == 2);
+   ASSURE(SymTable_get(oSymTable, "x") == acOuter);
+   ASSURE(! SymTable_contains(oSymTable, "z"));
+
+   /* Each level of a deep nest shadows x once; lookups see the
+      innermost and every pop reveals the next one out. */
+   for (i = 1; i <= DEPTH; i++)
+   {
+      iSuccessful = SymTable_pushScope(oSymTable);
+      ASSURE(iSuccessful);
+      sprintf(acKey, "%d", i);
+      iSuccessful = SymTable_put(oSymTable, "x", &acLevels[i]);
+      ASSURE(iSuccessful);
+      iSuccessful = SymTable_put(oSymTable, acKey, acLocal);
+      ASSURE(iSuccessful);
+      ASSURE(SymTable_getLength(oSymTable) == (size_t)(2 + i));
+   }
+   ASSURE(SymTable_getScopeDepth(oSymTable) == DEPTH);
+   for (i = DEPTH; i >= 1; i--)
+   {
+      sprintf(acKey, "%d", i);
+      ASSURE(SymTable_contains(oSymTable, acKey));
+      iSuccessful = SymTable_popScope(oSymTable);
+      ASSURE(iSuccessful);
+      ASSURE(! SymTable_contains(oSymTable, acKey));
+      if (i > 1)
+         ASSURE(SymTable_get(oSymTable, "x") == &acLevels[i - 1]);
+   }
+   ASSURE(SymTable_get(oSymTable, "x") == acOuter);
+   ASSURE(SymTable_getLength(oSymTable) == 2);
+
+   /* An outer binding removed from an inner scope stays removed. */
+   iSuccessful = SymTable_pushScope(oSymTable);
+   ASSURE(iSuccessful);
+   ASSURE(SymTable_remove(oSymTable, "y") == acOuter);
+   ASSURE(! SymTable_merge(oSymTable, oSymTable, SYMTABLE_KEEP_DEST));
+   iSuccessful = SymTable_popScope(oSymTable);
+   ASSURE(iSuccessful);
+   ASSURE(! SymTable_contains(oSymTable, "y"));
+   ASSURE(SymTable_getLength(oSymTable) == 1);
+
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Check that pvValue is a copy of pcKey, free it and count it in the
+   size_t pointed to by pvExtra. */
+
+static void evictCopy(const char *pcKey, void *pvValue, void *pvExtra)
+{
+   assert(pcKey != NULL);
+   assert(pvValue != NULL);
+   assert(pvExtra != NULL);
+
+   ASSURE(strcmp(pcKey, (char*)pvValue) == 0);
+   free(pvValue);
+   (*(size_t*)pvExtra)++;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Bind a malloc'd copy of pcKey to pcKey in oSymTable, and return
+   what SymTable_put returns. */
+
+static int putCopy(SymTable_T oSymTable, const char *pcKey)
+{
+   char *pcCopy;
+   int iSuccessful;
+
+   pcCopy = (char*)malloc(strlen(pcKey) + 1);
+   ASSURE(pcCopy != NULL);
+   strcpy(pcCopy, pcKey);
+   iSuccessful = SymTable_put(oSymTable, pcKey, pcCopy);
+   if (! iSuccessful)
+      free(pcCopy);
+   return iSuccessful;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTable_newBounded(). */
+
+static void testBounded(void)
+{
+   enum {BOUND = 100, MAX_KEY_LENGTH = 12};
+
+   SymTable_T oSymTable;
+   SymTable_T oSource;
+   char acKey[MAX_KEY_LENGTH];
+   char acValue[] = "value";
+   size_t uEvicted;
+   int iSuccessful;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing SymTable_newBounded().\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   uEvicted = 0;
+   oSymTable = SymTable_newBounded(BOUND, evictCopy, &uEvicted);
+   ASSURE(oSymTable != NULL);
+   ASSURE(! SymTable_pushScope(oSymTable));
+   for (i = 0; i < BOUND; i++)
+   {
+      sprintf(acKey, "%d", i);
+      iSuccessful = putCopy(oSymTable, acKey);
+      ASSURE(iSuccessful);
+   }
+   ASSURE(SymTable_getLength(oSymTable) == BOUND);
+   ASSURE(uEvicted == 0);
+
+   /* A bounded node is a plain one plus its reference bit. */
+   oSource = newRange(0, BOUND, acValue);
+   ASSURE(SymTable_memoryUsage(oSymTable) - SymTable_memoryUsage(oSource)
+      == BOUND * sizeof(int));
+   SymTable_free(oSource);
+
+   /* A key already bound is not put again, and evicts nothing. */
+   iSuccessful = putCopy(oSymTable, "0");
+   ASSURE(! iSuccessful);
+   ASSURE(uEvicted == 0);
+
+   /* The keys looked up get a second chance, so the new keys push out
+      only keys that were not. */
+   for (i = 0; i < BOUND / 2; i++)
+   {
+      sprintf(acKey, "%d", i);
+      ASSURE(SymTable_contains(oSymTable, acKey));
+   }
+   for (i = BOUND; i < BOUND + BOUND / 2; i++)
+   {
+      sprintf(acKey, "%d", i);
+      iSuccessful = putCopy(oSymTable, acKey);
+      ASSURE(iSuccessful);
+      ASSURE(SymTable_getLength(oSymTable) == BOUND);
+   }
+   ASSURE(uEvicted == BOUND / 2);
+   for (i = 0; i < BOUND / 2; i++)
+   {
+      sprintf(acKey, "%d", i);
+      ASSURE(SymTable_contains(oSymTable, acKey));
+   }
+
+   /* Removing a binding makes room without evicting, and does not
+      call the evictor. */
+   free(SymTable_remove(oSymTable, "0"));
+   ASSURE(SymTable_getLength(oSymTable) == BOUND - 1);
+   iSuccessful = putCopy(oSymTable, "0");
+   ASSURE(iSuccessful);
+   ASSURE(uEvicted == BOUND / 2);
+
+   SymTable_map(oSymTable, freeValue, NULL);
+   SymTable_free(oSymTable);
+
+   /* A table of one binding keeps the latest. */
+   oSymTable = SymTable_newBounded(1, NULL, NULL);
+   ASSURE(oSymTable != NULL);
+   iSuccessful = SymTable_put(oSymTable, "a", acValue);
+   ASSURE(iSuccessful);
+   ASSURE(SymTable_get(oSymTable, "a") == acValue);
+   iSuccessful = SymTable_put(oSymTable, "b", acValue);
+   ASSURE(iSuccessful);
+   ASSURE(! SymTable_contains(oSymTable, "a"));
+   ASSURE(SymTable_contains(oSymTable, "b"));
+   ASSURE(SymTable_getLength(oSymTable) == 1);
+
+   /* A merge evicts down to the bound afterwards. */
+   oSource = newRange(0, 3 * BOUND, acValue);
+   iSuccessful = SymTable_merge(oSymTable, oSource, SYMTABLE_KEEP_DEST);
+   ASSURE(iSuccessful);
+   ASSURE(SymTable_getLength(oSymTable) == 1);
+   SymTable_free(oSymTable);
+
+   oSymTable = SymTable_newBounded(BOUND, NULL, NULL);
+   ASSURE(oSymTable != NULL);
+   iSuccessful = SymTable_mergeAndFree(oSymTable, oSource,
+      SYMTABLE_KEEP_DEST);
+   ASSURE(iSuccessful);
+   ASSURE(SymTable_getLength(oSymTable) == BOUND);
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Count the binding pcKey, pvValue in the size_t pointed to by
+   pvExtra. */
+
+static void countBinding(const char *pcKey, void *pvValue, void *pvExtra)
+{
+   assert(pcKey != NULL);
+   assert(pvExtra != NULL);
+   (void)pvValue;
+
+   (*(size_t*)pvExtra)++;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTable_putWithTTL() and SymTable_expire(), first by hand and
+   then against the deadlines of many keys spread over the whole range
+   of the timing wheel. */
+
+static void testTTL(void)
+{
+   enum {KEY_COUNT = 2000, STEP_COUNT = 300, MAX_KEY_LENGTH = 12};
+
+   SymTable_T oSymTable;
+   static uint64_t auDeadlines[KEY_COUNT];
+   char acKey[MAX_KEY_LENGTH];
+   char acValue[] = "value";
+   char acOther[] = "other";
+   uint64_t uRandom = 12345;
+   uint64_t uNow;
+   size_t uCount;
+   size_t uExpected;
+   int iSuccessful;
+   int iStep;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing SymTable_putWithTTL() and SymTable_expire().\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   ASSURE(SymTable_expire(oSymTable, 100, NULL, NULL) == 0);
+   iSuccessful = SymTable_putWithTTL(oSymTable, "a", acValue, 100, 10);
+   ASSURE(iSuccessful);
+   iSuccessful = SymTable_putWithTTL(oSymTable, "b", acValue, 100, 1000);
+   ASSURE(iSuccessful);
+   iSuccessful = SymTable_put(oSymTable, "c", acValue);
+   ASSURE(iSuccessful);
+   iSuccessful = SymTable_putWithTTL(oSymTable, "a", acOther, 100, 10);
+   ASSURE(! iSuccessful);
+   ASSURE(! SymTable_pushScope(oSymTable));
+
+   /* A later time given to a put makes a lapse before it, until
+      SymTable_expire removes it. */
+   iSuccessful = SymTable_putWithTTL(oSymTable, "d", acValue, 110, 5);
+   ASSURE(iSuccessful);
+   ASSURE(! SymTable_contains(oSymTable, "a"));
+   ASSURE(SymTable_get(oSymTable, "a") == NULL);
+   ASSURE(SymTable_replace(oSymTable, "a", acOther) == NULL);
+   ASSURE(SymTable_get(oSymTable, "d") == acValue);
+   ASSURE(SymTable_getLength(oSymTable) == 4);
+   uCount = 0;
+   SymTable_map(oSymTable, countBinding, &uCount);
+   ASSURE(uCount == 3);
+
+   uCount = 0;
+   ASSURE(SymTable_expire(oSymTable, 110, countBinding, &uCount) == 1);
+   ASSURE(uCount == 1);
+   ASSURE(SymTable_getLength(oSymTable) == 3);
+
+   /* Removing a binding cancels its deadline, and replacing one keeps
+      it. */
+   ASSURE(SymTable_remove(oSymTable, "b") == acValue);
+   ASSURE(SymTable_replace(oSymTable, "d", acOther) == acValue);
+   ASSURE(SymTable_expire(oSymTable, 114, NULL, NULL) == 0);
+   ASSURE(SymTable_contains(oSymTable, "d"));
+   ASSURE(SymTable_expire(oSymTable, 2000, NULL, NULL) == 1);
+   ASSURE(! SymTable_contains(oSymTable, "d"));
+   ASSURE(SymTable_get(oSymTable, "c") == acValue);
+
+   /* An expired binding can be bound again before it is removed. */
+   iSuccessful = SymTable_putWithTTL(oSymTable, "e", acValue, 2000, 1);
+   ASSURE(iSuccessful);
+   iSuccessful = SymTable_putWithTTL(oSymTable, "f", acValue, 2001, 1);
+   ASSURE(iSuccessful);
+   iSuccessful = SymTable_put(oSymTable, "e", acOther);
+   ASSURE(iSuccessful);
+   ASSURE(SymTable_get(oSymTable, "e") == acOther);
+   ASSURE(SymTable_expire(oSymTable, 3000, NULL, NULL) == 1);
+   ASSURE(SymTable_get(oSymTable, "e") == acOther);
+   ASSURE(SymTable_getLength(oSymTable) == 2);
+   ASSURE(SymTable_pushScope(oSymTable));
+   SymTable_free(oSymTable);
+
+   /* Deadlines from a few units to most of the range of uint64_t,
+      reached by steps of every size. */
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   for (i = 0; i < KEY_COUNT; i++)
+   {
+      uRandom = uRandom * 6364136223846793005U + 1442695040888963407U;
+      auDeadlines[i] = 1 + (uRandom >> 1) % (UINT64_C(1)
+         << (i % 62 + 1));
+      sprintf(acKey, "%d", i);
+      iSuccessful = SymTable_putWithTTL(oSymTable, acKey, acValue, 0,
+         auDeadlines[i]);
+      ASSURE(iSuccessful);
+   }
+   uNow = 0;
+   uExpected = 0;
+   for (iStep = 0; iStep < STEP_COUNT; iStep++)
+   {
+      uRandom = uRandom * 6364136223846793005U + 1442695040888963407U;
+      uNow += (uRandom >> 1) % (UINT64_C(1) << (iStep % 64 * 60 / 63));
+      uCount = 0;
+      for (i = 0; i < KEY_COUNT; i++)
+         if (auDeadlines[i] <= uNow)
+            uCount++;
+      ASSURE(SymTable_expire(oSymTable, uNow, NULL, NULL)
+         == uCount - uExpected);
+      uExpected = uCount;
+      ASSURE(SymTable_getLength(oSymTable) == KEY_COUNT - uCount);
+      for (i = 0; i < KEY_COUNT; i++)
+      {
+         sprintf(acKey, "%d", i);
+         ASSURE(SymTable_contains(oSymTable, acKey)
+            == (auDeadlines[i] > uNow));
+      }
+   }
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Store in acKeys the first iCount decimal numbers from iStart on
+   whose hash codes all fall in the first bucket of a new table, and
+   return the number after the last. The hash function is the one
+   symtablehash.c uses. */
+
+static int findCollisions(char acKeys[][12], int iCount, int iStart)
+{
+   enum {FIRST_BUCKETS = 509};
+
+   size_t uHash;
+   size_t u;
+   int i;
+
+   for (i = 0; i < iCount; iStart++)
+   {
+      sprintf(acKeys[i], "%d", iStart);
+      uHash = 0;
+      for (u = 0; acKeys[i][u] != '\0'; u++)
+         uHash = uHash * 65599 + (size_t)acKeys[i][u];
+      if (uHash % FIRST_BUCKETS == 0)
+         i++;
+   }
+   return iStart;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test that a chain of many colliding keys is indexed by a tree, and
+   stays correct as it is searched, shrunk, evicted from and rehashed. */
+
+static void testTreeify(void)
+{
+   enum {COLLIDE_COUNT = 200, FEW_COUNT = 5, PLAIN_COUNT = 600,
+      BOUND = 20};
+
+   static char acKeys[COLLIDE_COUNT + 1][12];
+   struct SymTable_Stats stats;
+   SymTable_T oSymTable;
+   SymTable_Handle oHandle;
+   char acKey[12];
+   char acValue[] = "value";
+   size_t uCount;
+   int iSuccessful;
+   int i;
+   int j;
+#ifdef SYMTABLE_STATS
+   unsigned long ulProbes;
+#endif
+
+   printf("------------------------------------------------------\n");
+   printf("Testing long chains.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   (void)findCollisions(acKeys, COLLIDE_COUNT + 1, 0);
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   for (i = 0; i < COLLIDE_COUNT; i++)
+   {
+      iSuccessful = SymTable_put(oSymTable, acKeys[i], acKeys[i]);
+      ASSURE(iSuccessful);
+      SymTable_getStats(oSymTable, &stats);
+      ASSURE(stats.uTreeBuckets == (i >= 8 ? 1 : 0));
+   }
+   SymTable_getStats(oSymTable, &stats);
+   ASSURE(stats.uBucketCount == 509);
+   ASSURE(stats.uMaxChain == COLLIDE_COUNT);
+   iSuccessful = SymTable_put(oSymTable, acKeys[0], acValue);
+   ASSURE(! iSuccessful);
+   for (i = 0; i < COLLIDE_COUNT; i++)
+      ASSURE(SymTable_get(oSymTable, acKeys[i]) == acKeys[i]);
+   ASSURE(! SymTable_contains(oSymTable, acKeys[COLLIDE_COUNT]));
+   ASSURE(SymTable_remove(oSymTable, acKeys[COLLIDE_COUNT]) == NULL);
+   ASSURE(SymTable_replace(oSymTable, acKeys[7], acValue) == acKeys[7]);
+   ASSURE(SymTable_replace(oSymTable, acKeys[7], acKeys[7]) == acValue);
+
+#ifdef SYMTABLE_STATS
+   /* The tree, not the chain, is searched. */
+   SymTable_getStats(oSymTable, &stats);
+   ulProbes = stats.ulLookupProbes;
+   ASSURE(SymTable_contains(oSymTable, acKeys[0]));
+   SymTable_getStats(oSymTable, &stats);
+   ASSURE(stats.ulLookupProbes - ulProbes <= 16);
+#endif
+
+   /* Removing keys from the front, back and middle of the chain keeps
+      every other key found, until the tree is dropped. */
+   for (i = 0; i < COLLIDE_COUNT - FEW_COUNT; i++)
+   {
+      j = (i % 3 == 0) ? i / 3 : COLLIDE_COUNT - 1 - i / 3 * 2 - i % 3;
+      ASSURE(SymTable_remove(oSymTable, acKeys[j]) == acKeys[j]);
+      ASSURE(! SymTable_contains(oSymTable, acKeys[j]));
+      acKeys[j][0] = '\0';
+      if (i % 10 == 0)
+         for (j = 0; j < COLLIDE_COUNT; j++)
+            if (acKeys[j][0] != '\0')
+               ASSURE(SymTable_get(oSymTable, acKeys[j]) == acKeys[j]);
+   }
+   SymTable_getStats(oSymTable, &stats);
+   ASSURE(stats.uTreeBuckets == 0);
+   ASSURE(SymTable_getLength(oSymTable) == FEW_COUNT);
+   for (j = 0; j < COLLIDE_COUNT; j++)
+      if (acKeys[j][0] != '\0')
+         ASSURE(SymTable_get(oSymTable, acKeys[j]) == acKeys[j]);
+   SymTable_free(oSymTable);
+
+   /* A handle removes its binding from the middle of a tree. */
+   (void)findCollisions(acKeys, COLLIDE_COUNT + 1, 0);
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   for (i = 0; i < COLLIDE_COUNT; i++)
+   {
+      iSuccessful = SymTable_put(oSymTable, acKeys[i], acKeys[i]);
+      ASSURE(iSuccessful);
+   }
+   for (i = 1; i < COLLIDE_COUNT; i += 2)
+   {
+      oHandle = SymTable_find(oSymTable, acKeys[i]);
+      ASSURE(oHandle != NULL);
+      ASSURE(SymTable_handleRemove(oSymTable, oHandle) == acKeys[i]);
+   }
+   for (i = 0; i < COLLIDE_COUNT; i++)
+      ASSURE(SymTable_contains(oSymTable, acKeys[i]) == (i % 2 == 0));
+
+   /* Growing the buckets scatters the chain. Every chain still
+      longer than 8 has a tree, and none shorter than 6 does. */
+   for (i = 0; i < PLAIN_COUNT; i++)
+   {
+      sprintf(acKey, "x%d", i);
+      iSuccessful = SymTable_put(oSymTable, acKey, acValue);
+      ASSURE(iSuccessful);
+   }
+   SymTable_getStats(oSymTable, &stats);
+   ASSURE(stats.uBucketCount > 509);
+   uCount = 0;
+   for (i = 9; i < SYMTABLE_CHAIN_HISTOGRAM_SIZE; i++)
+      uCount += stats.auChainLengths[i];
+   ASSURE(stats.uTreeBuckets >= uCount);
+   for (i = 6; i < 9; i++)
+      uCount += stats.auChainLengths[i];
+   ASSURE(stats.uTreeBuckets <= uCount);
+   for (i = 0; i < COLLIDE_COUNT; i++)
+      ASSURE(SymTable_contains(oSymTable, acKeys[i]) == (i % 2 == 0));
+   for (i = 0; i < PLAIN_COUNT; i++)
+   {
+      sprintf(acKey, "x%d", i);
+      ASSURE(SymTable_get(oSymTable, acKey) == acValue);
+   }
+   SymTable_free(oSymTable);
+
+   /* Eviction from a tree keeps it consistent with its chain. */
+   oSymTable = SymTable_newBounded(BOUND, NULL, NULL);
+   ASSURE(oSymTable != NULL);
+   for (i = 0; i < COLLIDE_COUNT; i++)
+   {
+      iSuccessful = SymTable_put(oSymTable, acKeys[i], acKeys[i]);
+      ASSURE(iSuccessful);
+      if (i % 3 == 0)
+         (void)SymTable_contains(oSymTable, acKeys[i / 2]);
+   }
+   ASSURE(SymTable_getLength(oSymTable) == BOUND);
+   uCount = 0;
+   for (i = 0; i < COLLIDE_COUNT; i++)
+      if (SymTable_get(oSymTable, acKeys[i]) == acKeys[i])
+         uCount++;
+   ASSURE(uCount == BOUND);
+   uCount = 0;
+   SymTable_map(oSymTable, countBinding, &uCount);
+   ASSURE(uCount == BOUND);
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTable_buildParallel() against a table built by
+   SymTable_put(), with keys given twice and at several thread
+   counts. */
+
+static void testBuildParallel(void)
+{
+   enum {KEY_COUNT = 20000, DISTINCT_COUNT = 15000, COLLIDE_COUNT = 100};
+
+   static const size_t auThreads[] = {0, 1, 2, 3, 8, 1000};
+   static char acKeys[KEY_COUNT][12];
+   static const char *apcKeys[KEY_COUNT];
+   static const void *apvValues[KEY_COUNT];
+   static int aiValues[KEY_COUNT];
+   struct SymTable_Stats stats;
+   struct SymTable_Stats expected;
+   SymTable_T oSymTable;
+   SymTable_T oExpected;
+   size_t u;
+   int iSuccessful;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing SymTable_buildParallel().\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   /* The last keys repeat the first ones with other values. */
+   for (i = 0; i < KEY_COUNT; i++)
+   {
+      sprintf(acKeys[i], "%d", i % DISTINCT_COUNT);
+      apcKeys[i] = acKeys[i];
+      apvValues[i] = &aiValues[i];
+   }
+   oExpected = SymTable_new();
+   ASSURE(oExpected != NULL);
+   iSuccessful = SymTable_reserve(oExpected, KEY_COUNT);
+   ASSURE(iSuccessful);
+   for (i = 0; i < KEY_COUNT; i++)
+      (void)SymTable_put(oExpected, apcKeys[i], apvValues[i]);
+   SymTable_getStats(oExpected, &expected);
+
+   for (u = 0; u < sizeof(auThreads) / sizeof(auThreads[0]); u++)
+   {
+      oSymTable = SymTable_buildParallel(apcKeys, apvValues, KEY_COUNT,
+         auThreads[u]);
+      ASSURE(oSymTable != NULL);
+      ASSURE(SymTable_getLength(oSymTable) == DISTINCT_COUNT);
+      ASSURE(SymTable_memoryUsage(oSymTable)
+         == SymTable_memoryUsage(oExpected));
+      SymTable_getStats(oSymTable, &stats);
+      ASSURE(stats.uBucketCount == expected.uBucketCount);
+      ASSURE(stats.uMaxChain == expected.uMaxChain);
+      for (i = 0; i < DISTINCT_COUNT; i++)
+         ASSURE(SymTable_get(oSymTable, apcKeys[i]) == &aiValues[i]);
+      ASSURE(! SymTable_contains(oSymTable, "Jeter"));
+
+      /* The table goes on like any other. */
+      iSuccessful = SymTable_put(oSymTable, "Jeter", &aiValues[0]);
+      ASSURE(iSuccessful);
+      ASSURE(SymTable_remove(oSymTable, apcKeys[0]) == &aiValues[0]);
+      ASSURE(SymTable_getLength(oSymTable) == DISTINCT_COUNT);
+      SymTable_free(oSymTable);
+   }
+   SymTable_free(oExpected);
+
+   oSymTable = SymTable_buildParallel(NULL, NULL, 0, 4);
+   ASSURE(oSymTable != NULL);
+   ASSURE(SymTable_getLength(oSymTable) == 0);
+   iSuccessful = SymTable_put(oSymTable, "Jeter", &aiValues[0]);
+   ASSURE(iSuccessful);
+   SymTable_free(oSymTable);
+
+   /* Keys that share a bucket get its tree, and their repeats, deep
+      in the chain, are skipped. */
+   (void)findCollisions(acKeys, COLLIDE_COUNT, 0);
+   for (i = 0; i < COLLIDE_COUNT; i++)
+      apcKeys[COLLIDE_COUNT + i] = acKeys[COLLIDE_COUNT - 1 - i];
+   oSymTable = SymTable_buildParallel(apcKeys, apvValues,
+      2 * COLLIDE_COUNT, 4);
+   ASSURE(oSymTable != NULL);
+   ASSURE(SymTable_getLength(oSymTable) == COLLIDE_COUNT);
+   SymTable_getStats(oSymTable, &stats);
+   ASSURE(stats.uTreeBuckets == 1);
+   ASSURE(stats.uMaxChain == COLLIDE_COUNT);
+   for (i = 0; i < COLLIDE_COUNT; i++)
+      ASSURE(SymTable_get(oSymTable, apcKeys[i]) == &aiValues[i]);
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTable_newHugePages() with a table large enough that its
+   bucket array gets a mapping of its own, comparing it with a table
+   from SymTable_new(), and with NUMA nodes that may not exist. */
+
+static void testHugePages(void)
+{
+   enum {KEY_COUNT = 300000, MAX_KEY_LENGTH = 12};
+
+   static const int aiNodes[] = {-1, 0, 4000};
+   SymTable_T oSymTable;
+   SymTable_T oExpected;
+   char acKey[MAX_KEY_LENGTH];
+   char acValue[] = "value";
+   size_t u;
+   int iSuccessful;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing SymTable_newHugePages().\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   for (u = 0; u < sizeof(aiNodes) / sizeof(aiNodes[0]); u++)
+   {
+      oSymTable = SymTable_newHugePages(aiNodes[u]);
+      ASSURE(oSymTable != NULL);
+      oExpected = SymTable_new();
+      ASSURE(oExpected != NULL);
+      for (i = 0; i < KEY_COUNT; i++)
+      {
+         sprintf(acKey, "%d", i);
+         iSuccessful = SymTable_put(oSymTable, acKey, acValue);
+         ASSURE(iSuccessful);
+         iSuccessful = SymTable_put(oExpected, acKey, acValue);
+         ASSURE(iSuccessful);
+      }
+      ASSURE(SymTable_memoryUsage(oSymTable)
+         == SymTable_memoryUsage(oExpected));
+
+      /* Blocks given back are handed out again. */
+      for (i = 0; i < KEY_COUNT; i += 2)
+      {
+         sprintf(acKey, "%d", i);
+         ASSURE(SymTable_remove(oSymTable, acKey) == acValue);
+      }
+      for (i = 0; i < KEY_COUNT; i += 4)
+      {
+         sprintf(acKey, "%d", i);
+         iSuccessful = SymTable_put(oSymTable, acKey, acKey);
+         ASSURE(iSuccessful);
+      }
+      for (i = 0; i < KEY_COUNT; i++)
+      {
+         sprintf(acKey, "%d", i);
+         if (i % 4 == 0)
+            ASSURE(SymTable_get(oSymTable, acKey) == acKey);
+         else
+            ASSURE(SymTable_contains(oSymTable, acKey) == (i % 2 == 1));
+      }
+      ASSURE(SymTable_getLength(oSymTable)
+         == KEY_COUNT / 2 + KEY_COUNT / 4);
+      SymTable_free(oExpected);
+      SymTable_free(oSymTable);
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* A value stored inline by the tables of testInline */
+struct Point{
+   int iX;
+   double dY;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Add the x coordinate of the struct Point pvValue to the int pointed
+   to by pvExtra. */
+
+static void sumPointX(const char *pcKey, void *pvValue, void *pvExtra)
+{
+   assert(pcKey != NULL);
+   assert(pvValue != NULL);
+   assert(pvExtra != NULL);
+
+   *(int*)pvExtra += ((struct Point*)pvValue)->iX;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTable_newInline(), SymTable_putValue(),
+   SymTable_getValuePtr(), SymTable_removeValue() and SymTable_add(). */
+
+static void testInline(void)
+{
+   enum {KEY_COUNT = 1000, WORD_COUNT = 100, MAX_KEY_LENGTH = 12};
+
+   SymTable_T oSymTable;
+   SymTable_T oOther;
+   SymTable_Handle oHandle;
+   struct Point point;
+   struct Point *pPoint;
+   char acKey[MAX_KEY_LENGTH];
+   long *plCount;
+   int iSum;
+   int iSuccessful;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing SymTable_newInline().\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oSymTable = SymTable_newInline(sizeof(struct Point));
+   ASSURE(oSymTable != NULL);
+   oOther = SymTable_new();
+   ASSURE(oOther != NULL);
+   for (i = 0; i < KEY_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      point.iX = i;
+      point.dY = i / 2.0;
+      iSuccessful = SymTable_putValue(oSymTable, acKey, &point);
+      ASSURE(iSuccessful);
+      iSuccessful = SymTable_put(oOther, acKey, NULL);
+      ASSURE(iSuccessful);
+   }
+
+   /* Each binding holds its own copy, inside the node. */
+   point.iX = -1;
+   for (i = 0; i < KEY_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      pPoint = (struct Point*)SymTable_getValuePtr(oSymTable, acKey);
+      ASSURE(pPoint != NULL && pPoint != &point);
+      ASSURE(pPoint->iX == i && pPoint->dY == i / 2.0);
+      ASSURE(SymTable_get(oSymTable, acKey) == pPoint);
+   }
+   ASSURE(SymTable_getValuePtr(oSymTable, "Jeter") == NULL);
+   ASSURE(SymTable_memoryUsage(oSymTable) - SymTable_memoryUsage(oOther)
+      == KEY_COUNT * sizeof(struct Point));
+   iSuccessful = SymTable_putValue(oSymTable, "0", &point);
+   ASSURE(! iSuccessful);
+
+   /* Values change in place, through their address; replace, which
+      could not return the old value, fails. */
+   pPoint = (struct Point*)SymTable_getValuePtr(oSymTable, "7");
+   pPoint->iX = 70;
+   ASSURE(((struct Point*)SymTable_get(oSymTable, "7"))->iX == 70);
+   ASSURE(SymTable_replace(oSymTable, "7", &point) == NULL);
+   ASSURE(pPoint->iX == 70);
+   ASSURE(SymTable_replace(oSymTable, "Jeter", &point) == NULL);
+   pPoint->iX = 7;
+   iSum = 0;
+   SymTable_map(oSymTable, sumPointX, &iSum);
+   ASSURE(iSum == KEY_COUNT * (KEY_COUNT - 1) / 2);
+
+   /* Remove fails too; removeValue copies the old value out. */
+   ASSURE(SymTable_remove(oSymTable, "7") == NULL);
+   ASSURE(SymTable_contains(oSymTable, "7"));
+   ASSURE(SymTable_getLength(oSymTable) == KEY_COUNT);
+   iSuccessful = SymTable_removeValue(oSymTable, "7", &point);
+   ASSURE(iSuccessful);
+   ASSURE(point.iX == 7 && point.dY == 3.5);
+   ASSURE(! SymTable_contains(oSymTable, "7"));
+   ASSURE(SymTable_getLength(oSymTable) == KEY_COUNT - 1);
+   iSuccessful = SymTable_removeValue(oSymTable, "7", &point);
+   ASSURE(! iSuccessful);
+   iSuccessful = SymTable_removeValue(oSymTable, "8", NULL);
+   ASSURE(iSuccessful);
+   ASSURE(SymTable_getLength(oSymTable) == KEY_COUNT - 2);
+
+   /* So do the handle calls of the same names. */
+   oHandle = SymTable_find(oSymTable, "9");
+   ASSURE(oHandle != NULL);
+   ASSURE(SymTable_handleReplace(oSymTable, oHandle, &point) == NULL);
+   ASSURE(SymTable_handleRemove(oSymTable, oHandle) == NULL);
+   ASSURE(((struct Point*)SymTable_handleValue(oSymTable, oHandle))->iX
+      == 9);
+   ASSURE(SymTable_getLength(oSymTable) == KEY_COUNT - 2);
+
+   /* Values cannot be shared with other tables. */
+   ASSURE(! SymTable_pushScope(oSymTable));
+   ASSURE(! SymTable_merge(oOther, oSymTable, SYMTABLE_KEEP_DEST));
+   ASSURE(! SymTable_merge(oSymTable, oOther, SYMTABLE_KEEP_DEST));
+   ASSURE(SymTable_intersect(oOther, oSymTable) == NULL);
+   ASSURE(SymTable_difference(oSymTable, oOther) == NULL);
+   SymTable_free(oOther);
+   SymTable_free(oSymTable);
+
+   /* Counting words binds each new one, then adds in place. */
+   oSymTable = SymTable_newInline(sizeof(long));
+   ASSURE(oSymTable != NULL);
+   for (i = 0; i < KEY_COUNT; i++)
+   {
+      sprintf(acKey, "w%d", i % WORD_COUNT);
+      iSuccessful = SymTable_add(oSymTable, acKey, 1);
+      ASSURE(iSuccessful);
+   }
+   ASSURE(SymTable_getLength(oSymTable) == WORD_COUNT);
+   for (i = 0; i < WORD_COUNT; i++)
+   {
+      sprintf(acKey, "w%d", i);
+      plCount = (long*)SymTable_getValuePtr(oSymTable, acKey);
+      ASSURE(plCount != NULL && *plCount == KEY_COUNT / WORD_COUNT);
+   }
+   iSuccessful = SymTable_add(oSymTable, "w0", -KEY_COUNT);
+   ASSURE(iSuccessful);
+   ASSURE(*(long*)SymTable_getValuePtr(oSymTable, "w0")
+      == KEY_COUNT / WORD_COUNT - KEY_COUNT);
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return uSize bytes from malloc, or NULL if the int pvContext points
+   to is nonzero. */
+
+static void *refusingAlloc(size_t uSize, void *pvContext)
+{
+   assert(pvContext != NULL);
+
+   if (*(int*)pvContext)
+      return NULL;
+   return malloc(uSize);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Free pvBlock, which refusingAlloc returned. uSize and pvContext are
+   unused. */
+
+static void refusingFree(void *pvBlock, size_t uSize, void *pvContext)
+{
+   (void)uSize;
+   (void)pvContext;
+
+   free(pvBlock);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTable_compact() and SymTable_compactStep() on churned tables,
+   including bindings with trees, deadlines and inline values. */
+
+static void testCompact(void)
+{
+   enum {KEY_COUNT = 3000, COLLIDE_COUNT = 20, STEP_BINDINGS = 100,
+      MAX_KEY_LENGTH = 12};
+
+   static int aiValues[KEY_COUNT];
+   static char acKeys[COLLIDE_COUNT][12];
+   static int iRefuse;
+   struct SymTable_Stats stats;
+   SymTable_T oSymTable;
+   SymTable_T oTwin;
+   char acKey[MAX_KEY_LENGTH];
+   char acValue[] = "value";
+   const SymTable_Allocator refusing = {refusingAlloc, refusingFree,
+      &iRefuse};
+   long *plCount;
+   size_t uCount;
+   size_t uBytes;
+   int iSuccessful;
+   int iSteps;
+   int iMore;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing SymTable_compact() and SymTable_compactStep().\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   /* The same churn is done to both tables, but only one is
+      compacted. */
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   oTwin = SymTable_new();
+   ASSURE(oTwin != NULL);
+   for (i = 0; i < KEY_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      iSuccessful = SymTable_put(oSymTable, acKey, &aiValues[i]);
+      ASSURE(iSuccessful);
+      iSuccessful = SymTable_put(oTwin, acKey, &aiValues[i]);
+      ASSURE(iSuccessful);
+   }
+   for (i = 0; i < KEY_COUNT; i += 3)
+   {
+      sprintf(acKey, "%d", i);
+      ASSURE(SymTable_remove(oSymTable, acKey) == &aiValues[i]);
+      ASSURE(SymTable_remove(oTwin, acKey) == &aiValues[i]);
+   }
+   iSuccessful = SymTable_compact(oSymTable);
+   ASSURE(iSuccessful);
+
+   /* Every binding is still there, and the table changes as any
+      other. */
+   for (i = 0; i < KEY_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      if (i % 3 == 0)
+         ASSURE(! SymTable_contains(oSymTable, acKey));
+      else
+         ASSURE(SymTable_get(oSymTable, acKey) == &aiValues[i]);
+   }
+   uCount = 0;
+   SymTable_map(oSymTable, countBinding, &uCount);
+   ASSURE(uCount == SymTable_getLength(oSymTable));
+   ASSURE(uCount == SymTable_getLength(oTwin));
+   for (i = 0; i < KEY_COUNT; i += 3)
+   {
+      sprintf(acKey, "%d", i);
+      iSuccessful = SymTable_put(oSymTable, acKey, &aiValues[i]);
+      ASSURE(iSuccessful);
+      iSuccessful = SymTable_put(oTwin, acKey, &aiValues[i]);
+      ASSURE(iSuccessful);
+   }
+   iSuccessful = SymTable_compact(oSymTable);
+   ASSURE(iSuccessful);
+   iSuccessful = SymTable_put(oSymTable, "0", acValue);
+   ASSURE(! iSuccessful);
+
+   /* The blocks are given back once all of their bindings are gone,
+      so the two tables end up the same size. */
+   for (i = 0; i < KEY_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      ASSURE(SymTable_remove(oSymTable, acKey) == &aiValues[i]);
+      ASSURE(SymTable_remove(oTwin, acKey) == &aiValues[i]);
+   }
+   ASSURE(SymTable_getLength(oSymTable) == 0);
+   ASSURE(SymTable_memoryUsage(oSymTable) == SymTable_memoryUsage(oTwin));
+   SymTable_free(oTwin);
+
+   /* An incremental pass takes many steps and loses nothing. */
+   for (i = 0; i < KEY_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      iSuccessful = SymTable_put(oSymTable, acKey, &aiValues[i]);
+      ASSURE(iSuccessful);
+   }
+   iSteps = 1;
+   while ((iMore = SymTable_compactStep(oSymTable, STEP_BINDINGS)) == 1)
+      iSteps++;
+   ASSURE(iMore == 0);
+   ASSURE(iSteps > KEY_COUNT / STEP_BINDINGS / 2);
+   ASSURE(iSteps <= KEY_COUNT / STEP_BINDINGS + 1);
+   for (i = 0; i < KEY_COUNT; i += 2)
+   {
+      sprintf(acKey, "%d", i);
+      ASSURE(SymTable_remove(oSymTable, acKey) == &aiValues[i]);
+   }
+   ASSURE(SymTable_compactStep(oSymTable, KEY_COUNT) == 0);
+   for (i = 1; i < KEY_COUNT; i += 2)
+   {
+      sprintf(acKey, "%d", i);
+      ASSURE(SymTable_get(oSymTable, acKey) == &aiValues[i]);
+   }
+
+   /* A scope that is open keeps its nodes where they are. */
+   ASSURE(SymTable_pushScope(oSymTable));
+   ASSURE(! SymTable_compact(oSymTable));
+   ASSURE(SymTable_compactStep(oSymTable, STEP_BINDINGS) == -1);
+   ASSURE(SymTable_popScope(oSymTable));
+   SymTable_free(oSymTable);
+
+   /* A step the allocator refuses says so, and moves nothing. */
+   iRefuse = 0;
+   oSymTable = SymTable_newWithAllocator(&refusing);
+   ASSURE(oSymTable != NULL);
+   for (i = 0; i < KEY_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      iSuccessful = SymTable_put(oSymTable, acKey, &aiValues[i]);
+      ASSURE(iSuccessful);
+   }
+   ASSURE(SymTable_compactStep(oSymTable, STEP_BINDINGS) == 1);
+   uBytes = SymTable_memoryUsage(oSymTable);
+   iRefuse = 1;
+   ASSURE(SymTable_compactStep(oSymTable, STEP_BINDINGS) == -1);
+   ASSURE(! SymTable_compact(oSymTable));
+   ASSURE(SymTable_memoryUsage(oSymTable) == uBytes);
+   iRefuse = 0;
+   do
+      iMore = SymTable_compactStep(oSymTable, STEP_BINDINGS);
+   while (iMore == 1);
+   ASSURE(iMore == 0);
+   for (i = 0; i < KEY_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      ASSURE(SymTable_get(oSymTable, acKey) == &aiValues[i]);
+   }
+   SymTable_free(oSymTable);
+
+   /* A tree is built again over the moved nodes, and a deadline
+      follows its binding. */
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   (void)findCollisions(acKeys, COLLIDE_COUNT, 0);
+   for (i = 0; i < COLLIDE_COUNT; i++)
+   {
+      iSuccessful = SymTable_put(oSymTable, acKeys[i], &aiValues[i]);
+      ASSURE(iSuccessful);
+   }
+   iSuccessful = SymTable_putWithTTL(oSymTable, "Jeter", acValue, 0, 10);
+   ASSURE(iSuccessful);
+   iSuccessful = SymTable_compact(oSymTable);
+   ASSURE(iSuccessful);
+   SymTable_getStats(oSymTable, &stats);
+   ASSURE(stats.uTreeBuckets == 1);
+   for (i = 0; i < COLLIDE_COUNT; i++)
+      ASSURE(SymTable_get(oSymTable, acKeys[i]) == &aiValues[i]);
+   ASSURE(SymTable_remove(oSymTable, acKeys[0]) == &aiValues[0]);
+   ASSURE(! SymTable_contains(oSymTable, acKeys[0]));
+   uCount = 0;
+   ASSURE(SymTable_expire(oSymTable, 10, countBinding, &uCount) == 1);
+   ASSURE(uCount == 1);
+   ASSURE(! SymTable_contains(oSymTable, "Jeter"));
+   SymTable_free(oSymTable);
+
+   /* Inline values move with their nodes. */
+   oSymTable = SymTable_newInline(sizeof(long));
+   ASSURE(oSymTable != NULL);
+   for (i = 0; i < KEY_COUNT; i++)
+   {
+      sprintf(acKey, "w%d", i % 10);
+      iSuccessful = SymTable_add(oSymTable, acKey, 1);
+      ASSURE(iSuccessful);
+   }
+   iSuccessful = SymTable_compact(oSymTable);
+   ASSURE(iSuccessful);
+   for (i = 0; i < 10; i++)
+   {
+      sprintf(acKey, "w%d", i);
+      plCount = (long*)SymTable_getValuePtr(oSymTable, acKey);
+      ASSURE(plCount != NULL && *plCount == KEY_COUNT / 10);
+      ASSURE(SymTable_get(oSymTable, acKey) == plCount);
+   }
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Count the binding pcKey, pvValue in the size_t pointed to by
+   pvExtra, and return 1 so that it is removed. */
+
+static int countAndRemove(const char *pcKey, void *pvValue, void *pvExtra)
+{
+   assert(pcKey != NULL);
+   assert(pvExtra != NULL);
+   (void)pvValue;
+
+   (*(size_t*)pvExtra)++;
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return 1 if the int at pvValue is even, or 0 otherwise. pcKey and
+   pvExtra are unused. */
+
+static int isEven(const char *pcKey, void *pvValue, void *pvExtra)
+{
+   assert(pcKey != NULL);
+   assert(pvValue != NULL);
+   (void)pvExtra;
+
+   return *(int*)pvValue % 2 == 0;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTable_removeIf() on the bindings only a hash table has:
+   scoped ones, expired ones, and those of buckets with trees. */
+
+static void testRemoveIf(void)
+{
+   enum {COLLIDE_COUNT = 20};
+
+   static int aiValues[COLLIDE_COUNT];
+   static char acKeys[COLLIDE_COUNT][12];
+   SymTable_T oSymTable;
+   char acOuter[] = "outer";
+   char acInner[] = "inner";
+   size_t uCount;
+   int iSuccessful;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing SymTable_removeIf() on a hash table.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   /* Removing an inner binding reveals the outer one, which the same
+      pass does not look at again. */
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   iSuccessful = SymTable_put(oSymTable, "x", acOuter);
+   ASSURE(iSuccessful);
+   iSuccessful = SymTable_put(oSymTable, "y", acOuter);
+   ASSURE(iSuccessful);
+   iSuccessful = SymTable_pushScope(oSymTable);
+   ASSURE(iSuccessful);
+   iSuccessful = SymTable_put(oSymTable, "x", acInner);
+   ASSURE(iSuccessful);
+   iSuccessful = SymTable_put(oSymTable, "z", acInner);
+   ASSURE(iSuccessful);
+   uCount = 0;
+   ASSURE(SymTable_removeIf(oSymTable, countAndRemove, &uCount, NULL)
+      == 3);
+   ASSURE(uCount == 3);
+   ASSURE(SymTable_getLength(oSymTable) == 1);
+   ASSURE(SymTable_get(oSymTable, "x") == acOuter);
+   ASSURE(! SymTable_contains(oSymTable, "y"));
+   ASSURE(! SymTable_contains(oSymTable, "z"));
+   iSuccessful = SymTable_popScope(oSymTable);
+   ASSURE(iSuccessful);
+   ASSURE(SymTable_get(oSymTable, "x") == acOuter);
+   SymTable_free(oSymTable);
+
+   /* An expired binding is left for SymTable_expire. */
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   iSuccessful = SymTable_putWithTTL(oSymTable, "a", acOuter, 100, 10);
+   ASSURE(iSuccessful);
+   iSuccessful = SymTable_put(oSymTable, "b", acOuter);
+   ASSURE(iSuccessful);
+   iSuccessful = SymTable_putWithTTL(oSymTable, "c", acOuter, 110, 5);
+   ASSURE(iSuccessful);
+   uCount = 0;
+   ASSURE(SymTable_removeIf(oSymTable, countAndRemove, &uCount, NULL)
+      == 2);
+   ASSURE(uCount == 2);
+   ASSURE(SymTable_getLength(oSymTable) == 1);
+   ASSURE(SymTable_expire(oSymTable, 110, NULL, NULL) == 1);
+   ASSURE(SymTable_getLength(oSymTable) == 0);
+   SymTable_free(oSymTable);
+
+   /* The keys of a bucket with a tree stay found. */
+   (void)findCollisions(acKeys, COLLIDE_COUNT, 0);
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   for (i = 0; i < COLLIDE_COUNT; i++)
+   {
+      aiValues[i] = i;
+      iSuccessful = SymTable_put(oSymTable, acKeys[i], &aiValues[i]);
+      ASSURE(iSuccessful);
+   }
+   ASSURE(SymTable_removeIf(oSymTable, isEven, NULL, NULL)
+      == COLLIDE_COUNT / 2);
+   for (i = 0; i < COLLIDE_COUNT; i++)
+   {
+      if (i % 2 == 0)
+         ASSURE(! SymTable_contains(oSymTable, acKeys[i]));
+      else
+         ASSURE(SymTable_get(oSymTable, acKeys[i]) == &aiValues[i]);
+   }
+   uCount = 0;
+   SymTable_map(oSymTable, countBinding, &uCount);
+   ASSURE(uCount == COLLIDE_COUNT / 2);
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Add the key lKey and the value *pdValue to the sums pointed to by
+   pvExtra. */
+
+static void sumLongBinding(long lKey, double *pdValue, void *pvExtra)
+{
+   double *pdSums = (double*)pvExtra;
+
+   assert(pdValue != NULL);
+   assert(pvExtra != NULL);
+
+   pdSums[0] += (double)lKey;
+   pdSums[1] += *pdValue;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test the tables generated by SYMTABLE_DEFINE. */
+
+static void testGenerated(void)
+{
+   enum {BINDING_COUNT = 5000, MAX_KEY_LENGTH = 10};
+
+   LongTable_T oLongTable;
+   StringTable_T oStringTable;
+   char acKey[MAX_KEY_LENGTH];
+   double adSums[2];
+   double dOldValue;
+   double *pdValue;
+   int iOldValue;
+   int iSuccessful;
+   long l;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing SYMTABLE_DEFINE().\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oLongTable = LongTable_new();
+   ASSURE(oLongTable != NULL);
+   ASSURE(LongTable_getLength(oLongTable) == 0);
+   ASSURE(LongTable_get(oLongTable, 0) == NULL);
+   ASSURE(! LongTable_remove(oLongTable, 0, NULL));
+
+   /* Enough bindings to resize, with negative keys too. */
+   for (l = -BINDING_COUNT / 2; l < BINDING_COUNT / 2; l++)
+   {
+      iSuccessful = LongTable_put(oLongTable, l, (double)l / 2);
+      ASSURE(iSuccessful);
+   }
+   ASSURE(LongTable_getLength(oLongTable) == BINDING_COUNT);
+   iSuccessful = LongTable_put(oLongTable, 7, 0.0);
+   ASSURE(! iSuccessful);
+
+   for (l = -BINDING_COUNT / 2; l < BINDING_COUNT / 2; l++)
+   {
+      pdValue = LongTable_get(oLongTable, l);
+      ASSURE(pdValue != NULL);
+      if (pdValue != NULL)
+         ASSURE(*pdValue == (double)l / 2);
+   }
+   ASSURE(! LongTable_contains(oLongTable, BINDING_COUNT));
+
+   /* The address from get is the stored value itself. */
+   pdValue = LongTable_get(oLongTable, 7);
+   ASSURE(pdValue != NULL);
+   if (pdValue != NULL)
+      *pdValue = 70.0;
+   dOldValue = -1.0;
+   ASSURE(LongTable_replace(oLongTable, 7, 700.0, &dOldValue));
+   ASSURE(dOldValue == 70.0);
+   ASSURE(! LongTable_replace(oLongTable, BINDING_COUNT, 1.0, NULL));
+
+   dOldValue = -1.0;
+   ASSURE(LongTable_remove(oLongTable, 7, &dOldValue));
+   ASSURE(dOldValue == 700.0);
+   ASSURE(! LongTable_contains(oLongTable, 7));
+   ASSURE(! LongTable_remove(oLongTable, 7, NULL));
+   ASSURE(LongTable_getLength(oLongTable) == BINDING_COUNT - 1);
+
+   /* The keys sum to -BINDING_COUNT / 2 once 7 is gone, and each
+      value is half of its key. */
+   adSums[0] = 0.0;
+   adSums[1] = 0.0;
+   LongTable_map(oLongTable, sumLongBinding, adSums);
+   ASSURE(adSums[0] == (double)(-BINDING_COUNT / 2 - 7));
+   ASSURE(adSums[1] == adSums[0] / 2);
+
+   LongTable_free(oLongTable);
+
+   /* String keys are compared by characters, not by address. */
+   oStringTable = StringTable_new();
+   ASSURE(oStringTable != NULL);
+   iSuccessful = StringTable_put(oStringTable, "Ruth", 3);
+   ASSURE(iSuccessful);
+   iSuccessful = StringTable_put(oStringTable, "Gehrig", 4);
+   ASSURE(iSuccessful);
+   iSuccessful = StringTable_put(oStringTable, "", 0);
+   ASSURE(iSuccessful);
+   strcpy(acKey, "Ruth");
+   ASSURE(StringTable_contains(oStringTable, acKey));
+   iSuccessful = StringTable_put(oStringTable, acKey, 5);
+   ASSURE(! iSuccessful);
+   ASSURE(*StringTable_get(oStringTable, "Gehrig") == 4);
+   ASSURE(StringTable_get(oStringTable, "Jeter") == NULL);
+   iOldValue = -1;
+   ASSURE(StringTable_remove(oStringTable, "", &iOldValue));
+   ASSURE(iOldValue == 0);
+   ASSURE(StringTable_getLength(oStringTable) == 2);
+   StringTable_free(oStringTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test the functions that only the hash table implementation of the
+   SymTable ADT provides. Write the output of the tests to stdout.
+   Return 0. */
+
+int main(void)
+{
+   testSnapshot();
+   testLog();
+   testFrozen();
+   testStats();
+   testSetOperations();
+   testScopes();
+   testBounded();
+   testTTL();
+   testTreeify();
+   testBuildParallel();
+   testHugePages();
+   testInline();
+   testCompact();
+   testRemoveIf();
+   testGenerated();
+
+   printf("------------------------------------------------------\n");
+   printf("End of testsymtableext.\n");
+   return 0;
+}
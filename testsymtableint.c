@@ -0,0 +1,331 @@
+/*--------------------------------------------------------------------*/
+/* testsymtableint.c                                                  */
+/* Author: Maxwell Lloyd                                              */
+/*--------------------------------------------------------------------*/
+
+#include "symtableint.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <assert.h>
+
+/*--------------------------------------------------------------------*/
+
+#define ASSURE(i) assure(i, __LINE__)
+
+/*--------------------------------------------------------------------*/
+
+/* If !iSuccessful, print a message to stdout indicating that the
+   test at line iLineNum failed. */
+
+static void assure(int iSuccessful, int iLineNum)
+{
+   if (! iSuccessful)
+   {
+      printf("Test at line %d failed.\n", iLineNum);
+      fflush(stdout);
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test the basic SymTableInt functions, with the keys at both ends of
+   the range of uint64_t. */
+
+static void testBasics(void)
+{
+   SymTableInt_T oSymTableInt;
+   char acJeter[] = "Jeter";
+   char acMantle[] = "Mantle";
+   char acGehrig[] = "Gehrig";
+   char acRuth[] = "Ruth";
+   char *pcValue;
+   int iSuccessful;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing the basic SymTableInt functions.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oSymTableInt = SymTableInt_new();
+   ASSURE(oSymTableInt != NULL);
+   ASSURE(SymTableInt_getLength(oSymTableInt) == 0);
+   ASSURE(! SymTableInt_contains(oSymTableInt, 0));
+   ASSURE(SymTableInt_get(oSymTableInt, 0) == NULL);
+   ASSURE(SymTableInt_remove(oSymTableInt, 0) == NULL);
+   ASSURE(SymTableInt_replace(oSymTableInt, 2, acRuth) == NULL);
+
+   iSuccessful = SymTableInt_put(oSymTableInt, 2, acJeter);
+   ASSURE(iSuccessful);
+   iSuccessful = SymTableInt_put(oSymTableInt, 7, acMantle);
+   ASSURE(iSuccessful);
+   iSuccessful = SymTableInt_put(oSymTableInt, 0, acGehrig);
+   ASSURE(iSuccessful);
+   iSuccessful = SymTableInt_put(oSymTableInt, UINT64_MAX, acRuth);
+   ASSURE(iSuccessful);
+   ASSURE(SymTableInt_getLength(oSymTableInt) == 4);
+
+   iSuccessful = SymTableInt_put(oSymTableInt, 0, acRuth);
+   ASSURE(! iSuccessful);
+   iSuccessful = SymTableInt_put(oSymTableInt, 7, acRuth);
+   ASSURE(! iSuccessful);
+   ASSURE(SymTableInt_getLength(oSymTableInt) == 4);
+
+   ASSURE(SymTableInt_contains(oSymTableInt, 0));
+   ASSURE(SymTableInt_contains(oSymTableInt, UINT64_MAX));
+   ASSURE(! SymTableInt_contains(oSymTableInt, 3));
+   pcValue = (char*)SymTableInt_get(oSymTableInt, 0);
+   ASSURE(pcValue == acGehrig);
+   pcValue = (char*)SymTableInt_get(oSymTableInt, 7);
+   ASSURE(pcValue == acMantle);
+
+   pcValue = (char*)SymTableInt_replace(oSymTableInt, 0, acJeter);
+   ASSURE(pcValue == acGehrig);
+   pcValue = (char*)SymTableInt_replace(oSymTableInt, UINT64_MAX,
+      acMantle);
+   ASSURE(pcValue == acRuth);
+   ASSURE(SymTableInt_get(oSymTableInt, UINT64_MAX) == acMantle);
+
+   pcValue = (char*)SymTableInt_remove(oSymTableInt, 0);
+   ASSURE(pcValue == acJeter);
+   ASSURE(! SymTableInt_contains(oSymTableInt, 0));
+   pcValue = (char*)SymTableInt_remove(oSymTableInt, 2);
+   ASSURE(pcValue == acJeter);
+   ASSURE(SymTableInt_remove(oSymTableInt, 2) == NULL);
+   ASSURE(SymTableInt_getLength(oSymTableInt) == 2);
+
+   /* A NULL value is bound like any other. */
+   iSuccessful = SymTableInt_put(oSymTableInt, 5, NULL);
+   ASSURE(iSuccessful);
+   ASSURE(SymTableInt_contains(oSymTableInt, 5));
+   ASSURE(SymTableInt_get(oSymTableInt, 5) == NULL);
+
+   SymTableInt_free(oSymTableInt);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* The values of the bindings in testMap() */
+static const char acDigits[] = "0123456789";
+
+/*--------------------------------------------------------------------*/
+
+/* Add the key uKey to the sum pointed to by pvExtra, after checking
+   that the value pvValue is the address of the key's last digit in
+   acDigits. */
+
+static void sumKey(uint64_t uKey, void *pvValue, void *pvExtra)
+{
+   assert(pvExtra != NULL);
+
+   ASSURE(pvValue == &acDigits[uKey % 10]);
+   *(uint64_t*)pvExtra += uKey;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTableInt_map(), including the key 0. */
+
+static void testMap(void)
+{
+   enum {BINDING_COUNT = 100};
+
+   SymTableInt_T oSymTableInt;
+   uint64_t uSum;
+   uint64_t u;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing SymTableInt_map().\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oSymTableInt = SymTableInt_new();
+   ASSURE(oSymTableInt != NULL);
+   for (u = 0; u < BINDING_COUNT; u++)
+      ASSURE(SymTableInt_put(oSymTableInt, u, &acDigits[u % 10]));
+
+   uSum = 0;
+   SymTableInt_map(oSymTableInt, sumKey, &uSum);
+   ASSURE(uSum == BINDING_COUNT * (BINDING_COUNT - 1) / 2);
+
+   SymTableInt_free(oSymTableInt);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return uSize bytes from the byte limit pointed to by pvContext, or
+   NULL if there are not that many left. */
+
+static void *limitAlloc(size_t uSize, void *pvContext)
+{
+   size_t *puLeft = (size_t*)pvContext;
+   void *pvBlock;
+
+   assert(puLeft != NULL);
+
+   if (uSize > *puLeft)
+      return NULL;
+   pvBlock = malloc(uSize);
+   if (pvBlock != NULL)
+      *puLeft -= uSize;
+   return pvBlock;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Give the uSize bytes at pvBlock back to the byte limit pointed to
+   by pvContext. */
+
+static void limitFree(void *pvBlock, size_t uSize, void *pvContext)
+{
+   size_t *puLeft = (size_t*)pvContext;
+
+   assert(puLeft != NULL);
+
+   *puLeft += uSize;
+   free(pvBlock);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTableInt_newWithAllocator() and SymTableInt_memoryUsage()
+   with an allocator that stops giving memory once the table has
+   grown a few times. */
+
+static void testAllocator(void)
+{
+   enum {LIMIT = 4096, BINDING_COUNT = 1000};
+
+   SymTableInt_T oSymTableInt;
+   SymTable_Allocator allocator;
+   size_t uLeft;
+   uint64_t u;
+   uint64_t uPut;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing SymTableInt_newWithAllocator() and\n");
+   printf("SymTableInt_memoryUsage().\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   allocator.pfAlloc = limitAlloc;
+   allocator.pfFree = limitFree;
+   allocator.pvContext = &uLeft;
+
+   uLeft = 0;
+   ASSURE(SymTableInt_newWithAllocator(&allocator) == NULL);
+
+   uLeft = LIMIT;
+   oSymTableInt = SymTableInt_newWithAllocator(&allocator);
+   ASSURE(oSymTableInt != NULL);
+   ASSURE(SymTableInt_memoryUsage(oSymTableInt) == LIMIT - uLeft);
+
+   /* Puts keep working after the slots stop growing, until only one
+      slot is left empty. */
+   uPut = 0;
+   for (u = 1; u <= BINDING_COUNT; u++)
+   {
+      if (SymTableInt_put(oSymTableInt, u * 1024, NULL))
+         uPut++;
+      ASSURE(SymTableInt_memoryUsage(oSymTableInt) == LIMIT - uLeft);
+   }
+   ASSURE(uPut > 0 && uPut < BINDING_COUNT);
+   ASSURE(SymTableInt_getLength(oSymTableInt) == uPut);
+   for (u = 1; u <= uPut; u++)
+      ASSURE(SymTableInt_contains(oSymTableInt, u * 1024));
+   ASSURE(! SymTableInt_contains(oSymTableInt, (uPut + 1) * 1024));
+
+   SymTableInt_free(oSymTableInt);
+   ASSURE(uLeft == LIMIT);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test a SymTableInt object of iBindingCount bindings, removing every
+   other key to exercise the shifting of the keys that follow them. */
+
+static void testLargeTable(int iBindingCount)
+{
+   SymTableInt_T oSymTableInt;
+   int iSuccessful;
+   int i;
+   clock_t iInitialClock;
+   clock_t iFinalClock;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing a potentially large SymTableInt object.\n");
+   printf("No output except CPU time consumed should appear here:\n");
+   fflush(stdout);
+
+   iInitialClock = clock();
+
+   oSymTableInt = SymTableInt_new();
+   ASSURE(oSymTableInt != NULL);
+
+   /* Multiples of a power of 2 would all share a bucket under a
+      modulo hash. */
+   for (i = 1; i <= iBindingCount; i++)
+   {
+      iSuccessful = SymTableInt_put(oSymTableInt, (uint64_t)i << 20,
+         NULL);
+      ASSURE(iSuccessful);
+   }
+   ASSURE(SymTableInt_getLength(oSymTableInt) == (size_t)iBindingCount);
+
+   for (i = 1; i <= iBindingCount; i += 2)
+      SymTableInt_remove(oSymTableInt, (uint64_t)i << 20);
+   for (i = 1; i <= iBindingCount; i++)
+      ASSURE(SymTableInt_contains(oSymTableInt, (uint64_t)i << 20)
+         == (i % 2 == 0));
+   ASSURE(SymTableInt_getLength(oSymTableInt)
+      == (size_t)(iBindingCount / 2));
+
+   for (i = 2; i <= iBindingCount; i += 2)
+      SymTableInt_remove(oSymTableInt, (uint64_t)i << 20);
+   ASSURE(SymTableInt_getLength(oSymTableInt) == 0);
+
+   SymTableInt_free(oSymTableInt);
+
+   iFinalClock = clock();
+   printf("CPU time (%d bindings):  %f seconds\n", iBindingCount,
+      ((double)(iFinalClock - iInitialClock)) / CLOCKS_PER_SEC);
+   fflush(stdout);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test the SymTableInt ADT.  Write the output of the tests to stdout.
+   argv[1] is the number of bindings to put into a potentially large
+   SymTableInt object.  Exit with EXIT_FAILURE if argv[1] is missing,
+   not numeric or negative.  Otherwise return 0. */
+
+int main(int argc, char *argv[])
+{
+   int iBindingCount;
+
+   if (argc != 2)
+   {
+      fprintf(stderr, "Usage: %s bindingcount\n", argv[0]);
+      exit(EXIT_FAILURE);
+   }
+
+   if (sscanf(argv[1], "%d", &iBindingCount) != 1)
+   {
+      fprintf(stderr, "bindingcount must be numeric\n");
+      exit(EXIT_FAILURE);
+   }
+   if (iBindingCount < 0)
+   {
+      fprintf(stderr, "bindingcount cannot be negative\n");
+      exit(EXIT_FAILURE);
+   }
+
+   testBasics();
+   testMap();
+   testAllocator();
+   testLargeTable(iBindingCount);
+
+   printf("------------------------------------------------------\n");
+   printf("End of %s.\n", argv[0]);
+   return 0;
+}